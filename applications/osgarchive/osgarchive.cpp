@@ -17,10 +17,48 @@
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
 #include <osgDB/FileUtils>
+#include <osgDB/Registry>
+
+#include <OpenThreads/Thread>
 
 #include <iostream>
 #include <algorithm>
 
+// reads randomly chosen files from an archive, as DatabasePager threads paging a database from the archive would.
+class ReadThread : public OpenThreads::Thread
+{
+public:
+
+    ReadThread(osgDB::Archive* archive, const osgDB::Archive::FileNameList& fileNames, unsigned int numReads, unsigned int seed):
+        _archive(archive),
+        _fileNames(fileNames),
+        _numReads(numReads),
+        _seed(seed),
+        _numFailed(0) {}
+
+    virtual void run()
+    {
+        for(unsigned int i=0; i<_numReads; ++i)
+        {
+            // a linear congruential generator, as rand() isn't thread safe.
+            _seed = _seed*1664525u + 1013904223u;
+            const std::string& fileName = _fileNames[(_seed>>8) % _fileNames.size()];
+
+            if (!_archive->readObject(fileName).validObject()) ++_numFailed;
+        }
+    }
+
+    unsigned int getNumFailed() const { return _numFailed; }
+
+protected:
+
+    osgDB::Archive*                         _archive;
+    const osgDB::Archive::FileNameList&     _fileNames;
+    unsigned int                            _numReads;
+    unsigned int                            _seed;
+    unsigned int                            _numFailed;
+};
+
 
 int main( int argc, char **argv )
 {
@@ -31,6 +69,9 @@ int main( int argc, char **argv )
     arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
     arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" is an application for collecting a set of separate files into a single archive file that can be later read in OSG applications..");
     arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options] filename ...");
+    arguments.getApplicationUsage()->addCommandLineOption("--benchmark <numThreads>","Time reading randomly chosen files, those listed or else all the files of the archive, from numThreads threads at once.");
+    arguments.getApplicationUsage()->addCommandLineOption("--reads <num>","Number of files read by each thread of the benchmark (default 1000).");
+    arguments.getApplicationUsage()->addCommandLineOption("-O <option>","Option string passed to the archive plugin, e.g. -O MemoryMapped to read the archive concurrently from a memory mapping.");
 
     // if user request help write it out to cout.
     if (arguments.read("-h") || arguments.read("--help"))
@@ -62,6 +103,24 @@ int main( int argc, char **argv )
         list = true;
     }
 
+    unsigned int benchmarkNumThreads = 0;
+    while (arguments.read("--benchmark",benchmarkNumThreads))
+    {
+    }
+
+    unsigned int benchmarkNumReads = 1000;
+    while (arguments.read("--reads",benchmarkNumReads))
+    {
+    }
+
+    std::string str;
+    while (arguments.read("-O",str))
+    {
+        osgDB::ReaderWriter::Options* options = new osgDB::ReaderWriter::Options;
+        options->setOptionString(str);
+        osgDB::Registry::instance()->setOptions(options);
+    }
+
     typedef std::vector<std::string> FileNameList;
     FileNameList files;
     for(int pos=1;pos<arguments.argc();++pos)
@@ -110,9 +169,9 @@ int main( int argc, char **argv )
         return 1;
     }
 
-    if (!insert && !extract && !list)
+    if (!insert && !extract && !list && benchmarkNumThreads==0)
     {
-        std::cout<<"Please specify an operation on the archive, either --insert, --extract or --list"<<std::endl;
+        std::cout<<"Please specify an operation on the archive, either --insert, --extract, --list or --benchmark"<<std::endl;
         return 1;
     }
 
@@ -174,6 +233,45 @@ int main( int argc, char **argv )
         }
     }
 
+    if (benchmarkNumThreads>0 && !insert && archive.valid())
+    {
+        osgDB::Archive::FileNameList fileNames(files.begin(), files.end());
+        if (fileNames.empty()) archive->getFileNames(fileNames);
+
+        if (fileNames.empty())
+        {
+            std::cout<<"No files to read from the archive"<<std::endl;
+            return 1;
+        }
+
+        typedef std::vector<ReadThread*> ReadThreads;
+        ReadThreads threads;
+        for(unsigned int i=0; i<benchmarkNumThreads; ++i)
+        {
+            threads.push_back(new ReadThread(archive.get(), fileNames, benchmarkNumReads, i+1));
+        }
+
+        osg::Timer_t start = osg::Timer::instance()->tick();
+
+        for(ReadThreads::iterator itr=threads.begin(); itr!=threads.end(); ++itr)
+        {
+            (*itr)->startThread();
+        }
+
+        unsigned int numFailed = 0;
+        for(ReadThreads::iterator itr=threads.begin(); itr!=threads.end(); ++itr)
+        {
+            (*itr)->join();
+            numFailed += (*itr)->getNumFailed();
+            delete *itr;
+        }
+
+        double time = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+        unsigned int numReads = benchmarkNumThreads*benchmarkNumReads;
+        std::cout<<"Read "<<numReads<<" files chosen from "<<fileNames.size()<<" with "<<benchmarkNumThreads<<" threads in "<<time<<"s, "
+                 <<double(numReads)/time<<" files/s, "<<numFailed<<" failed"<<std::endl;
+    }
+
     if (list && archive.valid())
     {
         std::cout<<"List of files in archive:"<<std::endl;
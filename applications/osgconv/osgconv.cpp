@@ -517,6 +517,8 @@ static void usage( const char *prog, const char *msg )
                               "                         (--addMissingColours also accepted)."<< std::endl;
     osg::notify(osg::NOTICE)<<"    --overallNormal    - Replace normals with a single overall normal."<< std::endl;
     osg::notify(osg::NOTICE)<<"    --enable-object-cache - Enable caching of objects, images, etc."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --optimizer-threads <n> - Number of threads the optimizer uses for per\n"
+                              "                         geometry work, 0 uses one thread per processor."<< std::endl;
 
     osg::notify( osg::NOTICE ) << std::endl;
     osg::notify( osg::NOTICE ) <<
@@ -747,6 +749,9 @@ int main( int argc, char **argv )
     bool enableObjectCache = false;
     while(arguments.read("--enable-object-cache")) { enableObjectCache = true; }
 
+    unsigned int optimizerThreads = 1;
+    while(arguments.read("--optimizer-threads", optimizerThreads)) {}
+
     // any option left unread are converted into errors to write out later.
     arguments.reportRemainingOptionsAsUnrecognized();
 
@@ -818,6 +823,7 @@ int main( int argc, char **argv )
 
         // optimize the scene graph, remove redundant nodes and state etc.
         osgUtil::Optimizer optimizer;
+        optimizer.setNumThreads(optimizerThreads);
         optimizer.optimize(root.get());
 
         if( do_convert )
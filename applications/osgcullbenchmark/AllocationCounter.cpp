@@ -0,0 +1,62 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This application is open source and may be redistributed and/or modified
+ * freely and without restriction, both in commercial and non commercial applications,
+ * as long as this copyright notice is maintained.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*/
+
+#include "AllocationCounter.h"
+
+#include <OpenThreads/Atomic>
+
+#include <new>
+#include <stdlib.h>
+
+static OpenThreads::Atomic s_numAllocations;
+
+unsigned int getNumAllocations()
+{
+    return s_numAllocations;
+}
+
+void* operator new(size_t size)
+{
+    ++s_numAllocations;
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    ++s_numAllocations;
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) throw()
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr) throw()
+{
+    free(ptr);
+}
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* ptr, size_t) throw()
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) throw()
+{
+    free(ptr);
+}
+#endif
@@ -0,0 +1,1026 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This application is open source and may be redistributed and/or modified
+ * freely and without restriction, both in commercial and non commercial applications,
+ * as long as this copyright notice is maintained.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osg/Timer>
+#include <osg/Camera>
+#include <osg/Geode>
+#include <osg/MatrixTransform>
+#include <osg/Material>
+#include <osg/Polytope>
+#include <osg/ShapeDrawable>
+#include <osg/FrameStamp>
+#include <osg/RenderInfo>
+#include <osg/State>
+#include <osg/io_utils>
+
+#include <osgDB/ReadFile>
+
+#include <osgUtil/UpdateVisitor>
+#include <osgUtil/CullVisitor>
+#include <osgUtil/CompiledCullGroup>
+#include <osgUtil/StateGraph>
+#include <osgUtil/RenderStage>
+#include <osgUtil/Statistics>
+
+#include "AllocationCounter.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+
+/** Spins a MatrixTransform about its local z axis, giving the update traversal some work to do.*/
+class SpinCallback : public osg::NodeCallback
+{
+public:
+
+    SpinCallback(const osg::Vec3d& position):
+        _position(position) {}
+
+    virtual void operator()(osg::Node* node, osg::NodeVisitor* nv)
+    {
+        osg::MatrixTransform* transform = static_cast<osg::MatrixTransform*>(node);
+        double angle = nv->getFrameStamp() ? nv->getFrameStamp()->getSimulationTime() : 0.0;
+        transform->setMatrix(osg::Matrixd::rotate(angle, osg::Vec3d(0.0,0.0,1.0)) * osg::Matrixd::translate(_position));
+
+        traverse(node, nv);
+    }
+
+protected:
+
+    osg::Vec3d _position;
+};
+
+/** Builds a scene of numDrawables boxes laid out in a plane, beneath a tree of MatrixTransforms
+  * transformDepth levels deep and sharing numStateSets different StateSets. A flat scene instead has a Geode
+  * per box directly beneath the root, each with its own box built in place, and a city scene is a flat scene
+  * of tall boxes of random heights, in which most of the boxes are hidden from a street level view.*/
+class SceneGenerator
+{
+public:
+
+    SceneGenerator(unsigned int numDrawables, unsigned int transformDepth, unsigned int numStateSets, bool animate, bool flat, bool city):
+        _numDrawables(numDrawables),
+        _transformDepth(transformDepth),
+        _animate(animate),
+        _flat(flat),
+        _city(city)
+    {
+        _geometry = new osg::ShapeDrawable(new osg::Box(osg::Vec3(0.0f,0.0f,0.0f), 1.0f));
+
+        for(unsigned int i=0; i<numStateSets; ++i)
+        {
+            osg::ref_ptr<osg::StateSet> stateset = new osg::StateSet;
+            osg::ref_ptr<osg::Material> material = new osg::Material;
+            float hue = float(i)/float(numStateSets);
+            material->setDiffuse(osg::Material::FRONT_AND_BACK, osg::Vec4(hue, 1.0f-hue, 0.5f, 1.0f));
+            stateset->setAttribute(material.get());
+            _stateSets.push_back(stateset);
+        }
+
+        _branching = 1;
+        if (transformDepth>0)
+        {
+            _branching = static_cast<unsigned int>(ceil(pow(double(numDrawables), 1.0/double(transformDepth))));
+            if (_branching<2) _branching = 2;
+        }
+    }
+
+    osg::Node* create()
+    {
+        osg::ref_ptr<osg::Group> root = new osg::Group;
+        if (_city) buildCity(root.get());
+        else if (_flat) buildFlat(root.get());
+        else build(root.get(), 0, 0, _numDrawables, osg::Vec3d());
+        return root.release();
+    }
+
+protected:
+
+    /** Position of the drawable in a plane, following a z-order curve so that each subtree covers a compact area.*/
+    osg::Vec3d position(unsigned int index) const
+    {
+        unsigned int x = 0, y = 0;
+        for(unsigned int bit=0; bit<16; ++bit)
+        {
+            x |= ((index >> (2*bit)) & 1) << bit;
+            y |= ((index >> (2*bit+1)) & 1) << bit;
+        }
+        return osg::Vec3d(double(x)*2.0, double(y)*2.0, 0.0);
+    }
+
+    osg::Vec3d center(unsigned int begin, unsigned int end) const
+    {
+        osg::BoundingBoxd bb;
+        for(unsigned int i=begin; i<end; ++i) bb.expandBy(position(i));
+        return bb.center();
+    }
+
+    void buildFlat(osg::Group* parent)
+    {
+        for(unsigned int i=0; i<_numDrawables; ++i)
+        {
+            osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+            geode->addDrawable(new osg::ShapeDrawable(new osg::Box(osg::Vec3(position(i)), 1.0f)));
+            if (!_stateSets.empty()) geode->setStateSet(_stateSets[i%_stateSets.size()].get());
+            parent->addChild(geode.get());
+        }
+    }
+
+    void buildCity(osg::Group* parent)
+    {
+        srand(1);
+        for(unsigned int i=0; i<_numDrawables; ++i)
+        {
+            float height = 4.0f + 16.0f*float(rand())/float(RAND_MAX);
+            osg::Vec3 center = osg::Vec3(position(i)) + osg::Vec3(0.0f, 0.0f, height*0.5f);
+
+            osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+            geode->addDrawable(new osg::ShapeDrawable(new osg::Box(center, 1.6f, 1.6f, height)));
+            if (!_stateSets.empty()) geode->setStateSet(_stateSets[i%_stateSets.size()].get());
+            parent->addChild(geode.get());
+        }
+    }
+
+    void build(osg::Group* parent, unsigned int level, unsigned int begin, unsigned int end, const osg::Vec3d& origin)
+    {
+        if (level>=_transformDepth)
+        {
+            for(unsigned int i=begin; i<end; ++i)
+            {
+                osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+                geode->addDrawable(_geometry.get());
+                if (!_stateSets.empty()) geode->setStateSet(_stateSets[i%_stateSets.size()].get());
+
+                osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform;
+                osg::Vec3d local = position(i)-origin;
+                transform->setMatrix(osg::Matrixd::translate(local));
+                if (_animate) transform->setUpdateCallback(new SpinCallback(local));
+                transform->addChild(geode.get());
+
+                parent->addChild(transform.get());
+            }
+            return;
+        }
+
+        unsigned int chunk = (end-begin+_branching-1)/_branching;
+        for(unsigned int first=begin; first<end; first+=chunk)
+        {
+            unsigned int last = osg::minimum(first+chunk, end);
+            osg::Vec3d childOrigin = center(first, last);
+
+            osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform;
+            transform->setMatrix(osg::Matrixd::translate(childOrigin-origin));
+            parent->addChild(transform.get());
+
+            build(transform.get(), level+1, first, last, childOrigin);
+        }
+    }
+
+    unsigned int                                _numDrawables;
+    unsigned int                                _transformDepth;
+    unsigned int                                _branching;
+    bool                                        _animate;
+    bool                                        _flat;
+    bool                                        _city;
+    osg::ref_ptr<osg::Drawable>                 _geometry;
+    std::vector< osg::ref_ptr<osg::StateSet> >  _stateSets;
+};
+
+
+/** Runs the update and cull traversals of a camera the way osgUtil::SceneView does, without a graphics context,
+  * timing each phase separately.*/
+class CullBenchmark
+{
+public:
+
+    enum Phase
+    {
+        UPDATE,
+        CULL,
+        SORT,
+        PRUNE,
+        NUM_PHASES
+    };
+
+    struct FrameResult
+    {
+        double          time[NUM_PHASES];
+        unsigned int    allocations[NUM_PHASES];
+    };
+
+    CullBenchmark(osg::Camera* camera, osg::StateSet* globalStateSet):
+        _camera(camera),
+        _globalStateSet(globalStateSet)
+    {
+        _frameStamp = new osg::FrameStamp;
+
+        _updateVisitor = new osgUtil::UpdateVisitor;
+        _cullVisitor = osgUtil::CullVisitor::create();
+        _stateGraph = new osgUtil::StateGraph;
+        _renderStage = new osgUtil::RenderStage;
+        _projection = new osg::RefMatrix;
+        _modelview = new osg::RefMatrix;
+
+        // the State is only used to identify the context, no graphics calls are made.
+        _renderInfo.setState(new osg::State);
+    }
+
+    FrameResult frame(unsigned int frameNumber, double simulationTime)
+    {
+        FrameResult result;
+        osg::Timer* timer = osg::Timer::instance();
+
+        _frameStamp->setFrameNumber(frameNumber);
+        _frameStamp->setReferenceTime(simulationTime);
+        _frameStamp->setSimulationTime(simulationTime);
+
+        // update
+        osg::Timer_t start = timer->tick();
+        unsigned int allocations = getNumAllocations();
+
+        _updateVisitor->reset();
+        _updateVisitor->setFrameStamp(_frameStamp.get());
+        _updateVisitor->setTraversalNumber(frameNumber);
+        _camera->accept(*_updateVisitor);
+        _camera->getBound();
+
+        endPhase(result, UPDATE, start, allocations);
+
+        // cull traversal, which also builds the StateGraph and fills the RenderBins
+        // the matrices are only referenced by the previous frame's RenderLeaves so can be reused.
+        _projection->set(_camera->getProjectionMatrix());
+        _modelview->set(_camera->getViewMatrix());
+
+        _cullVisitor->reset();
+        _cullVisitor->setFrameStamp(_frameStamp.get());
+        _cullVisitor->setTraversalNumber(frameNumber);
+        _cullVisitor->inheritCullSettings(*_camera);
+        _cullVisitor->setStateGraph(_stateGraph.get());
+        _cullVisitor->setRenderStage(_renderStage.get());
+        _cullVisitor->setRenderInfo(_renderInfo);
+
+        _renderStage->reset();
+        _stateGraph->clean();
+
+        _renderStage->setInitialViewMatrix(_modelview.get());
+        _renderStage->setViewport(_camera->getViewport());
+        _renderStage->setClearMask(_camera->getClearMask());
+        _renderStage->setCamera(_camera.get());
+
+        _cullVisitor->pushStateSet(_globalStateSet.get());
+        _cullVisitor->pushViewport(_camera->getViewport());
+        _cullVisitor->pushProjectionMatrix(_projection.get());
+        _cullVisitor->pushModelViewMatrix(_modelview.get(), osg::Transform::ABSOLUTE_RF);
+
+        _cullVisitor->traverse(*_camera);
+
+        _cullVisitor->popModelViewMatrix();
+        _cullVisitor->popProjectionMatrix();
+        _cullVisitor->popViewport();
+        _cullVisitor->popStateSet();
+
+        endPhase(result, CULL, start, allocations);
+
+        // sort the RenderBins
+        _renderStage->sort();
+
+        endPhase(result, SORT, start, allocations);
+
+        // remove the StateGraphs that were not used this frame
+        _stateGraph->prune();
+
+        endPhase(result, PRUNE, start, allocations);
+
+        return result;
+    }
+
+    /** Compare the RenderBins, StateGraphs and RenderLeaves of the last frame with those of another CullBenchmark,
+      * writing the first difference found to out.*/
+    bool compare(const CullBenchmark& rhs, std::ostream& out) const
+    {
+        if (_cullVisitor->getCalculatedNearPlane()!=rhs._cullVisitor->getCalculatedNearPlane() ||
+            _cullVisitor->getCalculatedFarPlane()!=rhs._cullVisitor->getCalculatedFarPlane())
+        {
+            out<<"near/far planes differ, "<<_cullVisitor->getCalculatedNearPlane()<<" "<<_cullVisitor->getCalculatedFarPlane()
+               <<" vs "<<rhs._cullVisitor->getCalculatedNearPlane()<<" "<<rhs._cullVisitor->getCalculatedFarPlane()<<std::endl;
+            return false;
+        }
+        return compareRenderBins(_renderStage.get(), rhs._renderStage.get(), out);
+    }
+
+    const osgUtil::OcclusionBuffer* getOcclusionBuffer() const { return _cullVisitor->getOcclusionBuffer(); }
+
+    unsigned int getNumRenderLeaves() const { return countRenderLeaves(_renderStage.get()); }
+    unsigned int getNumRenderBins() const { return countRenderBins(_renderStage.get()); }
+    unsigned int getNumStateGraphs() const { return countStateGraphs(_stateGraph.get()); }
+
+    static const char* getPhaseName(unsigned int phase)
+    {
+        switch(phase)
+        {
+            case(UPDATE): return "update";
+            case(CULL): return "cull";
+            case(SORT): return "sort";
+            case(PRUNE): return "prune";
+            default: return "";
+        }
+    }
+
+protected:
+
+    void endPhase(FrameResult& result, Phase phase, osg::Timer_t& start, unsigned int& allocations)
+    {
+        osg::Timer_t end = osg::Timer::instance()->tick();
+        unsigned int endAllocations = getNumAllocations();
+
+        result.time[phase] = osg::Timer::instance()->delta_m(start, end);
+        result.allocations[phase] = endAllocations-allocations;
+
+        start = end;
+        allocations = endAllocations;
+    }
+
+    static bool compareRenderLeaves(const osgUtil::RenderLeaf* lhs, const osgUtil::RenderLeaf* rhs, std::ostream& out)
+    {
+        if (lhs->getDrawable()!=rhs->getDrawable() ||
+            lhs->_depth!=rhs->_depth ||
+            lhs->_traversalOrderNumber!=rhs->_traversalOrderNumber ||
+            (lhs->_modelview.valid()!=rhs->_modelview.valid()) ||
+            (lhs->_modelview.valid() && *lhs->_modelview!=*rhs->_modelview) ||
+            (lhs->_projection.valid()!=rhs->_projection.valid()) ||
+            (lhs->_projection.valid() && *lhs->_projection!=*rhs->_projection))
+        {
+            out<<"RenderLeaf differs, drawable "<<lhs->getDrawable()<<" vs "<<rhs->getDrawable()
+               <<", depth "<<lhs->_depth<<" vs "<<rhs->_depth
+               <<", traversal order "<<lhs->_traversalOrderNumber<<" vs "<<rhs->_traversalOrderNumber<<std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    static bool compareStateGraphs(const osgUtil::StateGraph* lhs, const osgUtil::StateGraph* rhs, std::ostream& out)
+    {
+        for(const osgUtil::StateGraph *l = lhs, *r = rhs; l || r; l = l->_parent, r = r->_parent)
+        {
+            if (!l || !r || l->getStateSet()!=r->getStateSet())
+            {
+                out<<"StateGraph StateSet paths differ"<<std::endl;
+                return false;
+            }
+        }
+
+        if (lhs->_leaves.size()!=rhs->_leaves.size())
+        {
+            out<<"StateGraph leaf counts differ, "<<lhs->_leaves.size()<<" vs "<<rhs->_leaves.size()<<std::endl;
+            return false;
+        }
+
+        for(unsigned int i=0; i<lhs->_leaves.size(); ++i)
+        {
+            if (!compareRenderLeaves(lhs->_leaves[i].get(), rhs->_leaves[i].get(), out)) return false;
+        }
+        return true;
+    }
+
+    static bool compareRenderBins(const osgUtil::RenderBin* lhs, const osgUtil::RenderBin* rhs, std::ostream& out)
+    {
+        if (lhs->getBinNum()!=rhs->getBinNum() ||
+            lhs->getSortMode()!=rhs->getSortMode() ||
+            lhs->getStateGraphList().size()!=rhs->getStateGraphList().size() ||
+            lhs->getRenderLeafList().size()!=rhs->getRenderLeafList().size() ||
+            lhs->getRenderBinList().size()!=rhs->getRenderBinList().size())
+        {
+            out<<"RenderBin "<<lhs->getBinNum()<<" differs, "
+               <<lhs->getStateGraphList().size()<<" vs "<<rhs->getStateGraphList().size()<<" StateGraphs, "
+               <<lhs->getRenderLeafList().size()<<" vs "<<rhs->getRenderLeafList().size()<<" RenderLeaves, "
+               <<lhs->getRenderBinList().size()<<" vs "<<rhs->getRenderBinList().size()<<" RenderBins"<<std::endl;
+            return false;
+        }
+
+        for(unsigned int i=0; i<lhs->getStateGraphList().size(); ++i)
+        {
+            if (!compareStateGraphs(lhs->getStateGraphList()[i], rhs->getStateGraphList()[i], out)) return false;
+        }
+
+        for(unsigned int i=0; i<lhs->getRenderLeafList().size(); ++i)
+        {
+            if (!compareRenderLeaves(lhs->getRenderLeafList()[i], rhs->getRenderLeafList()[i], out)) return false;
+        }
+
+        for(osgUtil::RenderBin::RenderBinList::const_iterator litr = lhs->getRenderBinList().begin(), ritr = rhs->getRenderBinList().begin();
+            litr != lhs->getRenderBinList().end();
+            ++litr, ++ritr)
+        {
+            if (!compareRenderBins(litr->second.get(), ritr->second.get(), out)) return false;
+        }
+        return true;
+    }
+
+    static unsigned int countRenderLeaves(const osgUtil::RenderBin* bin)
+    {
+        unsigned int count = bin->getRenderLeafList().size();
+        for(osgUtil::RenderBin::StateGraphList::const_iterator itr = bin->getStateGraphList().begin();
+            itr != bin->getStateGraphList().end();
+            ++itr)
+        {
+            count += (*itr)->_leaves.size();
+        }
+        for(osgUtil::RenderBin::RenderBinList::const_iterator itr = bin->getRenderBinList().begin();
+            itr != bin->getRenderBinList().end();
+            ++itr)
+        {
+            count += countRenderLeaves(itr->second.get());
+        }
+        return count;
+    }
+
+    static unsigned int countRenderBins(const osgUtil::RenderBin* bin)
+    {
+        unsigned int count = 1;
+        for(osgUtil::RenderBin::RenderBinList::const_iterator itr = bin->getRenderBinList().begin();
+            itr != bin->getRenderBinList().end();
+            ++itr)
+        {
+            count += countRenderBins(itr->second.get());
+        }
+        return count;
+    }
+
+    static unsigned int countStateGraphs(const osgUtil::StateGraph* stateGraph)
+    {
+        unsigned int count = 1;
+        for(osgUtil::StateGraph::ChildList::const_iterator itr = stateGraph->_children.begin();
+            itr != stateGraph->_children.end();
+            ++itr)
+        {
+            count += countStateGraphs(itr->second.get());
+        }
+        return count;
+    }
+
+    osg::ref_ptr<osg::Camera>               _camera;
+    osg::ref_ptr<osg::FrameStamp>           _frameStamp;
+    osg::ref_ptr<osgUtil::UpdateVisitor>    _updateVisitor;
+    osg::ref_ptr<osgUtil::CullVisitor>      _cullVisitor;
+    osg::ref_ptr<osgUtil::StateGraph>       _stateGraph;
+    osg::ref_ptr<osgUtil::RenderStage>      _renderStage;
+    osg::ref_ptr<osg::RefMatrix>            _projection;
+    osg::ref_ptr<osg::RefMatrix>            _modelview;
+    osg::ref_ptr<osg::StateSet>             _globalStateSet;
+    osg::RenderInfo                         _renderInfo;
+};
+
+
+/** Times testing random bounding spheres and boxes against the frustum of a camera, one at a time with
+  * osg::Polytope::contains() and in batches, checking that both give the same results.*/
+int runFrustumBenchmark(const osg::Camera& camera, const osg::BoundingSphere& sceneBound, unsigned int numBounds, unsigned int numPasses)
+{
+    osg::Polytope frustum;
+    frustum.setToUnitFrustum();
+    frustum.transformProvidingInverse(camera.getViewMatrix()*camera.getProjectionMatrix());
+
+    std::vector<osg::BoundingSphere> spheres(numBounds);
+    std::vector<osg::BoundingBox> boxes(numBounds);
+    srand(1);
+    for(unsigned int i=0; i<numBounds; ++i)
+    {
+        osg::Vec3 center = sceneBound.center() + osg::Vec3(float(rand())/float(RAND_MAX)-0.5f,
+                                                           float(rand())/float(RAND_MAX)-0.5f,
+                                                           float(rand())/float(RAND_MAX)-0.5f)*(sceneBound.radius()*2.0f);
+        float radius = sceneBound.radius()*0.01f*float(rand())/float(RAND_MAX);
+        spheres[i].set(center, radius);
+        boxes[i].set(center-osg::Vec3(radius, radius, radius), center+osg::Vec3(radius, radius, radius));
+    }
+
+    std::vector<char> serialContained(numBounds);
+    std::vector<osg::Polytope::ClippingMask> serialMasks(numBounds);
+    bool* batchContained = new bool[numBounds];
+    std::vector<osg::Polytope::ClippingMask> batchMasks(numBounds);
+
+    const char* names[2] = { "spheres", "boxes" };
+    unsigned int numMismatches = 0;
+
+    std::cout<<"Culling "<<numBounds<<" bounds against the frustum "<<numPasses<<" times"<<std::endl;
+    std::cout<<"bounds      serial ns   batched ns    speedup   contained"<<std::endl;
+    for(unsigned int type=0; type<2; ++type)
+    {
+        double serialTime = DBL_MAX;
+        double batchTime = DBL_MAX;
+        unsigned int numContained = 0;
+        for(unsigned int pass=0; pass<numPasses; ++pass)
+        {
+            osg::Timer_t startTick = osg::Timer::instance()->tick();
+            for(unsigned int i=0; i<numBounds; ++i)
+            {
+                serialContained[i] = (type==0) ? frustum.contains(spheres[i]) : frustum.contains(boxes[i]);
+                serialMasks[i] = frustum.getResultMask();
+            }
+            osg::Timer_t middleTick = osg::Timer::instance()->tick();
+            numContained = (type==0) ? frustum.contains(&spheres.front(), numBounds, batchContained, &batchMasks.front()) :
+                                       frustum.contains(&boxes.front(), numBounds, batchContained, &batchMasks.front());
+            osg::Timer_t endTick = osg::Timer::instance()->tick();
+
+            serialTime = osg::minimum(serialTime, osg::Timer::instance()->delta_n(startTick, middleTick));
+            batchTime = osg::minimum(batchTime, osg::Timer::instance()->delta_n(middleTick, endTick));
+        }
+
+        for(unsigned int i=0; i<numBounds; ++i)
+        {
+            if ((serialContained[i]!=0)!=batchContained[i] || serialMasks[i]!=batchMasks[i]) ++numMismatches;
+        }
+
+        std::cout.setf(std::ios::fixed);
+        std::cout.precision(2);
+        std::cout<<std::left;
+        std::cout.width(8);
+        std::cout<<names[type]<<std::right;
+        std::cout.width(13); std::cout<<serialTime/double(numBounds);
+        std::cout.width(13); std::cout<<batchTime/double(numBounds);
+        std::cout.width(11); std::cout<<serialTime/batchTime;
+        std::cout.width(12); std::cout<<numContained<<std::endl;
+    }
+
+    delete [] batchContained;
+
+    if (numMismatches>0)
+    {
+        std::cout<<numMismatches<<" bounds gave different results when culled in batches"<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+struct LessDepth
+{
+    bool operator() (const osgUtil::RenderLeaf* lhs, const osgUtil::RenderLeaf* rhs) const { return lhs->_depth<rhs->_depth; }
+};
+
+struct GreaterDepth
+{
+    bool operator() (const osgUtil::RenderLeaf* lhs, const osgUtil::RenderLeaf* rhs) const { return rhs->_depth<lhs->_depth; }
+};
+
+struct LessTraversalOrder
+{
+    bool operator() (const osgUtil::RenderLeaf* lhs, const osgUtil::RenderLeaf* rhs) const { return lhs->_traversalOrderNumber<rhs->_traversalOrderNumber; }
+};
+
+struct LessLeafDepth
+{
+    bool operator() (const osg::ref_ptr<osgUtil::RenderLeaf>& lhs, const osg::ref_ptr<osgUtil::RenderLeaf>& rhs) const { return lhs->_depth<rhs->_depth; }
+};
+
+struct LessMinimumDistance
+{
+    bool operator() (const osgUtil::StateGraph* lhs, const osgUtil::StateGraph* rhs) const { return lhs->_minimumDistance<rhs->_minimumDistance; }
+};
+
+/** Times the sorts of a RenderBin against std::sort of the same leaves, and StateGraph::find_or_insert() against
+  * a std::map lookup, checking that each sort gives the order of a stable sort with the original comparisons.*/
+int runSortBenchmark(unsigned int numLeaves, unsigned int numStateSets, unsigned int numPasses)
+{
+    numStateSets = osg::maximum(numStateSets, 1u);
+
+    osg::ref_ptr<osg::Drawable> drawable = new osg::ShapeDrawable(new osg::Box(osg::Vec3(0.0f,0.0f,0.0f), 1.0f));
+    osg::ref_ptr<osgUtil::StateGraph> root = new osgUtil::StateGraph;
+    std::vector< osg::ref_ptr<osg::StateSet> > statesets(numStateSets);
+    std::vector<osgUtil::StateGraph*> stateGraphs(numStateSets);
+    for(unsigned int i=0; i<numStateSets; ++i)
+    {
+        statesets[i] = new osg::StateSet;
+        stateGraphs[i] = root->find_or_insert(statesets[i].get());
+    }
+
+    // leaves are created in traversal order but spread over the StateGraphs, with repeated depths so that ties are sorted too.
+    srand(1);
+    std::vector<osgUtil::StateGraph::LeafList> leaves(numStateSets);
+    for(unsigned int i=0; i<numLeaves; ++i)
+    {
+        float depth = float(rand()%(numLeaves/4+1)) - float(numLeaves/8);
+        leaves[rand()%numStateSets].push_back(new osgUtil::RenderLeaf(drawable.get(), 0, 0, depth, i));
+    }
+
+    osg::ref_ptr<osgUtil::RenderBin> bin = new osgUtil::RenderBin;
+
+    const osgUtil::RenderBin::SortMode modes[4] = { osgUtil::RenderBin::SORT_FRONT_TO_BACK, osgUtil::RenderBin::SORT_BACK_TO_FRONT,
+                                                    osgUtil::RenderBin::TRAVERSAL_ORDER, osgUtil::RenderBin::SORT_BY_STATE_THEN_FRONT_TO_BACK };
+    const char* names[4] = { "front to back", "back to front", "traversal order", "state then front to back" };
+    unsigned int numMismatches = 0;
+
+    std::cout<<"Sorting "<<numLeaves<<" leaves in "<<numStateSets<<" StateGraphs "<<numPasses<<" times"<<std::endl;
+    std::cout<<"sort                      std::sort ms   RenderBin ms    speedup"<<std::endl;
+    for(unsigned int m=0; m<4; ++m)
+    {
+        double referenceTime = DBL_MAX;
+        double binTime = DBL_MAX;
+        for(unsigned int pass=0; pass<numPasses; ++pass)
+        {
+            bin->reset();
+            for(unsigned int i=0; i<numStateSets; ++i)
+            {
+                stateGraphs[i]->_leaves.clear();
+                for(unsigned int l=0; l<leaves[i].size(); ++l) stateGraphs[i]->addLeaf(leaves[i][l].get());
+                bin->addStateGraph(stateGraphs[i]);
+            }
+            bin->setSortMode(modes[m]);
+
+            osgUtil::RenderBin::RenderLeafList referenceLeaves;
+            osgUtil::RenderBin::StateGraphList referenceStateGraphs;
+            std::vector<osgUtil::StateGraph::LeafList> referenceStateGraphLeaves(leaves);
+            for(unsigned int i=0; i<numStateSets; ++i)
+            {
+                for(unsigned int l=0; l<leaves[i].size(); ++l) referenceLeaves.push_back(leaves[i][l].get());
+            }
+
+            osg::Timer_t startTick = osg::Timer::instance()->tick();
+            switch(modes[m])
+            {
+                case(osgUtil::RenderBin::SORT_FRONT_TO_BACK): std::sort(referenceLeaves.begin(), referenceLeaves.end(), LessDepth()); break;
+                case(osgUtil::RenderBin::SORT_BACK_TO_FRONT): std::sort(referenceLeaves.begin(), referenceLeaves.end(), GreaterDepth()); break;
+                case(osgUtil::RenderBin::TRAVERSAL_ORDER): std::sort(referenceLeaves.begin(), referenceLeaves.end(), LessTraversalOrder()); break;
+                default:
+                    for(unsigned int i=0; i<numStateSets; ++i)
+                    {
+                        std::sort(referenceStateGraphLeaves[i].begin(), referenceStateGraphLeaves[i].end(), LessLeafDepth());
+                    }
+                    break;
+            }
+            osg::Timer_t middleTick = osg::Timer::instance()->tick();
+            bin->sort();
+            osg::Timer_t endTick = osg::Timer::instance()->tick();
+
+            referenceTime = osg::minimum(referenceTime, osg::Timer::instance()->delta_m(startTick, middleTick));
+            binTime = osg::minimum(binTime, osg::Timer::instance()->delta_m(middleTick, endTick));
+
+            // std::sort leaves the order of equal elements unspecified, so check against a stable sort of the same leaves.
+            referenceLeaves.clear();
+            for(unsigned int i=0; i<numStateSets; ++i)
+            {
+                for(unsigned int l=0; l<leaves[i].size(); ++l) referenceLeaves.push_back(leaves[i][l].get());
+            }
+
+            switch(modes[m])
+            {
+                case(osgUtil::RenderBin::SORT_FRONT_TO_BACK): std::stable_sort(referenceLeaves.begin(), referenceLeaves.end(), LessDepth()); break;
+                case(osgUtil::RenderBin::SORT_BACK_TO_FRONT): std::stable_sort(referenceLeaves.begin(), referenceLeaves.end(), GreaterDepth()); break;
+                case(osgUtil::RenderBin::TRAVERSAL_ORDER): std::stable_sort(referenceLeaves.begin(), referenceLeaves.end(), LessTraversalOrder()); break;
+                default:
+                    referenceLeaves.clear();
+                    referenceStateGraphs = stateGraphs;
+                    std::stable_sort(referenceStateGraphs.begin(), referenceStateGraphs.end(), LessMinimumDistance());
+                    for(unsigned int i=0; i<numStateSets; ++i)
+                    {
+                        osgUtil::StateGraph::LeafList sorted(leaves[i]);
+                        std::stable_sort(sorted.begin(), sorted.end(), LessLeafDepth());
+                        if (sorted!=stateGraphs[i]->_leaves) ++numMismatches;
+                    }
+                    break;
+            }
+
+            if (referenceLeaves!=bin->getRenderLeafList() || referenceStateGraphs!=bin->getStateGraphList()) ++numMismatches;
+        }
+
+        std::cout.setf(std::ios::fixed);
+        std::cout.precision(3);
+        std::cout<<std::left;
+        std::cout.width(26);
+        std::cout<<names[m]<<std::right;
+        std::cout.width(12); std::cout<<referenceTime;
+        std::cout.width(15); std::cout<<binTime;
+        std::cout.width(11); std::cout<<referenceTime/binTime<<std::endl;
+    }
+
+    // look up the StateGraph of each leaf's StateSet, as the cull does for every drawable.
+    std::vector<const osg::StateSet*> lookups(numLeaves);
+    for(unsigned int i=0; i<numLeaves; ++i) lookups[i] = statesets[rand()%numStateSets].get();
+
+    double mapTime = DBL_MAX;
+    double hashTime = DBL_MAX;
+    for(unsigned int pass=0; pass<numPasses; ++pass)
+    {
+        unsigned int numMapFound = 0;
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        for(unsigned int i=0; i<numLeaves; ++i)
+        {
+            osgUtil::StateGraph::ChildList::iterator itr = root->_children.find(lookups[i]);
+            if (itr!=root->_children.end() && itr->second->getStateSet()==lookups[i]) ++numMapFound;
+        }
+        osg::Timer_t middleTick = osg::Timer::instance()->tick();
+        unsigned int numHashFound = 0;
+        for(unsigned int i=0; i<numLeaves; ++i)
+        {
+            if (root->find_or_insert(lookups[i])->getStateSet()==lookups[i]) ++numHashFound;
+        }
+        osg::Timer_t endTick = osg::Timer::instance()->tick();
+
+        mapTime = osg::minimum(mapTime, osg::Timer::instance()->delta_m(startTick, middleTick));
+        hashTime = osg::minimum(hashTime, osg::Timer::instance()->delta_m(middleTick, endTick));
+
+        if (numMapFound!=numLeaves || numHashFound!=numLeaves || root->_children.size()!=numStateSets) ++numMismatches;
+    }
+
+    std::cout<<"lookup                    std::map ms    StateGraph ms"<<std::endl;
+    std::cout<<std::left;
+    std::cout.width(26);
+    std::cout<<"state graph"<<std::right;
+    std::cout.width(12); std::cout<<mapTime;
+    std::cout.width(15); std::cout<<hashTime;
+    std::cout.width(11); std::cout<<mapTime/hashTime<<std::endl;
+
+    if (numMismatches>0)
+    {
+        std::cout<<numMismatches<<" sorts or lookups gave different results"<<std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main( int argc, char **argv )
+{
+    osg::ArgumentParser arguments(&argc,argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" measures the CPU cost of the update and cull traversals without a graphics context.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options] [filename ...]");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help","Display this information.");
+    arguments.getApplicationUsage()->addCommandLineOption("--drawables <num>","Number of drawables in the generated scene, used when no file is loaded (default 10000).");
+    arguments.getApplicationUsage()->addCommandLineOption("--depth <num>","Depth of the tree of MatrixTransforms above the drawables of the generated scene (default 3).");
+    arguments.getApplicationUsage()->addCommandLineOption("--statesets <num>","Number of unique StateSets in the generated scene (default 100).");
+    arguments.getApplicationUsage()->addCommandLineOption("--animate","Attach an update callback to the transform of every drawable of the generated scene.");
+    arguments.getApplicationUsage()->addCommandLineOption("--flat","Generate a scene of Geodes directly beneath the root rather than beneath MatrixTransforms.");
+    arguments.getApplicationUsage()->addCommandLineOption("--city","Generate a flat scene of tall boxes of random heights and view it from street level.");
+    arguments.getApplicationUsage()->addCommandLineOption("--occlusion","Cull drawables hidden behind the largest drawables of the previous frame with CullSettings::SOFTWARE_OCCLUSION_CULLING.");
+    arguments.getApplicationUsage()->addCommandLineOption("--compiled","Place the scene beneath an osgUtil::CompiledCullGroup, culling its static parts from a flattened copy.");
+    arguments.getApplicationUsage()->addCommandLineOption("--frames <num>","Number of frames timed (default 100).");
+    arguments.getApplicationUsage()->addCommandLineOption("--warmup <num>","Number of frames run before timing starts (default 10).");
+    arguments.getApplicationUsage()->addCommandLineOption("--window <width> <height>","Size of the viewport (default 1280 1024).");
+    arguments.getApplicationUsage()->addCommandLineOption("--fov <degrees>","Vertical field of view (default 30).");
+    arguments.getApplicationUsage()->addCommandLineOption("--zoom <ratio>","Distance of the eye relative to the one that fits the whole scene in view, less than 1 moves in and culls part of the scene (default 1).");
+    arguments.getApplicationUsage()->addCommandLineOption("--csv <filename>","Write the timings and allocations of every timed frame to a comma separated file.");
+    arguments.getApplicationUsage()->addCommandLineOption("--parallel-cull <num>","Number of threads used to cull the children of large Groups in parallel (default 0, serial).");
+    arguments.getApplicationUsage()->addCommandLineOption("--parallel-cull-children <num>","Minimum number of children of a Group for a parallel cull (default 256).");
+    arguments.getApplicationUsage()->addCommandLineOption("--validate","Compare the output of every timed frame with that of a serial cull of the same frame.");
+    arguments.getApplicationUsage()->addCommandLineOption("--frustum-benchmark <num>","Time culling num random bounds against the frustum one at a time and in batches, then exit.");
+    arguments.getApplicationUsage()->addCommandLineOption("--sort-benchmark <num>","Time sorting num RenderLeaves spread over the StateGraphs of --statesets StateSets in each sort mode and looking up their StateGraphs, then exit.");
+    arguments.getApplicationUsage()->addCommandLineOption("--sort-mode <mode>","Sort mode of the RenderBins, one of SORT_BY_STATE, SORT_BY_STATE_THEN_FRONT_TO_BACK, SORT_FRONT_TO_BACK, SORT_BACK_TO_FRONT or TRAVERSAL_ORDER.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    unsigned int numDrawables = 10000;
+    unsigned int transformDepth = 3;
+    unsigned int numStateSets = 100;
+    unsigned int numFrames = 100;
+    unsigned int numWarmupFrames = 10;
+    int width = 1280;
+    int height = 1024;
+    double fov = 30.0;
+    double zoom = 1.0;
+    std::string csvFileName;
+    unsigned int parallelCullNumThreads = 0;
+    unsigned int parallelCullMinimumNumChildren = 256;
+    unsigned int frustumBenchmarkNumBounds = 0;
+    unsigned int sortBenchmarkNumLeaves = 0;
+    std::string sortMode;
+
+    while(arguments.read("--drawables", numDrawables)) {}
+    while(arguments.read("--depth", transformDepth)) {}
+    while(arguments.read("--statesets", numStateSets)) {}
+    while(arguments.read("--frames", numFrames)) {}
+    while(arguments.read("--warmup", numWarmupFrames)) {}
+    while(arguments.read("--window", width, height)) {}
+    while(arguments.read("--fov", fov)) {}
+    while(arguments.read("--zoom", zoom)) {}
+    while(arguments.read("--csv", csvFileName)) {}
+    while(arguments.read("--parallel-cull", parallelCullNumThreads)) {}
+    while(arguments.read("--parallel-cull-children", parallelCullMinimumNumChildren)) {}
+    while(arguments.read("--frustum-benchmark", frustumBenchmarkNumBounds)) {}
+    while(arguments.read("--sort-benchmark", sortBenchmarkNumLeaves)) {}
+    while(arguments.read("--sort-mode", sortMode)) {}
+    bool animate = arguments.read("--animate");
+    bool flat = arguments.read("--flat");
+    bool city = arguments.read("--city");
+    bool occlusion = arguments.read("--occlusion");
+    bool compiled = arguments.read("--compiled");
+    bool validate = arguments.read("--validate");
+
+    osg::ref_ptr<osg::Node> scene = osgDB::readRefNodeFiles(arguments);
+
+    arguments.reportRemainingOptionsAsUnrecognized();
+    if (arguments.errors())
+    {
+        arguments.writeErrorMessages(std::cout);
+        return 1;
+    }
+
+    if (sortBenchmarkNumLeaves>0)
+    {
+        return runSortBenchmark(sortBenchmarkNumLeaves, numStateSets, osg::maximum(numFrames, 1u));
+    }
+
+    if (!sortMode.empty())
+    {
+        if (sortMode=="SORT_BY_STATE") osgUtil::RenderBin::setDefaultRenderBinSortMode(osgUtil::RenderBin::SORT_BY_STATE);
+        else if (sortMode=="SORT_BY_STATE_THEN_FRONT_TO_BACK") osgUtil::RenderBin::setDefaultRenderBinSortMode(osgUtil::RenderBin::SORT_BY_STATE_THEN_FRONT_TO_BACK);
+        else if (sortMode=="SORT_FRONT_TO_BACK") osgUtil::RenderBin::setDefaultRenderBinSortMode(osgUtil::RenderBin::SORT_FRONT_TO_BACK);
+        else if (sortMode=="SORT_BACK_TO_FRONT") osgUtil::RenderBin::setDefaultRenderBinSortMode(osgUtil::RenderBin::SORT_BACK_TO_FRONT);
+        else if (sortMode=="TRAVERSAL_ORDER") osgUtil::RenderBin::setDefaultRenderBinSortMode(osgUtil::RenderBin::TRAVERSAL_ORDER);
+        else
+        {
+            std::cout<<"Unknown sort mode "<<sortMode<<std::endl;
+            return 1;
+        }
+    }
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    if (scene.valid())
+    {
+        std::cout<<"Loaded scene in "<<osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick())<<"s"<<std::endl;
+    }
+    else
+    {
+        SceneGenerator generator(numDrawables, transformDepth, numStateSets, animate, flat, city);
+        scene = generator.create();
+        std::cout<<"Generated "<<(city ? "city " : (flat ? "flat " : ""))<<"scene of "<<numDrawables<<" drawables, transform depth "<<transformDepth<<", "<<numStateSets<<" StateSets in "
+                 <<osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick())<<"s"<<std::endl;
+    }
+
+    osgUtil::StatsVisitor statsVisitor;
+    scene->accept(statsVisitor);
+    std::cout<<"Scene contains "<<statsVisitor._numInstancedGroup+statsVisitor._numInstancedTransform+statsVisitor._numInstancedGeode+statsVisitor._numInstancedLOD+statsVisitor._numInstancedSwitch
+             <<" nodes, "<<statsVisitor._numInstancedDrawable<<" drawables, "<<statsVisitor._statesetSet.size()<<" unique StateSets"<<std::endl;
+
+    if (compiled)
+    {
+        osg::ref_ptr<osgUtil::CompiledCullGroup> compiledCullGroup = new osgUtil::CompiledCullGroup;
+        compiledCullGroup->addChild(scene.get());
+        scene = compiledCullGroup;
+    }
+
+    // set up a camera that views the whole scene from above at an angle, as the home position of a viewer would
+    osg::ref_ptr<osg::Camera> camera = new osg::Camera;
+    camera->setViewport(0, 0, width, height);
+    camera->addChild(scene.get());
+
+    const osg::BoundingSphere& bs = scene->getBound();
+    double distance = bs.radius()/sin(osg::DegreesToRadians(fov*0.5))*zoom;
+    osg::Vec3d direction(0.0, -1.0, 1.0);
+    direction.normalize();
+    if (city)
+    {
+        // look across the city from just outside the middle of its southern edge at the height of a person.
+        osg::Vec3d eye(bs.center().x()+1.0, bs.center().y()-bs.radius()*0.75, 0.5);
+        camera->setViewMatrixAsLookAt(eye, eye+osg::Vec3d(0.3, 1.0, 0.0), osg::Vec3d(0.0, 0.0, 1.0));
+        camera->setProjectionMatrixAsPerspective(fov, double(width)/double(height), 0.1, bs.radius()*3.0);
+    }
+    else
+    {
+        camera->setViewMatrixAsLookAt(osg::Vec3d(bs.center())+direction*distance, osg::Vec3d(bs.center()), osg::Vec3d(0.0, 0.0, 1.0));
+        camera->setProjectionMatrixAsPerspective(fov, double(width)/double(height), (distance+bs.radius())*0.0001, distance+bs.radius());
+    }
+
+    if (occlusion) camera->setCullingMode(camera->getCullingMode()|osg::CullSettings::SOFTWARE_OCCLUSION_CULLING);
+
+    if (frustumBenchmarkNumBounds>0)
+    {
+        return runFrustumBenchmark(*camera, bs, frustumBenchmarkNumBounds, osg::maximum(numFrames, 1u));
+    }
+
+    camera->setParallelCullMinimumNumChildren(parallelCullMinimumNumChildren);
+
+    // the reference for validation is a serial cull of the same scene and view.
+    osg::ref_ptr<osg::Camera> serialCamera = new osg::Camera(*camera);
+    serialCamera->setParallelCullNumThreads(0);
+
+    camera->setParallelCullNumThreads(parallelCullNumThreads);
+
+    osg::ref_ptr<osg::StateSet> globalStateSet = new osg::StateSet;
+    globalStateSet->setGlobalDefaults();
+
+    CullBenchmark benchmark(camera.get(), globalStateSet.get());
+    CullBenchmark serialBenchmark(serialCamera.get(), globalStateSet.get());
+    unsigned int numValidationFailures = 0;
+
+    std::ofstream csv;
+    if (!csvFileName.empty())
+    {
+        csv.open(csvFileName.c_str());
+        csv<<"frame";
+        for(unsigned int phase=0; phase<CullBenchmark::NUM_PHASES; ++phase) csv<<","<<CullBenchmark::getPhaseName(phase)<<"_ms";
+        for(unsigned int phase=0; phase<CullBenchmark::NUM_PHASES; ++phase) csv<<","<<CullBenchmark::getPhaseName(phase)<<"_allocations";
+        csv<<std::endl;
+    }
+
+    double sumTime[CullBenchmark::NUM_PHASES];
+    double minTime[CullBenchmark::NUM_PHASES];
+    double maxTime[CullBenchmark::NUM_PHASES];
+    double sumAllocations[CullBenchmark::NUM_PHASES];
+    for(unsigned int phase=0; phase<CullBenchmark::NUM_PHASES; ++phase)
+    {
+        sumTime[phase] = 0.0;
+        minTime[phase] = DBL_MAX;
+        maxTime[phase] = 0.0;
+        sumAllocations[phase] = 0.0;
+    }
+
+    for(unsigned int frameNumber=0; frameNumber<numWarmupFrames+numFrames; ++frameNumber)
+    {
+        CullBenchmark::FrameResult result = benchmark.frame(frameNumber, double(frameNumber)/60.0);
+
+        // the serial cull runs the warm up frames too, as the occluders of SOFTWARE_OCCLUSION_CULLING are picked from earlier frames.
+        if (validate) serialBenchmark.frame(frameNumber, double(frameNumber)/60.0);
+
+        if (frameNumber<numWarmupFrames) continue;
+
+        if (validate)
+        {
+            if (!benchmark.compare(serialBenchmark, std::cout))
+            {
+                std::cout<<"Frame "<<frameNumber-numWarmupFrames<<" differs from the serial cull"<<std::endl;
+                ++numValidationFailures;
+            }
+        }
+
+        if (csv.is_open()) csv<<frameNumber-numWarmupFrames;
+        for(unsigned int phase=0; phase<CullBenchmark::NUM_PHASES; ++phase)
+        {
+            sumTime[phase] += result.time[phase];
+            minTime[phase] = osg::minimum(minTime[phase], result.time[phase]);
+            maxTime[phase] = osg::maximum(maxTime[phase], result.time[phase]);
+            sumAllocations[phase] += result.allocations[phase];
+            if (csv.is_open()) csv<<","<<result.time[phase];
+        }
+        if (csv.is_open())
+        {
+            for(unsigned int phase=0; phase<CullBenchmark::NUM_PHASES; ++phase) csv<<","<<result.allocations[phase];
+            csv<<std::endl;
+        }
+    }
+
+    if (numFrames==0) return 0;
+
+    std::cout<<"RenderLeaves "<<benchmark.getNumRenderLeaves()<<", StateGraphs "<<benchmark.getNumStateGraphs()<<", RenderBins "<<benchmark.getNumRenderBins()<<std::endl;
+    if (benchmark.getOcclusionBuffer())
+    {
+        const osgUtil::OcclusionBuffer* ob = benchmark.getOcclusionBuffer();
+        std::cout<<"Occluders "<<ob->getNumOccluders()<<", occluder triangles "<<ob->getNumOccluderTriangles()<<", drawables and subgraphs occluded "<<ob->getNumOccluded()<<std::endl;
+    }
+    if (compiled)
+    {
+        osg::ref_ptr<const osgUtil::CompiledCull> compiledCull = static_cast<osgUtil::CompiledCullGroup*>(scene.get())->getCompiledCull();
+        if (compiledCull.valid()) std::cout<<"Compiled drawables "<<compiledCull->_items.size()<<", transforms "<<compiledCull->_matrices.size()-1<<", bounding volume nodes "<<compiledCull->_bvhNodes.size()<<std::endl;
+        else std::cout<<"Scene not compiled"<<std::endl;
+    }
+    std::cout<<numFrames<<" frames"<<std::endl;
+    std::cout<<"phase       mean ms      min ms      max ms   allocations/frame"<<std::endl;
+
+    double totalTime = 0.0;
+    double totalAllocations = 0.0;
+    for(unsigned int phase=0; phase<CullBenchmark::NUM_PHASES; ++phase)
+    {
+        std::cout.setf(std::ios::fixed);
+        std::cout.precision(3);
+        std::cout<<std::left;
+        std::cout.width(8);
+        std::cout<<CullBenchmark::getPhaseName(phase)<<std::right;
+        std::cout.width(12); std::cout<<sumTime[phase]/double(numFrames);
+        std::cout.width(12); std::cout<<minTime[phase];
+        std::cout.width(12); std::cout<<maxTime[phase];
+        std::cout.precision(1);
+        std::cout.width(20); std::cout<<sumAllocations[phase]/double(numFrames)<<std::endl;
+
+        totalTime += sumTime[phase];
+        totalAllocations += sumAllocations[phase];
+    }
+    std::cout.precision(3);
+    std::cout<<"total   ";
+    std::cout.width(12); std::cout<<totalTime/double(numFrames);
+    std::cout.precision(1);
+    std::cout.width(44); std::cout<<totalAllocations/double(numFrames)<<std::endl;
+
+    if (validate)
+    {
+        std::cout<<numFrames-numValidationFailures<<" of "<<numFrames<<" frames matched the serial cull"<<std::endl;
+        if (numValidationFailures>0) return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This application is open source and may be redistributed and/or modified
+ * freely and without restriction, both in commercial and non commercial applications,
+ * as long as this copyright notice is maintained.
+ *
+ * This application is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osg/Timer>
+
+#include <osgDB/Registry>
+#include <osgDB/PluginQuery>
+
+#include <iostream>
+#include <vector>
+#include <string>
+
+// Times the first lookup of the ReaderWriter for each extension, as paid by each start of a tool, with and without a plugin index.
+int main( int argc, char **argv )
+{
+    osg::ArgumentParser arguments(&argc,argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" times the first lookup of the plugin for each of a list of extensions, run it repeatedly to time tool start up.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options] [extension ...]");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help","Display this information");
+    arguments.getApplicationUsage()->addCommandLineOption("--index <file>","Use the plugin index file, building it if it is missing or out of date, in place of the OSG_PLUGIN_INDEX_FILE environment variable.");
+    arguments.getApplicationUsage()->addCommandLineOption("--no-index","Search for the plugins without a plugin index.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    std::string indexFile;
+    while (arguments.read("--index", indexFile))
+    {
+        osgDB::Registry::instance()->setPluginIndexFile(indexFile);
+    }
+
+    while (arguments.read("--no-index"))
+    {
+        osgDB::Registry::instance()->setPluginIndexFile(std::string());
+    }
+
+    std::vector<std::string> extensions;
+    for(int pos=1; pos<arguments.argc(); ++pos)
+    {
+        if (!arguments.isOption(pos)) extensions.push_back(arguments[pos]);
+    }
+
+    if (extensions.empty())
+    {
+        // a mix of extensions named after their plugins, aliased to other plugins and supported by none.
+        const char* defaultExtensions[] = { "osgt", "osgb", "ive", "obj", "png", "jpeg", "tga", "zip", "osga", "3ds", "flt", "unknown" };
+        extensions.assign(defaultExtensions, defaultExtensions+sizeof(defaultExtensions)/sizeof(defaultExtensions[0]));
+    }
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    osg::ref_ptr<osgDB::PluginIndex> pluginIndex = osgDB::Registry::instance()->getPluginIndex();
+
+    osg::Timer_t indexed = osg::Timer::instance()->tick();
+
+    if (pluginIndex.valid())
+    {
+        std::cout<<"Plugin index of "<<pluginIndex->getPlugins().size()<<" plugins read in "<<osg::Timer::instance()->delta_m(start, indexed)<<"ms"<<std::endl;
+    }
+    else
+    {
+        std::cout<<"No plugin index"<<std::endl;
+    }
+
+    unsigned int numFound = 0;
+    for(std::vector<std::string>::iterator itr = extensions.begin();
+        itr != extensions.end();
+        ++itr)
+    {
+        osg::Timer_t before = osg::Timer::instance()->tick();
+        osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(*itr);
+        osg::Timer_t after = osg::Timer::instance()->tick();
+
+        if (rw) ++numFound;
+        std::cout<<"  "<<*itr<<" : "<<(rw ? rw->className() : "not found")<<" in "<<osg::Timer::instance()->delta_m(before, after)<<"ms"<<std::endl;
+    }
+
+    osg::Timer_t end = osg::Timer::instance()->tick();
+    std::cout<<"Found "<<numFound<<" of "<<extensions.size()<<" extensions in "<<osg::Timer::instance()->delta_m(start, end)<<"ms"<<std::endl;
+
+    return 0;
+}
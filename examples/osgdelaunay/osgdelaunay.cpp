@@ -0,0 +1,159 @@
+/* OpenSceneGraph example, osgdelaunay.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Timer>
+
+#include <osgUtil/DelaunayTriangulator>
+#include <osgUtil/SmoothingVisitor>
+
+#include <osgViewer/Viewer>
+#include <osgViewer/ViewerEventHandlers>
+
+#include <osgGA/StateSetManipulator>
+
+#include <iostream>
+#include <math.h>
+
+// repeatable pseudo random terrain samples over a 1000x1000 area
+static osg::Vec3Array* createSamplePoints(unsigned int numPoints)
+{
+    osg::Vec3Array* points = new osg::Vec3Array;
+    points->reserve(numPoints);
+
+    unsigned int random = 12345;
+    for(unsigned int i=0; i<numPoints; ++i)
+    {
+        random = random*1664525u + 1013904223u;
+        float x = static_cast<float>(random>>8) / static_cast<float>(1<<24) * 1000.0f;
+        random = random*1664525u + 1013904223u;
+        float y = static_cast<float>(random>>8) / static_cast<float>(1<<24) * 1000.0f;
+
+        points->push_back(osg::Vec3(x, y, 20.0f*sinf(x*0.01f)*cosf(y*0.013f)));
+    }
+    return points;
+}
+
+// a star shaped loop in the middle of the terrain
+static osgUtil::DelaunayConstraint* createConstraint()
+{
+    osg::ref_ptr<osgUtil::DelaunayConstraint> constraint = new osgUtil::DelaunayConstraint;
+
+    osg::Vec3Array* vertices = new osg::Vec3Array;
+    const unsigned int numCorners = 10;
+    for(unsigned int i=0; i<numCorners; ++i)
+    {
+        float angle = static_cast<float>(i) * 2.0f * osg::PI / static_cast<float>(numCorners);
+        float radius = (i%2==0) ? 300.0f : 150.0f;
+        vertices->push_back(osg::Vec3(500.0f + radius*cosf(angle), 500.0f + radius*sinf(angle), 30.0f));
+    }
+
+    constraint->setVertexArray(vertices);
+    constraint->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::LINE_LOOP, 0, vertices->size()));
+    return constraint.release();
+}
+
+static void benchmark(unsigned int maxPoints, bool useConstraint)
+{
+    std::cout<<"points\ttriangles\ttime (s)\tpoints/s"<<std::endl;
+    for(unsigned int numPoints=10000; numPoints<=maxPoints; numPoints*=10)
+    {
+        osg::ref_ptr<osg::Vec3Array> points = createSamplePoints(numPoints);
+        osg::ref_ptr<osgUtil::DelaunayTriangulator> triangulator = new osgUtil::DelaunayTriangulator(points.get());
+        if (useConstraint) triangulator->addInputConstraint(createConstraint());
+
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        triangulator->triangulate();
+        double time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+        unsigned int numTriangles = triangulator->getTriangles() ? triangulator->getTriangles()->getNumPrimitives() : 0;
+        std::cout<<numPoints<<"\t"<<numTriangles<<"\t"<<time<<"\t"<<(time>0.0 ? static_cast<double>(numPoints)/time : 0.0)<<std::endl;
+    }
+}
+
+int main( int argc, char **argv )
+{
+    // use an ArgumentParser object to manage the program arguments.
+    osg::ArgumentParser arguments(&argc,argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" example triangulates random terrain samples with osgUtil::DelaunayTriangulator.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options]");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help","Display this information");
+    arguments.getApplicationUsage()->addCommandLineOption("--points <num>","Number of sample points to triangulate.","10000");
+    arguments.getApplicationUsage()->addCommandLineOption("--constraint","Add a constraint loop and remove the triangles inside it.");
+    arguments.getApplicationUsage()->addCommandLineOption("--benchmark","Time the triangulation of 10k, 100k, 1M and 10M points then exit.");
+    arguments.getApplicationUsage()->addCommandLineOption("--max-points <num>","Largest number of points triangulated by --benchmark.","10000000");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    unsigned int numPoints = 10000;
+    while (arguments.read("--points", numPoints)) {}
+
+    bool useConstraint = false;
+    while (arguments.read("--constraint")) { useConstraint = true; }
+
+    unsigned int maxPoints = 10000000;
+    while (arguments.read("--max-points", maxPoints)) {}
+
+    if (arguments.read("--benchmark"))
+    {
+        benchmark(maxPoints, useConstraint);
+        return 0;
+    }
+
+    osg::ref_ptr<osg::Vec3Array> points = createSamplePoints(numPoints);
+    osg::ref_ptr<osgUtil::DelaunayTriangulator> triangulator = new osgUtil::DelaunayTriangulator(points.get());
+
+    osg::ref_ptr<osgUtil::DelaunayConstraint> constraint;
+    if (useConstraint)
+    {
+        constraint = createConstraint();
+        triangulator->addInputConstraint(constraint.get());
+    }
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    if (!triangulator->triangulate())
+    {
+        std::cout<<arguments.getApplicationName()<<": triangulation failed"<<std::endl;
+        return 1;
+    }
+    std::cout<<"Triangulated "<<points->size()<<" points in "<<osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick())<<"s"<<std::endl;
+
+    if (constraint.valid()) triangulator->removeInternalTriangles(constraint.get());
+
+    osg::ref_ptr<osg::Geometry> terrain = new osg::Geometry;
+    terrain->setVertexArray(points.get());
+    terrain->addPrimitiveSet(triangulator->getTriangles());
+    osgUtil::SmoothingVisitor::smooth(*terrain);
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(terrain.get());
+
+    osgViewer::Viewer viewer(arguments);
+    viewer.addEventHandler(new osgGA::StateSetManipulator(viewer.getCamera()->getOrCreateStateSet()));
+    viewer.addEventHandler(new osgViewer::StatsHandler);
+    viewer.setSceneData(geode.get());
+
+    return viewer.run();
+}
@@ -54,6 +54,16 @@ int main(int argc, char **argv)
     // use an ArgumentParser object to manage the program arguments.
     osg::ArgumentParser arguments(&argc,argv);
 
+    unsigned int packetSize = 0;
+    unsigned int numThreads = 0;
+    unsigned int maxNumThreads = 0;
+    unsigned int numRows = 20;
+    unsigned int numColumns = 20;
+    while (arguments.read("--packet", packetSize)) {}
+    while (arguments.read("--threads", numThreads)) {}
+    while (arguments.read("--scaling", maxNumThreads)) {}
+    while (arguments.read("--grid", numRows)) { numColumns = numRows; }
+
     osg::ref_ptr<osg::Node> scene = osgDB::readRefNodeFiles(arguments);
 
     if (!scene)
@@ -83,12 +93,14 @@ int main(int argc, char **argv)
         osg::Vec3d deltaColumn( bs.radius()*0.01, 0.0, 0.0);
 
         osgSim::LineOfSight los;
+        los.setPacketSize(packetSize);
+        los.setNumThreads(numThreads);
 
 #if 1
-        unsigned int numRows = 20;
-        unsigned int numColumns = 20;
         osgSim::HeightAboveTerrain hat;
         hat.setDatabaseCacheReadCallback(los.getDatabaseCacheReadCallback());
+        hat.setPacketSize(packetSize);
+        hat.setNumThreads(numThreads);
 
         for(unsigned int r=0; r<numRows; ++r)
         {
@@ -101,6 +113,27 @@ int main(int argc, char **argv)
             }
         }
 
+        if (maxNumThreads>0)
+        {
+            // time the same batch of line of sight tests across an increasing number of threads.
+            for(unsigned int n=1; n<=maxNumThreads; ++n)
+            {
+                los.setNumThreads(n);
+
+                osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+                los.computeIntersections(scene.get());
+
+                osg::Timer_t endTick = osg::Timer::instance()->tick();
+
+                double duration = osg::Timer::instance()->delta_s(startTick,endTick);
+                std::cout<<"LineOfSight "<<los.getNumLOS()<<" tests on "<<n<<" threads completed in "<<duration<<"s";
+                if (duration>0.0) std::cout<<", "<<double(los.getNumLOS())/duration<<" tests per second";
+                std::cout<<std::endl;
+            }
+            return 0;
+        }
+
 
         {
             std::cout<<"Computing LineOfSight"<<std::endl;
@@ -184,8 +217,6 @@ int main(int argc, char **argv)
         osg::Vec3d end = bs.center();// - osg::Vec3d(0.0, bs.radius(),0.0);
         osg::Vec3d deltaRow( 0.0, 0.0, bs.radius()*0.01);
         osg::Vec3d deltaColumn( bs.radius()*0.01, 0.0, 0.0);
-        unsigned int numRows = 20;
-        unsigned int numColumns = 20;
 
         osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::IntersectorGroup();
 
@@ -42,6 +42,74 @@
 #include <osg/KdTree>
 
 #include <iostream>
+#include <cstdlib>
+
+// strip any KdTree's already attached to the scene so that the benchmark can rebuild them with different settings.
+class RemoveKdTreesVisitor : public osg::NodeVisitor
+{
+public:
+    RemoveKdTreesVisitor():
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN) {}
+
+    void apply(osg::Geometry& geometry)
+    {
+        if (dynamic_cast<osg::KdTree*>(geometry.getShape())) geometry.setShape(0);
+    }
+};
+
+typedef std::vector< std::pair<osg::Vec3d, osg::Vec3d> > Segments;
+
+void createRandomSegments(const osg::BoundingSphere& bs, unsigned int numRays, Segments& segments)
+{
+    srand(1);
+    segments.reserve(numRays);
+    for(unsigned int i=0; i<numRays; ++i)
+    {
+        osg::Vec3d direction(double(rand())/double(RAND_MAX)-0.5, double(rand())/double(RAND_MAX)-0.5, double(rand())/double(RAND_MAX)-0.5);
+        direction.normalize();
+        osg::Vec3d offset(double(rand())/double(RAND_MAX)-0.5, double(rand())/double(RAND_MAX)-0.5, double(rand())/double(RAND_MAX)-0.5);
+        offset *= bs.radius();
+
+        segments.push_back(Segments::value_type(bs.center()+offset-direction*bs.radius()*2.0, bs.center()+offset+direction*bs.radius()*2.0));
+    }
+}
+
+void benchmark(osg::Node* scene, osg::KdTree::BuildOptions::SplitMethod splitMethod, int maxNumLevels, int targetNumIndicesPerLeaf, const Segments& segments)
+{
+    RemoveKdTreesVisitor rkv;
+    scene->accept(rkv);
+
+    osg::ref_ptr<osg::KdTreeBuilder> builder = new osg::KdTreeBuilder;
+    builder->_buildOptions._maxNumLevels = maxNumLevels;
+    builder->_buildOptions._targetNumTrianglesPerLeaf = targetNumIndicesPerLeaf;
+    builder->_buildOptions._splitMethod = splitMethod;
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+    scene->accept(*builder);
+    osg::Timer_t endTick = osg::Timer::instance()->tick();
+
+    std::cout<<(splitMethod==osg::KdTree::BuildOptions::MIDPOINT_SPLIT ? "MIDPOINT_SPLIT" : "SURFACE_AREA_HEURISTIC_SPLIT")<<std::endl;
+    std::cout<<"  build time "<<osg::Timer::instance()->delta_m(startTick, endTick)<<"ms"<<std::endl;
+
+    unsigned int numHits = 0;
+    osgUtil::IntersectionVisitor iv;
+
+    startTick = osg::Timer::instance()->tick();
+    for(Segments::const_iterator itr = segments.begin();
+        itr != segments.end();
+        ++itr)
+    {
+        osg::ref_ptr<osgUtil::LineSegmentIntersector> lsi = new osgUtil::LineSegmentIntersector(itr->first, itr->second);
+        iv.setIntersector(lsi.get());
+        scene->accept(iv);
+        numHits += lsi->getIntersections().size();
+    }
+    endTick = osg::Timer::instance()->tick();
+
+    double duration = osg::Timer::instance()->delta_s(startTick, endTick);
+    std::cout<<"  "<<segments.size()<<" rays, "<<numHits<<" hits in "<<duration*1000.0<<"ms"<<std::endl;
+    if (duration>0.0) std::cout<<"  "<<double(segments.size())/duration<<" rays per second"<<std::endl;
+}
 
 int main(int argc, char **argv)
 {
@@ -50,11 +118,19 @@ int main(int argc, char **argv)
 
     int maxNumLevels = 16;
     int targetNumIndicesPerLeaf = 16;
+    unsigned int numRays = 0;
+    bool useSAH = false;
 
     while (arguments.read("--max", maxNumLevels)) {}
     while (arguments.read("--leaf", targetNumIndicesPerLeaf)) {}
+    while (arguments.read("--sah")) { useSAH = true; }
+    while (arguments.read("--benchmark", numRays)) {}
 
     osgDB::Registry::instance()->setBuildKdTreesHint(osgDB::ReaderWriter::Options::BUILD_KDTREES);
+    if (useSAH)
+    {
+        osgDB::Registry::instance()->getKdTreeBuilder()->_buildOptions._splitMethod = osg::KdTree::BuildOptions::SURFACE_AREA_HEURISTIC_SPLIT;
+    }
 
     osg::ref_ptr<osg::Node> scene = osgDB::readRefNodeFiles(arguments);
 
@@ -64,6 +140,17 @@ int main(int argc, char **argv)
         return 0;
     }
 
+    if (numRays>0)
+    {
+        // compare rays per second of the KdTree split methods against the same set of random line segments.
+        Segments segments;
+        createRandomSegments(scene->getBound(), numRays, segments);
+
+        benchmark(scene.get(), osg::KdTree::BuildOptions::MIDPOINT_SPLIT, maxNumLevels, targetNumIndicesPerLeaf, segments);
+        benchmark(scene.get(), osg::KdTree::BuildOptions::SURFACE_AREA_HEURISTIC_SPLIT, maxNumLevels, targetNumIndicesPerLeaf, segments);
+        return 0;
+    }
+
     osgViewer::Viewer viewer;
     viewer.setSceneData(scene);
     return viewer.run();
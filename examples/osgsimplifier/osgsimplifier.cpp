@@ -16,6 +16,9 @@
 *  THE SOFTWARE.
 */
 
+#include <osg/TriangleFunctor>
+#include <osg/Timer>
+
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
 
@@ -29,6 +32,9 @@
 #include <osgGA/StateSetManipulator>
 
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
 
 class KeyboardEventHandler : public osgGA::GUIEventHandler
 {
@@ -81,6 +87,224 @@ private:
 };
 
 
+class CollectGeometriesVisitor : public osg::NodeVisitor
+{
+public:
+
+    CollectGeometriesVisitor():
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN) {}
+
+    virtual void apply(osg::Geometry& geometry) { _geometries.push_back(&geometry); }
+
+    std::vector<osg::Geometry*> _geometries;
+};
+
+struct CollectTriangles
+{
+    void operator() (const osg::Vec3& v1, const osg::Vec3& v2, const osg::Vec3& v3)
+    {
+        _vertices.push_back(v1);
+        _vertices.push_back(v2);
+        _vertices.push_back(v3);
+    }
+
+    std::vector<osg::Vec3> _vertices;
+};
+
+// closest point on triangle abc to p, from Ericson's Real-Time Collision Detection
+static osg::Vec3 closestPointOnTriangle(const osg::Vec3& p, const osg::Vec3& a, const osg::Vec3& b, const osg::Vec3& c)
+{
+    osg::Vec3 ab = b-a, ac = c-a, ap = p-a;
+    float d1 = ab*ap, d2 = ac*ap;
+    if (d1<=0.0f && d2<=0.0f) return a;
+
+    osg::Vec3 bp = p-b;
+    float d3 = ab*bp, d4 = ac*bp;
+    if (d3>=0.0f && d4<=d3) return b;
+
+    float vc = d1*d4 - d3*d2;
+    if (vc<=0.0f && d1>=0.0f && d3<=0.0f) return a + ab*(d1/(d1-d3));
+
+    osg::Vec3 cp = p-c;
+    float d5 = ab*cp, d6 = ac*cp;
+    if (d6>=0.0f && d5<=d6) return c;
+
+    float vb = d5*d2 - d1*d6;
+    if (vb<=0.0f && d2>=0.0f && d6<=0.0f) return a + ac*(d2/(d2-d6));
+
+    float va = d3*d6 - d5*d4;
+    if (va<=0.0f && (d4-d3)>=0.0f && (d5-d6)>=0.0f) return b + (c-b)*((d4-d3)/((d4-d3)+(d5-d6)));
+
+    float denom = 1.0f/(va+vb+vc);
+    return a + ab*(vb*denom) + ac*(vc*denom);
+}
+
+// uniform grid of the triangles overlapping each cell, for finding the distance from a point to a triangle mesh
+class TriangleGrid
+{
+public:
+
+    TriangleGrid(const std::vector<osg::Vec3>& vertices, const osg::BoundingBox& bb):
+        _vertices(vertices),
+        _bb(bb)
+    {
+        unsigned int numTriangles = osg::maximum(static_cast<unsigned int>(vertices.size()/3), 1u);
+        _cellSize = osg::maximum((bb._max-bb._min).length() / powf(static_cast<float>(numTriangles), 1.0f/3.0f), 1e-6f);
+
+        for(unsigned int i=0;i<3;++i)
+        {
+            _dimensions[i] = osg::clampBetween(static_cast<int>(ceilf((bb._max[i]-bb._min[i])/_cellSize)), 1, 256);
+        }
+        _cells.resize(_dimensions[0]*_dimensions[1]*_dimensions[2]);
+
+        for(unsigned int t=0;t+2<vertices.size();t+=3)
+        {
+            osg::BoundingBox tbb;
+            tbb.expandBy(vertices[t]); tbb.expandBy(vertices[t+1]); tbb.expandBy(vertices[t+2]);
+
+            int minCell[3], maxCell[3];
+            cell(tbb._min, minCell);
+            cell(tbb._max, maxCell);
+
+            for(int z=minCell[2];z<=maxCell[2];++z)
+                for(int y=minCell[1];y<=maxCell[1];++y)
+                    for(int x=minCell[0];x<=maxCell[0];++x)
+                        _cells[(z*_dimensions[1]+y)*_dimensions[0]+x].push_back(t);
+        }
+    }
+
+    float distance(const osg::Vec3& point) const
+    {
+        int c[3];
+        cell(point, c);
+
+        float best2 = FLT_MAX;
+        int maxRing = osg::maximum(_dimensions[0], osg::maximum(_dimensions[1], _dimensions[2]));
+        for(int ring=0; ring<=maxRing; ++ring)
+        {
+            for(int z=c[2]-ring;z<=c[2]+ring;++z)
+                for(int y=c[1]-ring;y<=c[1]+ring;++y)
+                    for(int x=c[0]-ring;x<=c[0]+ring;++x)
+                    {
+                        // only visit the shell of cells at this ring
+                        if (abs(x-c[0])!=ring && abs(y-c[1])!=ring && abs(z-c[2])!=ring) continue;
+                        if (x<0 || y<0 || z<0 || x>=_dimensions[0] || y>=_dimensions[1] || z>=_dimensions[2]) continue;
+
+                        const std::vector<unsigned int>& triangles = _cells[(z*_dimensions[1]+y)*_dimensions[0]+x];
+                        for(std::vector<unsigned int>::const_iterator itr = triangles.begin(); itr != triangles.end(); ++itr)
+                        {
+                            osg::Vec3 closest = closestPointOnTriangle(point, _vertices[*itr], _vertices[*itr+1], _vertices[*itr+2]);
+                            best2 = osg::minimum(best2, (closest-point).length2());
+                        }
+                    }
+
+            // any triangle not yet visited is at least ring cells away
+            float searched = static_cast<float>(ring)*_cellSize;
+            if (best2<=searched*searched) break;
+        }
+
+        return sqrtf(best2);
+    }
+
+protected:
+
+    void cell(const osg::Vec3& point, int* c) const
+    {
+        for(unsigned int i=0;i<3;++i)
+        {
+            c[i] = osg::clampBetween(static_cast<int>((point[i]-_bb._min[i])/_cellSize), 0, _dimensions[i]-1);
+        }
+    }
+
+    const std::vector<osg::Vec3>&               _vertices;
+    osg::BoundingBox                            _bb;
+    float                                       _cellSize;
+    int                                         _dimensions[3];
+    std::vector< std::vector<unsigned int> >    _cells;
+};
+
+// one sided Hausdorff distance from the vertices and triangle centres of one mesh to another mesh
+static float hausdorffDistance(const std::vector<osg::Vec3>& from, const TriangleGrid& to)
+{
+    float maxDistance = 0.0f;
+    for(unsigned int t=0;t+2<from.size();t+=3)
+    {
+        maxDistance = osg::maximum(maxDistance, to.distance(from[t]));
+        maxDistance = osg::maximum(maxDistance, to.distance(from[t+1]));
+        maxDistance = osg::maximum(maxDistance, to.distance(from[t+2]));
+        maxDistance = osg::maximum(maxDistance, to.distance((from[t]+from[t+1]+from[t+2])/3.0f));
+    }
+    return maxDistance;
+}
+
+static void benchmark(osg::Node* model, float sampleRatio, float maxError)
+{
+    const char* methodNames[] = { "EDGE_COLLAPSE", "QUADRIC_EDGE_COLLAPSE" };
+    osgUtil::Simplifier::Method methods[] = { osgUtil::Simplifier::EDGE_COLLAPSE, osgUtil::Simplifier::QUADRIC_EDGE_COLLAPSE };
+
+    CollectGeometriesVisitor originalGeometries;
+    model->accept(originalGeometries);
+
+    std::cout<<"Simplifying "<<originalGeometries._geometries.size()<<" geometries with SampleRatio="<<sampleRatio<<" maxError="<<maxError<<std::endl;
+
+    for(unsigned int m=0;m<2;++m)
+    {
+        osg::ref_ptr<osg::Node> root = (osg::Node*)model->clone(osg::CopyOp::DEEP_COPY_ALL);
+
+        CollectGeometriesVisitor geometries;
+        root->accept(geometries);
+
+        std::vector< std::vector<osg::Vec3> > originalTriangles(geometries._geometries.size());
+        unsigned int numTrianglesBefore = 0;
+        for(unsigned int i=0;i<geometries._geometries.size();++i)
+        {
+            osg::TriangleFunctor<CollectTriangles> collect;
+            geometries._geometries[i]->accept(collect);
+            originalTriangles[i].swap(collect._vertices);
+            numTrianglesBefore += originalTriangles[i].size()/3;
+        }
+
+        // time the simplification alone, without the smoothing and tri-stripping of the results
+        osgUtil::Simplifier simplifier(sampleRatio, maxError);
+        simplifier.setMethod(methods[m]);
+        simplifier.setSmoothing(false);
+        simplifier.setDoTriStrip(false);
+
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+        root->accept(simplifier);
+        double time = osg::Timer::instance()->delta_s(startTick, osg::Timer::instance()->tick());
+
+        unsigned int numTrianglesAfter = 0;
+        float hausdorff = 0.0f;
+        float diagonal = 0.0f;
+        for(unsigned int i=0;i<geometries._geometries.size();++i)
+        {
+            osg::TriangleFunctor<CollectTriangles> collect;
+            geometries._geometries[i]->accept(collect);
+            numTrianglesAfter += collect._vertices.size()/3;
+
+            if (originalTriangles[i].empty() || collect._vertices.empty()) continue;
+
+            osg::BoundingBox bb;
+            for(std::vector<osg::Vec3>::iterator itr = originalTriangles[i].begin(); itr != originalTriangles[i].end(); ++itr) bb.expandBy(*itr);
+            for(std::vector<osg::Vec3>::iterator itr = collect._vertices.begin(); itr != collect._vertices.end(); ++itr) bb.expandBy(*itr);
+            diagonal = osg::maximum(diagonal, (bb._max-bb._min).length());
+
+            TriangleGrid originalGrid(originalTriangles[i], bb);
+            TriangleGrid simplifiedGrid(collect._vertices, bb);
+            hausdorff = osg::maximum(hausdorff, hausdorffDistance(originalTriangles[i], simplifiedGrid));
+            hausdorff = osg::maximum(hausdorff, hausdorffDistance(collect._vertices, originalGrid));
+        }
+
+        double removedPerSecond = time>0.0 ? static_cast<double>(numTrianglesBefore-numTrianglesAfter)/time : 0.0;
+
+        std::cout<<"  "<<methodNames[m]<<": triangles "<<numTrianglesBefore<<" -> "<<numTrianglesAfter
+                 <<", time "<<time<<"s, "<<removedPerSecond<<" triangles removed/s"
+                 <<", Hausdorff error "<<hausdorff<<" ("<<(diagonal>0.0f ? hausdorff/diagonal*100.0f : 0.0f)<<"% of the diagonal)"<<std::endl;
+    }
+}
+
+
 int main( int argc, char **argv )
 {
 
@@ -94,6 +318,8 @@ int main( int argc, char **argv )
     arguments.getApplicationUsage()->addCommandLineOption("-h or --help","Display this information");
     arguments.getApplicationUsage()->addCommandLineOption("--ratio <ratio>","Specify the sample ratio","0.5]");
     arguments.getApplicationUsage()->addCommandLineOption("--max-error <error>","Specify the maximum error","4.0");
+    arguments.getApplicationUsage()->addCommandLineOption("--quadric","Use the QUADRIC_EDGE_COLLAPSE method of the simplifier.");
+    arguments.getApplicationUsage()->addCommandLineOption("--benchmark","Simplify the model with each simplifier method, reporting the triangles removed per second and the Hausdorff error, then exit.");
 
 
     std::string outputFilename="model.osgt";
@@ -109,6 +335,12 @@ int main( int argc, char **argv )
     while (arguments.read("--max-error",maxError)) {}
     while (arguments.read("-o",outputFilename)) {}
 
+    osgUtil::Simplifier::Method method = osgUtil::Simplifier::EDGE_COLLAPSE;
+    while (arguments.read("--quadric")) { method = osgUtil::Simplifier::QUADRIC_EDGE_COLLAPSE; }
+
+    bool runBenchmark = false;
+    while (arguments.read("--benchmark")) { runBenchmark = true; }
+
     // if user request help write it out to cout.
     if (arguments.read("-h") || arguments.read("--help"))
     {
@@ -135,6 +367,12 @@ int main( int argc, char **argv )
         return 1;
     }
 
+    if (runBenchmark)
+    {
+        benchmark(loadedModel.get(), sampleRatio, maxError);
+        return 0;
+    }
+
     //loadedModel->accept(simplifier);
 
     unsigned int keyFlag = 0;
@@ -174,6 +412,7 @@ int main( int argc, char **argv )
             if (ratio<minRatio) ratio=minRatio;
 
             osgUtil::Simplifier simplifier(ratio, maxError);
+            simplifier.setMethod(method);
 
             std::cout<<"Running osgUtil::Simplifier with SampleRatio="<<ratio<<" maxError="<<maxError<<" ...";
             std::cout.flush();
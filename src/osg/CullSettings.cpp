@@ -44,6 +44,8 @@ void CullSettings::setDefaults()
     _cullMask = 0xffffffff;
     _cullMaskLeft = 0xffffffff;
     _cullMaskRight = 0xffffffff;
+    _parallelCullNumThreads = 0;
+    _parallelCullMinimumNumChildren = 256;
 
     // override during testing
     //_computeNearFar = COMPUTE_NEAR_FAR_USING_PRIMITIVES;
@@ -70,6 +72,9 @@ void CullSettings::setCullSettings(const CullSettings& rhs)
     _cullMask = rhs._cullMask;
     _cullMaskLeft = rhs._cullMaskLeft;
     _cullMaskRight =  rhs._cullMaskRight;
+
+    _parallelCullNumThreads = rhs._parallelCullNumThreads;
+    _parallelCullMinimumNumChildren = rhs._parallelCullMinimumNumChildren;
 }
 
 
@@ -88,11 +93,15 @@ void CullSettings::inheritCullSettings(const CullSettings& settings, unsigned in
     if (inheritanceMask & LOD_SCALE) _LODScale = settings._LODScale;
     if (inheritanceMask & SMALL_FEATURE_CULLING_PIXEL_SIZE) _smallFeatureCullingPixelSize = settings._smallFeatureCullingPixelSize;
     if (inheritanceMask & CLAMP_PROJECTION_MATRIX_CALLBACK) _clampProjectionMatrixCallback = settings._clampProjectionMatrixCallback;
+    if (inheritanceMask & PARALLEL_CULL_NUM_THREADS) _parallelCullNumThreads = settings._parallelCullNumThreads;
+    if (inheritanceMask & PARALLEL_CULL_MINIMUM_NUM_CHILDREN) _parallelCullMinimumNumChildren = settings._parallelCullMinimumNumChildren;
 }
 
 
 static ApplicationUsageProxy ApplicationUsageProxyCullSettings_e0(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_COMPUTE_NEAR_FAR_MODE <mode>","DO_NOT_COMPUTE_NEAR_FAR | COMPUTE_NEAR_FAR_USING_BOUNDING_VOLUMES | COMPUTE_NEAR_FAR_USING_PRIMITIVES");
 static ApplicationUsageProxy ApplicationUsageProxyCullSettings_e1(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_NEAR_FAR_RATIO <float>","Set the ratio between near and far planes - must greater than 0.0 but less than 1.0.");
+static ApplicationUsageProxy ApplicationUsageProxyCullSettings_e2(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_PARALLEL_CULL_NUM_THREADS <int>","Set the number of threads used to cull the children of large Groups in parallel, 0 or 1 disables the parallel cull.");
+static ApplicationUsageProxy ApplicationUsageProxyCullSettings_e3(ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_SOFTWARE_OCCLUSION_CULLING <mode>","ON | OFF - Cull drawables hidden behind the largest drawables of the previous frame using a depth buffer rasterized on the CPU.");
 
 void CullSettings::readEnvironmentalVariables()
 {
@@ -113,6 +122,19 @@ void CullSettings::readEnvironmentalVariables()
     {
         OSG_INFO<<"Set near/far ratio to "<<_nearFarRatio<<std::endl;
     }
+
+    if (getEnvVar("OSG_PARALLEL_CULL_NUM_THREADS", _parallelCullNumThreads))
+    {
+        OSG_INFO<<"Set parallel cull number of threads to "<<_parallelCullNumThreads<<std::endl;
+    }
+
+    if (getEnvVar("OSG_SOFTWARE_OCCLUSION_CULLING", value))
+    {
+        if (value=="ON") _cullingMode |= SOFTWARE_OCCLUSION_CULLING;
+        else if (value=="OFF") _cullingMode &= ~SOFTWARE_OCCLUSION_CULLING;
+
+        OSG_INFO<<"Set culling mode to "<<_cullingMode<<std::endl;
+    }
 }
 
 void CullSettings::readCommandLine(ArgumentParser& arguments)
@@ -124,11 +146,14 @@ void CullSettings::readCommandLine(ArgumentParser& arguments)
     {
         arguments.getApplicationUsage()->addCommandLineOption("--COMPUTE_NEAR_FAR_MODE <mode>","DO_NOT_COMPUTE_NEAR_FAR | COMPUTE_NEAR_FAR_USING_BOUNDING_VOLUMES | COMPUTE_NEAR_FAR_USING_PRIMITIVES");
         arguments.getApplicationUsage()->addCommandLineOption("--NEAR_FAR_RATIO <float>","Set the ratio between near and far planes - must greater than 0.0 but less than 1.0.");
+        arguments.getApplicationUsage()->addCommandLineOption("--PARALLEL_CULL_NUM_THREADS <int>","Set the number of threads used to cull the children of large Groups in parallel, 0 or 1 disables the parallel cull.");
+        arguments.getApplicationUsage()->addCommandLineOption("--SOFTWARE_OCCLUSION_CULLING","Cull drawables hidden behind the largest drawables of the previous frame using a depth buffer rasterized on the CPU.");
     }
 
     while(arguments.read("--NO_CULLING")) setCullingMode(NO_CULLING);
     while(arguments.read("--VIEW_FRUSTUM")) setCullingMode(VIEW_FRUSTUM_CULLING);
     while(arguments.read("--VIEW_FRUSTUM_SIDES") || arguments.read("--vfs") ) setCullingMode(VIEW_FRUSTUM_SIDES_CULLING);
+    while(arguments.read("--SOFTWARE_OCCLUSION_CULLING")) setCullingMode(getCullingMode()|SOFTWARE_OCCLUSION_CULLING);
 
 
     std::string str;
@@ -149,6 +174,13 @@ void CullSettings::readCommandLine(ArgumentParser& arguments)
         OSG_INFO<<"Set near/far ratio to "<<_nearFarRatio<<std::endl;
     }
 
+    unsigned int numThreads;
+    while(arguments.read("--PARALLEL_CULL_NUM_THREADS",numThreads))
+    {
+        _parallelCullNumThreads = numThreads;
+
+        OSG_INFO<<"Set parallel cull number of threads to "<<_parallelCullNumThreads<<std::endl;
+    }
 }
 
 void CullSettings::write(std::ostream& out)
@@ -170,6 +202,8 @@ void CullSettings::write(std::ostream& out)
     out<<"    _cullMask = "<<_cullMask<<std::endl;
     out<<"    _cullMaskLeft = "<<_cullMaskLeft<<std::endl;
     out<<"    _cullMaskRight = "<<_cullMaskRight<<std::endl;
+    out<<"    _parallelCullNumThreads = "<<_parallelCullNumThreads<<std::endl;
+    out<<"    _parallelCullMinimumNumChildren = "<<_parallelCullMinimumNumChildren<<std::endl;
 
     out<<"{"<<std::endl;
 }
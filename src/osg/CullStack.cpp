@@ -29,6 +29,15 @@ CullStack::CullStack()
     _index_modelviewCullingStack = 0;
     _back_modelviewCullingStack = 0;
 
+    _numAllocations = 0;
+    _numAbsoluteModelViewMatrices = 0;
+
+    _precomputedSphere = 0;
+    _precomputedBox = 0;
+    _precomputedCullingSetIndex = 0;
+    _precomputedCulled = false;
+    _precomputedResultMask = 0;
+
     _referenceViewPoints.push_back(osg::Vec3(0.0f,0.0f,0.0f));
 }
 
@@ -44,6 +53,15 @@ CullStack::CullStack(const CullStack& cs):
     _index_modelviewCullingStack = 0;
     _back_modelviewCullingStack = 0;
 
+    _numAllocations = 0;
+    _numAbsoluteModelViewMatrices = 0;
+
+    _precomputedSphere = 0;
+    _precomputedBox = 0;
+    _precomputedCullingSetIndex = 0;
+    _precomputedCulled = false;
+    _precomputedResultMask = 0;
+
     _referenceViewPoints.push_back(osg::Vec3(0.0f,0.0f,0.0f));
 }
 
@@ -77,6 +95,9 @@ void CullStack::reset()
     _index_modelviewCullingStack=0;
     _back_modelviewCullingStack = 0;
 
+    _precomputedSphere = 0;
+    _precomputedBox = 0;
+
     osg::Vec3 lookVector(0.0,0.0,-1.0);
 
     _bbCornerFar = (lookVector.x()>=0?1:0) |
@@ -86,6 +107,8 @@ void CullStack::reset()
     _bbCornerNear = (~_bbCornerFar)&7;
 
     _currentReuseMatrixIndex=0;
+    _numAllocations = 0;
+    _numAbsoluteModelViewMatrices = 0;
 }
 
 
@@ -161,6 +184,14 @@ void CullStack::pushProjectionMatrix(RefMatrix* matrix)
     _projectionCullingStack.push_back(osg::CullingSet());
     osg::CullingSet& cullingSet = _projectionCullingStack.back();
 
+    // reuse the planes of a previously popped frustum rather than allocating new ones.
+    if (!_reusePlaneLists.empty())
+    {
+        cullingSet.getFrustum().getPlaneList().swap(_reusePlaneLists.back());
+        _reusePlaneLists.pop_back();
+    }
+    cullingSet.getFrustum().getMaskStack().clear();
+
     // set up view frustum.
     cullingSet.getFrustum().setToUnitFrustum(((_cullingMode&NEAR_PLANE_CULLING)!=0),((_cullingMode&FAR_PLANE_CULLING)!=0));
     cullingSet.getFrustum().transformProvidingInverse(*matrix);
@@ -197,6 +228,9 @@ void CullStack::popProjectionMatrix()
 
     _projectionStack.pop_back();
 
+    _reusePlaneLists.push_back(Polytope::PlaneList());
+    _reusePlaneLists.back().swap(_projectionCullingStack.back().getFrustum().getPlaneList());
+
     _projectionCullingStack.pop_back();
 
     // need to recompute frustum volume.
@@ -211,6 +245,8 @@ void CullStack::pushModelViewMatrix(RefMatrix* matrix, Transform::ReferenceFrame
 
     _modelviewStack.push_back(matrix);
 
+    if (originalModelView && referenceFrame!=Transform::RELATIVE_RF) ++_numAbsoluteModelViewMatrices;
+
     pushCullingSet();
 
     osg::Matrix inv;
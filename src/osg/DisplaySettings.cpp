@@ -101,6 +101,7 @@ void DisplaySettings::setDisplaySettings(const DisplaySettings& vs)
     _compileContextsHint = vs._compileContextsHint;
     _serializeDrawDispatch = vs._serializeDrawDispatch;
     _useSceneViewForStereoHint = vs._useSceneViewForStereoHint;
+    _sharedStereoCullHint = vs._sharedStereoCullHint;
 
     _numDatabaseThreadsHint = vs._numDatabaseThreadsHint;
     _numHttpDatabaseThreadsHint = vs._numHttpDatabaseThreadsHint;
@@ -148,6 +149,7 @@ void DisplaySettings::merge(const DisplaySettings& vs)
     if (vs._compileContextsHint) _compileContextsHint = vs._compileContextsHint;
     if (vs._serializeDrawDispatch) _serializeDrawDispatch = vs._serializeDrawDispatch;
     if (vs._useSceneViewForStereoHint) _useSceneViewForStereoHint = vs._useSceneViewForStereoHint;
+    if (vs._sharedStereoCullHint) _sharedStereoCullHint = vs._sharedStereoCullHint;
 
     if (vs._numDatabaseThreadsHint>_numDatabaseThreadsHint) _numDatabaseThreadsHint = vs._numDatabaseThreadsHint;
     if (vs._numHttpDatabaseThreadsHint>_numHttpDatabaseThreadsHint) _numHttpDatabaseThreadsHint = vs._numHttpDatabaseThreadsHint;
@@ -231,6 +233,7 @@ void DisplaySettings::setDefaults()
     _compileContextsHint = false;
     _serializeDrawDispatch = false;
     _useSceneViewForStereoHint = true;
+    _sharedStereoCullHint = false;
 
     _numDatabaseThreadsHint = 2;
     _numHttpDatabaseThreadsHint = 1;
@@ -403,6 +406,9 @@ static ApplicationUsageProxy DisplaySetting_e35(ApplicationUsage::ENVIRONMENTAL_
 static ApplicationUsageProxy DisplaySetting_e36(ApplicationUsage::ENVIRONMENTAL_VARIABLE,
         "OSG_TEXT_SHADER_TECHNIQUE <value>",
         "Set the defafult osgText::ShaderTechnique. ALL_FEATURES | ALL | GREYSCALE | SIGNED_DISTANCE_FIELD | SDF | NO_TEXT_SHADER | NONE");
+static ApplicationUsageProxy DisplaySetting_e37(ApplicationUsage::ENVIRONMENTAL_VARIABLE,
+        "OSG_SHARED_STEREO_CULL <mode>",
+        "OFF | ON Disable/enable the hint for osgUtil::SceneView to cull both eyes of stereo with one traversal of the scene graph.");
 
 void DisplaySettings::readEnvironmentalVariables()
 {
@@ -573,6 +579,19 @@ void DisplaySettings::readEnvironmentalVariables()
         }
     }
 
+    if (getEnvVar("OSG_SHARED_STEREO_CULL", value))
+    {
+        if (value=="OFF")
+        {
+            _sharedStereoCullHint = false;
+        }
+        else
+        if (value=="ON")
+        {
+            _sharedStereoCullHint = true;
+        }
+    }
+
     getEnvVar("OSG_NUM_DATABASE_THREADS", _numDatabaseThreadsHint);
 
     getEnvVar("OSG_NUM_HTTP_DATABASE_THREADS", _numHttpDatabaseThreadsHint);
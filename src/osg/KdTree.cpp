@@ -19,6 +19,8 @@
 
 #include <osg/io_utils>
 
+#include <algorithm>
+
 using namespace osg;
 
 //#define VERBOSE_OUTPUT
@@ -31,9 +33,11 @@ using namespace osg;
 struct BuildKdTree
 {
     BuildKdTree(KdTree& kdTree):
-        _kdTree(kdTree) {}
+        _kdTree(kdTree),
+        _collectBounds(false) {}
 
     typedef std::vector< osg::Vec3 >            CenterList;
+    typedef std::vector< osg::BoundingBox >     BoundsList;
     typedef std::vector< unsigned int >           Indices;
     typedef std::vector< unsigned int >         AxisStack;
 
@@ -43,12 +47,27 @@ struct BuildKdTree
 
     int divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int nodeIndex, unsigned int level);
 
+    bool computeSAHSplit(KdTree::BuildOptions& options, int istart, int iend, int& axis, float& splitMin, float& splitScale, int& splitBin);
+
+    void computeLeafBound(KdTree::KdNode& node);
+
+    void reorderDepthFirst();
+
+    inline void addPrimitive(const osg::BoundingBox& bb)
+    {
+        _primitiveIndices.push_back(_centers.size());
+        _centers.push_back(bb.center());
+        if (_collectBounds) _bounds.push_back(bb);
+    }
+
     KdTree&             _kdTree;
 
     osg::BoundingBox    _bb;
     AxisStack           _axisStack;
     Indices             _primitiveIndices;
     CenterList          _centers;
+    bool                _collectBounds;
+    BoundsList          _bounds;
 
 protected:
 
@@ -72,8 +91,7 @@ struct PrimitiveIndicesCollector
         osg::BoundingBox bb;
         bb.expandBy(v0);
 
-        _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
-        _buildKdTree->_centers.push_back(bb.center());
+        _buildKdTree->addPrimitive(bb);
     }
 
     inline void operator () (unsigned int p0, unsigned int p1)
@@ -96,8 +114,7 @@ struct PrimitiveIndicesCollector
         bb.expandBy(v0);
         bb.expandBy(v1);
 
-        _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
-        _buildKdTree->_centers.push_back(bb.center());
+        _buildKdTree->addPrimitive(bb);
     }
 
     inline void operator () (unsigned int p0, unsigned int p1, unsigned int p2)
@@ -123,8 +140,7 @@ struct PrimitiveIndicesCollector
         bb.expandBy(v1);
         bb.expandBy(v2);
 
-        _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
-        _buildKdTree->_centers.push_back(bb.center());
+        _buildKdTree->addPrimitive(bb);
     }
 
     inline void operator () (unsigned int p0, unsigned int p1, unsigned int p2, unsigned int p3)
@@ -152,8 +168,7 @@ struct PrimitiveIndicesCollector
         bb.expandBy(v2);
         bb.expandBy(v3);
 
-        _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
-        _buildKdTree->_centers.push_back(bb.center());
+        _buildKdTree->addPrimitive(bb);
     }
 
     BuildKdTree* _buildKdTree;
@@ -196,6 +211,9 @@ bool BuildKdTree::build(KdTree::BuildOptions& options, osg::Geometry* geometry)
     _primitiveIndices.reserve(estimatedNumTriangles);
     _centers.reserve(estimatedNumTriangles);
 
+    _collectBounds = (options._splitMethod==KdTree::BuildOptions::SURFACE_AREA_HEURISTIC_SPLIT);
+    if (_collectBounds) _bounds.reserve(estimatedNumTriangles);
+
     osg::TemplatePrimitiveIndexFunctor<PrimitiveIndicesCollector> collectIndices;
     collectIndices._buildKdTree = this;
     geometry->accept(collectIndices);
@@ -222,6 +240,10 @@ bool BuildKdTree::build(KdTree::BuildOptions& options, osg::Geometry* geometry)
     }
     primitiveIndices.swap(new_indices);
 
+    if (options._splitMethod==KdTree::BuildOptions::SURFACE_AREA_HEURISTIC_SPLIT)
+    {
+        reorderDepthFirst();
+    }
 
 #ifdef VERBOSE_OUTPUT
     OSG_NOTICE<<"Root nodeNum="<<nodeNum<<std::endl;
@@ -271,6 +293,217 @@ void BuildKdTree::computeDivisions(KdTree::BuildOptions& options)
 #endif
 }
 
+void BuildKdTree::computeLeafBound(KdTree::KdNode& node)
+{
+    int istart = -node.first-1;
+    int iend = istart+node.second-1;
+
+    // leaf is done, now compute bound on it.
+    node.bb.init();
+    for(int i=istart; i<=iend; ++i)
+    {
+        unsigned int primitiveIndex = _kdTree.getPrimitiveIndices()[_primitiveIndices[i]];
+        primitiveIndex++; //skip original Primitive index
+        unsigned int numPoints = _kdTree.getVertexIndices()[primitiveIndex++];
+
+        for(; numPoints>0; --numPoints)
+        {
+            unsigned int vi = _kdTree.getVertexIndices()[primitiveIndex++];
+            const osg::Vec3& v = (*_kdTree.getVertices())[vi];
+            node.bb.expandBy(v);
+        }
+    }
+
+    if (node.bb.valid())
+    {
+        float epsilon = 1e-6f;
+        node.bb._min.x() -= epsilon;
+        node.bb._min.y() -= epsilon;
+        node.bb._min.z() -= epsilon;
+        node.bb._max.x() += epsilon;
+        node.bb._max.y() += epsilon;
+        node.bb._max.z() += epsilon;
+    }
+
+#ifdef VERBOSE_OUTPUT
+    if (!node.bb.valid())
+    {
+        OSG_NOTICE<<"After reset "<<node.first<<","<<node.second<<std::endl;
+        OSG_NOTICE<<"  bb._min ("<<node.bb._min<<")"<<std::endl;
+        OSG_NOTICE<<"  bb._max ("<<node.bb._max<<")"<<std::endl;
+    }
+#endif
+}
+
+static inline float surfaceArea(const osg::BoundingBox& bb)
+{
+    if (!bb.valid()) return 0.0f;
+    float dx = bb.xMax()-bb.xMin();
+    float dy = bb.yMax()-bb.yMin();
+    float dz = bb.zMax()-bb.zMin();
+    return 2.0f*(dx*dy + dy*dz + dz*dx);
+}
+
+static const unsigned int maxNumSAHBins = 64;
+
+static inline unsigned int getNumSAHBins(const KdTree::BuildOptions& options)
+{
+    return osg::clampBetween(options._numSAHBins, 2u, maxNumSAHBins);
+}
+
+bool BuildKdTree::computeSAHSplit(KdTree::BuildOptions& options, int istart, int iend, int& axis, float& splitMin, float& splitScale, int& splitBin)
+{
+    unsigned int numBins = getNumSAHBins(options);
+
+    osg::BoundingBox nodeBound;
+    osg::BoundingBox centerBound;
+    for(int i=istart; i<=iend; ++i)
+    {
+        unsigned int pi = _primitiveIndices[i];
+        nodeBound.expandBy(_bounds[pi]);
+        centerBound.expandBy(_centers[pi]);
+    }
+
+    float nodeArea = surfaceArea(nodeBound);
+    if (nodeArea<=0.0f) return false;
+
+    unsigned int numPrimitives = (iend-istart)+1;
+
+    // the cost of not dividing at all, the split has to beat this.
+    float bestCost = options._intersectionCost*float(numPrimitives);
+    bool found = false;
+
+    osg::BoundingBox binBounds[maxNumSAHBins];
+    unsigned int binCounts[maxNumSAHBins];
+    float rightAreas[maxNumSAHBins];
+    unsigned int rightCounts[maxNumSAHBins];
+
+    for(int a=0; a<3; ++a)
+    {
+        float cmin = centerBound._min[a];
+        float cmax = centerBound._max[a];
+        if (cmax<=cmin) continue;
+
+        float scale = float(numBins)/(cmax-cmin);
+
+        for(unsigned int b=0; b<numBins; ++b)
+        {
+            binBounds[b].init();
+            binCounts[b] = 0;
+        }
+
+        for(int i=istart; i<=iend; ++i)
+        {
+            unsigned int pi = _primitiveIndices[i];
+            unsigned int b = osg::minimum(numBins-1, static_cast<unsigned int>((_centers[pi][a]-cmin)*scale));
+            binBounds[b].expandBy(_bounds[pi]);
+            ++binCounts[b];
+        }
+
+        // sweep from the right to accumulate the area and count of everything right of each candidate plane.
+        osg::BoundingBox accumulated;
+        unsigned int count = 0;
+        for(unsigned int b=numBins-1; b>0; --b)
+        {
+            accumulated.expandBy(binBounds[b]);
+            count += binCounts[b];
+            rightAreas[b-1] = surfaceArea(accumulated);
+            rightCounts[b-1] = count;
+        }
+
+        // then sweep from the left evaluating the cost of splitting after bin b.
+        accumulated.init();
+        count = 0;
+        for(unsigned int b=0; b<numBins-1; ++b)
+        {
+            accumulated.expandBy(binBounds[b]);
+            count += binCounts[b];
+
+            if (count==0 || rightCounts[b]==0) continue;
+
+            float cost = options._traversalCost +
+                         options._intersectionCost*(surfaceArea(accumulated)*float(count) + rightAreas[b]*float(rightCounts[b]))/nodeArea;
+
+            if (cost<bestCost)
+            {
+                bestCost = cost;
+                axis = a;
+                splitMin = cmin;
+                splitScale = scale;
+                splitBin = b;
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+void BuildKdTree::reorderDepthFirst()
+{
+    KdTree::KdNodeList& nodes = _kdTree.getNodes();
+    if (nodes.empty()) return;
+
+    // assign new indices in pre-order so that each node's first child immediately follows it in memory.
+    std::vector<int> newIndices(nodes.size(), 0);
+    KdTree::KdNodeList reordered;
+    reordered.reserve(nodes.size());
+
+    std::vector<int> stack;
+    stack.push_back(0);
+    while(!stack.empty())
+    {
+        int nodeIndex = stack.back();
+        stack.pop_back();
+
+        newIndices[nodeIndex] = static_cast<int>(reordered.size());
+        reordered.push_back(nodes[nodeIndex]);
+
+        const KdTree::KdNode& node = nodes[nodeIndex];
+        if (node.first>=0)
+        {
+            if (node.second>0) stack.push_back(node.second);
+            if (node.first>0) stack.push_back(node.first);
+        }
+    }
+
+    for(KdTree::KdNodeList::iterator itr = reordered.begin();
+        itr != reordered.end();
+        ++itr)
+    {
+        if (itr->first>=0)
+        {
+            if (itr->first>0) itr->first = newIndices[itr->first];
+            if (itr->second>0) itr->second = newIndices[itr->second];
+        }
+    }
+
+    nodes.swap(reordered);
+}
+
+struct SAHBinPredicate
+{
+    SAHBinPredicate(const BuildKdTree::CenterList& centers, int axis, float splitMin, float splitScale, int splitBin, unsigned int numBins):
+        _centers(centers), _axis(axis), _splitMin(splitMin), _splitScale(splitScale), _splitBin(splitBin), _numBins(numBins) {}
+
+    bool operator() (unsigned int pi) const
+    {
+        unsigned int b = osg::minimum(_numBins-1, static_cast<unsigned int>((_centers[pi][_axis]-_splitMin)*_splitScale));
+        return static_cast<int>(b)<=_splitBin;
+    }
+
+    const BuildKdTree::CenterList& _centers;
+    int             _axis;
+    float           _splitMin;
+    float           _splitScale;
+    int             _splitBin;
+    unsigned int    _numBins;
+
+protected:
+
+    SAHBinPredicate& operator = (const SAHBinPredicate&) { return *this; }
+};
+
 int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int nodeIndex, unsigned int level)
 {
     KdTree::KdNode& node = _kdTree.getNode(nodeIndex);
@@ -278,56 +511,55 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
     bool needToDivide = level < _axisStack.size() &&
                         (node.first<0 && static_cast<unsigned int>(node.second)>options._targetNumTrianglesPerLeaf);
 
+    int sahAxis = 0;
+    float sahSplitMin = 0.0f;
+    float sahSplitScale = 0.0f;
+    int sahSplitBin = 0;
+
+    if (needToDivide && options._splitMethod==KdTree::BuildOptions::SURFACE_AREA_HEURISTIC_SPLIT)
+    {
+        int istart = -node.first-1;
+        int iend = istart+node.second-1;
+        needToDivide = computeSAHSplit(options, istart, iend, sahAxis, sahSplitMin, sahSplitScale, sahSplitBin);
+    }
+
     if (!needToDivide)
     {
         if (node.first<0)
         {
-            int istart = -node.first-1;
-            int iend = istart+node.second-1;
+            computeLeafBound(node);
+        }
 
-            // leaf is done, now compute bound on it.
-            node.bb.init();
-            for(int i=istart; i<=iend; ++i)
-            {
-                unsigned int primitiveIndex = _kdTree.getPrimitiveIndices()[_primitiveIndices[i]];
-                primitiveIndex++; //skip original Primitive index
-                unsigned int numPoints = _kdTree.getVertexIndices()[primitiveIndex++];
+        return nodeIndex;
 
-                for(; numPoints>0; --numPoints)
-                {
-                    unsigned int vi = _kdTree.getVertexIndices()[primitiveIndex++];
-                    const osg::Vec3& v = (*_kdTree.getVertices())[vi];
-                    node.bb.expandBy(v);
-                }
-            }
+    }
 
-            if (node.bb.valid())
-            {
-                float epsilon = 1e-6f;
-                node.bb._min.x() -= epsilon;
-                node.bb._min.y() -= epsilon;
-                node.bb._min.z() -= epsilon;
-                node.bb._max.x() += epsilon;
-                node.bb._max.y() += epsilon;
-                node.bb._max.z() += epsilon;
-            }
+    if (options._splitMethod==KdTree::BuildOptions::SURFACE_AREA_HEURISTIC_SPLIT)
+    {
+        int istart = -node.first-1;
+        int iend = istart+node.second-1;
 
-#ifdef VERBOSE_OUTPUT
-            if (!node.bb.valid())
-            {
-                OSG_NOTICE<<"After reset "<<node.first<<","<<node.second<<std::endl;
-                OSG_NOTICE<<"  bb._min ("<<node.bb._min<<")"<<std::endl;
-                OSG_NOTICE<<"  bb._max ("<<node.bb._max<<")"<<std::endl;
-            }
-            else
-            {
-                OSG_NOTICE<<"Set bb for nodeIndex = "<<nodeIndex<<std::endl;
-            }
-#endif
-        }
+        Indices::iterator middle = std::partition(_primitiveIndices.begin()+istart, _primitiveIndices.begin()+iend+1,
+                                                  SAHBinPredicate(_centers, sahAxis, sahSplitMin, sahSplitScale, sahSplitBin, getNumSAHBins(options)));
+        int left = static_cast<int>(middle-_primitiveIndices.begin());
 
-        return nodeIndex;
+        // computeSAHSplit() only accepts splits with primitives on both sides
+        int leftChildIndex = _kdTree.addNode(KdTree::KdNode(-istart-1, left-istart));
+        int rightChildIndex = _kdTree.addNode(KdTree::KdNode(-left-1, (iend-left)+1));
+
+        leftChildIndex = divide(options, bb, leftChildIndex, level+1);
+        rightChildIndex = divide(options, bb, rightChildIndex, level+1);
 
+        // take a second reference as the std::vector<> resize could have invalidated the previous node ref.
+        KdTree::KdNode& newNodeRef = _kdTree.getNode(nodeIndex);
+        newNodeRef.first = leftChildIndex;
+        newNodeRef.second = rightChildIndex;
+
+        newNodeRef.bb.init();
+        newNodeRef.bb.expandBy(_kdTree.getNode(leftChildIndex).bb);
+        newNodeRef.bb.expandBy(_kdTree.getNode(rightChildIndex).bb);
+
+        return nodeIndex;
     }
 
     int axis = _axisStack[level];
@@ -476,7 +708,11 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
 KdTree::BuildOptions::BuildOptions():
         _numVerticesProcessed(0),
         _targetNumTrianglesPerLeaf(4),
-        _maxNumLevels(32)
+        _maxNumLevels(32),
+        _splitMethod(MIDPOINT_SPLIT),
+        _numSAHBins(16),
+        _traversalCost(1.0f),
+        _intersectionCost(1.5f)
 {
 }
 
@@ -14,6 +14,21 @@
 #include <osg/Polytope>
 #include <osg/Notify>
 
+// the batch tests run four bounds through each plane at a time, this requires double precision planes to
+// match the results of Plane::intersect() as the bounds are converted to the precision of the plane.
+#if !defined(OSG_USE_FLOAT_PLANE)
+    #if defined(__AVX__)
+        #include <immintrin.h>
+        #define OSG_POLYTOPE_BATCH_AVX
+    #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+        #include <emmintrin.h>
+        #define OSG_POLYTOPE_BATCH_SSE2
+    #elif defined(__aarch64__) || defined(_M_ARM64)
+        #include <arm_neon.h>
+        #define OSG_POLYTOPE_BATCH_NEON
+    #endif
+#endif
+
 using namespace osg;
 
 bool Polytope::contains(const osg::Vec3f& v0, const osg::Vec3f& v1, const osg::Vec3f& v2) const
@@ -99,3 +114,417 @@ bool Polytope::contains(const osg::Vec3f& v0, const osg::Vec3f& v1, const osg::V
     //OSG_NOTICE<<"Polytope::contains() triangle within Polytope, src.size()="<<src.size()<<std::endl;
     return true;
 }
+
+namespace
+{
+
+#if defined(OSG_POLYTOPE_BATCH_AVX)
+
+    /** Four doubles, one for each bound in a block.*/
+    struct Batch { __m256d v; };
+
+    inline Batch set(double a0, double a1, double a2, double a3) { Batch b; b.v = _mm256_set_pd(a3, a2, a1, a0); return b; }
+    inline Batch broadcast(double value) { Batch b; b.v = _mm256_set1_pd(value); return b; }
+    inline Batch add(const Batch& lhs, const Batch& rhs) { Batch b; b.v = _mm256_add_pd(lhs.v, rhs.v); return b; }
+    inline Batch mul(const Batch& lhs, const Batch& rhs) { Batch b; b.v = _mm256_mul_pd(lhs.v, rhs.v); return b; }
+    inline Batch negate(const Batch& lhs) { Batch b; b.v = _mm256_xor_pd(lhs.v, _mm256_set1_pd(-0.0)); return b; }
+    inline Batch roundToFloat(const Batch& lhs) { Batch b; b.v = _mm256_cvtps_pd(_mm256_cvtpd_ps(lhs.v)); return b; }
+    inline unsigned int greaterThan(const Batch& lhs, const Batch& rhs) { return _mm256_movemask_pd(_mm256_cmp_pd(lhs.v, rhs.v, _CMP_GT_OQ)); }
+    inline unsigned int lessThan(const Batch& lhs, const Batch& rhs) { return _mm256_movemask_pd(_mm256_cmp_pd(lhs.v, rhs.v, _CMP_LT_OQ)); }
+
+    /** Four floats, one for each bound in a block.*/
+    struct FloatBatch { __m128 v; };
+
+    inline FloatBatch toFloat(const Batch& lhs) { FloatBatch b; b.v = _mm256_cvtpd_ps(lhs.v); return b; }
+    inline FloatBatch negate(const FloatBatch& lhs) { FloatBatch b; b.v = _mm_xor_ps(lhs.v, _mm_set1_ps(-0.0f)); return b; }
+    inline unsigned int greaterThan(const FloatBatch& lhs, const FloatBatch& rhs) { return _mm_movemask_ps(_mm_cmpgt_ps(lhs.v, rhs.v)); }
+    inline unsigned int lessThan(const FloatBatch& lhs, const FloatBatch& rhs) { return _mm_movemask_ps(_mm_cmplt_ps(lhs.v, rhs.v)); }
+
+    /** Load four spheres stored as x, y, z, radius floats, transposing them into a batch for each component.*/
+    inline void loadSpheres(const float* ptr, Batch& x, Batch& y, Batch& z, FloatBatch& radius)
+    {
+        __m128 r0 = _mm_loadu_ps(ptr);
+        __m128 r1 = _mm_loadu_ps(ptr+4);
+        __m128 r2 = _mm_loadu_ps(ptr+8);
+        __m128 r3 = _mm_loadu_ps(ptr+12);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        x.v = _mm256_cvtps_pd(r0);
+        y.v = _mm256_cvtps_pd(r1);
+        z.v = _mm256_cvtps_pd(r2);
+        radius.v = r3;
+    }
+
+    inline FloatBatch setFloat(float a0, float a1, float a2, float a3) { FloatBatch b; b.v = _mm_set_ps(a3, a2, a1, a0); return b; }
+
+#elif defined(OSG_POLYTOPE_BATCH_SSE2)
+
+    /** Four doubles, one for each bound in a block.*/
+    struct Batch { __m128d lo, hi; };
+
+    inline Batch set(double a0, double a1, double a2, double a3) { Batch b; b.lo = _mm_set_pd(a1, a0); b.hi = _mm_set_pd(a3, a2); return b; }
+    inline Batch broadcast(double value) { Batch b; b.lo = b.hi = _mm_set1_pd(value); return b; }
+    inline Batch add(const Batch& lhs, const Batch& rhs) { Batch b; b.lo = _mm_add_pd(lhs.lo, rhs.lo); b.hi = _mm_add_pd(lhs.hi, rhs.hi); return b; }
+    inline Batch mul(const Batch& lhs, const Batch& rhs) { Batch b; b.lo = _mm_mul_pd(lhs.lo, rhs.lo); b.hi = _mm_mul_pd(lhs.hi, rhs.hi); return b; }
+
+    inline Batch negate(const Batch& lhs)
+    {
+        __m128d sign = _mm_set1_pd(-0.0);
+        Batch b;
+        b.lo = _mm_xor_pd(lhs.lo, sign);
+        b.hi = _mm_xor_pd(lhs.hi, sign);
+        return b;
+    }
+
+    inline Batch roundToFloat(const Batch& lhs)
+    {
+        Batch b;
+        b.lo = _mm_cvtps_pd(_mm_cvtpd_ps(lhs.lo));
+        b.hi = _mm_cvtps_pd(_mm_cvtpd_ps(lhs.hi));
+        return b;
+    }
+
+    inline unsigned int greaterThan(const Batch& lhs, const Batch& rhs) { return _mm_movemask_pd(_mm_cmpgt_pd(lhs.lo, rhs.lo)) | (_mm_movemask_pd(_mm_cmpgt_pd(lhs.hi, rhs.hi))<<2); }
+    inline unsigned int lessThan(const Batch& lhs, const Batch& rhs) { return _mm_movemask_pd(_mm_cmplt_pd(lhs.lo, rhs.lo)) | (_mm_movemask_pd(_mm_cmplt_pd(lhs.hi, rhs.hi))<<2); }
+
+    /** Four floats, one for each bound in a block.*/
+    struct FloatBatch { __m128 v; };
+
+    inline FloatBatch toFloat(const Batch& lhs) { FloatBatch b; b.v = _mm_movelh_ps(_mm_cvtpd_ps(lhs.lo), _mm_cvtpd_ps(lhs.hi)); return b; }
+    inline FloatBatch negate(const FloatBatch& lhs) { FloatBatch b; b.v = _mm_xor_ps(lhs.v, _mm_set1_ps(-0.0f)); return b; }
+    inline unsigned int greaterThan(const FloatBatch& lhs, const FloatBatch& rhs) { return _mm_movemask_ps(_mm_cmpgt_ps(lhs.v, rhs.v)); }
+    inline unsigned int lessThan(const FloatBatch& lhs, const FloatBatch& rhs) { return _mm_movemask_ps(_mm_cmplt_ps(lhs.v, rhs.v)); }
+
+    /** Load four spheres stored as x, y, z, radius floats, transposing them into a batch for each component.*/
+    inline void loadSpheres(const float* ptr, Batch& x, Batch& y, Batch& z, FloatBatch& radius)
+    {
+        __m128 r0 = _mm_loadu_ps(ptr);
+        __m128 r1 = _mm_loadu_ps(ptr+4);
+        __m128 r2 = _mm_loadu_ps(ptr+8);
+        __m128 r3 = _mm_loadu_ps(ptr+12);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        x.lo = _mm_cvtps_pd(r0); x.hi = _mm_cvtps_pd(_mm_movehl_ps(r0, r0));
+        y.lo = _mm_cvtps_pd(r1); y.hi = _mm_cvtps_pd(_mm_movehl_ps(r1, r1));
+        z.lo = _mm_cvtps_pd(r2); z.hi = _mm_cvtps_pd(_mm_movehl_ps(r2, r2));
+        radius.v = r3;
+    }
+
+    inline FloatBatch setFloat(float a0, float a1, float a2, float a3) { FloatBatch b; b.v = _mm_set_ps(a3, a2, a1, a0); return b; }
+
+#elif defined(OSG_POLYTOPE_BATCH_NEON)
+
+    /** Four doubles, one for each bound in a block.*/
+    struct Batch { float64x2_t lo, hi; };
+
+    inline Batch set(double a0, double a1, double a2, double a3)
+    {
+        Batch b;
+        b.lo = vsetq_lane_f64(a1, vdupq_n_f64(a0), 1);
+        b.hi = vsetq_lane_f64(a3, vdupq_n_f64(a2), 1);
+        return b;
+    }
+
+    inline Batch broadcast(double value) { Batch b; b.lo = b.hi = vdupq_n_f64(value); return b; }
+    inline Batch add(const Batch& lhs, const Batch& rhs) { Batch b; b.lo = vaddq_f64(lhs.lo, rhs.lo); b.hi = vaddq_f64(lhs.hi, rhs.hi); return b; }
+    inline Batch mul(const Batch& lhs, const Batch& rhs) { Batch b; b.lo = vmulq_f64(lhs.lo, rhs.lo); b.hi = vmulq_f64(lhs.hi, rhs.hi); return b; }
+    inline Batch negate(const Batch& lhs) { Batch b; b.lo = vnegq_f64(lhs.lo); b.hi = vnegq_f64(lhs.hi); return b; }
+
+    inline Batch roundToFloat(const Batch& lhs)
+    {
+        Batch b;
+        b.lo = vcvt_f64_f32(vcvt_f32_f64(lhs.lo));
+        b.hi = vcvt_f64_f32(vcvt_f32_f64(lhs.hi));
+        return b;
+    }
+
+    inline unsigned int toBits(uint64x2_t lo, uint64x2_t hi)
+    {
+        return static_cast<unsigned int>((vgetq_lane_u64(lo, 0)&1) | ((vgetq_lane_u64(lo, 1)&1)<<1) |
+                                         ((vgetq_lane_u64(hi, 0)&1)<<2) | ((vgetq_lane_u64(hi, 1)&1)<<3));
+    }
+
+    inline unsigned int greaterThan(const Batch& lhs, const Batch& rhs) { return toBits(vcgtq_f64(lhs.lo, rhs.lo), vcgtq_f64(lhs.hi, rhs.hi)); }
+    inline unsigned int lessThan(const Batch& lhs, const Batch& rhs) { return toBits(vcltq_f64(lhs.lo, rhs.lo), vcltq_f64(lhs.hi, rhs.hi)); }
+
+    /** Four floats, one for each bound in a block.*/
+    struct FloatBatch { float32x4_t v; };
+
+    inline FloatBatch toFloat(const Batch& lhs) { FloatBatch b; b.v = vcombine_f32(vcvt_f32_f64(lhs.lo), vcvt_f32_f64(lhs.hi)); return b; }
+    inline FloatBatch negate(const FloatBatch& lhs) { FloatBatch b; b.v = vnegq_f32(lhs.v); return b; }
+
+    inline unsigned int toBits(uint32x4_t mask)
+    {
+        static const uint32_t s_bits[4] = { 1, 2, 4, 8 };
+        return vaddvq_u32(vandq_u32(mask, vld1q_u32(s_bits)));
+    }
+
+    inline unsigned int greaterThan(const FloatBatch& lhs, const FloatBatch& rhs) { return toBits(vcgtq_f32(lhs.v, rhs.v)); }
+    inline unsigned int lessThan(const FloatBatch& lhs, const FloatBatch& rhs) { return toBits(vcltq_f32(lhs.v, rhs.v)); }
+
+    /** Load four spheres stored as x, y, z, radius floats, transposing them into a batch for each component.*/
+    inline void loadSpheres(const float* ptr, Batch& x, Batch& y, Batch& z, FloatBatch& radius)
+    {
+        float32x4x4_t v = vld4q_f32(ptr);
+        x.lo = vcvt_f64_f32(vget_low_f32(v.val[0])); x.hi = vcvt_high_f64_f32(v.val[0]);
+        y.lo = vcvt_f64_f32(vget_low_f32(v.val[1])); y.hi = vcvt_high_f64_f32(v.val[1]);
+        z.lo = vcvt_f64_f32(vget_low_f32(v.val[2])); z.hi = vcvt_high_f64_f32(v.val[2]);
+        radius.v = v.val[3];
+    }
+
+    inline FloatBatch setFloat(float a0, float a1, float a2, float a3)
+    {
+        float values[4] = { a0, a1, a2, a3 };
+        FloatBatch b;
+        b.v = vld1q_f32(values);
+        return b;
+    }
+
+#endif
+
+#if defined(OSG_POLYTOPE_BATCH_AVX) || defined(OSG_POLYTOPE_BATCH_SSE2) || defined(OSG_POLYTOPE_BATCH_NEON)
+
+    /** An active plane of the polytope with its coefficients broadcast ready for testing blocks of bounds.*/
+    struct ActivePlane
+    {
+        void set(const Plane& plane, Polytope::ClippingMask selectorMask)
+        {
+            a = broadcast(plane[0]);
+            b = broadcast(plane[1]);
+            c = broadcast(plane[2]);
+            d = broadcast(plane[3]);
+            lowerBBCorner = plane.getLowerBBCorner();
+            upperBBCorner = plane.getUpperBBCorner();
+            selector = selectorMask;
+        }
+
+        /** Same order of operations as Plane::distance().*/
+        inline Batch distance(const Batch& x, const Batch& y, const Batch& z) const
+        {
+            return add(add(add(mul(a, x), mul(b, y)), mul(c, z)), d);
+        }
+
+        Batch                   a, b, c, d;
+        unsigned int            lowerBBCorner;
+        unsigned int            upperBBCorner;
+        Polytope::ClippingMask  selector;
+    };
+
+    /** Up to four bounding spheres transposed so that each plane can be tested against all of them at once.
+      * Plane::intersect(const BoundingSphere&) compares the distance as a float, so float spheres are compared
+      * four at a time as floats and double spheres as doubles rounded to float.*/
+    struct SphereBlock
+    {
+        SphereBlock(const BoundingSphere* spheres, unsigned int num)
+        {
+            if (isFloat() && num==4 && sizeof(BoundingSphere)==4*sizeof(float))
+            {
+                loadSpheres(reinterpret_cast<const float*>(spheres), _x, _y, _z, _floatRadius);
+            }
+            else
+            {
+                // pad a partial block with copies of its last sphere.
+                const BoundingSphere& s0 = spheres[0];
+                const BoundingSphere& s1 = spheres[num>1 ? 1 : num-1];
+                const BoundingSphere& s2 = spheres[num>2 ? 2 : num-1];
+                const BoundingSphere& s3 = spheres[num>3 ? 3 : num-1];
+                _x = set(s0.center().x(), s1.center().x(), s2.center().x(), s3.center().x());
+                _y = set(s0.center().y(), s1.center().y(), s2.center().y(), s3.center().y());
+                _z = set(s0.center().z(), s1.center().z(), s2.center().z(), s3.center().z());
+                if (isFloat()) _floatRadius = setFloat(s0.radius(), s1.radius(), s2.radius(), s3.radius());
+                else _radius = set(s0.radius(), s1.radius(), s2.radius(), s3.radius());
+            }
+
+            if (isFloat()) _negativeFloatRadius = negate(_floatRadius);
+            else _negativeRadius = negate(_radius);
+        }
+
+        static inline bool isFloat() { return sizeof(BoundingSphere::value_type)==sizeof(float); }
+
+        /** Return the bits of the spheres completely above the plane, and set below to the bits of those completely below it.*/
+        inline unsigned int intersect(const ActivePlane& plane, unsigned int& below) const
+        {
+            unsigned int above;
+            if (isFloat())
+            {
+                FloatBatch d = toFloat(plane.distance(_x, _y, _z));
+                above = greaterThan(d, _floatRadius);
+                below = lessThan(d, _negativeFloatRadius) & ~above;
+            }
+            else
+            {
+                Batch d = roundToFloat(plane.distance(_x, _y, _z));
+                above = greaterThan(d, _radius);
+                below = lessThan(d, _negativeRadius) & ~above;
+            }
+            return above;
+        }
+
+        Batch       _x, _y, _z;
+        FloatBatch  _floatRadius, _negativeFloatRadius;
+        Batch       _radius, _negativeRadius;
+    };
+
+    /** Up to four bounding boxes transposed so that each plane can be tested against all of them at once.
+      * Plane::intersect(const BoundingBox&) compares the distances of the corners of float boxes as floats
+      * and those of double boxes as doubles.*/
+    struct BoxBlock
+    {
+        BoxBlock(const BoundingBox* boxes, unsigned int num)
+        {
+            // pad a partial block with copies of its last box.
+            const BoundingBox& b0 = boxes[0];
+            const BoundingBox& b1 = boxes[num>1 ? 1 : num-1];
+            const BoundingBox& b2 = boxes[num>2 ? 2 : num-1];
+            const BoundingBox& b3 = boxes[num>3 ? 3 : num-1];
+            _coords[0] = set(b0.xMin(), b1.xMin(), b2.xMin(), b3.xMin());
+            _coords[1] = set(b0.yMin(), b1.yMin(), b2.yMin(), b3.yMin());
+            _coords[2] = set(b0.zMin(), b1.zMin(), b2.zMin(), b3.zMin());
+            _coords[3] = set(b0.xMax(), b1.xMax(), b2.xMax(), b3.xMax());
+            _coords[4] = set(b0.yMax(), b1.yMax(), b2.yMax(), b3.yMax());
+            _coords[5] = set(b0.zMax(), b1.zMax(), b2.zMax(), b3.zMax());
+            _zero = broadcast(0.0);
+            _floatZero = setFloat(0.0f, 0.0f, 0.0f, 0.0f);
+        }
+
+        static inline bool isFloat() { return sizeof(BoundingBox::value_type)==sizeof(float); }
+
+        /** Distance of the given corner of each box, using the corner numbering of BoundingBox::corner().*/
+        inline Batch cornerDistance(const ActivePlane& plane, unsigned int corner) const
+        {
+            return plane.distance(_coords[(corner&1) ? 3 : 0], _coords[(corner&2) ? 4 : 1], _coords[(corner&4) ? 5 : 2]);
+        }
+
+        /** Return the bits of the boxes completely above the plane, and set below to the bits of those completely below it.*/
+        inline unsigned int intersect(const ActivePlane& plane, unsigned int& below) const
+        {
+            unsigned int above;
+            if (isFloat())
+            {
+                above = greaterThan(toFloat(cornerDistance(plane, plane.lowerBBCorner)), _floatZero);
+                below = lessThan(toFloat(cornerDistance(plane, plane.upperBBCorner)), _floatZero) & ~above;
+            }
+            else
+            {
+                above = greaterThan(cornerDistance(plane, plane.lowerBBCorner), _zero);
+                below = lessThan(cornerDistance(plane, plane.upperBBCorner), _zero) & ~above;
+            }
+            return above;
+        }
+
+        Batch       _coords[6];
+        Batch       _zero;
+        FloatBatch  _floatZero;
+    };
+
+#else
+
+    /** An active plane of the polytope, tested with Plane::intersect() when no vector instructions are available.*/
+    struct ActivePlane
+    {
+        void set(const Plane& p, Polytope::ClippingMask selectorMask)
+        {
+            plane = &p;
+            selector = selectorMask;
+        }
+
+        const Plane*            plane;
+        Polytope::ClippingMask  selector;
+    };
+
+    /** Up to four bounds tested against each plane in turn.*/
+    template<class T>
+    struct BoundBlock
+    {
+        BoundBlock(const T* bounds, unsigned int num):
+            _bounds(bounds),
+            _num(num) {}
+
+        inline unsigned int intersect(const ActivePlane& plane, unsigned int& below) const
+        {
+            unsigned int above = 0;
+            below = 0;
+            for(unsigned int i=0; i<_num; ++i)
+            {
+                int res = plane.plane->intersect(_bounds[i]);
+                if (res>0) above |= (1<<i);
+                else if (res<0) below |= (1<<i);
+            }
+            return above;
+        }
+
+        const T*        _bounds;
+        unsigned int    _num;
+    };
+
+    typedef BoundBlock<BoundingSphere> SphereBlock;
+    typedef BoundBlock<BoundingBox> BoxBlock;
+
+#endif
+
+    /** Two bits spread into the lowest bit of two 32 bit lanes, multiplying by a plane selector then sets it in the lanes of the bits set.*/
+    const unsigned long long s_lanes[4] = { 0x0ULL, 0x1ULL, 0x100000000ULL, 0x100000001ULL };
+
+    /** Test the bounds against the active planes of the polytope in blocks of four, following the same
+      * plane order and mask updates as Polytope::contains() does for a single bound.*/
+    template<class Block, class T>
+    unsigned int containsBatch(const Polytope::PlaneList& planeList, Polytope::ClippingMask currentMask,
+                               const T* bounds, unsigned int num, bool* contained, Polytope::ClippingMask* resultMasks)
+    {
+        const unsigned int maxNumPlanes = sizeof(Polytope::ClippingMask)*8;
+        ActivePlane planes[maxNumPlanes];
+        unsigned int numPlanes = 0;
+
+        Polytope::ClippingMask selector_mask = 0x1;
+        for(Polytope::PlaneList::const_iterator itr=planeList.begin();
+            itr!=planeList.end() && numPlanes<maxNumPlanes;
+            ++itr)
+        {
+            if (currentMask&selector_mask) planes[numPlanes++].set(*itr, selector_mask);
+            selector_mask <<= 1;
+        }
+
+        unsigned int numContained = 0;
+        for(unsigned int begin=0; begin<num; begin+=4)
+        {
+            unsigned int blockSize = osg::minimum(4u, num-begin);
+            unsigned int blockBits = (1u<<blockSize)-1;
+
+            Block block(bounds+begin, blockSize);
+
+            // the planes each bound is completely above, accumulated in a 32 bit lane per bound.
+            unsigned long long aboveLanes[2] = { 0, 0 };
+            unsigned int outside = 0;
+            for(unsigned int p=0; p<numPlanes && outside!=blockBits; ++p)
+            {
+                // bounds already outside keep the mask they had when found to be, as contains() returns at that point.
+                unsigned int below;
+                unsigned int above = block.intersect(planes[p], below) & ~outside;
+                outside |= (below & blockBits);
+
+                aboveLanes[0] |= s_lanes[above&3] * planes[p].selector;
+                aboveLanes[1] |= s_lanes[(above>>2)&3] * planes[p].selector;
+            }
+
+            for(unsigned int i=0; i<blockSize; ++i)
+            {
+                bool inside = (outside&(1u<<i))==0;
+                contained[begin+i] = inside;
+
+                // subsequent checks against the planes the bound is above are not required.
+                resultMasks[begin+i] = currentMask ^ static_cast<Polytope::ClippingMask>(aboveLanes[i>>1] >> ((i&1)*32));
+                if (inside) ++numContained;
+            }
+        }
+
+        return numContained;
+    }
+}
+
+unsigned int Polytope::contains(const osg::BoundingSphere* spheres, unsigned int num, bool* contained, ClippingMask* resultMasks) const
+{
+    return containsBatch<SphereBlock>(_planeList, _maskStack.back(), spheres, num, contained, resultMasks);
+}
+
+unsigned int Polytope::contains(const osg::BoundingBox* boxes, unsigned int num, bool* contained, ClippingMask* resultMasks) const
+{
+    return containsBatch<BoxBlock>(_planeList, _maskStack.back(), boxes, num, contained, resultMasks);
+}
@@ -173,4 +173,544 @@ public:
 
 REGISTER_COMPRESSOR( "zlib", ZLibCompressor )
 
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
+#include <OpenThreads/ScopedLock>
+
+#include <deque>
+
+// the size of the blocks the data is split into by the chunked zlib compressor, and the most a block may inflate to.
+#define CHUNKED_BLOCK_SIZE (1024*1024)
+
+// the chunked zlib data starts with this magic number and version, followed by the index, all little endian.
+#define CHUNKED_MAGIC_NUMBER 0x4b48435au // "ZCHK"
+#define CHUNKED_VERSION 1u
+
+static void writeChunkedUInt( std::ostream& fout, unsigned int value )
+{
+    unsigned char bytes[4] = { (unsigned char)(value & 0xff), (unsigned char)((value>>8) & 0xff),
+                               (unsigned char)((value>>16) & 0xff), (unsigned char)((value>>24) & 0xff) };
+    fout.write( (char*)bytes, 4 );
+}
+
+static bool readChunkedUInt( std::istream& fin, unsigned int& value )
+{
+    unsigned char bytes[4];
+    fin.read( (char*)bytes, 4 );
+    if ( fin.fail() ) return false;
+
+    value = (unsigned int)bytes[0] | ((unsigned int)bytes[1]<<8) | ((unsigned int)bytes[2]<<16) | ((unsigned int)bytes[3]<<24);
+    return true;
+}
+
+// Blocks compressed or decompressed independently by any number of threads, each taking the next block not yet taken.
+// The job owns the compressed data being decompressed so that it outlives the threads still working on it. A window
+// limits how many blocks the pool may take ahead of the block being read, so that blocks aren't all inflated into
+// memory at once while the reader is still parsing the first of them.
+class ChunkedZLibJob : public osg::Referenced
+{
+public:
+    struct Block
+    {
+        Block(): source(0), sourceSize(0), dest(0), destSize(0), done(false), succeeded(false) {}
+
+        const char*         source;
+        unsigned long       sourceSize;
+        char*               dest;
+        unsigned long       destSize;
+        std::vector<char>   buffer;
+        bool                done;
+        bool                succeeded;
+    };
+
+    ChunkedZLibJob( bool compress ):
+        _compress(compress), _nextBlock(0), _readBlock(0), _windowSize(0), _cancelled(false) {}
+
+    std::vector<Block>& getBlocks() { return _blocks; }
+
+    std::vector<char>& getCompressedData() { return _compressed; }
+
+    // set the most blocks the pool may take ahead of the block being read, 0 for no limit.
+    void setWindowSize( unsigned int windowSize )
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _windowSize = windowSize;
+    }
+
+    // return true if all the blocks have been taken, or the job cancelled, so there's nothing left for a thread to run.
+    bool finished()
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        return _cancelled || _nextBlock>=_blocks.size();
+    }
+
+    // return true if the pool may take the next block, false once finished or while the window is full.
+    bool runnable()
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        return !_cancelled && _nextBlock<_blocks.size() && !windowFull();
+    }
+
+    // run blocks for the pool until all have been taken or the window is full.
+    void run()
+    {
+        while ( runNextBlock(true) ) {}
+    }
+
+    // take the next block not yet taken and run it, return false if there are none left, or if limited by the window
+    // and it is full.
+    bool runNextBlock( bool limitedByWindow )
+    {
+        unsigned int i = 0;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            if ( _cancelled || _nextBlock>=_blocks.size() || (limitedByWindow && windowFull()) ) return false;
+            i = _nextBlock++;
+        }
+
+        // blocks without a destination are decompressed into a buffer of their own, released once read.
+        Block& block = _blocks[i];
+        if ( !block.dest )
+        {
+            block.buffer.resize( block.destSize );
+            block.dest = block.buffer.empty() ? 0 : &block.buffer[0];
+        }
+
+        uLongf destSize = block.destSize;
+        bool succeeded = false;
+        if ( _compress )
+        {
+            succeeded = compress2( (Bytef*)block.dest, &destSize, (const Bytef*)block.source, block.sourceSize, 6 )==Z_OK;
+        }
+        else
+        {
+            succeeded = uncompress( (Bytef*)block.dest, &destSize, (const Bytef*)block.source, block.sourceSize )==Z_OK &&
+                        destSize==block.destSize;
+        }
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        block.destSize = destSize;
+        block.succeeded = succeeded;
+        block.done = true;
+        _condition.broadcast();
+        return true;
+    }
+
+    // wait for a block to be done, running it on the calling thread if no other thread has taken it yet.
+    // Moves the window on to the block, letting the pool take the blocks following it.
+    bool waitForBlock( unsigned int i );
+
+    // run the blocks on the calling thread alongside the pool, returning once all are done.
+    bool runAndWait();
+
+    void cancel();
+
+protected:
+    bool windowFull() const { return _windowSize>0 && _nextBlock>=_readBlock+_windowSize; }
+
+    std::vector<Block>      _blocks;
+    std::vector<char>       _compressed;
+    bool                    _compress;
+    unsigned int            _nextBlock;
+    unsigned int            _readBlock;
+    unsigned int            _windowSize;
+    OpenThreads::Mutex      _mutex;
+    OpenThreads::Condition  _condition;
+    bool                    _cancelled;
+};
+
+// Pool of threads shared by all the ChunkedZLibJobs, sized to the number of processors, so that any number of threads
+// reading chunked files at once don't each start threads of their own.
+class ChunkedZLibThreadPool : public osg::Referenced
+{
+public:
+    ChunkedZLibThreadPool(): _done(false)
+    {
+        int numProcessors = OpenThreads::GetNumberOfProcessors();
+        unsigned int numThreads = numProcessors>1 ? (unsigned int)(numProcessors-1) : 1u;
+        for ( unsigned int i=0; i<numThreads; ++i )
+        {
+            _threads.push_back( new Worker(this) );
+            _threads.back()->startThread();
+        }
+    }
+
+    // get the pool, its threads are started the first time it is needed.
+    static ChunkedZLibThreadPool* instance();
+
+    unsigned int getNumThreads() const { return _threads.size(); }
+
+    void add( ChunkedZLibJob* job )
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _jobs.push_back( job );
+        _condition.broadcast();
+    }
+
+    // wake the threads to look again at a job whose window has moved on or that has been cancelled.
+    void wake()
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _condition.broadcast();
+    }
+
+    // wait for a job with blocks the pool may run, several threads work on the same job until all its blocks are
+    // taken or its window is full, jobs with full windows are left queued until their readers move on.
+    // Returns 0 once the pool is being destroyed.
+    osg::ref_ptr<ChunkedZLibJob> nextJob()
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        for (;;)
+        {
+            if ( _done ) return 0;
+
+            std::deque< osg::ref_ptr<ChunkedZLibJob> >::iterator itr = _jobs.begin();
+            while ( itr!=_jobs.end() )
+            {
+                if ( (*itr)->finished() ) itr = _jobs.erase( itr );
+                else if ( (*itr)->runnable() ) return *itr;
+                else ++itr;
+            }
+            _condition.wait( &_mutex );
+        }
+    }
+
+protected:
+    class Worker : public OpenThreads::Thread
+    {
+    public:
+        Worker( ChunkedZLibThreadPool* pool ): _pool(pool) {}
+
+        virtual void run()
+        {
+            osg::ref_ptr<ChunkedZLibJob> job;
+            while ( (job = _pool->nextJob()).valid() )
+            {
+                job->run();
+                job = 0;
+            }
+        }
+
+    protected:
+        ChunkedZLibThreadPool* _pool;
+    };
+
+    virtual ~ChunkedZLibThreadPool()
+    {
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            _done = true;
+            _condition.broadcast();
+        }
+
+        for ( std::vector<Worker*>::iterator itr=_threads.begin(); itr!=_threads.end(); ++itr )
+        {
+            (*itr)->join();
+            delete *itr;
+        }
+    }
+
+    std::vector<Worker*>                            _threads;
+    std::deque< osg::ref_ptr<ChunkedZLibJob> >      _jobs;
+    OpenThreads::Mutex                              _mutex;
+    OpenThreads::Condition                          _condition;
+    bool                                            _done;
+};
+
+static OpenThreads::Mutex s_chunkedZLibThreadPoolMutex;
+static osg::ref_ptr<ChunkedZLibThreadPool> s_chunkedZLibThreadPool;
+
+ChunkedZLibThreadPool* ChunkedZLibThreadPool::instance()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_chunkedZLibThreadPoolMutex);
+    if ( !s_chunkedZLibThreadPool ) s_chunkedZLibThreadPool = new ChunkedZLibThreadPool;
+    return s_chunkedZLibThreadPool.get();
+}
+
+bool ChunkedZLibJob::waitForBlock( unsigned int i )
+{
+    bool windowMoved = false;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        if ( _windowSize>0 && i>_readBlock )
+        {
+            windowMoved = windowFull();
+            _readBlock = i;
+        }
+    }
+    if ( windowMoved ) ChunkedZLibThreadPool::instance()->wake();
+
+    for (;;)
+    {
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            if ( _nextBlock>i ) break;
+        }
+        if ( !runNextBlock(false) ) break;
+    }
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    while ( !_blocks[i].done ) _condition.wait( &_mutex );
+    return _blocks[i].succeeded;
+}
+
+bool ChunkedZLibJob::runAndWait()
+{
+    // a single block is run on the calling thread without involving the pool.
+    if ( _blocks.size()>1 ) ChunkedZLibThreadPool::instance()->add( this );
+
+    bool succeeded = true;
+    for ( unsigned int i=0; i<_blocks.size(); ++i )
+    {
+        if ( !waitForBlock(i) ) succeeded = false;
+    }
+    return succeeded;
+}
+
+void ChunkedZLibJob::cancel()
+{
+    bool windowed = false;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _cancelled = true;
+        windowed = _windowSize>0;
+    }
+
+    // let the pool drop a job left queued with a full window.
+    if ( windowed ) ChunkedZLibThreadPool::instance()->wake();
+}
+
+// Stream buffer over the blocks of a ChunkedZLibJob, each read once it has been decompressed and released once read past.
+// Seeks forward to any position and back within the current block.
+class ChunkedZLibStreamBuf : public std::streambuf
+{
+public:
+    ChunkedZLibStreamBuf( ChunkedZLibJob* job ):
+        _job(job), _currentBlock(0), _currentBlockBegin(0), _nextBlockBegin(0)
+    {
+        // the first block is inflated by the reading thread, those following by the pool in the meantime,
+        // keeping up to two blocks per pool thread inflated ahead of the block being read.
+        if ( _job->getBlocks().size()>1 )
+        {
+            ChunkedZLibThreadPool* pool = ChunkedZLibThreadPool::instance();
+            _job->setWindowSize( 2*pool->getNumThreads() );
+            pool->add( _job.get() );
+        }
+    }
+
+    virtual ~ChunkedZLibStreamBuf()
+    {
+        // blocks already being inflated by the pool finish with the job, which owns their data.
+        _job->cancel();
+    }
+
+protected:
+    bool nextBlock()
+    {
+        std::vector<ChunkedZLibJob::Block>& blocks = _job->getBlocks();
+        if ( _currentBlock>0 ) std::vector<char>().swap( blocks[_currentBlock-1].buffer );
+
+        _currentBlockBegin = _nextBlockBegin;
+        if ( _currentBlock>=blocks.size() || !_job->waitForBlock(_currentBlock) )
+        {
+            setg( 0, 0, 0 );
+            return false;
+        }
+
+        ChunkedZLibJob::Block& block = blocks[_currentBlock++];
+        _nextBlockBegin += block.destSize;
+        setg( block.dest, block.dest, block.dest+block.destSize );
+        return true;
+    }
+
+    virtual int_type underflow()
+    {
+        while ( gptr()==egptr() )
+        {
+            if ( !nextBlock() ) return traits_type::eof();
+        }
+        return traits_type::to_int_type( *gptr() );
+    }
+
+    virtual std::streamsize showmanyc()
+    {
+        return egptr()-gptr();
+    }
+
+    virtual pos_type seekoff( off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which )
+    {
+        if ( which!=std::ios_base::in ) return pos_type(off_type(-1));
+
+        off_type position = _currentBlockBegin + (gptr()-eback());
+        if ( dir==std::ios_base::beg ) position = off;
+        else if ( dir==std::ios_base::cur ) position += off;
+        else return pos_type(off_type(-1));
+
+        return seekpos( pos_type(position), which );
+    }
+
+    virtual pos_type seekpos( pos_type pos, std::ios_base::openmode which )
+    {
+        off_type position = pos;
+        if ( which!=std::ios_base::in || position<_currentBlockBegin ) return pos_type(off_type(-1));
+
+        while ( position>=_nextBlockBegin && _currentBlock<_job->getBlocks().size() )
+        {
+            if ( !nextBlock() ) return pos_type(off_type(-1));
+        }
+
+        if ( position>_currentBlockBegin+(egptr()-eback()) ) return pos_type(off_type(-1));
+
+        setg( eback(), eback()+(position-_currentBlockBegin), egptr() );
+        return pos;
+    }
+
+    osg::ref_ptr<ChunkedZLibJob>    _job;
+    unsigned int                    _currentBlock;
+    off_type                        _currentBlockBegin;
+    off_type                        _nextBlockBegin;
+};
+
+class ChunkedZLibStream : public std::istream
+{
+public:
+    ChunkedZLibStream( ChunkedZLibJob* job ):
+        std::istream(0), _buffer(job)
+    {
+        rdbuf( &_buffer );
+    }
+
+protected:
+    ChunkedZLibStreamBuf _buffer;
+};
+
+// ZLib compressor splitting the data into blocks compressed independently, written after an index of their sizes,
+// so that they are compressed and decompressed by several threads at once and the blocks decompressed first can
+// be parsed while the rest are still being decompressed.
+class ChunkedZLibCompressor : public BaseCompressor
+{
+public:
+    ChunkedZLibCompressor() {}
+
+    virtual bool compress( std::ostream& fout, const std::string& src )
+    {
+        osg::ref_ptr<ChunkedZLibJob> job = new ChunkedZLibJob(true);
+        std::vector<ChunkedZLibJob::Block>& blocks = job->getBlocks();
+        blocks.resize( (src.size()+CHUNKED_BLOCK_SIZE-1)/CHUNKED_BLOCK_SIZE );
+        for ( unsigned int i=0; i<blocks.size(); ++i )
+        {
+            blocks[i].source = src.c_str() + (size_t)i*CHUNKED_BLOCK_SIZE;
+            blocks[i].sourceSize = osg::minimum( src.size()-(size_t)i*CHUNKED_BLOCK_SIZE, (size_t)CHUNKED_BLOCK_SIZE );
+            blocks[i].destSize = compressBound( blocks[i].sourceSize );
+        }
+
+        if ( !job->runAndWait() ) return false;
+
+        unsigned int numBlocks = blocks.size();
+        writeChunkedUInt( fout, CHUNKED_MAGIC_NUMBER );
+        writeChunkedUInt( fout, CHUNKED_VERSION );
+        writeChunkedUInt( fout, numBlocks );
+        for ( unsigned int i=0; i<numBlocks; ++i )
+        {
+            writeChunkedUInt( fout, (unsigned int)blocks[i].destSize );
+            writeChunkedUInt( fout, (unsigned int)blocks[i].sourceSize );
+        }
+
+        for ( unsigned int i=0; i<numBlocks; ++i )
+        {
+            fout.write( blocks[i].dest, blocks[i].destSize );
+        }
+        return !fout.fail();
+    }
+
+    virtual bool decompress( std::istream& fin, std::string& target )
+    {
+        osg::ref_ptr<ChunkedZLibJob> job = readBlocks( fin );
+        if ( !job ) return false;
+
+        std::vector<ChunkedZLibJob::Block>& blocks = job->getBlocks();
+        size_t size = 0;
+        for ( unsigned int i=0; i<blocks.size(); ++i ) size += blocks[i].destSize;
+
+        target.resize( size );
+        size = 0;
+        for ( unsigned int i=0; i<blocks.size(); ++i )
+        {
+            blocks[i].dest = &target[size];
+            size += blocks[i].destSize;
+        }
+
+        return job->runAndWait();
+    }
+
+    virtual std::istream* decompressStream( std::istream& fin )
+    {
+        osg::ref_ptr<ChunkedZLibJob> job = readBlocks( fin );
+        if ( !job ) return new std::istream(0);
+
+        return new ChunkedZLibStream( job.get() );
+    }
+
+protected:
+    // read and check the index and read all the compressed blocks, which are decompressed into buffers of their own unless given a destination.
+    ChunkedZLibJob* readBlocks( std::istream& fin )
+    {
+        unsigned int magic = 0, version = 0, numBlocks = 0;
+        if ( !readChunkedUInt(fin, magic) || magic!=CHUNKED_MAGIC_NUMBER )
+        {
+            OSG_WARN << "ChunkedZLibCompressor: data is not chunked zlib." << std::endl;
+            return 0;
+        }
+
+        if ( !readChunkedUInt(fin, version) || version!=CHUNKED_VERSION )
+        {
+            OSG_WARN << "ChunkedZLibCompressor: unsupported version " << version << "." << std::endl;
+            return 0;
+        }
+
+        if ( !readChunkedUInt(fin, numBlocks) ) return 0;
+
+        // the index and data are read a block at a time so that a corrupt block count fails at the end of the
+        // stream rather than allocating for blocks that aren't there.
+        osg::ref_ptr<ChunkedZLibJob> job = new ChunkedZLibJob(false);
+        std::vector<ChunkedZLibJob::Block>& blocks = job->getBlocks();
+        unsigned long maximumSourceSize = compressBound( CHUNKED_BLOCK_SIZE );
+        for ( unsigned int i=0; i<numBlocks; ++i )
+        {
+            unsigned int sizes[2];
+            if ( !readChunkedUInt(fin, sizes[0]) || !readChunkedUInt(fin, sizes[1]) ) return 0;
+
+            if ( sizes[0]==0 || sizes[0]>maximumSourceSize || sizes[1]==0 || sizes[1]>CHUNKED_BLOCK_SIZE )
+            {
+                OSG_WARN << "ChunkedZLibCompressor: invalid size of block " << i << "." << std::endl;
+                return 0;
+            }
+
+            blocks.push_back( ChunkedZLibJob::Block() );
+            blocks.back().sourceSize = sizes[0];
+            blocks.back().destSize = sizes[1];
+        }
+
+        std::vector<char>& compressed = job->getCompressedData();
+        for ( unsigned int i=0; i<blocks.size(); ++i )
+        {
+            size_t offset = compressed.size();
+            compressed.resize( offset + blocks[i].sourceSize );
+            fin.read( &compressed[offset], blocks[i].sourceSize );
+            if ( fin.fail() ) return 0;
+        }
+
+        size_t offset = 0;
+        for ( unsigned int i=0; i<blocks.size(); ++i )
+        {
+            blocks[i].source = &compressed[offset];
+            offset += blocks[i].sourceSize;
+        }
+        return job.release();
+    }
+};
+
+REGISTER_COMPRESSOR( "zlibchunked", ChunkedZLibCompressor )
+
 #endif
@@ -47,6 +47,7 @@ static osg::ApplicationUsageProxy DatabasePager_e0(osg::ApplicationUsage::ENVIRO
 static osg::ApplicationUsageProxy DatabasePager_e3(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_DRAWABLE <mode>","Set the drawable policy for setting of loaded drawable to specified type.  mode can be one of DoNotModify, DisplayList, VBO or VertexArrays>.");
 static osg::ApplicationUsageProxy DatabasePager_e4(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_PRIORITY <mode>", "Set the thread priority to DEFAULT, MIN, LOW, NOMINAL, HIGH or MAX.");
 static osg::ApplicationUsageProxy DatabasePager_e11(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_MAX_PAGEDLOD <num>","Set the target maximum number of PagedLOD to maintain.");
+static osg::ApplicationUsageProxy DatabasePager_e13(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_WORK_STEALING <ON/OFF>","Set whether idle http database threads take requests from the file request queue.");
 static osg::ApplicationUsageProxy DatabasePager_e12(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_ASSIGN_PBO_TO_IMAGES <ON/OFF>","Set whether PixelBufferObjects should be assigned to Images to aid download to the GPU.");
 
 
@@ -377,10 +378,12 @@ void DatabasePager::DatabaseRequest::invalidate()
 //
 //  RequestQueue
 //
-DatabasePager::RequestQueue::RequestQueue(DatabasePager* pager):
+DatabasePager::RequestQueue::RequestQueue(DatabasePager* pager, bool prioritized):
     _pager(pager),
-    _frameNumberLastPruned(osg::UNINITIALIZED_FRAME_NUMBER)
+    _frameNumberLastPruned(osg::UNINITIALIZED_FRAME_NUMBER),
+    _prioritized(prioritized)
 {
+    resetLatencyStats();
 }
 
 DatabasePager::RequestQueue::~RequestQueue()
@@ -408,6 +411,114 @@ void DatabasePager::RequestQueue::invalidate(DatabaseRequest* dr)
     dr->invalidate();
 }
 
+//
+// Indexed binary heap of the prioritized queues, each DatabaseRequest records its position in
+// the heap so that a request can be repositioned or removed without searching for it.
+// The timestamp and priority are copied into the HeapEntry so that the heap ordering can be
+// maintained without holding the _dr_mutex.  All methods require _requestMutex to be held.
+//
+void DatabasePager::RequestQueue::setHeapEntry(unsigned int index, const HeapEntry& entry)
+{
+    _requestHeap[index] = entry;
+    (*entry._itr)->_heapIndex = index;
+}
+
+void DatabasePager::RequestQueue::moveUpHeap(unsigned int index)
+{
+    HeapEntry entry = _requestHeap[index];
+    while(index>0)
+    {
+        unsigned int parent = (index-1)/2;
+        if (!(_requestHeap[parent] < entry)) break;
+
+        setHeapEntry(index, _requestHeap[parent]);
+        index = parent;
+    }
+    setHeapEntry(index, entry);
+}
+
+void DatabasePager::RequestQueue::moveDownHeap(unsigned int index)
+{
+    unsigned int size = _requestHeap.size();
+    HeapEntry entry = _requestHeap[index];
+    for(;;)
+    {
+        unsigned int child = index*2+1;
+        if (child>=size) break;
+
+        if (child+1<size && _requestHeap[child] < _requestHeap[child+1]) ++child;
+        if (!(entry < _requestHeap[child])) break;
+
+        setHeapEntry(index, _requestHeap[child]);
+        index = child;
+    }
+    setHeapEntry(index, entry);
+}
+
+void DatabasePager::RequestQueue::pushHeap(RequestList::iterator itr)
+{
+    DatabaseRequest* dr = itr->get();
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+        dr->_requestQueue = this;
+        _requestHeap.push_back(HeapEntry(itr, dr->_timestampLastRequest, dr->_priorityLastRequest));
+    }
+    moveUpHeap(_requestHeap.size()-1);
+}
+
+DatabasePager::RequestQueue::RequestList::iterator DatabasePager::RequestQueue::popHeap(unsigned int index)
+{
+    RequestList::iterator itr = _requestHeap[index]._itr;
+
+    unsigned int last = _requestHeap.size()-1;
+    if (index!=last)
+    {
+        bool moveUp = _requestHeap[index] < _requestHeap[last];
+        setHeapEntry(index, _requestHeap[last]);
+        _requestHeap.pop_back();
+
+        if (moveUp) moveUpHeap(index);
+        else moveDownHeap(index);
+    }
+    else
+    {
+        _requestHeap.pop_back();
+    }
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+        (*itr)->_requestQueue = 0;
+    }
+
+    return itr;
+}
+
+void DatabasePager::RequestQueue::rebuildHeap()
+{
+    _requestHeap.clear();
+    _requestHeap.reserve(_requestList.size());
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+        for(RequestList::iterator itr = _requestList.begin();
+            itr != _requestList.end();
+            ++itr)
+        {
+            (*itr)->_requestQueue = this;
+            _requestHeap.push_back(HeapEntry(itr, (*itr)->_timestampLastRequest, (*itr)->_priorityLastRequest));
+        }
+    }
+
+    for(unsigned int i=0; i<_requestHeap.size(); ++i)
+    {
+        (*_requestHeap[i]._itr)->_heapIndex = i;
+    }
+
+    for(unsigned int i=_requestHeap.size()/2; i>0; --i)
+    {
+        moveDownHeap(i-1);
+    }
+}
 
 bool DatabasePager::RequestQueue::pruneOldRequestsAndCheckIfEmpty()
 {
@@ -416,6 +527,7 @@ bool DatabasePager::RequestQueue::pruneOldRequestsAndCheckIfEmpty()
     unsigned int frameNumber = _pager->_frameNumber;
     if (_frameNumberLastPruned != frameNumber)
     {
+        bool pruned = false;
         for(RequestQueue::RequestList::iterator citr = _requestList.begin();
             citr != _requestList.end();
             )
@@ -428,12 +540,16 @@ bool DatabasePager::RequestQueue::pruneOldRequestsAndCheckIfEmpty()
             else
             {
                 invalidate(citr->get());
+                (*citr)->_requestQueue = 0;
 
                 OSG_INFO<<"DatabasePager::RequestQueue::pruneOldRequestsAndCheckIfEmpty(): Pruning "<<(*citr)<<std::endl;
                 citr = _requestList.erase(citr);
+                pruned = true;
             }
         }
 
+        if (_prioritized && pruned) rebuildHeap();
+
         _frameNumberLastPruned = frameNumber;
 
         updateBlock();
@@ -464,9 +580,11 @@ void DatabasePager::RequestQueue::clear()
     {
         OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
         invalidate(citr->get());
+        (*citr)->_requestQueue = 0;
     }
 
     _requestList.clear();
+    _requestHeap.clear();
 
     _frameNumberLastPruned = _pager->_frameNumber;
 
@@ -485,6 +603,23 @@ void DatabasePager::RequestQueue::remove(DatabasePager::DatabaseRequest* databas
 {
     // OSG_NOTICE<<"DatabasePager::RequestQueue::remove(DatabaseRequest* databaseRequest)"<<std::endl;
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+
+    if (_prioritized)
+    {
+        bool inQueue = false;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+            inQueue = (databaseRequest->_requestQueue == this);
+        }
+
+        if (inQueue)
+        {
+            _requestList.erase(popHeap(databaseRequest->_heapIndex));
+            updateBlock();
+        }
+        return;
+    }
+
     for(RequestList::iterator citr = _requestList.begin();
         citr != _requestList.end();
         ++citr)
@@ -501,28 +636,94 @@ void DatabasePager::RequestQueue::remove(DatabasePager::DatabaseRequest* databas
 
 void DatabasePager::RequestQueue::addNoLock(DatabasePager::DatabaseRequest* databaseRequest)
 {
+    databaseRequest->_tickQueued = osg::Timer::instance()->tick();
     _requestList.push_back(databaseRequest);
+    if (_prioritized) pushHeap(--_requestList.end());
     updateBlock();
 }
 
+void DatabasePager::RequestQueue::updatePriority(DatabasePager::DatabaseRequest* databaseRequest)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+
+    if (!_prioritized) return;
+
+    HeapEntry entry(_requestList.end(), 0.0, 0.0f);
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+        if (databaseRequest->_requestQueue != this) return;
+
+        entry = _requestHeap[databaseRequest->_heapIndex];
+        entry._timestamp = databaseRequest->_timestampLastRequest;
+        entry._priority = databaseRequest->_priorityLastRequest;
+    }
+
+    unsigned int index = databaseRequest->_heapIndex;
+    bool moveUp = _requestHeap[index] < entry;
+    _requestHeap[index] = entry;
+
+    if (moveUp) moveUpHeap(index);
+    else moveDownHeap(index);
+}
+
 void DatabasePager::RequestQueue::swap(RequestList& requestList)
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+
+    if (_prioritized)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+        for(RequestList::iterator itr = _requestList.begin();
+            itr != _requestList.end();
+            ++itr)
+        {
+            (*itr)->_requestQueue = 0;
+        }
+    }
+
     _requestList.swap(requestList);
+
+    if (_prioritized)
+    {
+        rebuildHeap();
+        updateBlock();
+    }
 }
 
 void DatabasePager::RequestQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& databaseRequest)
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
 
-    if (!_requestList.empty())
+    int frameNumber = _pager->_frameNumber;
+
+    if (_prioritized)
+    {
+        // the heap top is the most recently requested, highest priority request, requests that are no longer
+        // current have older timestamps so sink towards the bottom of the heap and are discarded as they surface.
+        while(!_requestHeap.empty())
+        {
+            RequestList::iterator itr = popHeap(0);
+            osg::ref_ptr<DatabaseRequest> dr = *itr;
+            _requestList.erase(itr);
+
+            OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
+            if (dr->isRequestCurrent(frameNumber))
+            {
+                databaseRequest = dr;
+                break;
+            }
+
+            invalidate(dr.get());
+
+            OSG_INFO<<"DatabasePager::RequestQueue::takeFirst(): Pruning "<<dr.get()<<std::endl;
+        }
+    }
+    else if (!_requestList.empty())
     {
         DatabasePager::SortFileRequestFunctor highPriority;
 
         RequestQueue::RequestList::iterator selected_itr = _requestList.end();
 
-        int frameNumber = _pager->_frameNumber;
-
         for(RequestQueue::RequestList::iterator citr = _requestList.begin();
             citr != _requestList.end();
             )
@@ -553,15 +754,43 @@ void DatabasePager::RequestQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& datab
         {
             databaseRequest = *selected_itr;
             _requestList.erase(selected_itr);
-            OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() Found DatabaseRequest size()="<<_requestList.size()<<std::endl;
-        }
-        else
-        {
-            OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() No suitable DatabaseRequest found size()="<<_requestList.size()<<std::endl;
         }
+    }
 
-        updateBlock();
+    if (databaseRequest.valid())
+    {
+        double latency = osg::Timer::instance()->delta_s(databaseRequest->_tickQueued, osg::Timer::instance()->tick());
+        if (latency<_minimumLatency) _minimumLatency = latency;
+        if (latency>_maximumLatency) _maximumLatency = latency;
+        _totalLatency += latency;
+        ++_numRequestsTaken;
+
+        OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() Found DatabaseRequest size()="<<_requestList.size()<<std::endl;
     }
+    else
+    {
+        OSG_INFO<<" DatabasePager::RequestQueue::takeFirst() No suitable DatabaseRequest found size()="<<_requestList.size()<<std::endl;
+    }
+
+    updateBlock();
+}
+
+void DatabasePager::RequestQueue::getLatencyStats(unsigned int& numRequests, double& totalLatency, double& minimumLatency, double& maximumLatency)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+    numRequests = _numRequestsTaken;
+    totalLatency = _totalLatency;
+    minimumLatency = _minimumLatency;
+    maximumLatency = _maximumLatency;
+}
+
+void DatabasePager::RequestQueue::resetLatencyStats()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+    _numRequestsTaken = 0;
+    _totalLatency = 0.0;
+    _minimumLatency = DBL_MAX;
+    _maximumLatency = -DBL_MAX;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -569,16 +798,28 @@ void DatabasePager::RequestQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& datab
 //  ReadQueue
 //
 DatabasePager::ReadQueue::ReadQueue(DatabasePager* pager, const std::string& name):
-    RequestQueue(pager),
-    _name(name)
+    RequestQueue(pager, true),
+    _name(name),
+    _stealFromQueue(0),
+    _stealingQueue(0)
 {
     _block = new osg::RefBlock;
 }
 
 void DatabasePager::ReadQueue::updateBlock()
 {
-    _block->set((!_requestList.empty() || !_childrenToDeleteList.empty()) &&
-                !_pager->_databasePagerThreadPaused);
+    _numPendingRequests.exchange(_requestList.size());
+
+    bool hasWork = !_requestList.empty() || !_childrenToDeleteList.empty();
+    if (_stealFromQueue && _pager->_workStealing && _stealFromQueue->_numPendingRequests>0) hasWork = true;
+
+    _block->set(hasWork && !_pager->_databasePagerThreadPaused);
+
+    // wake up any idle threads of the stealing queue so they can help out.
+    if (_stealingQueue && _pager->_workStealing && !_requestList.empty() && !_pager->_databasePagerThreadPaused)
+    {
+        _stealingQueue->_block->release();
+    }
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -648,6 +889,7 @@ void DatabasePager::DatabaseThread::run()
 
     osg::ref_ptr<DatabasePager::ReadQueue> read_queue;
     osg::ref_ptr<DatabasePager::ReadQueue> out_queue;
+    osg::ref_ptr<DatabasePager::ReadQueue> steal_queue;
 
     switch(_mode)
     {
@@ -660,6 +902,7 @@ void DatabasePager::DatabaseThread::run()
             break;
         case(HANDLE_ONLY_HTTP):
             read_queue = _pager->_httpRequestQueue;
+            steal_queue = _pager->_fileRequestQueue;
             break;
     }
 
@@ -704,6 +947,19 @@ void DatabasePager::DatabaseThread::run()
         osg::ref_ptr<DatabaseRequest> databaseRequest;
         read_queue->takeFirst(databaseRequest);
 
+        // when there are no http requests to service help out with the file requests.
+        Mode requestMode = _mode;
+        if (!databaseRequest && steal_queue.valid() && _pager->_workStealing)
+        {
+            steal_queue->takeFirst(databaseRequest);
+            if (databaseRequest.valid())
+            {
+                OSG_INFO<<_name<<": taking request from "<<steal_queue->_name<<std::endl;
+                ++(_pager->_numRequestsStolen);
+                requestMode = HANDLE_ALL_REQUESTS;
+            }
+        }
+
         bool readFromFileCache = false;
 
         osg::ref_ptr<FileCache> fileCache = osgDB::Registry::instance()->getFileCache();
@@ -788,7 +1044,7 @@ void DatabasePager::DatabaseThread::run()
             {
 
                 // now check to see if this request is appropriate for this thread
-                switch(_mode)
+                switch(requestMode)
                 {
                     case(HANDLE_ALL_REQUESTS):
                     {
@@ -1047,11 +1303,20 @@ DatabasePager::DatabasePager()
                         strcmp(str,"on")==0 || strcmp(str,"ON")==0;
     }
 
-    // initialize the stats variables
-    resetStats();
+    _workStealing = true;
+    if( (str = getenv("OSG_DATABASE_PAGER_WORK_STEALING")) != 0)
+    {
+        _workStealing = strcmp(str,"yes")==0 || strcmp(str,"YES")==0 ||
+                        strcmp(str,"on")==0 || strcmp(str,"ON")==0;
+    }
 
     _fileRequestQueue = new ReadQueue(this,"fileRequestQueue");
     _httpRequestQueue = new ReadQueue(this,"httpRequestQueue");
+    _httpRequestQueue->_stealFromQueue = _fileRequestQueue.get();
+    _fileRequestQueue->_stealingQueue = _httpRequestQueue.get();
+
+    // initialize the stats variables
+    resetStats();
 
     _dataToCompileList = new RequestQueue(this);
     _dataToMergeList = new RequestQueue(this);
@@ -1122,8 +1387,12 @@ DatabasePager::DatabasePager(const DatabasePager& rhs)
 
     _doPreCompile = rhs._doPreCompile;
 
+    _workStealing = rhs._workStealing;
+
     _fileRequestQueue = new ReadQueue(this,"fileRequestQueue");
     _httpRequestQueue = new ReadQueue(this,"httpRequestQueue");
+    _httpRequestQueue->_stealFromQueue = _fileRequestQueue.get();
+    _fileRequestQueue->_stealingQueue = _httpRequestQueue.get();
 
     _dataToCompileList = new RequestQueue(this);
     _dataToMergeList = new RequestQueue(this);
@@ -1330,6 +1599,52 @@ void DatabasePager::resetStats()
     _maximumTimeToMergeTile = -DBL_MAX;
     _totalTimeToMergeTiles = 0.0;
     _numTilesMerges = 0;
+
+    _numRequestsStolen.exchange(0);
+    if (_fileRequestQueue.valid()) _fileRequestQueue->resetLatencyStats();
+    if (_httpRequestQueue.valid()) _httpRequestQueue->resetLatencyStats();
+}
+
+double DatabasePager::getMinimumRequestQueueLatency() const
+{
+    unsigned int numFile, numHttp;
+    double totalFile, totalHttp, minFile, minHttp, maxFile, maxHttp;
+    _fileRequestQueue->getLatencyStats(numFile, totalFile, minFile, maxFile);
+    _httpRequestQueue->getLatencyStats(numHttp, totalHttp, minHttp, maxHttp);
+    return osg::minimum(minFile, minHttp);
+}
+
+double DatabasePager::getMaximumRequestQueueLatency() const
+{
+    unsigned int numFile, numHttp;
+    double totalFile, totalHttp, minFile, minHttp, maxFile, maxHttp;
+    _fileRequestQueue->getLatencyStats(numFile, totalFile, minFile, maxFile);
+    _httpRequestQueue->getLatencyStats(numHttp, totalHttp, minHttp, maxHttp);
+    return osg::maximum(maxFile, maxHttp);
+}
+
+double DatabasePager::getAverageRequestQueueLatency() const
+{
+    unsigned int numFile, numHttp;
+    double totalFile, totalHttp, minFile, minHttp, maxFile, maxHttp;
+    _fileRequestQueue->getLatencyStats(numFile, totalFile, minFile, maxFile);
+    _httpRequestQueue->getLatencyStats(numHttp, totalHttp, minHttp, maxHttp);
+    return (numFile+numHttp > 0) ? (totalFile+totalHttp)/static_cast<double>(numFile+numHttp) : 0.0;
+}
+
+void DatabasePager::setWorkStealing(bool flag)
+{
+    if (_workStealing == flag) return;
+
+    _workStealing = flag;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_fileRequestQueue->_requestMutex);
+        _fileRequestQueue->updateBlock();
+    }
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_httpRequestQueue->_requestMutex);
+        _httpRequestQueue->updateBlock();
+    }
 }
 
 bool DatabasePager::getRequestsInProgress() const
@@ -1415,6 +1730,7 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
     {
         DatabaseRequest* databaseRequest = dynamic_cast<DatabaseRequest*>(databaseRequestRef.get());
         bool requeue = false;
+        RequestQueue* requestQueue = 0;
         if (databaseRequest)
         {
             OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_dr_mutex);
@@ -1434,6 +1750,8 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
                 databaseRequest->_priorityLastRequest = priority;
                 ++(databaseRequest->_numOfRequests);
 
+                requestQueue = databaseRequest->_requestQueue;
+
                 foundEntry = true;
 
                 if (databaseRequestRef->referenceCount()==1)
@@ -1454,6 +1772,8 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
         }
         if (requeue)
             _fileRequestQueue->add(databaseRequest);
+        else if (requestQueue)
+            requestQueue->updatePriority(databaseRequest);
     }
 
     if (!foundEntry)
@@ -0,0 +1,140 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/DirectoryCache>
+#include <osgDB/FileUtils>
+#include <osgDB/FileNameUtils>
+
+#include <osg/Notify>
+
+#include <OpenThreads/ScopedLock>
+
+using namespace osgDB;
+
+DirectoryCache::DirectoryCache():
+    _validationInterval(1.0),
+    _numListings(0),
+    _numValidations(0)
+{
+}
+
+DirectoryCache::~DirectoryCache()
+{
+}
+
+bool DirectoryCache::fileExists(const std::string& fileName)
+{
+    std::string::size_type slash = fileName.find_last_of("/\\");
+    std::string directory = slash==std::string::npos ? std::string(".") : (slash==0 ? fileName.substr(0, 1) : fileName.substr(0, slash));
+    std::string simpleFileName = slash==std::string::npos ? fileName : fileName.substr(slash+1);
+
+    // names the listing doesn't answer for, such as directories named with a trailing slash, are left to the file system.
+    if (simpleFileName.empty() || simpleFileName=="." || simpleFileName=="..") return osgDB::fileExists(fileName);
+
+#ifdef _WIN32
+    return !findEntry(directory, simpleFileName, CASE_INSENSITIVE).empty();
+#else
+    return !findEntry(directory, simpleFileName, CASE_SENSITIVE).empty();
+#endif
+}
+
+std::string DirectoryCache::findEntry(const std::string& directory, const std::string& fileName, CaseSensitivity caseSensitivity)
+{
+    osg::ref_ptr<Directory> listing = getDirectory(directory);
+
+    if (listing->entries.count(fileName)!=0) return fileName;
+
+    if (caseSensitivity==CASE_INSENSITIVE)
+    {
+        std::map<std::string, std::string>::const_iterator itr = listing->lowerCaseEntries.find(convertToLowerCase(fileName));
+        if (itr!=listing->lowerCaseEntries.end()) return itr->second;
+    }
+
+    return std::string();
+}
+
+void DirectoryCache::flush()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    _directories.clear();
+}
+
+void DirectoryCache::flush(const std::string& directory)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    _directories.erase(directory);
+}
+
+osg::ref_ptr<DirectoryCache::Directory> DirectoryCache::getDirectory(const std::string& directory)
+{
+    osg::Timer_t now = osg::Timer::instance()->tick();
+
+    osg::ref_ptr<Directory> listing;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+        Directories::iterator itr = _directories.find(directory);
+        if (itr!=_directories.end())
+        {
+            listing = itr->second;
+            if (osg::Timer::instance()->delta_s(listing->validated, now)<_validationInterval) return listing;
+
+            // marked as validated straight away so that other threads carry on with the current listing meanwhile.
+            ++_numValidations;
+            listing->validated = now;
+        }
+    }
+
+    if (listing.valid())
+    {
+        // a listing taken in the same second the directory was last modified may have missed a later modification within that second.
+        time_t modified = 0;
+        bool exists = getModificationTime(directory, modified);
+        if (exists==listing->exists && modified==listing->modified && listing->modified<listing->listed) return listing;
+    }
+
+    osg::ref_ptr<Directory> newListing = listDirectory(directory);
+    newListing->validated = now;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    ++_numListings;
+
+    // replace the listing, unless another thread listed the directory again meanwhile, or flushed and listed it.
+    osg::ref_ptr<Directory>& cached = _directories[directory];
+    if (cached==listing || !cached) cached = newListing;
+    return cached;
+}
+
+DirectoryCache::Directory* DirectoryCache::listDirectory(const std::string& directory)
+{
+    Directory* listing = new Directory;
+    listing->listed = time(0);
+    listing->exists = getModificationTime(directory, listing->modified);
+
+    if (!listing->exists) return listing;
+
+    DirectoryContents contents = getDirectoryContents(directory);
+    for(DirectoryContents::iterator itr = contents.begin();
+        itr != contents.end();
+        ++itr)
+    {
+        listing->entries.insert(*itr);
+
+        // the first of the entries equal ignoring case is kept, as findFileInDirectory() returns the first it lists.
+        listing->lowerCaseEntries.insert(std::make_pair(convertToLowerCase(*itr), *itr));
+    }
+
+    OSG_DEBUG<<"DirectoryCache::listDirectory("<<directory<<") listed "<<contents.size()<<" entries"<<std::endl;
+
+    return listing;
+}
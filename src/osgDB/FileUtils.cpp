@@ -326,6 +326,22 @@ osgDB::FileType osgDB::fileType(const std::string& filename)
     return FILE_NOT_FOUND;
 }
 
+bool osgDB::getModificationTime(const std::string& filename, time_t& modified)
+{
+    struct stat64 fileStat;
+#ifdef OSG_USE_UTF8_FILENAME
+    if ( _wstat64(OSGDB_STRING_TO_FILENAME(filename).c_str(), &fileStat) != 0 )
+#else
+    if ( stat64(filename.c_str(), &fileStat) != 0 )
+#endif
+    {
+        return false;
+    }
+
+    modified = fileStat.st_mtime;
+    return true;
+}
+
 std::string osgDB::findFileInPath(const std::string& filename, const FilePathList& filepath,CaseSensitivity caseSensitivity)
 {
     if (filename.empty())
@@ -335,6 +351,8 @@ std::string osgDB::findFileInPath(const std::string& filename, const FilePathLis
         return findFileInPath(convertFileNameToNativeStyle(filename), filepath, caseSensitivity);
 
 
+    DirectoryCache* directoryCache = Registry::instance()->getDirectoryCache();
+
     for(FilePathList::const_iterator itr=filepath.begin();
         itr!=filepath.end();
         ++itr)
@@ -347,11 +365,14 @@ std::string osgDB::findFileInPath(const std::string& filename, const FilePathLis
         if (path.length()>MAX_PATH) continue;
 #endif
 
-        path = getRealPath(path);
+        // with a DirectoryCache only the path of the file found is resolved, rather than each path tried.
+        if (!directoryCache) path = getRealPath(path);
 
         OSG_DEBUG << "FindFileInPath() : trying " << path << " ...\n";
-        if(fileExists(path))
+        if(directoryCache ? directoryCache->fileExists(path) : fileExists(path))
         {
+            if (directoryCache) path = getRealPath(path);
+
             OSG_DEBUG << "FindFileInPath() : USING " << path << "\n";
             return path;
         }
@@ -390,6 +411,7 @@ std::string osgDB::findFileInDirectory(const std::string& fileName,const std::st
     bool needFollowingBackslash = false;
     bool needDirectoryName = true;
     osgDB::DirectoryContents dc;
+    std::string listDirName;
 
     std::string realDirName = dirName;
     std::string realFileName = fileName;
@@ -443,19 +465,19 @@ std::string osgDB::findFileInDirectory(const std::string& fileName,const std::st
 
     if (realDirName.empty())
     {
-        dc = osgDB::getDirectoryContents(".");
+        listDirName = ".";
         needFollowingBackslash = false;
         needDirectoryName = false;
     }
     else if (realDirName=="." || realDirName=="./" || realDirName==".\\")
     {
-        dc = osgDB::getDirectoryContents(".");
+        listDirName = ".";
         needFollowingBackslash = false;
         needDirectoryName = false;
     }
     else if (realDirName=="/")
     {
-        dc = osgDB::getDirectoryContents("/");
+        listDirName = "/";
         needFollowingBackslash = false;
         needDirectoryName = true;
     }
@@ -480,7 +502,7 @@ std::string osgDB::findFileInDirectory(const std::string& fileName,const std::st
                 realDirName = findFileInDirectory(lastElement, directoryStringToUse,
                                                   CASE_INSENSITIVE);
 
-                dc = osgDB::getDirectoryContents(realDirName);
+                listDirName = realDirName;
                 needFollowingBackslash = true;
                 needDirectoryName = true;
             }
@@ -491,7 +513,7 @@ std::string osgDB::findFileInDirectory(const std::string& fileName,const std::st
                 realDirName = findFileInDirectory(lastElement, parentPath,
                                                   CASE_INSENSITIVE);
 
-                dc = osgDB::getDirectoryContents(realDirName);
+                listDirName = realDirName;
                 char lastChar = realDirName[realDirName.size()-1];
                 if (lastChar=='/') needFollowingBackslash = false;
                 else if (lastChar=='\\') needFollowingBackslash = false;
@@ -502,7 +524,7 @@ std::string osgDB::findFileInDirectory(const std::string& fileName,const std::st
         else
         {
             // No need for recursive search if we're doing an exact comparison
-            dc = osgDB::getDirectoryContents(realDirName);
+            listDirName = realDirName;
             char lastChar = realDirName[realDirName.size()-1];
             if (lastChar=='/') needFollowingBackslash = false;
             else if (lastChar=='\\') needFollowingBackslash = false;
@@ -511,19 +533,33 @@ std::string osgDB::findFileInDirectory(const std::string& fileName,const std::st
         }
     }
 
-    for(osgDB::DirectoryContents::iterator itr=dc.begin();
-        itr!=dc.end();
-        ++itr)
+    std::string entry;
+
+    DirectoryCache* directoryCache = Registry::instance()->getDirectoryCache();
+    if (directoryCache)
     {
-        if ((caseSensitivity==CASE_INSENSITIVE && osgDB::equalCaseInsensitive(realFileName,*itr)) ||
-            (realFileName==*itr))
+        entry = directoryCache->findEntry(listDirName, realFileName, caseSensitivity);
+    }
+    else
+    {
+        dc = osgDB::getDirectoryContents(listDirName);
+        for(osgDB::DirectoryContents::iterator itr=dc.begin();
+            itr!=dc.end();
+            ++itr)
         {
-            if (!needDirectoryName) return *itr;
-            else if (needFollowingBackslash) return realDirName+'/'+*itr;
-            else return realDirName+*itr;
+            if ((caseSensitivity==CASE_INSENSITIVE && osgDB::equalCaseInsensitive(realFileName,*itr)) ||
+                (realFileName==*itr))
+            {
+                entry = *itr;
+                break;
+            }
         }
     }
-    return "";
+
+    if (entry.empty()) return "";
+    else if (!needDirectoryName) return entry;
+    else if (needFollowingBackslash) return realDirName+'/'+entry;
+    else return realDirName+entry;
 }
 
 static void appendInstallationLibraryFilePaths(osgDB::FilePathList& filepath)
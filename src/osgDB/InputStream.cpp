@@ -25,6 +25,21 @@ using namespace osgDB;
 
 static std::string s_lastSchema;
 
+namespace
+{
+    /** Image whose data lives in a memory mapped file, keeps the mapping alive for the lifetime of the image.*/
+    class MappedImage : public osg::Image
+    {
+    public:
+        MappedImage( osg::Referenced* owner ) : _owner(owner) {}
+
+    protected:
+        virtual ~MappedImage() {}
+
+        osg::ref_ptr<osg::Referenced> _owner;
+    };
+}
+
 InputStream::InputStream( const osgDB::Options* options )
     :   _fileVersion(0), _useSchemaData(false), _forceReadingImage(false), _dataDecompress(0)
 {
@@ -707,7 +722,16 @@ osg::ref_ptr<osg::Image> InputStream::readImage(bool readFromExternal)
 
             // _data
             unsigned int size = 0; *this >> size;
-            if ( size )
+            char* mappedData = size ? _in->readMappedCharArray( size ) : NULL;
+            if ( mappedData )
+            {
+                // reference the data in place, modifying it only copies the touched pages of the private mapping
+                image = new MappedImage( _in->getMappedDataOwner() );
+                image->setOrigin( (osg::Image::Origin)origin );
+                image->setImage( s, t, r, internalFormat, pixelFormat, dataType,
+                    (unsigned char*)mappedData, osg::Image::NO_DELETE, packing );
+            }
+            else if ( size )
             {
                 char* data = new char[size];
                 if ( !data )
@@ -1036,7 +1060,6 @@ void InputStream::decompress()
     std::string compressorName; *this >> compressorName;
     if ( compressorName!="0" )
     {
-        std::string data;
         _fields.push_back( "Decompression" );
 
         BaseCompressor* compressor = Registry::instance()->getObjectWrapperManager()->findCompressor(compressorName);
@@ -1046,11 +1069,24 @@ void InputStream::decompress()
             return;
         }
 
-        if ( !compressor->decompress(*(_in->getStream()), data) )
-            throwException( "InputStream: Failed to decompress stream." );
+        // parse the data as it is decompressed if the compressor can, otherwise once it has all been decompressed.
+        _dataDecompress = compressor->decompressStream(*(_in->getStream()));
+        if ( _dataDecompress )
+        {
+            if ( !_dataDecompress->good() )
+                throwException( "InputStream: Failed to decompress stream." );
+        }
+        else
+        {
+            std::string data;
+            if ( !compressor->decompress(*(_in->getStream()), data) )
+                throwException( "InputStream: Failed to decompress stream." );
+            if ( getException() ) return;
+
+            _dataDecompress = new std::stringstream(data);
+        }
         if ( getException() ) return;
 
-        _dataDecompress = new std::stringstream(data);
         _in->setStream( _dataDecompress );
         _fields.pop_back();
     }
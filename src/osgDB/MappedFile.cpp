@@ -0,0 +1,227 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2008 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/MappedFile>
+#include <osgDB/ConvertUTF>
+#include <osgDB/Options>
+#include <osg/Config>
+#include <osg/Notify>
+
+#include <sstream>
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    #include <windows.h>
+    #define OSGDB_WIN32_MAPPEDFILE
+#else
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using namespace osgDB;
+
+bool osgDB::isMemoryMappedRequested(const Options* options)
+{
+    if (!options) return false;
+
+    bool memoryMapped = false;
+    std::istringstream iss(options->getOptionString());
+    std::string opt;
+    while (iss >> opt)
+    {
+        if (opt=="MemoryMapped" || opt=="MemoryMapped=true") memoryMapped = true;
+        else if (opt=="MemoryMapped=false") memoryMapped = false;
+    }
+    return memoryMapped;
+}
+
+MappedFile::MappedFile():
+    _data(0),
+    _size(0),
+    _handle(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef OSGDB_WIN32_MAPPEDFILE
+
+bool MappedFile::open(const std::string& fileName)
+{
+    close();
+
+#ifdef OSG_USE_UTF8_FILENAME
+    HANDLE file = CreateFileW(convertUTF8toUTF16(fileName).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+#else
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+#endif
+    if (file==INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart==0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMapping(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) return false;
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    _fileName = fileName;
+    _data = static_cast<char*>(data);
+    _size = static_cast<size_t>(fileSize.QuadPart);
+    _handle = mapping;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data) UnmapViewOfFile(_data);
+    if (_handle) CloseHandle(static_cast<HANDLE>(_handle));
+
+    _data = 0;
+    _size = 0;
+    _handle = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string& fileName)
+{
+    close();
+
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd<0) return false;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat)!=0 || !S_ISREG(fileStat.st_mode) || fileStat.st_size==0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(fileStat.st_size);
+
+    // MAP_PRIVATE gives copy-on-write semantics, pages only get copied if the data is modified.
+    void* data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (data==MAP_FAILED)
+    {
+        OSG_INFO<<"MappedFile::open("<<fileName<<") mmap failed."<<std::endl;
+        return false;
+    }
+
+#if defined(MADV_SEQUENTIAL)
+    madvise(data, size, MADV_SEQUENTIAL);
+#endif
+
+    _fileName = fileName;
+    _data = static_cast<char*>(data);
+    _size = size;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data) munmap(_data, _size);
+
+    _data = 0;
+    _size = 0;
+}
+
+#endif
+
+
+MappedFileStreamBuf::MappedFileStreamBuf(MappedFile* mappedFile):
+    _mappedFile(mappedFile)
+{
+    init(0, mappedFile->size());
+}
+
+MappedFileStreamBuf::MappedFileStreamBuf(MappedFile* mappedFile, size_t offset, size_t size):
+    _mappedFile(mappedFile)
+{
+    init(offset, size);
+}
+
+void MappedFileStreamBuf::init(size_t offset, size_t size)
+{
+    char* begin = _mappedFile->data();
+    size_t fileSize = _mappedFile->size();
+    if (offset>fileSize) offset = fileSize;
+    if (size>fileSize-offset) size = fileSize-offset;
+
+    setg(begin+offset, begin+offset, begin+offset+size);
+}
+
+char* MappedFileStreamBuf::take(size_t size)
+{
+    if (static_cast<size_t>(egptr()-gptr())<size) return 0;
+
+    char* ptr = gptr();
+    setg(eback(), ptr+size, egptr());
+    return ptr;
+}
+
+MappedFileStreamBuf::pos_type MappedFileStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+    if ((which & std::ios_base::in)==0) return pos_type(off_type(-1));
+
+    off_type pos = 0;
+    switch(dir)
+    {
+        case(std::ios_base::beg): pos = off; break;
+        case(std::ios_base::cur): pos = (gptr()-eback()) + off; break;
+        case(std::ios_base::end): pos = (egptr()-eback()) + off; break;
+        default: return pos_type(off_type(-1));
+    }
+
+    if (pos<0 || pos>(egptr()-eback())) return pos_type(off_type(-1));
+
+    setg(eback(), eback()+pos, egptr());
+    return pos_type(pos);
+}
+
+MappedFileStreamBuf::pos_type MappedFileStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+
+MappedFileStream::MappedFileStream(MappedFile* mappedFile):
+    std::istream(0),
+    _streamBuf(mappedFile)
+{
+    rdbuf(&_streamBuf);
+}
+
+MappedFileStream::MappedFileStream(MappedFile* mappedFile, size_t offset, size_t size):
+    std::istream(0),
+    _streamBuf(mappedFile, offset, size)
+{
+    rdbuf(&_streamBuf);
+}
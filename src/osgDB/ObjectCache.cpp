@@ -12,29 +12,19 @@
 */
 
 #include <osg/Texture>
+#include <osg/Geometry>
 #include <osgDB/ObjectCache>
 #include <osgDB/Options>
 
+#include <set>
+
 using namespace osgDB;
 
-bool ObjectCache::ClassComp::operator() (const ObjectCache::FileNameOptionsPair& lhs, const ObjectCache::FileNameOptionsPair& rhs) const
+ObjectCache::FileNameOptionsKey::FileNameOptionsKey(const std::string& fileName, const Options* options):
+    _fileName(fileName),
+    _hasOptions(options!=0)
 {
-    // check if filename are the same
-    if (lhs.first < rhs.first) return true;
-    if (rhs.first < lhs.first) return false;
-
-    // check if Options pointers are the same.
-    if (lhs.second == rhs.second) return false;
-
-    // need to compare Options pointers
-    if (lhs.second.valid() && rhs.second.valid())
-    {
-        // lhs & rhs have valid Options objects
-        return *lhs.second < *rhs.second;
-    }
-
-    // finally use pointer comparison, expecting at least one will be NULL pointer
-    return lhs.second < rhs.second;
+    if (options) _optionString = options->getOptionString();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -42,7 +32,9 @@ bool ObjectCache::ClassComp::operator() (const ObjectCache::FileNameOptionsPair&
 // ObjectCache
 //
 ObjectCache::ObjectCache():
-    osg::Referenced(true)
+    osg::Referenced(true),
+    _maximumSizeInBytes(0),
+    _sizeInBytes(0)
 {
 //    OSG_NOTICE<<"Constructed ObjectCache"<<std::endl;
 }
@@ -52,141 +44,368 @@ ObjectCache::~ObjectCache()
 //    OSG_NOTICE<<"Destructed ObjectCache"<<std::endl;
 }
 
-void ObjectCache::addObjectCache(ObjectCache* objectCache)
+ObjectCache::Shard& ObjectCache::getShard(const std::string& fileName)
 {
-    // don't allow a cache to be added to itself.
-    if (objectCache==this) return;
+    // FNV-1a hash of the filename
+    unsigned int hash = 2166136261u;
+    for(std::string::const_iterator itr = fileName.begin(); itr != fileName.end(); ++itr)
+    {
+        hash ^= static_cast<unsigned char>(*itr);
+        hash *= 16777619u;
+    }
+    return _shards[hash % NUM_SHARDS];
+}
 
-    // lock both ObjectCache to prevent their contents from being modified by other threads while we merge.
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock1(_objectCacheMutex);
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock2(objectCache->_objectCacheMutex);
+void ObjectCache::setMaximumSizeInBytes(unsigned long long size)
+{
+    unsigned long long previousSize = 0;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_sizeMutex);
+        previousSize = _maximumSizeInBytes;
+        _maximumSizeInBytes = size;
+    }
+
+    if (size==0) return;
+
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
+    {
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        // sizes aren't estimated without a budget, so estimate the entries cached before this one was set.
+        if (previousSize==0)
+        {
+            for(ObjectCacheMap::iterator itr = shard._objectCache.begin();
+                itr != shard._objectCache.end();
+                ++itr)
+            {
+                if (itr->second._sizeInBytes!=0) continue;
+
+                unsigned long long sizeInBytes = estimateSizeInBytes(itr->second._object.get());
+                itr->second._sizeInBytes = sizeInBytes;
+                shard._sizeInBytes += sizeInBytes;
+
+                OpenThreads::ScopedLock<OpenThreads::Mutex> sizeLock(_sizeMutex);
+                _sizeInBytes += sizeInBytes;
+            }
+        }
 
-    OSG_DEBUG<<"Inserting objects to main ObjectCache "<<objectCache->_objectCache.size()<<std::endl;
+        evict(shard);
+    }
+}
 
-    _objectCache.insert(objectCache->_objectCache.begin(), objectCache->_objectCache.end());
+unsigned long long ObjectCache::getMaximumSizeInBytes() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_sizeMutex);
+    return _maximumSizeInBytes;
 }
 
+unsigned long long ObjectCache::getSizeInBytes() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_sizeMutex);
+    return _sizeInBytes;
+}
 
-void ObjectCache::addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp, const Options *options)
+unsigned int ObjectCache::getNumEntries() const
 {
-    if (!object) return;
+    unsigned int numEntries = 0;
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_shards[i]._mutex);
+        numEntries += _shards[i]._objectCache.size();
+    }
+    return numEntries;
+}
 
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache[FileNameOptionsPair(filename, options ? osg::clone(options) : 0)] = ObjectTimeStampPair(object,timestamp);
-    OSG_DEBUG<<"Adding "<<filename<<" with options '"<<(options ? options->getOptionString() : "")<<"' to ObjectCache "<<this<<std::endl;
+unsigned int ObjectCache::getNumHits() const
+{
+    unsigned int numHits = 0;
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_shards[i]._mutex);
+        numHits += _shards[i]._numHits;
+    }
+    return numHits;
 }
 
-ObjectCache::ObjectCacheMap::iterator ObjectCache::find(const std::string& fileName, const osgDB::Options* options)
+unsigned int ObjectCache::getNumMisses() const
 {
-    for(ObjectCacheMap::iterator itr = _objectCache.begin();
-        itr != _objectCache.end();
-        ++itr)
+    unsigned int numMisses = 0;
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
     {
-        if (itr->first.first==fileName)
-        {
-            if (itr->first.second.valid())
-            {
-                if (options && *(itr->first.second)==*options) return itr;
-            }
-            else if (!options) return itr;
-        }
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_shards[i]._mutex);
+        numMisses += _shards[i]._numMisses;
     }
-    return _objectCache.end();
+    return numMisses;
 }
 
+unsigned int ObjectCache::getNumEvictions() const
+{
+    unsigned int numEvictions = 0;
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_shards[i]._mutex);
+        numEvictions += _shards[i]._numEvictions;
+    }
+    return numEvictions;
+}
 
-osg::Object* ObjectCache::getFromObjectCache(const std::string& fileName, const Options *options)
+void ObjectCache::resetStatistics()
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = find(fileName, options);
-    if (itr!=_objectCache.end())
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
     {
-        osg::ref_ptr<const osgDB::Options> o = itr->first.second;
-        if (o.valid())
-        {
-            OSG_DEBUG<<"Found "<<fileName<<" with options '"<< o->getOptionString()<< "' in ObjectCache "<<this<<std::endl;
-        }
-        else
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_shards[i]._mutex);
+        _shards[i]._numHits = 0;
+        _shards[i]._numMisses = 0;
+        _shards[i]._numEvictions = 0;
+    }
+}
+
+void ObjectCache::erase(Shard& shard, ObjectCacheMap::iterator itr)
+{
+    shard._sizeInBytes -= itr->second._sizeInBytes;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_sizeMutex);
+        _sizeInBytes -= itr->second._sizeInBytes;
+    }
+
+    shard._lruList.erase(itr->second._lruPosition);
+    shard._objectCache.erase(itr);
+}
+
+void ObjectCache::evict(Shard& shard)
+{
+    unsigned long long maximumSizeInBytes = getMaximumSizeInBytes();
+    if (maximumSizeInBytes==0) return;
+
+    if (evictFromShard(shard, maximumSizeInBytes)) return;
+
+    // the budget is for the whole cache, so carry on with the other shards. Only try their locks, as another
+    // thread may hold one of them while waiting on this shard's lock, and skip those already locked.
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
+    {
+        Shard& otherShard = _shards[i];
+        if (&otherShard==&shard || otherShard._mutex.trylock()!=0) continue;
+
+        bool withinBudget = evictFromShard(otherShard, maximumSizeInBytes);
+
+        otherShard._mutex.unlock();
+
+        if (withinBudget) return;
+    }
+}
+
+bool ObjectCache::evictFromShard(Shard& shard, unsigned long long maximumSizeInBytes)
+{
+    // walk from the least recently used entry, skipping those referenced elsewhere
+    // as removing them wouldn't release any memory.
+    LRUList::iterator itr = shard._lruList.end();
+    while(getSizeInBytes()>maximumSizeInBytes)
+    {
+        if (itr == shard._lruList.begin()) return false;
+
+        --itr;
+
+        ObjectCacheMap::iterator entry_itr = shard._objectCache.find(**itr);
+        if (entry_itr->second._object->referenceCount()==1)
         {
-            OSG_DEBUG<<"Found "<<fileName<<" in ObjectCache "<<this<<std::endl;
+            OSG_DEBUG<<"Evicting "<<entry_itr->first._fileName<<" from ObjectCache "<<this<<std::endl;
+
+            LRUList::iterator next_itr = itr;
+            ++next_itr;
+
+            erase(shard, entry_itr);
+            ++shard._numEvictions;
+
+            itr = next_itr;
         }
-        return itr->second.first.get();
     }
-    else return 0;
+    return true;
 }
 
-osg::ref_ptr<osg::Object> ObjectCache::getRefFromObjectCache(const std::string& fileName, const Options *options)
+void ObjectCache::insert(const FileNameOptionsKey& key, osg::Object* object, double timestamp, unsigned long long sizeInBytes, bool replace)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = find(fileName, options);
-    if (itr!=_objectCache.end())
+    Shard& shard = getShard(key._fileName);
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+    ObjectCacheMap::iterator itr = shard._objectCache.find(key);
+    if (itr != shard._objectCache.end())
     {
-        osg::ref_ptr<const osgDB::Options> o = itr->first.second;
-        if (o.valid())
+        if (!replace) return;
+        erase(shard, itr);
+    }
+
+    itr = shard._objectCache.insert(ObjectCacheMap::value_type(key, CacheEntry())).first;
+
+    CacheEntry& entry = itr->second;
+    entry._object = object;
+    entry._timeStamp = timestamp;
+    entry._sizeInBytes = sizeInBytes;
+    entry._lruPosition = shard._lruList.insert(shard._lruList.begin(), &(itr->first));
+
+    shard._sizeInBytes += sizeInBytes;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> sizeLock(_sizeMutex);
+        _sizeInBytes += sizeInBytes;
+    }
+
+    evict(shard);
+}
+
+void ObjectCache::addObjectCache(ObjectCache* objectCache)
+{
+    // don't allow a cache to be added to itself.
+    if (objectCache==this) return;
+
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
+    {
+        // copy the entries out first so that only one cache is locked at any one time.
+        typedef std::vector< std::pair<FileNameOptionsKey, CacheEntry> > Entries;
+        Entries entries;
         {
-            OSG_DEBUG<<"Found "<<fileName<<" with options '"<< o->getOptionString()<< "' in ObjectCache "<<this<<std::endl;
+            Shard& shard = objectCache->_shards[i];
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+            entries.insert(entries.end(), shard._objectCache.begin(), shard._objectCache.end());
         }
-        else
+
+        OSG_DEBUG<<"Inserting objects to main ObjectCache "<<entries.size()<<std::endl;
+
+        for(Entries::iterator itr = entries.begin();
+            itr != entries.end();
+            ++itr)
         {
-            OSG_DEBUG<<"Found "<<fileName<<" in ObjectCache "<<this<<std::endl;
+            // entries of a cache without a budget have no size estimate.
+            unsigned long long sizeInBytes = itr->second._sizeInBytes;
+            if (sizeInBytes==0 && getMaximumSizeInBytes()>0) sizeInBytes = estimateSizeInBytes(itr->second._object.get());
+
+            insert(itr->first, itr->second._object.get(), itr->second._timeStamp, sizeInBytes, false);
         }
-        return itr->second.first.get();
     }
-    else return 0;
 }
 
-void ObjectCache::updateTimeStampOfObjectsInCacheWithExternalReferences(double referenceTime)
+
+void ObjectCache::addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp, const Options *options)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
+    if (!object) return;
+
+    // only pay for estimating the size when there is a budget to keep to, setting one estimates the entries already cached.
+    unsigned long long sizeInBytes = (getMaximumSizeInBytes()>0) ? estimateSizeInBytes(object) : 0;
+    insert(FileNameOptionsKey(filename, options), object, timestamp, sizeInBytes, true);
+
+    OSG_DEBUG<<"Adding "<<filename<<" with options '"<<(options ? options->getOptionString() : "")<<"' to ObjectCache "<<this<<std::endl;
+}
+
+osg::ref_ptr<osg::Object> ObjectCache::find(const std::string& fileName, const osgDB::Options* options)
+{
+    Shard& shard = getShard(fileName);
 
-    // look for objects with external references and update their time stamp.
-    for(ObjectCacheMap::iterator itr=_objectCache.begin();
-        itr!=_objectCache.end();
-        ++itr)
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+    ObjectCacheMap::iterator itr = shard._objectCache.find(FileNameOptionsKey(fileName, options));
+    if (itr==shard._objectCache.end())
     {
-        // if ref count is greater the 1 the object has an external reference.
-        if (itr->second.first->referenceCount()>1)
-        {
-            // so update it time stamp.
-            itr->second.second = referenceTime;
-        }
+        ++shard._numMisses;
+        return 0;
     }
+
+    ++shard._numHits;
+
+    // move to the front of the least recently used list
+    shard._lruList.splice(shard._lruList.begin(), shard._lruList, itr->second._lruPosition);
+
+    if (itr->first._hasOptions)
+    {
+        OSG_DEBUG<<"Found "<<fileName<<" with options '"<< itr->first._optionString<< "' in ObjectCache "<<this<<std::endl;
+    }
+    else
+    {
+        OSG_DEBUG<<"Found "<<fileName<<" in ObjectCache "<<this<<std::endl;
+    }
+
+    return itr->second._object;
 }
 
-void ObjectCache::removeExpiredObjectsInCache(double expiryTime)
+osg::Object* ObjectCache::getFromObjectCache(const std::string& fileName, const Options *options)
+{
+    return find(fileName, options).get();
+}
+
+osg::ref_ptr<osg::Object> ObjectCache::getRefFromObjectCache(const std::string& fileName, const Options *options)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
+    return find(fileName, options);
+}
 
-    // Remove expired entries from object cache
-    ObjectCacheMap::iterator oitr = _objectCache.begin();
-    while(oitr != _objectCache.end())
+void ObjectCache::updateTimeStampOfObjectsInCacheWithExternalReferences(double referenceTime)
+{
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
     {
-        if (oitr->second.second<=expiryTime)
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        // look for objects with external references and update their time stamp.
+        for(ObjectCacheMap::iterator itr=shard._objectCache.begin();
+            itr!=shard._objectCache.end();
+            ++itr)
         {
-#if __cplusplus > 199711L
-            oitr = _objectCache.erase(oitr);
-#else
-            _objectCache.erase(oitr++);
-#endif
+            // if ref count is greater the 1 the object has an external reference.
+            if (itr->second._object->referenceCount()>1)
+            {
+                // so update it time stamp.
+                itr->second._timeStamp = referenceTime;
+            }
         }
-        else
+    }
+}
+
+void ObjectCache::removeExpiredObjectsInCache(double expiryTime)
+{
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
+    {
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        // Remove expired entries from object cache
+        ObjectCacheMap::iterator oitr = shard._objectCache.begin();
+        while(oitr != shard._objectCache.end())
         {
-            ++oitr;
+            if (oitr->second._timeStamp<=expiryTime)
+            {
+                erase(shard, oitr++);
+            }
+            else
+            {
+                ++oitr;
+            }
         }
     }
 }
 
 void ObjectCache::removeFromObjectCache(const std::string& fileName, const Options *options)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = find(fileName, options);
-    if (itr!=_objectCache.end()) _objectCache.erase(itr);
+    Shard& shard = getShard(fileName);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+    ObjectCacheMap::iterator itr = shard._objectCache.find(FileNameOptionsKey(fileName, options));
+    if (itr!=shard._objectCache.end()) erase(shard, itr);
 }
 
 void ObjectCache::clear()
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache.clear();
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
+    {
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> sizeLock(_sizeMutex);
+            _sizeInBytes -= shard._sizeInBytes;
+        }
+
+        shard._objectCache.clear();
+        shard._lruList.clear();
+        shard._sizeInBytes = 0;
+    }
 }
 
 namespace ObjectCacheUtils
@@ -252,32 +471,119 @@ struct ContainsUnreffedTextures : public osg::NodeVisitor
     }
 };
 
+struct EstimateSizeVisitor : public osg::NodeVisitor
+{
+    EstimateSizeVisitor() :
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        sizeInBytes(0)
+    {}
+
+    typedef std::set<const osg::BufferData*> BufferDataSet;
+    typedef std::set<const osg::StateSet*> StateSets;
+
+    unsigned long long  sizeInBytes;
+    BufferDataSet       bufferDataSet;
+    StateSets           stateSets;
+
+    void add(const osg::BufferData* bufferData)
+    {
+        if (bufferData && bufferDataSet.insert(bufferData).second) sizeInBytes += bufferData->getTotalDataSize();
+    }
+
+    void add(const osg::StateAttribute* sa)
+    {
+        const osg::Texture* texture = sa ? sa->asTexture() : 0;
+        if (!texture) return;
+
+        for(unsigned int i=0; i<texture->getNumImages(); ++i)
+        {
+            add(texture->getImage(i));
+        }
+    }
+
+    void add(const osg::StateSet* stateset)
+    {
+        if (!stateset || !stateSets.insert(stateset).second) return;
+
+        for(unsigned int i=0; i<stateset->getNumTextureAttributeLists(); ++i)
+        {
+            add(stateset->getTextureAttribute(i, osg::StateAttribute::TEXTURE));
+        }
+    }
+
+    void add(const osg::Object* object)
+    {
+        if (!object) return;
+
+        if (object->asNode()) const_cast<osg::Node*>(object->asNode())->accept(*this);
+        else if (object->asStateSet()) add(object->asStateSet());
+        else if (object->asStateAttribute()) add(object->asStateAttribute());
+        else add(dynamic_cast<const osg::BufferData*>(object));
+    }
+
+    void apply(osg::Node& node)
+    {
+        add(node.getStateSet());
+        traverse(node);
+    }
+
+    void apply(osg::Geometry& geometry)
+    {
+        add(geometry.getStateSet());
+
+        osg::Geometry::ArrayList arrays;
+        geometry.getArrayList(arrays);
+        for(osg::Geometry::ArrayList::iterator itr = arrays.begin();
+            itr != arrays.end();
+            ++itr)
+        {
+            add(itr->get());
+        }
+
+        for(unsigned int i=0; i<geometry.getNumPrimitiveSets(); ++i)
+        {
+            add(geometry.getPrimitiveSet(i));
+        }
+    }
+};
+
 } // ObjectCacheUtils
 
-void ObjectCache::releaseGLObjects(osg::State* state)
+unsigned long long ObjectCache::estimateSizeInBytes(const osg::Object* object)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
+    ObjectCacheUtils::EstimateSizeVisitor esv;
+    esv.add(object);
+    return esv.sizeInBytes;
+}
 
+void ObjectCache::releaseGLObjects(osg::State* state)
+{
     ObjectCacheUtils::ContainsUnreffedTextures cut;
 
-    for(ObjectCacheMap::iterator itr = _objectCache.begin();
-        itr != _objectCache.end();
-        )
+    for(unsigned int i=0; i<NUM_SHARDS; ++i)
     {
-        ObjectCacheMap::iterator curr_itr = itr;
+        Shard& shard = _shards[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
 
-        // get object and advance iterator to next item
-        osg::Object* object = itr->second.first.get();
+        for(ObjectCacheMap::iterator itr = shard._objectCache.begin();
+            itr != shard._objectCache.end();
+            )
+        {
+            ObjectCacheMap::iterator curr_itr = itr;
 
-        bool needToRemoveEntry = cut.check(itr->second.first.get());
+            // get object and advance iterator to next item
+            osg::Object* object = itr->second._object.get();
 
-        object->releaseGLObjects(state);
+            bool needToRemoveEntry = cut.check(object);
 
-        ++itr;
+            object->releaseGLObjects(state);
 
-        if (needToRemoveEntry)
-        {
-            _objectCache.erase(curr_itr);
+            ++itr;
+
+            if (needToRemoveEntry)
+            {
+                erase(shard, curr_itr);
+            }
         }
     }
 }
@@ -11,10 +11,23 @@
 
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
+#include <osgDB/fstream>
 #include <osg/Version>
+#include <osg/Notify>
 
 #include <osgDB/PluginQuery>
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <sstream>
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    #include <process.h>
+    #define getpid _getpid
+#else
+    #include <unistd.h>
+#endif
+
 using namespace osgDB;
 
 FileNameList osgDB::listAllAvailablePlugins()
@@ -202,3 +215,241 @@ bool osgDB::outputPluginDetails(std::ostream& out, const std::string& fileName)
     }
 }
 
+
+PluginIndex::PluginIndex():
+    _directoryModified(0)
+{
+}
+
+PluginIndex::~PluginIndex()
+{
+}
+
+void PluginIndex::build()
+{
+    _directory = osgDB::findLibraryFile(std::string("osgPlugins-")+std::string(osgGetVersion()));
+    _directoryModified = 0;
+    _plugins.clear();
+
+    if (!_directory.empty()) getModificationTime(_directory, _directoryModified);
+
+    FileNameList plugins = listAllAvailablePlugins();
+    for(FileNameList::iterator itr = plugins.begin();
+        itr != plugins.end();
+        ++itr)
+    {
+        // querying a plugin that is already loaded finds none of its ReaderWriters and closes it under its users, so leave
+        // it out of the index to be searched for on the library file path instead.
+        if (Registry::instance()->getLibrary(*itr))
+        {
+            OSG_INFO<<"PluginIndex::build() not indexing "<<*itr<<" as it is already loaded"<<std::endl;
+            continue;
+        }
+
+        Plugin plugin;
+        plugin.fileName = *itr;
+        getModificationTime(plugin.fileName, plugin.modified);
+
+        ReaderWriterInfoList infoList;
+        if (queryPlugin(plugin.fileName, infoList))
+        {
+            for(ReaderWriterInfoList::iterator rwi_itr = infoList.begin();
+                rwi_itr != infoList.end();
+                ++rwi_itr)
+            {
+                ReaderWriterInfo& info = *(*rwi_itr);
+                plugin.features = ReaderWriter::Features(plugin.features | info.features);
+
+                ReaderWriter::FormatDescriptionMap::iterator fdm_itr;
+                for(fdm_itr = info.extensions.begin(); fdm_itr != info.extensions.end(); ++fdm_itr)
+                {
+                    plugin.extensions.insert(convertToLowerCase(fdm_itr->first));
+                }
+                for(fdm_itr = info.protocols.begin(); fdm_itr != info.protocols.end(); ++fdm_itr)
+                {
+                    plugin.protocols.insert(convertToLowerCase(fdm_itr->first));
+                }
+            }
+        }
+
+        _plugins.push_back(plugin);
+    }
+
+    buildMaps();
+
+    OSG_INFO<<"PluginIndex::build() indexed "<<_plugins.size()<<" plugins in "<<_directory<<std::endl;
+}
+
+bool PluginIndex::read(const std::string& fileName)
+{
+    osgDB::ifstream fin(fileName.c_str());
+    if (!fin) return false;
+
+    std::string line;
+    if (!std::getline(fin, line) || line!="#OpenSceneGraph plugin index 1") return false;
+
+    _directory.clear();
+    _directoryModified = 0;
+    _plugins.clear();
+
+    // each line is a keyword followed by fields separated by tabs, with file names last as they may hold any other character.
+    while(std::getline(fin, line))
+    {
+        std::vector<std::string> fields;
+        std::string::size_type start = 0;
+        unsigned int numFields = (line.compare(0, 7, "plugin\t")==0) ? 4 : 3;
+        while(fields.size()+1<numFields)
+        {
+            std::string::size_type end = line.find('\t', start);
+            if (end==std::string::npos) break;
+            fields.push_back(line.substr(start, end-start));
+            start = end+1;
+        }
+        fields.push_back(line.substr(start));
+
+        if (fields[0]=="directory" && fields.size()==3)
+        {
+            _directoryModified = (time_t)strtoll(fields[1].c_str(), 0, 10);
+            _directory = fields[2];
+        }
+        else if (fields[0]=="plugin" && fields.size()==4)
+        {
+            Plugin plugin;
+            plugin.modified = (time_t)strtoll(fields[1].c_str(), 0, 10);
+            plugin.features = ReaderWriter::Features(atoi(fields[2].c_str()));
+            plugin.fileName = fields[3];
+            _plugins.push_back(plugin);
+        }
+        else if (fields[0]=="extension" && fields.size()==2 && !_plugins.empty())
+        {
+            _plugins.back().extensions.insert(fields[1]);
+        }
+        else if (fields[0]=="protocol" && fields.size()==2 && !_plugins.empty())
+        {
+            _plugins.back().protocols.insert(fields[1]);
+        }
+        else
+        {
+            OSG_INFO<<"PluginIndex::read() unrecognised line in "<<fileName<<" : "<<line<<std::endl;
+            return false;
+        }
+    }
+
+    buildMaps();
+    return !_directory.empty();
+}
+
+bool PluginIndex::write(const std::string& fileName) const
+{
+    // written alongside then renamed over the existing index, named after the process as several processes
+    // finding the index out of date may each rebuild and write it at the same time.
+    std::ostringstream tempFileNameStream;
+    tempFileNameStream<<fileName<<"."<<getpid()<<".tmp";
+    std::string tempFileName = tempFileNameStream.str();
+    {
+        osgDB::ofstream fout(tempFileName.c_str());
+        if (!fout) return false;
+
+        fout<<"#OpenSceneGraph plugin index 1"<<std::endl;
+        fout<<"directory\t"<<(long long)_directoryModified<<"\t"<<_directory<<std::endl;
+        for(Plugins::const_iterator itr = _plugins.begin();
+            itr != _plugins.end();
+            ++itr)
+        {
+            fout<<"plugin\t"<<(long long)itr->modified<<"\t"<<int(itr->features)<<"\t"<<itr->fileName<<std::endl;
+
+            std::set<std::string>::const_iterator sitr;
+            for(sitr = itr->extensions.begin(); sitr != itr->extensions.end(); ++sitr)
+            {
+                fout<<"extension\t"<<*sitr<<std::endl;
+            }
+            for(sitr = itr->protocols.begin(); sitr != itr->protocols.end(); ++sitr)
+            {
+                fout<<"protocol\t"<<*sitr<<std::endl;
+            }
+        }
+
+        if (fout.fail()) return false;
+    }
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+    // rename() won't replace an existing file on Windows.
+    remove(fileName.c_str());
+#endif
+    if (rename(tempFileName.c_str(), fileName.c_str())!=0)
+    {
+        remove(tempFileName.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool PluginIndex::isUpToDate() const
+{
+    if (_directory.empty()) return false;
+
+    // a plugin added or removed changes the time the directory was modified, a plugin rebuilt in place the time it was modified.
+    if (osgDB::findLibraryFile(std::string("osgPlugins-")+std::string(osgGetVersion()))!=_directory) return false;
+
+    time_t modified = 0;
+    if (!getModificationTime(_directory, modified) || modified!=_directoryModified) return false;
+
+    for(Plugins::const_iterator itr = _plugins.begin();
+        itr != _plugins.end();
+        ++itr)
+    {
+        if (!getModificationTime(itr->fileName, modified) || modified!=itr->modified) return false;
+    }
+    return true;
+}
+
+bool PluginIndex::containsPlugin(const std::string& fileName) const
+{
+    for(Plugins::const_iterator itr = _plugins.begin();
+        itr != _plugins.end();
+        ++itr)
+    {
+        if (itr->fileName==fileName) return true;
+    }
+    return false;
+}
+
+std::string PluginIndex::findPluginForExtension(const std::string& ext, const std::string& preferredFileName) const
+{
+    PluginMap::const_iterator itr = _extensionMap.find(ext);
+    if (itr==_extensionMap.end()) return std::string();
+
+    std::string preferredSimpleFileName = getSimpleFileName(preferredFileName);
+    for(std::vector<unsigned int>::const_iterator pitr = itr->second.begin();
+        pitr != itr->second.end();
+        ++pitr)
+    {
+        if (getSimpleFileName(_plugins[*pitr].fileName)==preferredSimpleFileName) return _plugins[*pitr].fileName;
+    }
+    return _plugins[itr->second.front()].fileName;
+}
+
+std::string PluginIndex::findPluginForProtocol(const std::string& protocol) const
+{
+    PluginMap::const_iterator itr = _protocolMap.find(protocol);
+    return itr!=_protocolMap.end() ? _plugins[itr->second.front()].fileName : std::string();
+}
+
+void PluginIndex::buildMaps()
+{
+    _extensionMap.clear();
+    _protocolMap.clear();
+
+    for(unsigned int i=0; i<_plugins.size(); ++i)
+    {
+        std::set<std::string>::const_iterator sitr;
+        for(sitr = _plugins[i].extensions.begin(); sitr != _plugins[i].extensions.end(); ++sitr)
+        {
+            _extensionMap[*sitr].push_back(i);
+        }
+        for(sitr = _plugins[i].protocols.begin(); sitr != _plugins[i].protocols.end(); ++sitr)
+        {
+            _protocolMap[*sitr].push_back(i);
+        }
+    }
+}
@@ -63,6 +63,9 @@ static osg::ApplicationUsageProxy Registry_e1(osg::ApplicationUsage::ENVIRONMENT
 #endif
 
 static osg::ApplicationUsageProxy Registry_e2(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_BUILD_KDTREES on/off","Enable/disable the automatic building of KdTrees for each loaded Geometry.");
+static osg::ApplicationUsageProxy Registry_e5(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DIRECTORY_CACHE <seconds>","Find data files and libraries from cached directory listings, checked for modification no more often than every <seconds>.");
+static osg::ApplicationUsageProxy Registry_e4(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_PLUGIN_INDEX_FILE <file>","File of the index of the plugins and the extensions and protocols they support, rebuilt when the plugins change, used to load plugins without searching for them.");
+static osg::ApplicationUsageProxy Registry_e3(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OBJECT_CACHE_SIZE <megabytes>","Maximum estimated memory footprint of the Registry's ObjectCache, least recently used objects are evicted beyond it.");
 
 
 // from MimeTypes.cpp
@@ -219,7 +222,8 @@ OSG_INIT_SINGLETON_PROXY(ProxyInitRegistry, Registry::instance())
 
 
 // definition of the Registry
-Registry::Registry()
+Registry::Registry():
+    _pluginIndexRead(false)
 {
     // comment out because it was causing problems under OSX - causing it to crash osgconv when constructing ostream in osg::notify().
     // OSG_INFO << "Constructing osg::Registry"<<std::endl;
@@ -244,6 +248,19 @@ Registry::Registry()
         OSG_INFO<<"Registry : Expiry delay = "<<_expiryDelay<<std::endl;
     }
 
+    const char* pluginIndexFile = getenv("OSG_PLUGIN_INDEX_FILE");
+    if (pluginIndexFile)
+    {
+        _pluginIndexFile = pluginIndexFile;
+    }
+
+    if( (ptr = getenv("OSG_DIRECTORY_CACHE")) != 0)
+    {
+        _directoryCache = new DirectoryCache;
+        _directoryCache->setValidationInterval(osg::asciiToDouble(ptr));
+        OSG_INFO<<"Registry : DirectoryCache validation interval = "<<_directoryCache->getValidationInterval()<<"s"<<std::endl;
+    }
+
     const char* fileCachePath = getenv("OSG_FILE_CACHE");
     if (fileCachePath)
     {
@@ -253,6 +270,13 @@ Registry::Registry()
     // assign ObjectCache.
     _objectCache = new ObjectCache;
 
+    if( (ptr = getenv("OSG_OBJECT_CACHE_SIZE")) != 0)
+    {
+        double sizeInMegabytes = osg::asciiToDouble(ptr);
+        if (sizeInMegabytes>0.0) _objectCache->setMaximumSizeInBytes(static_cast<unsigned long long>(sizeInMegabytes*1024.0*1024.0));
+        OSG_INFO<<"Registry : ObjectCache size = "<<sizeInMegabytes<<"MB"<<std::endl;
+    }
+
     _createNodeFromImage = false;
     _openingLibrary = false;
 
@@ -784,17 +808,26 @@ std::string Registry::createLibraryNameForExtension(const std::string& ext)
     std::string prepend = std::string("osgPlugins-")+std::string(osgGetVersion())+std::string("/");
 
 #if defined(__CYGWIN__)
-    return prepend+"cygwin_"+"osgdb_"+lowercase_ext+OSG_LIBRARY_POSTFIX_WITH_QUOTES+".dll";
+    std::string libraryName = prepend+"cygwin_"+"osgdb_"+lowercase_ext+OSG_LIBRARY_POSTFIX_WITH_QUOTES+".dll";
 #elif defined(__MINGW32__)
-    return prepend+"mingw_"+"osgdb_"+lowercase_ext+OSG_LIBRARY_POSTFIX_WITH_QUOTES+".dll";
+    std::string libraryName = prepend+"mingw_"+"osgdb_"+lowercase_ext+OSG_LIBRARY_POSTFIX_WITH_QUOTES+".dll";
 #elif defined(_WIN32)
-    return prepend+"osgdb_"+lowercase_ext+OSG_LIBRARY_POSTFIX_WITH_QUOTES+".dll";
+    std::string libraryName = prepend+"osgdb_"+lowercase_ext+OSG_LIBRARY_POSTFIX_WITH_QUOTES+".dll";
 #elif macintosh
-    return prepend+"osgdb_"+lowercase_ext+OSG_LIBRARY_POSTFIX_WITH_QUOTES;
+    std::string libraryName = prepend+"osgdb_"+lowercase_ext+OSG_LIBRARY_POSTFIX_WITH_QUOTES;
 #else
-    return prepend+"osgdb_"+lowercase_ext+OSG_LIBRARY_POSTFIX_WITH_QUOTES+ADDQUOTES(OSG_PLUGIN_EXTENSION);
+    std::string libraryName = prepend+"osgdb_"+lowercase_ext+OSG_LIBRARY_POSTFIX_WITH_QUOTES+ADDQUOTES(OSG_PLUGIN_EXTENSION);
 #endif
 
+    // with a plugin index use the plugin named after the extension if it supports it, otherwise any other plugin that does.
+    osg::ref_ptr<PluginIndex> pluginIndex = getPluginIndex();
+    if (pluginIndex.valid())
+    {
+        std::string pluginFileName = pluginIndex->findPluginForExtension(lowercase_ext, libraryName);
+        if (!pluginFileName.empty()) return pluginFileName;
+    }
+
+    return libraryName;
 }
 
 std::string Registry::createLibraryNameForNodeKit(const std::string& name)
@@ -812,10 +845,94 @@ std::string Registry::createLibraryNameForNodeKit(const std::string& name)
 #endif
 }
 
-Registry::LoadStatus Registry::loadLibrary(const std::string& fileName)
+void Registry::setPluginIndexFile(const std::string& fileName)
+{
+    OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_pluginMutex);
+    _pluginIndexFile = fileName;
+    _pluginIndex = 0;
+    _pluginIndexRead = false;
+}
+
+osg::ref_ptr<PluginIndex> Registry::getPluginIndex()
+{
+    OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_pluginMutex);
+
+    if (!_pluginIndexRead)
+    {
+        // set first as building the index loads each plugin, which mustn't consult the index.
+        _pluginIndexRead = true;
+
+        if (!_pluginIndexFile.empty())
+        {
+            osg::ref_ptr<PluginIndex> pluginIndex = new PluginIndex;
+            if (!pluginIndex->read(_pluginIndexFile) || !pluginIndex->isUpToDate())
+            {
+                // building queries each plugin by loading and closing it, which would index plugins already loaded without
+                // their ReaderWriters and close them under their users, so only build before any plugin has been loaded.
+                if (!_dlList.empty())
+                {
+                    OSG_NOTICE<<"Warning: Registry::getPluginIndex() can't build plugin index "<<_pluginIndexFile<<" once plugins are loaded, plugin index not used."<<std::endl;
+                    return _pluginIndex;
+                }
+
+                OSG_INFO<<"Registry::getPluginIndex() building plugin index "<<_pluginIndexFile<<std::endl;
+
+                pluginIndex = new PluginIndex;
+                pluginIndex->build();
+                if (!pluginIndex->write(_pluginIndexFile))
+                {
+                    OSG_NOTICE<<"Warning: Registry::getPluginIndex() could not write plugin index "<<_pluginIndexFile<<std::endl;
+                }
+            }
+
+            if (!pluginIndex->getDirectory().empty()) _pluginIndex = pluginIndex;
+        }
+    }
+
+    return _pluginIndex;
+}
+
+std::string Registry::getIndexedLibraryName(const std::string& fileName)
+{
+    osg::ref_ptr<PluginIndex> pluginIndex = getPluginIndex();
+    if (!pluginIndex) return fileName;
+
+    // plugins named relative to the library file path are taken from the indexed plugin directory if the index holds them.
+    std::string prepend = std::string("osgPlugins-")+std::string(osgGetVersion())+std::string("/");
+    if (fileName.compare(0, prepend.size(), prepend)!=0) return fileName;
+
+    std::string pluginFileName = pluginIndex->getDirectory()+std::string("/")+fileName.substr(prepend.size());
+    if (pluginIndex->containsPlugin(pluginFileName)) return pluginFileName;
+
+    // others may be in osgPlugins directories further down the library file path, so look in those, skipping the
+    // indexed directory as the index already says the plugin isn't there, so that misses stay cheap.
+    const FilePathList& filepath = getLibraryFilePathList();
+    for(FilePathList::const_iterator itr = filepath.begin();
+        itr != filepath.end();
+        ++itr)
+    {
+        // the indexed directory was found by findFileInPath(), so compare against the path as it resolves them.
+        std::string directory = itr->empty() ? prepend.substr(0, prepend.size()-1) : concatPaths(*itr, prepend.substr(0, prepend.size()-1));
+        if (getRealPath(directory)==pluginIndex->getDirectory()) continue;
+
+        std::string path = itr->empty() ? fileName : concatPaths(*itr, fileName);
+        if (cachedFileExists(path)) return getRealPath(path);
+    }
+
+    return std::string();
+}
+
+Registry::LoadStatus Registry::loadLibrary(const std::string& name)
 {
     OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_pluginMutex);
 
+    std::string fileName = getIndexedLibraryName(name);
+    if (fileName.empty())
+    {
+        OSG_INFO<<"Registry::loadLibrary() "<<name<<" isn't in the plugin index or any other plugin directory"<<std::endl;
+        return NOT_LOADED;
+    }
+
     DynamicLibraryList::iterator ditr = getLibraryItr(fileName);
     if (ditr!=_dlList.end()) return PREVIOUSLY_LOADED;
 
@@ -836,7 +953,7 @@ Registry::LoadStatus Registry::loadLibrary(const std::string& fileName)
 bool Registry::closeLibrary(const std::string& fileName)
 {
     OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_pluginMutex);
-    DynamicLibraryList::iterator ditr = getLibraryItr(fileName);
+    DynamicLibraryList::iterator ditr = getLibraryItr(getIndexedLibraryName(fileName));
     if (ditr!=_dlList.end())
     {
         _dlList.erase(ditr);
@@ -865,7 +982,7 @@ Registry::DynamicLibraryList::iterator Registry::getLibraryItr(const std::string
 DynamicLibrary* Registry::getLibrary(const std::string& fileName)
 {
     OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_pluginMutex);
-    DynamicLibraryList::iterator ditr = getLibraryItr(fileName);
+    DynamicLibraryList::iterator ditr = getLibraryItr(getIndexedLibraryName(fileName));
     if (ditr!=_dlList.end()) return ditr->get();
     else return NULL;
 }
@@ -1025,6 +1142,11 @@ void Registry::addArchiveExtension(const std::string ext)
     _archiveExtList.push_back(ext);
 }
 
+bool Registry::cachedFileExists(const std::string& fileName)
+{
+    return _directoryCache.valid() ? _directoryCache->fileExists(fileName) : fileExists(fileName);
+}
+
 std::string Registry::findDataFileImplementation(const std::string& filename, const Options* options, CaseSensitivity caseSensitivity)
 {
     if (filename.empty()) return filename;
@@ -1034,7 +1156,7 @@ std::string Registry::findDataFileImplementation(const std::string& filename, co
 
     bool absolutePath = osgDB::isAbsolutePath(filename);
 
-    if (absolutePath && fileExists(filename))
+    if (absolutePath && cachedFileExists(filename))
     {
         OSG_DEBUG << "FindFileInPath(" << filename << "): returning " << filename << std::endl;
         return filename;
@@ -1070,7 +1192,7 @@ std::string Registry::findDataFileImplementation(const std::string& filename, co
     if (!absolutePath && !pathsContainsCurrentWorkingDirectory)
     {
         // check current working directory
-        if (fileExists(filename))
+        if (cachedFileExists(filename))
         {
             return filename;
         }
@@ -1082,7 +1204,7 @@ std::string Registry::findDataFileImplementation(const std::string& filename, co
     if (simpleFileName!=filename)
     {
 
-        if(fileExists(simpleFileName))
+        if(cachedFileExists(simpleFileName))
         {
             OSG_DEBUG << "FindFileInPath(" << filename << "): returning " << simpleFileName << std::endl;
             return simpleFileName;
@@ -1118,7 +1240,7 @@ std::string Registry::findLibraryFileImplementation(const std::string& filename,
     if (!fileFound.empty())
         return fileFound;
 
-    if(fileExists(filename))
+    if(cachedFileExists(filename))
     {
         OSG_DEBUG << "FindFileInPath(" << filename << "): returning " << filename << std::endl;
         return filename;
@@ -1746,5 +1868,22 @@ ReaderWriter* Registry::getReaderWriterForProtocolAndExtension(const std::string
             return i->get();
     }
 
+    // load the plugin the plugin index has for the protocol, if it isn't loaded already.
+    osg::ref_ptr<PluginIndex> pluginIndex = result ? osg::ref_ptr<PluginIndex>() : getPluginIndex();
+    std::string pluginFileName = pluginIndex.valid() ? pluginIndex->findPluginForProtocol(convertToLowerCase(protocol)) : std::string();
+    if (!pluginFileName.empty() && loadLibrary(pluginFileName)==LOADED)
+    {
+        results.clear();
+        getReaderWriterListForProtocol(protocol, results);
+
+        for(ReaderWriterList::const_iterator i = results.begin(); i != results.end(); ++i)
+        {
+            if ((*i)->acceptsExtension("*"))
+                result = i->get();
+            else if ((*i)->acceptsExtension(extension))
+                return i->get();
+        }
+    }
+
     return result ? result : getReaderWriterForExtension("curl");
 }
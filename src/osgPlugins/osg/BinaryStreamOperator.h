@@ -2,6 +2,7 @@
 #define OSG2_BINARYSTREAMOPERATOR
 
 #include <osgDB/StreamOperator>
+#include <osgDB/MappedFile>
 #include <osg/Types>
 #include <vector>
 
@@ -301,6 +302,18 @@ public:
     virtual void readWrappedString( std::string& str )
     { readString( str ); }
 
+    virtual char* readMappedCharArray( unsigned int size )
+    {
+        osgDB::MappedFileStreamBuf* buf = dynamic_cast<osgDB::MappedFileStreamBuf*>( _in->rdbuf() );
+        return buf ? buf->take( size ) : NULL;
+    }
+
+    virtual osg::Referenced* getMappedDataOwner()
+    {
+        osgDB::MappedFileStreamBuf* buf = dynamic_cast<osgDB::MappedFileStreamBuf*>( _in->rdbuf() );
+        return buf ? buf->getMappedFile() : NULL;
+    }
+
     virtual void advanceToCurrentEndBracket()
     {
         if ( _supportBinaryBrackets && _beginPositions.size()>0 )
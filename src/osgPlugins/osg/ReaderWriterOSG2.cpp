@@ -128,9 +128,10 @@ public:
         supportsOption( "Ascii", "Import/Export option: Force reading/writing ascii file" );
         supportsOption( "XML", "Import/Export option: Force reading/writing XML file" );
         supportsOption( "ForceReadingImage", "Import option: Load an empty image instead if required file missed" );
+        supportsOption( "MemoryMapped", "Import option: Read files through a private memory mapping, inline image data of uncompressed binary files is used in place" );
         supportsOption( "SchemaData", "Export option: Record inbuilt schema data into a binary file" );
         supportsOption( "SchemaFile=<file>", "Import/Export option: Use/Record an ascii schema file" );
-        supportsOption( "Compressor=<name>", "Export option: Use an inbuilt or user-defined compressor" );
+        supportsOption( "Compressor=<name>", "Export option: Use an inbuilt (null, zlib or zlibchunked) or user-defined compressor" );
         supportsOption( "WriteImageHint=<hint>", "Export option: Hint of writing image to stream: "
                         "<IncludeData> writes Image::data() directly; "
                         "<IncludeFile> writes the image file itself to stream; "
@@ -174,6 +175,19 @@ public:
         return local_opt.release();
     }
 
+    MappedFile* openMappedFile( const std::string& fileName, const Options* options ) const
+    {
+        if ( !osgDB::isMemoryMappedRequested(options) ) return 0;
+
+        osg::ref_ptr<MappedFile> mappedFile = new MappedFile;
+        if ( !mappedFile->open(fileName) )
+        {
+            OSG_INFO<<"ReaderWriterOSG2: unable to memory map "<<fileName<<", falling back to ifstream."<<std::endl;
+            return 0;
+        }
+        return mappedFile.release();
+    }
+
     virtual ReadResult readObject( const std::string& file, const Options* options ) const
     {
         ReadResult result = ReadResult::FILE_LOADED;
@@ -182,6 +196,13 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        osg::ref_ptr<MappedFile> mappedFile = openMappedFile( fileName, local_opt );
+        if ( mappedFile.valid() )
+        {
+            MappedFileStream istream( mappedFile.get() );
+            return readObject( istream, local_opt );
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readObject( istream, local_opt );
     }
@@ -213,6 +234,13 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        osg::ref_ptr<MappedFile> mappedFile = openMappedFile( fileName, local_opt );
+        if ( mappedFile.valid() )
+        {
+            MappedFileStream istream( mappedFile.get() );
+            return readImage( istream, local_opt );
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readImage( istream, local_opt );
     }
@@ -244,6 +272,13 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
+        osg::ref_ptr<MappedFile> mappedFile = openMappedFile( fileName, local_opt );
+        if ( mappedFile.valid() )
+        {
+            MappedFileStream istream( mappedFile.get() );
+            return readNode( istream, local_opt );
+        }
+
         osgDB::ifstream istream( fileName.c_str(), mode );
         return readNode( istream, local_opt );
     }
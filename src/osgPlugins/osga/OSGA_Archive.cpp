@@ -320,7 +320,8 @@ void OSGA_Archive::IndexBlock::setPositionNextIndexBlock(pos_type position)
 
 OSGA_Archive::OSGA_Archive():
     _version(0.0f),
-    _status(READ)
+    _status(READ),
+    _memoryMapped(false)
 {
 }
 
@@ -341,7 +342,20 @@ bool OSGA_Archive::open(const std::string& filename, ArchiveStatus status, unsig
         _status = status;
         _input.open(filename.c_str(), std::ios_base::binary | std::ios_base::in);
 
-        return _open(_input);
+        if (!_open(_input)) return false;
+
+        if (_memoryMapped)
+        {
+            // files are read from the mapping without the serializer, _input is kept for reopening the archive for writing.
+            _mappedFile = new osgDB::MappedFile;
+            if (!_mappedFile->open(filename))
+            {
+                OSG_INFO<<"OSGA_Archive::open("<<filename<<") unable to memory map archive, reads will be serialized."<<std::endl;
+                _mappedFile = 0;
+            }
+        }
+
+        return true;
     }
     else
     {
@@ -375,6 +389,7 @@ bool OSGA_Archive::open(const std::string& filename, ArchiveStatus status, unsig
                 }
             }
             _input.close();
+            _mappedFile = 0;
             _status = WRITE;
 
             osgDB::open(_output, filename.c_str(), std::ios_base::binary | std::ios_base::in | std::ios_base::out);
@@ -475,6 +490,8 @@ bool OSGA_Archive::_open(std::istream& input)
                 (*itr)->getFileReferences(_indexMap);
             }
 
+            _fileIndex.build(_indexMap);
+
             for(FileNamePositionMap::iterator mitr=_indexMap.begin();
                 mitr!=_indexMap.end();
                 ++mitr)
@@ -494,6 +511,7 @@ void OSGA_Archive::close()
     SERIALIZER();
 
     _input.close();
+    _mappedFile = 0;
 
     if (_status==WRITE)
     {
@@ -509,7 +527,7 @@ std::string OSGA_Archive::getMasterFileName() const
 
 osgDB::FileType OSGA_Archive::getFileType(const std::string& filename) const
 {
-    if (_indexMap.count(filename)!=0) return osgDB::REGULAR_FILE;
+    if (findFile(filename)) return osgDB::REGULAR_FILE;
     return osgDB::FILE_NOT_FOUND;
 }
 
@@ -548,7 +566,20 @@ void OSGA_Archive::writeIndexBlocks()
 
 bool OSGA_Archive::fileExists(const std::string& filename) const
 {
-    return (_indexMap.count(filename)!=0);
+    return findFile(filename)!=0;
+}
+
+const OSGA_Archive::PositionSizePair* OSGA_Archive::findFile(const std::string& filename) const
+{
+    // the index is only built once all the index blocks are read, files added to an archive being written are left to the map.
+    if (_fileIndex.empty() || _status!=READ)
+    {
+        FileNamePositionMap::const_iterator itr = _indexMap.find(filename);
+        return itr!=_indexMap.end() ? &(itr->second) : 0;
+    }
+
+    const FileNamePositionMap::value_type* file = _fileIndex.find(filename);
+    return file ? &(file->second) : 0;
 }
 
 bool OSGA_Archive::addFileReference(pos_type position, size_type size, const std::string& fileName)
@@ -724,8 +755,40 @@ struct OSGA_Archive::ReadShaderFunctor : public OSGA_Archive::ReadFunctor
     virtual ReaderWriter::ReadResult doRead(ReaderWriter& rw, std::istream& input) const { return rw.readShader(input, _options); }
 };
 
+ReaderWriter::ReadResult OSGA_Archive::readMapped(const ReadFunctor& readFunctor) const
+{
+    const PositionSizePair* file = findFile(readFunctor._filename);
+    if (!file)
+    {
+        OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<") failed, file not found in archive"<<std::endl;
+        return ReadResult(ReadResult::FILE_NOT_FOUND);
+    }
+
+    if (file->first<0 || file->second<0 || static_cast<unsigned long long>(file->first+file->second)>_mappedFile->size())
+    {
+        OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<") failed, file lies outside the archive"<<std::endl;
+        return ReadResult(ReadResult::FILE_NOT_HANDLED);
+    }
+
+    ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(getLowerCaseFileExtension(readFunctor._filename));
+    if (!rw)
+    {
+        OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<") failed to find appropriate plugin to read file."<<std::endl;
+        return ReadResult(ReadResult::FILE_NOT_HANDLED);
+    }
+
+    OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<") from memory mapped archive"<<std::endl;
+
+    // each read has a stream of its own over the file's range of the mapping, so needs no serializing.
+    osgDB::MappedFileStream ins(_mappedFile.get(), static_cast<size_t>(file->first), static_cast<size_t>(file->second));
+    return readFunctor.doRead(*rw, ins);
+}
+
 ReaderWriter::ReadResult OSGA_Archive::read(const ReadFunctor& readFunctor)
 {
+    // a mapped archive is only ever read from, and is left unchanged until closed.
+    if (_mappedFile.valid()) return readMapped(readFunctor);
+
     SERIALIZER();
 
     if (_status!=READ)
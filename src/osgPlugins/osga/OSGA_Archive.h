@@ -14,6 +14,7 @@
 #include <osg/Notify>
 #include <osgDB/Archive>
 #include <osgDB/FileNameUtils>
+#include <osgDB/MappedFile>
 
 #include <OpenThreads/ScopedLock>
 #include <OpenThreads/ReentrantMutex>
@@ -35,6 +36,11 @@ class OSGA_Archive : public osgDB::Archive
             return osgDB::equalCaseInsensitive(extension,"osga");
         }
 
+        /** Set whether an archive opened for reading from a file is memory mapped, so that files are read from it concurrently
+          * rather than one at a time through a shared stream. Defaults to false, must be set before the archive is opened.*/
+        void setMemoryMapped(bool flag) { _memoryMapped = flag; }
+        bool getMemoryMapped() const { return _memoryMapped; }
+
         /** open the archive.*/
         virtual bool open(const std::string& filename, ArchiveStatus status, unsigned int indexBlockSizeHint=4096);
 
@@ -203,6 +209,9 @@ class OSGA_Archive : public osgDB::Archive
 
 
         osgDB::ReaderWriter::ReadResult read(const ReadFunctor& readFunctor);
+
+        /** Read a file from the memory mapping of the archive, called by read() without the serializer.*/
+        osgDB::ReaderWriter::ReadResult readMapped(const ReadFunctor& readFunctor) const;
         osgDB::ReaderWriter::WriteResult write(const WriteFunctor& writeFunctor);
 
         typedef std::list< osg::ref_ptr<IndexBlock> >   IndexBlockList;
@@ -213,6 +222,12 @@ class OSGA_Archive : public osgDB::Archive
 
         bool addFileReference(pos_type position, size_type size, const std::string& fileName);
 
+        /** Hash table of the entries of the index map, built when the archive is opened for reading.*/
+        typedef osgDB::ArchiveFileIndex<FileNamePositionMap> FileIndex;
+
+        /** Get the position and size of a file in the archive, or 0 if it isn't in the archive.*/
+        const PositionSizePair* findFile(const std::string& filename) const;
+
         static float        s_currentSupportedVersion;
         float               _version;
         ArchiveStatus       _status;
@@ -223,6 +238,10 @@ class OSGA_Archive : public osgDB::Archive
         std::string         _masterFileName;
         IndexBlockList      _indexBlockList;
         FileNamePositionMap _indexMap;
+        FileIndex           _fileIndex;
+
+        bool                                _memoryMapped;
+        osg::ref_ptr<osgDB::MappedFile>     _mappedFile;
 
 
         template <typename T>
@@ -12,6 +12,7 @@ public:
     ReaderWriterOSGA()
     {
         supportsExtension("osga","OpenSceneGraph Archive format");
+        supportsOption("MemoryMapped","Import option: Read archives concurrently from a memory mapping rather than through a single shared stream, one file at a time");
     }
 
     virtual const char* className() const { return "OpenSceneGraph Archive Reader/Writer"; }
@@ -30,6 +31,7 @@ public:
         }
 
         osg::ref_ptr<OSGA_Archive> archive = new OSGA_Archive;
+        archive->setMemoryMapped(osgDB::isMemoryMappedRequested(options));
         if (!archive->open(fileName, status, indexBlockSize))
         {
             return ReadResult(ReadResult::FILE_NOT_HANDLED);
@@ -61,7 +63,7 @@ public:
 
     virtual ReadResult readMasterFile(ReadType type, const std::string& file, const Options* options) const
     {
-        ReadResult result = openArchive(file, osgDB::Archive::READ);
+        ReadResult result = openArchive(file, osgDB::Archive::READ, 4096, options);
 
         if (!result.validArchive()) return result;
 
@@ -14,6 +14,7 @@ class ReaderWriterZIP : public osgDB::ReaderWriter
         ReaderWriterZIP()
         {
             supportsExtension("zip","Zip archive format");
+            supportsOption("MemoryMapped","Import option: Read entries directly from a memory mapping of the archive rather than through a zip handle per thread");
             osgDB::Registry::instance()->addArchiveExtension("zip");
         }
 
@@ -37,8 +37,104 @@
 #endif
 
 
+// streambuf reading from a block of memory, either an entry unzipped into a ZipEntryStream or an entry stored uncompressed in the archive's memory.
+class ZipEntryStreamBuf : public std::streambuf
+{
+    public:
+
+        void set(char* data, size_t size) { setg(data, data, data+size); }
+
+    protected:
+
+        virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which = std::ios_base::in | std::ios_base::out)
+        {
+            if ((which & std::ios_base::in)==0) return pos_type(off_type(-1));
+
+            off_type pos = 0;
+            switch(dir)
+            {
+                case(std::ios_base::beg): pos = off; break;
+                case(std::ios_base::cur): pos = (gptr()-eback()) + off; break;
+                case(std::ios_base::end): pos = (egptr()-eback()) + off; break;
+                default: return pos_type(off_type(-1));
+            }
+
+            if (pos<0 || pos>(egptr()-eback())) return pos_type(off_type(-1));
+
+            setg(eback(), eback()+pos, egptr());
+            return pos_type(pos);
+        }
+
+        virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in | std::ios_base::out)
+        {
+            return seekoff(off_type(pos), std::ios_base::beg, which);
+        }
+};
+
+// stream over the data of an entry, replacing a std::stringstream so that the data isn't copied once more after unzipping,
+// and entries stored uncompressed in a memory mapped archive are read in place through an osgDB::MappedFileStreamBuf.
+class ZipEntryStream : public std::istream
+{
+    public:
+
+        ZipEntryStream():
+            std::istream(0),
+            _buffer(0),
+            _mappedStreamBuf(0)
+        {
+            rdbuf(&_streamBuf);
+        }
+
+        ~ZipEntryStream()
+        {
+            delete [] _buffer;
+            delete _mappedStreamBuf;
+        }
+
+        /** Allocate a buffer of size bytes for the entry to be unzipped into, returns NULL if it can't be allocated.*/
+        char* allocate(size_t size)
+        {
+            delete [] _buffer;
+            _buffer = new (std::nothrow) char[size];
+            setData(_buffer, _buffer ? size : 0);
+            return _buffer;
+        }
+
+        void setData(char* data, size_t size)
+        {
+            _streamBuf.set(data, size);
+            rdbuf(&_streamBuf);
+        }
+
+        void setMappedData(osgDB::MappedFile* mappedFile, size_t offset, size_t size)
+        {
+            delete _mappedStreamBuf;
+            _mappedStreamBuf = new osgDB::MappedFileStreamBuf(mappedFile, offset, size);
+            rdbuf(_mappedStreamBuf);
+        }
+
+    protected:
+
+        char*                           _buffer;
+        ZipEntryStreamBuf               _streamBuf;
+        osgDB::MappedFileStreamBuf*     _mappedStreamBuf;
+};
+
+static inline unsigned int ReadZipShort(const unsigned char* ptr)
+{
+    return static_cast<unsigned int>(ptr[0]) | (static_cast<unsigned int>(ptr[1])<<8);
+}
+
+static inline unsigned int ReadZipLong(const unsigned char* ptr)
+{
+    return ReadZipShort(ptr) | (ReadZipShort(ptr+2)<<16);
+}
+
+
 ZipArchive::ZipArchive()  :
-_zipLoaded( false )
+_zipLoaded( false ),
+_zipData( 0 ),
+_zipDataSize( 0 )
 {
 }
 
@@ -64,6 +160,12 @@ void ZipArchive::close()
 
             // clear out the index.
             _zipIndex.clear();
+            _zipHashIndex.clear();
+
+            _zipDataList.clear();
+            _zipData = 0;
+            _zipDataSize = 0;
+            _mappedFile = 0;
 
             _zipLoaded = false;
         }
@@ -130,6 +232,22 @@ bool ZipArchive::open(const std::string& file, ArchiveStatus /*status*/, const o
 
             _password = ReadPassword(options);
 
+            // when requested map the archive so that entries can be read from its memory by all threads at once.
+            if (osgDB::isMemoryMappedRequested(options))
+            {
+                _mappedFile = new osgDB::MappedFile;
+                if (_mappedFile->open(_filename))
+                {
+                    _zipData = _mappedFile->data();
+                    _zipDataSize = _mappedFile->size();
+                }
+                else
+                {
+                    OSG_INFO<<"ZipArchive::open("<<_filename<<") unable to memory map archive, entries will be read through unzip handles."<<std::endl;
+                    _mappedFile = 0;
+                }
+            }
+
             // open the zip file in this thread:
             const PerThreadData& data = getDataNoLock();
 
@@ -163,6 +281,8 @@ bool ZipArchive::open(std::istream& fin, const osgDB::ReaderWriter::Options* opt
             std::stringstream buf;
             buf << fin.rdbuf();
             _membuffer = buf.str();
+            _zipData = _membuffer.data();
+            _zipDataSize = _membuffer.size();
 
             _password = ReadPassword(options);
 
@@ -190,7 +310,7 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readObject(const std::string& file,
     const ZIPENTRY* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        ZipEntryStream buffer;
 
         osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
         if (rw != NULL)
@@ -223,7 +343,7 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readImage(const std::string& file,co
     const ZIPENTRY* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        ZipEntryStream buffer;
 
         osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
         if (rw != NULL)
@@ -256,7 +376,7 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readHeightField(const std::string& f
     const ZIPENTRY* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        ZipEntryStream buffer;
 
         osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
         if (rw != NULL)
@@ -289,7 +409,7 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readNode(const std::string& file,con
     const ZIPENTRY* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        ZipEntryStream buffer;
 
         osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
         if (rw != NULL)
@@ -322,7 +442,7 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readScript(const std::string& file,c
     const ZIPENTRY* ze = GetZipEntry(file);
     if (ze != NULL)
     {
-        std::stringstream buffer;
+        ZipEntryStream buffer;
 
         osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
         if (rw != NULL)
@@ -355,7 +475,7 @@ osgDB::ReaderWriter::ReadResult ZipArchive::readShader(const std::string& file,c
     const ZIPENTRY* ze = GetZipEntry(file);
     if(ze != NULL)
     {
-        std::stringstream buffer;
+        ZipEntryStream buffer;
 
         osgDB::ReaderWriter* rw = ReadFromZipEntry(ze, options, buffer);
         if (rw != NULL)
@@ -409,48 +529,87 @@ osgDB::ReaderWriter::WriteResult ZipArchive::writeShader(const osg::Shader& /*sh
 }
 
 
-osgDB::ReaderWriter* ZipArchive::ReadFromZipEntry(const ZIPENTRY* ze, const osgDB::ReaderWriter::Options* /*options*/, std::stringstream& buffer) const
+osgDB::ReaderWriter* ZipArchive::ReadFromZipEntry(const ZIPENTRY* ze, const osgDB::ReaderWriter::Options* /*options*/, ZipEntryStream& buffer) const
 {
     if (ze != 0)
     {
-        char* ibuf = new (std::nothrow) char[ze->unc_size];
-        if (ibuf)
+        if (!ReadFromZipData(ze, buffer))
         {
+            char* ibuf = buffer.allocate(ze->unc_size);
+            if (!ibuf)
+            {
+                //std::cout << "Error- failed to allocate enough memory to unzip file '" << ze->name << ", with size '" << ze->unc_size << std::endl;
+                return NULL;
+            }
+
             // fetch the handle for the current thread:
             const PerThreadData& data = getData();
-            if ( data._zipHandle != NULL )
+            if ( data._zipHandle == NULL )
             {
-                ZRESULT result = UnzipItem(data._zipHandle, ze->index, ibuf, ze->unc_size);
-                bool unzipSuccesful = CheckZipErrorCode(result);
-                if(unzipSuccesful)
-                {
-                    buffer.write(ibuf,ze->unc_size);
-                }
-
-                delete[] ibuf;
-
-                std::string file_ext = osgDB::getFileExtension(ze->name);
-
-                osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(file_ext);
-                if (rw != NULL)
-                {
-                    return rw;
-                }
+                return NULL;
             }
-            else
+
+            ZRESULT result = UnzipItem(data._zipHandle, ze->index, ibuf, ze->unc_size);
+            bool unzipSuccesful = CheckZipErrorCode(result);
+            if(!unzipSuccesful)
             {
-                delete[] ibuf;
+                buffer.setData(0, 0);
             }
         }
-        else
+
+        std::string file_ext = osgDB::getFileExtension(ze->name);
+
+        osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(file_ext);
+        if (rw != NULL)
         {
-            //std::cout << "Error- failed to allocate enough memory to unzip file '" << ze->name << ", with size '" << ze->unc_size << std::endl;
+            return rw;
         }
     }
 
     return NULL;
 }
 
+bool ZipArchive::ReadFromZipData(const ZIPENTRY* ze, ZipEntryStream& buffer) const
+{
+    if (ze->index<0 || static_cast<size_t>(ze->index)>=_zipDataList.size()) return false;
+
+    // encrypted entries and compression methods other than stored (0) and deflated (8) are left to unzip.
+    const ZipEntryData& entry = _zipDataList[ze->index];
+    if ((entry.flags & 1)!=0 || (entry.method!=0 && entry.method!=8) || static_cast<long>(entry.uncompressedSize)!=ze->unc_size)
+    {
+        return false;
+    }
+
+    // the data follows the local header, whose file name and extra field may differ in length from those of the central directory.
+    const size_t localHeaderSize = 30;
+    if (entry.localHeaderOffset+localHeaderSize>_zipDataSize) return false;
+
+    const unsigned char* header = reinterpret_cast<const unsigned char*>(_zipData+entry.localHeaderOffset);
+    if (ReadZipLong(header)!=0x04034b50) return false;
+
+    size_t dataOffset = entry.localHeaderOffset+localHeaderSize+ReadZipShort(header+26)+ReadZipShort(header+28);
+    if (dataOffset+entry.compressedSize>_zipDataSize) return false;
+
+    if (entry.method==0)
+    {
+        if (entry.compressedSize!=entry.uncompressedSize) return false;
+
+        // stored entries are read in place.
+        if (_mappedFile.valid()) buffer.setMappedData(_mappedFile.get(), dataOffset, entry.uncompressedSize);
+        else buffer.setData(const_cast<char*>(_zipData+dataOffset), entry.uncompressedSize);
+        return true;
+    }
+
+    char* ibuf = buffer.allocate(entry.uncompressedSize);
+    if (!ibuf) return false;
+
+    if (!CheckZipErrorCode(InflateItem(_zipData+dataOffset, entry.compressedSize, ibuf, entry.uncompressedSize)))
+    {
+        buffer.setData(0, 0);
+    }
+    return true;
+}
+
 void CleanupFileString(std::string& strFileOrDir)
 {
     if (strFileOrDir.empty())
@@ -509,37 +668,81 @@ void ZipArchive::IndexZipFiles(HZIP hz)
                 delete ze;
             }
         }
+
+        _zipHashIndex.build(_zipIndex);
+
+        if (_zipData && !IndexZipData())
+        {
+            OSG_INFO<<"ZipArchive: unable to parse central directory of "<<getArchiveFileName()<<", entries will be read through unzip handles."<<std::endl;
+        }
     }
 }
 
-ZIPENTRY* ZipArchive::GetZipEntry(const std::string& filename)
+bool ZipArchive::IndexZipData()
 {
-    ZIPENTRY* ze = NULL;
-    std::string fileToLoad = filename;
-    CleanupFileString(fileToLoad);
+    _zipDataList.clear();
+
+    // find the end of central directory record, which may be followed by a comment of up to 64k.
+    const size_t endRecordSize = 22;
+    if (_zipDataSize<endRecordSize) return false;
+
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(_zipData);
+    size_t endRecord = _zipDataSize-endRecordSize;
+    size_t searchEnd = endRecord>0xffff ? endRecord-0xffff : 0;
+    while(ReadZipLong(data+endRecord)!=0x06054b50)
+    {
+        if (endRecord==searchEnd) return false;
+        --endRecord;
+    }
+
+    unsigned int numEntries = ReadZipShort(data+endRecord+10);
+    size_t directorySize = ReadZipLong(data+endRecord+12);
+    size_t directoryOffset = ReadZipLong(data+endRecord+16);
+
+    // allow for data before the start of the zip, such as in self extracting archives, as unzip does.
+    if (static_cast<int>(numEntries)!=_mainRecord.index || directoryOffset+directorySize>endRecord) return false;
+    size_t bytesBefore = endRecord-(directoryOffset+directorySize);
 
-    ZipEntryMap::iterator iter = _zipIndex.find(fileToLoad);
-    if(iter != _zipIndex.end())
+    // the entries are in the order of ZIPENTRY::index.
+    _zipDataList.reserve(numEntries);
+    size_t position = bytesBefore+directoryOffset;
+    for(unsigned int i=0; i<numEntries; ++i)
     {
-        ze = (*iter).second;
+        const size_t recordSize = 46;
+        if (position+recordSize>endRecord || ReadZipLong(data+position)!=0x02014b50)
+        {
+            _zipDataList.clear();
+            return false;
+        }
+
+        const unsigned char* record = data+position;
+
+        ZipEntryData entry;
+        entry.flags = ReadZipShort(record+8);
+        entry.method = ReadZipShort(record+10);
+        entry.compressedSize = ReadZipLong(record+20);
+        entry.uncompressedSize = ReadZipLong(record+24);
+        entry.localHeaderOffset = bytesBefore+ReadZipLong(record+42);
+        _zipDataList.push_back(entry);
+
+        position += recordSize+ReadZipShort(record+28)+ReadZipShort(record+30)+ReadZipShort(record+32);
     }
 
-    return ze;
+    return true;
+}
+
+ZIPENTRY* ZipArchive::GetZipEntry(const std::string& filename)
+{
+    return const_cast<ZIPENTRY*>(static_cast<const ZipArchive*>(this)->GetZipEntry(filename));
 }
 
 const ZIPENTRY* ZipArchive::GetZipEntry(const std::string& filename) const
 {
-    ZIPENTRY* ze = NULL;
     std::string fileToLoad = filename;
     CleanupFileString(fileToLoad);
 
-    ZipEntryMap::const_iterator iter = _zipIndex.find(fileToLoad);
-    if(iter != _zipIndex.end())
-    {
-        ze = (*iter).second;
-    }
-
-    return ze;
+    const ZipEntryMap::value_type* entry = _zipHashIndex.find(fileToLoad);
+    return entry ? entry->second : NULL;
 }
 
 osgDB::FileType ZipArchive::getFileType(const std::string& filename) const
@@ -684,7 +887,11 @@ ZipArchive::getDataNoLock() const
 
         // data does not already exist, so open the ZIP with a handle exclusively for this thread:
         PerThreadData& data = ncThis->_perThreadData[current];
-        if ( !_filename.empty() )
+        if ( _mappedFile.valid() )
+        {
+            data._zipHandle = OpenZip( _mappedFile->data(), _mappedFile->size(), _password.c_str() );
+        }
+        else if ( !_filename.empty() )
         {
             data._zipHandle = OpenZip( _filename.c_str(), _password.c_str() );
         }
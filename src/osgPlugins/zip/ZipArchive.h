@@ -5,11 +5,14 @@
 #include <osgDB/FileUtils>
 
 #include <osgDB/Archive>
+#include <osgDB/MappedFile>
 #include <OpenThreads/Mutex>
 
 #include "unzip.h"
 
 
+class ZipEntryStream;
+
 class ZipArchive : public osgDB::Archive
 {
     public:
@@ -66,9 +69,15 @@ class ZipArchive : public osgDB::Archive
 
     protected:
 
-        osgDB::ReaderWriter* ReadFromZipEntry(const ZIPENTRY* ze, const osgDB::ReaderWriter::Options* options, std::stringstream& streamIn) const;
+        osgDB::ReaderWriter* ReadFromZipEntry(const ZIPENTRY* ze, const osgDB::ReaderWriter::Options* options, ZipEntryStream& streamIn) const;
+
+        /** Read an entry straight from the archive's memory, returns false if it must be read through an unzip handle.*/
+        bool ReadFromZipData(const ZIPENTRY* ze, ZipEntryStream& streamIn) const;
 
         void IndexZipFiles(HZIP hz);
+
+        /** Parse the central directory of the archive's memory into _zipData, returns false if it doesn't match the entries of the unzip handle.*/
+        bool IndexZipData();
         const ZIPENTRY* GetZipEntry(const std::string& filename) const;
         ZIPENTRY* GetZipEntry(const std::string& filename);
 
@@ -81,13 +90,37 @@ class ZipArchive : public osgDB::Archive
         typedef std::pair<std::string, ZIPENTRY*> ZipEntryMapping;
         typedef std::map<std::string, ZIPENTRY*> ZipEntryMap;
 
+        /** Hash table of the entries of _zipIndex, keyed on their cleaned up names.*/
+        typedef osgDB::ArchiveFileIndex<ZipEntryMap> ZipHashIndex;
+
+        /** The location and compression of an entry's data, from its record in the central directory.*/
+        struct ZipEntryData
+        {
+            unsigned int        flags;
+            unsigned int        method;
+            unsigned int        compressedSize;
+            unsigned int        uncompressedSize;
+            size_t              localHeaderOffset;
+        };
+
+        /** The ZipEntryData of each entry, indexed by ZIPENTRY::index.*/
+        typedef std::vector<ZipEntryData> ZipDataList;
+
         std::string _filename, _password, _membuffer;
 
         OpenThreads::Mutex _zipMutex;
         bool               _zipLoaded;
         ZipEntryMap        _zipIndex;
+        ZipHashIndex       _zipHashIndex;
         ZIPENTRY           _mainRecord;
 
+        /** The archive in memory, either mapped from the file or read from a stream into _membuffer, and its entries' data
+          * if its central directory could be parsed, read from by all threads at once without locking.*/
+        osg::ref_ptr<osgDB::MappedFile> _mappedFile;
+        const char*        _zipData;
+        size_t             _zipDataSize;
+        ZipDataList        _zipDataList;
+
         struct PerThreadData {
             HZIP _zipHandle;
         };
@@ -4519,6 +4519,20 @@ ZRESULT UnzipItemHandle(HZIP hz, int index, HANDLE h) {return UnzipItemInternal(
 ZRESULT UnzipItem(HZIP hz, int index, const TCHAR *fn) {return UnzipItemInternal(hz,index,(void*)fn,0,ZIP_FILENAME);}
 ZRESULT UnzipItem(HZIP hz, int index, void *z,unsigned int len) {return UnzipItemInternal(hz,index,z,len,ZIP_MEMORY);}
 
+ZRESULT InflateItem(const void *src, unsigned int srclen, void *dst, unsigned int dstlen)
+{ z_stream stream;
+  stream.next_in=(Byte*)src; stream.avail_in=srclen; stream.total_in=0;
+  stream.next_out=(Byte*)dst; stream.avail_out=dstlen; stream.total_out=0;
+  stream.zalloc=(alloc_func)0; stream.zfree=(free_func)0; stream.opaque=(voidpf)0;
+  if (inflateInit2(&stream)!=Z_OK) return ZR_NOALLOC;
+  // as in unzReadCurrentFile, the end of the data is known from the sizes rather than waiting for Z_STREAM_END.
+  int err=Z_OK;
+  while (err==Z_OK && stream.avail_out>0) err=inflate(&stream,Z_SYNC_FLUSH);
+  inflateEnd(&stream);
+  if (stream.total_out!=dstlen || (err!=Z_OK && err!=Z_STREAM_END)) return ZR_FLATE;
+  return ZR_OK;
+}
+
 ZRESULT SetUnzipBaseDir(HZIP hz, const TCHAR *dir)
 { if (hz==0) {lasterrorU=ZR_ARGS;return ZR_ARGS;}
   TUnzipHandleData *han = (TUnzipHandleData*)hz;
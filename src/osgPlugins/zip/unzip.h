@@ -156,6 +156,12 @@ ZRESULT SetUnzipBaseDir(HZIP hz, const TCHAR *dir);
 // if unzipping to a filename, and it's a relative filename, then it will be relative to here.
 // (defaults to current-directory).
 
+ZRESULT InflateItem(const void *src, unsigned int srclen, void *dst, unsigned int dstlen);
+// InflateItem - given the deflated data of an item, read straight from the zip rather than
+// through a handle, inflates it into a memory block of exactly its uncompressed size.
+// Each call has an inflate state of its own, so unlike the functions that take a handle
+// it may be called from several threads at once.
+
 
 ZRESULT CloseZip(HZIP hz);
 // CloseZip - the zip handle must be closed with this function.
@@ -17,9 +17,13 @@
 #include <osg/Notify>
 #include <osgUtil/LineSegmentIntersector>
 
+#include "IntersectionBatch.h"
+
 using namespace osgSim;
 
-HeightAboveTerrain::HeightAboveTerrain()
+HeightAboveTerrain::HeightAboveTerrain():
+    _packetSize(0),
+    _numThreads(0)
 {
     _lowestHeight = -1000.0;
 
@@ -43,7 +47,8 @@ void HeightAboveTerrain::computeIntersections(osg::Node* scene, osg::Node::NodeM
     osg::CoordinateSystemNode* csn = dynamic_cast<osg::CoordinateSystemNode*>(scene);
     osg::EllipsoidModel* em = csn ? csn->getEllipsoidModel() : 0;
 
-    osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::IntersectorGroup();
+    LineSegmentIntersectors lineSegmentIntersectors;
+    lineSegmentIntersectors.reserve(_HATList.size());
 
     for(HATList::iterator itr = _HATList.begin();
         itr != _HATList.end();
@@ -63,8 +68,7 @@ void HeightAboveTerrain::computeIntersections(osg::Node* scene, osg::Node::NodeM
 
             OSG_NOTICE<<"lat = "<<latitude<<" longitude = "<<longitude<<" height = "<<height<<std::endl;
 
-            osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector = new osgUtil::LineSegmentIntersector(start, end);
-            intersectorGroup->addIntersector( intersector.get() );
+            lineSegmentIntersectors.push_back(new osgUtil::LineSegmentIntersector(start, end));
         }
         else
         {
@@ -76,34 +80,21 @@ void HeightAboveTerrain::computeIntersections(osg::Node* scene, osg::Node::NodeM
 
             itr->_hat = height;
 
-            osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector = new osgUtil::LineSegmentIntersector( start, end);
-            intersectorGroup->addIntersector( intersector.get() );
+            lineSegmentIntersectors.push_back(new osgUtil::LineSegmentIntersector(start, end));
         }
     }
 
-    _intersectionVisitor.reset();
-    _intersectionVisitor.setTraversalMask(traversalMask);
-    _intersectionVisitor.setIntersector( intersectorGroup.get() );
-
-    scene->accept(_intersectionVisitor);
+    intersectLineSegments(scene, traversalMask, lineSegmentIntersectors, _packetSize, _numThreads, _intersectionVisitor);
 
-    unsigned int index = 0;
-    osgUtil::IntersectorGroup::Intersectors& intersectors = intersectorGroup->getIntersectors();
-    for(osgUtil::IntersectorGroup::Intersectors::iterator intersector_itr = intersectors.begin();
-        intersector_itr != intersectors.end();
-        ++intersector_itr, ++index)
+    for(unsigned int index = 0; index<lineSegmentIntersectors.size(); ++index)
     {
-        osgUtil::LineSegmentIntersector* lsi = dynamic_cast<osgUtil::LineSegmentIntersector*>(intersector_itr->get());
-        if (lsi)
+        osgUtil::LineSegmentIntersector::Intersections& intersections = lineSegmentIntersectors[index]->getIntersections();
+        if (!intersections.empty())
         {
-            osgUtil::LineSegmentIntersector::Intersections& intersections = lsi->getIntersections();
-            if (!intersections.empty())
-            {
-                const osgUtil::LineSegmentIntersector::Intersection& intersection = *intersections.begin();
-                osg::Vec3d intersectionPoint = intersection.matrix.valid() ? intersection.localIntersectionPoint * (*intersection.matrix) :
-                                               intersection.localIntersectionPoint;
-                _HATList[index]._hat = (_HATList[index]._point - intersectionPoint).length();
-            }
+            const osgUtil::LineSegmentIntersector::Intersection& intersection = *intersections.begin();
+            osg::Vec3d intersectionPoint = intersection.matrix.valid() ? intersection.localIntersectionPoint * (*intersection.matrix) :
+                                           intersection.localIntersectionPoint;
+            _HATList[index]._hat = (_HATList[index]._point - intersectionPoint).length();
         }
     }
 
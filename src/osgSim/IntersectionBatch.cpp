@@ -0,0 +1,125 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include "IntersectionBatch.h"
+
+#include <OpenThreads/Thread>
+
+using namespace osgSim;
+
+static osgUtil::Intersector* createIntersector(LineSegmentIntersectors::iterator begin, LineSegmentIntersectors::iterator end, unsigned int packetSize)
+{
+    osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::IntersectorGroup();
+
+    osg::ref_ptr<osgUtil::LineSegmentPacketIntersector> packet;
+    for(LineSegmentIntersectors::iterator itr = begin;
+        itr != end;
+        ++itr)
+    {
+        if (packetSize>1)
+        {
+            if (!packet || packet->getIntersectors().size()>=packetSize || !packet->addIntersector(itr->get()))
+            {
+                packet = new osgUtil::LineSegmentPacketIntersector;
+                packet->addIntersector(itr->get());
+                intersectorGroup->addIntersector( packet.get() );
+            }
+        }
+        else
+        {
+            intersectorGroup->addIntersector( itr->get() );
+        }
+    }
+
+    return intersectorGroup.release();
+}
+
+namespace
+{
+
+class IntersectionThread : public osg::Referenced, public OpenThreads::Thread
+{
+    public:
+
+        IntersectionThread(osg::Node* scene, osg::Node::NodeMask traversalMask, osgUtil::Intersector* intersector, osgUtil::IntersectionVisitor::ReadCallback* readCallback):
+            _scene(scene)
+        {
+            _intersectionVisitor.setTraversalMask(traversalMask);
+            _intersectionVisitor.setIntersector(intersector);
+            _intersectionVisitor.setReadCallback(readCallback);
+        }
+
+        virtual void run()
+        {
+            _scene->accept(_intersectionVisitor);
+        }
+
+    protected:
+
+        virtual ~IntersectionThread() {}
+
+        osg::ref_ptr<osg::Node>         _scene;
+        osgUtil::IntersectionVisitor    _intersectionVisitor;
+};
+
+}
+
+void osgSim::intersectLineSegments(osg::Node* scene, osg::Node::NodeMask traversalMask,
+                                   LineSegmentIntersectors& intersectors,
+                                   unsigned int packetSize, unsigned int numThreads,
+                                   osgUtil::IntersectionVisitor& intersectionVisitor)
+{
+    if (numThreads>intersectors.size()) numThreads = intersectors.size();
+
+    if (numThreads<=1)
+    {
+        osg::ref_ptr<osgUtil::Intersector> intersector = createIntersector(intersectors.begin(), intersectors.end(), packetSize);
+
+        intersectionVisitor.reset();
+        intersectionVisitor.setTraversalMask(traversalMask);
+        intersectionVisitor.setIntersector( intersector.get() );
+
+        scene->accept(intersectionVisitor);
+        return;
+    }
+
+    // make sure the bounds are computed up front so that the threads only ever read the scene graph.
+    scene->getBound();
+
+    typedef std::vector< osg::ref_ptr<IntersectionThread> > IntersectionThreads;
+    IntersectionThreads threads;
+
+    unsigned int numIntersectors = intersectors.size();
+    for(unsigned int i=0; i<numThreads; ++i)
+    {
+        LineSegmentIntersectors::iterator begin = intersectors.begin() + (numIntersectors*i)/numThreads;
+        LineSegmentIntersectors::iterator end = intersectors.begin() + (numIntersectors*(i+1))/numThreads;
+
+        osg::ref_ptr<osgUtil::Intersector> intersector = createIntersector(begin, end, packetSize);
+        threads.push_back(new IntersectionThread(scene, traversalMask, intersector.get(), intersectionVisitor.getReadCallback()));
+    }
+
+    for(IntersectionThreads::iterator itr = threads.begin();
+        itr != threads.end();
+        ++itr)
+    {
+        (*itr)->start();
+    }
+
+    for(IntersectionThreads::iterator itr = threads.begin();
+        itr != threads.end();
+        ++itr)
+    {
+        (*itr)->join();
+    }
+}
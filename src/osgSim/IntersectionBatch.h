@@ -0,0 +1,37 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#ifndef OSGSIM_INTERSECTIONBATCH
+#define OSGSIM_INTERSECTIONBATCH 1
+
+#include <osgUtil/LineSegmentIntersector>
+
+#include <vector>
+
+namespace osgSim {
+
+typedef std::vector< osg::ref_ptr<osgUtil::LineSegmentIntersector> > LineSegmentIntersectors;
+
+/** Intersect a batch of line segments with a scene graph, shared by LineOfSight and HeightAboveTerrain.
+  * Segments are grouped into LineSegmentPacketIntersector's when packetSize is greater than 1, and when
+  * numThreads is greater than 1 the batch is split into contiguous ranges that are each traversed by their
+  * own IntersectionVisitor on a separate thread, otherwise the supplied intersectionVisitor is used.
+  * The intersections are left in each LineSegmentIntersector, and are identical whichever path is taken.*/
+extern void intersectLineSegments(osg::Node* scene, osg::Node::NodeMask traversalMask,
+                                  LineSegmentIntersectors& intersectors,
+                                  unsigned int packetSize, unsigned int numThreads,
+                                  osgUtil::IntersectionVisitor& intersectionVisitor);
+
+}
+
+#endif
@@ -17,6 +17,8 @@
 #include <osgDB/ReadFile>
 #include <osgUtil/LineSegmentIntersector>
 
+#include "IntersectionBatch.h"
+
 using namespace osgSim;
 
 DatabaseCacheReadCallback::DatabaseCacheReadCallback()
@@ -36,10 +38,15 @@ void DatabaseCacheReadCallback::pruneUnusedDatabaseCache()
 
 osg::ref_ptr<osg::Node> DatabaseCacheReadCallback::readNodeFile(const std::string& filename)
 {
-    // first check to see if file is already loaded.
+    // first check to see if file is already loaded, or is being loaded by another thread.
     {
         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
 
+        while(_filesBeingLoaded.count(filename)!=0)
+        {
+            _loadedCondition.wait(&_mutex);
+        }
+
         FileNameSceneMap::iterator itr = _filenameSceneMap.find(filename);
         if (itr != _filenameSceneMap.end())
         {
@@ -47,16 +54,21 @@ osg::ref_ptr<osg::Node> DatabaseCacheReadCallback::readNodeFile(const std::strin
 
             return itr->second.get();
         }
+
+        _filesBeingLoaded.insert(filename);
     }
 
     // now load the file.
     osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile(filename);
 
+    // compute the bounds before the subgraph is shared so that concurrent intersection traversals only read it.
+    if (node.valid()) node->getBound();
+
     // insert into the cache.
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
     if (node.valid())
     {
-        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
-
         if (_filenameSceneMap.size() < _maxNumFilesToCache)
         {
             OSG_INFO<<"Inserting into cache "<<filename<<std::endl;
@@ -84,10 +96,15 @@ osg::ref_ptr<osg::Node> DatabaseCacheReadCallback::readNodeFile(const std::strin
         }
     }
 
+    _filesBeingLoaded.erase(filename);
+    _loadedCondition.broadcast();
+
     return node;
 }
 
-LineOfSight::LineOfSight()
+LineOfSight::LineOfSight():
+    _packetSize(0),
+    _numThreads(0)
 {
     setDatabaseCacheReadCallback(new DatabaseCacheReadCallback);
 }
@@ -106,44 +123,34 @@ unsigned int LineOfSight::addLOS(const osg::Vec3d& start, const osg::Vec3d& end)
 
 void LineOfSight::computeIntersections(osg::Node* scene, osg::Node::NodeMask traversalMask)
 {
-    osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::IntersectorGroup();
+    LineSegmentIntersectors lineSegmentIntersectors;
+    lineSegmentIntersectors.reserve(_LOSList.size());
 
     for(LOSList::iterator itr = _LOSList.begin();
         itr != _LOSList.end();
         ++itr)
     {
-        osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector = new osgUtil::LineSegmentIntersector(itr->_start, itr->_end);
-        intersectorGroup->addIntersector( intersector.get() );
+        lineSegmentIntersectors.push_back(new osgUtil::LineSegmentIntersector(itr->_start, itr->_end));
     }
 
-    _intersectionVisitor.reset();
-    _intersectionVisitor.setTraversalMask(traversalMask);
-    _intersectionVisitor.setIntersector( intersectorGroup.get() );
-
-    scene->accept(_intersectionVisitor);
+    intersectLineSegments(scene, traversalMask, lineSegmentIntersectors, _packetSize, _numThreads, _intersectionVisitor);
 
-    unsigned int index = 0;
-    osgUtil::IntersectorGroup::Intersectors& intersectors = intersectorGroup->getIntersectors();
-    for(osgUtil::IntersectorGroup::Intersectors::iterator intersector_itr = intersectors.begin();
-        intersector_itr != intersectors.end();
-        ++intersector_itr, ++index)
+    for(unsigned int index = 0; index<lineSegmentIntersectors.size(); ++index)
     {
-        osgUtil::LineSegmentIntersector* lsi = dynamic_cast<osgUtil::LineSegmentIntersector*>(intersector_itr->get());
-        if (lsi)
-        {
-            Intersections& intersectionsLOS = _LOSList[index]._intersections;
-            _LOSList[index]._intersections.clear();
+        osgUtil::LineSegmentIntersector* lsi = lineSegmentIntersectors[index].get();
 
-            osgUtil::LineSegmentIntersector::Intersections& intersections = lsi->getIntersections();
+        Intersections& intersectionsLOS = _LOSList[index]._intersections;
+        _LOSList[index]._intersections.clear();
 
-            for(osgUtil::LineSegmentIntersector::Intersections::iterator itr = intersections.begin();
-                itr != intersections.end();
-                ++itr)
-            {
-                const osgUtil::LineSegmentIntersector::Intersection& intersection = *itr;
-                if (intersection.matrix.valid()) intersectionsLOS.push_back( intersection.localIntersectionPoint * (*intersection.matrix) );
-                else intersectionsLOS.push_back( intersection.localIntersectionPoint  );
-            }
+        osgUtil::LineSegmentIntersector::Intersections& intersections = lsi->getIntersections();
+
+        for(osgUtil::LineSegmentIntersector::Intersections::iterator itr = intersections.begin();
+            itr != intersections.end();
+            ++itr)
+        {
+            const osgUtil::LineSegmentIntersector::Intersection& intersection = *itr;
+            if (intersection.matrix.valid()) intersectionsLOS.push_back( intersection.localIntersectionPoint * (*intersection.matrix) );
+            else intersectionsLOS.push_back( intersection.localIntersectionPoint  );
         }
     }
 
@@ -0,0 +1,851 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgUtil/ClusterLODBuilder>
+#include <osgUtil/Simplifier>
+#include <osgUtil/Optimizer>
+
+#include <osg/LOD>
+#include <osg/Notify>
+#include <osg/Timer>
+#include <osg/TriangleIndexFunctor>
+
+#include <algorithm>
+#include <map>
+
+using namespace osgUtil;
+
+namespace
+{
+
+typedef std::vector<unsigned int> IndexList;
+
+struct CollectTriangleOperator
+{
+    IndexList* _indices;
+
+    CollectTriangleOperator() : _indices(0) {}
+
+    inline void operator()(unsigned int p1, unsigned int p2, unsigned int p3)
+    {
+        if (p1==p2 || p2==p3 || p1==p3) return;
+
+        _indices->push_back(p1);
+        _indices->push_back(p2);
+        _indices->push_back(p3);
+    }
+};
+
+typedef osg::TriangleIndexFunctor<CollectTriangleOperator> CollectTriangleIndexFunctor;
+
+void collectTriangles(const osg::Geometry& geometry, IndexList& indices)
+{
+    CollectTriangleIndexFunctor collector;
+    collector._indices = &indices;
+    for(unsigned int i=0; i<geometry.getNumPrimitiveSets(); ++i)
+    {
+        geometry.getPrimitiveSet(i)->accept(collector);
+    }
+}
+
+unsigned int expandBits(unsigned int v)
+{
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+/** Morton code of a point in the box, used to visit triangles and clusters in a spatially coherent order.*/
+unsigned int mortonCode(const osg::Vec3& v, const osg::BoundingBox& bb)
+{
+    osg::Vec3 size(bb._max - bb._min);
+    unsigned int code[3];
+    for(unsigned int i=0; i<3; ++i)
+    {
+        float r = size[i]>0.0f ? (v[i]-bb._min[i])/size[i] : 0.0f;
+        code[i] = static_cast<unsigned int>(osg::clampBetween(r*1023.0f, 0.0f, 1023.0f));
+    }
+    return (expandBits(code[0])<<2) | (expandBits(code[1])<<1) | expandBits(code[2]);
+}
+
+struct MortonLess
+{
+    MortonLess(const std::vector<unsigned int>& codes) : _codes(codes) {}
+
+    bool operator() (unsigned int lhs, unsigned int rhs) const
+    {
+        if (_codes[lhs]<_codes[rhs]) return true;
+        if (_codes[rhs]<_codes[lhs]) return false;
+        return lhs<rhs;
+    }
+
+    const std::vector<unsigned int>& _codes;
+};
+
+/** Split the triangles into connected clusters of at most clusterSize triangles, growing each
+  * cluster breadth first from the first unassigned triangle in Morton order.*/
+void splitIntoClusters(const osg::Vec3Array& positions, const IndexList& indices, unsigned int clusterSize, std::vector<IndexList>& clusters)
+{
+    unsigned int numTriangles = indices.size()/3;
+    if (numTriangles==0) return;
+
+    osg::BoundingBox bb;
+    for(IndexList::const_iterator itr = indices.begin(); itr != indices.end(); ++itr)
+    {
+        bb.expandBy(positions[*itr]);
+    }
+
+    std::vector<unsigned int> codes(numTriangles);
+    std::vector<unsigned int> order(numTriangles);
+    for(unsigned int t=0; t<numTriangles; ++t)
+    {
+        osg::Vec3 centroid = (positions[indices[t*3]] + positions[indices[t*3+1]] + positions[indices[t*3+2]])/3.0f;
+        codes[t] = mortonCode(centroid, bb);
+        order[t] = t;
+    }
+    std::sort(order.begin(), order.end(), MortonLess(codes));
+
+    // vertex to triangle adjacency
+    unsigned int numVertices = positions.size();
+    std::vector<unsigned int> vertexTriangleOffsets(numVertices+1, 0);
+    for(IndexList::const_iterator itr = indices.begin(); itr != indices.end(); ++itr)
+    {
+        ++vertexTriangleOffsets[*itr+1];
+    }
+    for(unsigned int v=0; v<numVertices; ++v)
+    {
+        vertexTriangleOffsets[v+1] += vertexTriangleOffsets[v];
+    }
+    std::vector<unsigned int> vertexTriangles(indices.size());
+    std::vector<unsigned int> fill(vertexTriangleOffsets.begin(), vertexTriangleOffsets.end()-1);
+    for(unsigned int i=0; i<indices.size(); ++i)
+    {
+        vertexTriangles[fill[indices[i]]++] = i/3;
+    }
+
+    std::vector<bool> assigned(numTriangles, false);
+    std::vector<unsigned int> queuedBy(numTriangles, ~0u);
+    IndexList queue;
+
+    for(std::vector<unsigned int>::iterator oitr = order.begin(); oitr != order.end(); ++oitr)
+    {
+        if (assigned[*oitr]) continue;
+
+        unsigned int clusterIndex = clusters.size();
+        clusters.push_back(IndexList());
+        IndexList& cluster = clusters.back();
+
+        queue.clear();
+        queue.push_back(*oitr);
+        queuedBy[*oitr] = clusterIndex;
+
+        for(unsigned int head=0; head<queue.size() && cluster.size()<clusterSize; ++head)
+        {
+            unsigned int t = queue[head];
+            assigned[t] = true;
+            cluster.push_back(t);
+
+            for(unsigned int i=0; i<3; ++i)
+            {
+                unsigned int v = indices[t*3+i];
+                for(unsigned int j=vertexTriangleOffsets[v]; j<vertexTriangleOffsets[v+1]; ++j)
+                {
+                    unsigned int u = vertexTriangles[j];
+                    if (!assigned[u] && queuedBy[u]!=clusterIndex)
+                    {
+                        queuedBy[u] = clusterIndex;
+                        queue.push_back(u);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/** Copies the elements of one or more arrays of the same type into a new array.*/
+class GatherArrayVisitor : public osg::ConstArrayVisitor
+{
+    public:
+
+        struct Source
+        {
+            Source(const osg::Array* array, const IndexList* indices) : _array(array), _indices(indices) {}
+
+            const osg::Array*   _array;
+            const IndexList*    _indices;
+        };
+
+        typedef std::vector<Source> Sources;
+
+        GatherArrayVisitor(const Sources& sources) : _sources(sources) {}
+
+        template<class ARRAY>
+        void gather(const ARRAY& first)
+        {
+            osg::ref_ptr<ARRAY> result = new ARRAY(first.getBinding());
+            result->setNormalize(first.getNormalize());
+
+            for(Sources::const_iterator itr = _sources.begin(); itr != _sources.end(); ++itr)
+            {
+                if (!itr->_array || itr->_array->getType()!=first.getType()) return;
+
+                const ARRAY& source = static_cast<const ARRAY&>(*(itr->_array));
+                if (itr->_indices)
+                {
+                    for(IndexList::const_iterator iitr = itr->_indices->begin(); iitr != itr->_indices->end(); ++iitr)
+                    {
+                        result->push_back(source[*iitr]);
+                    }
+                }
+                else
+                {
+                    result->insert(result->end(), source.begin(), source.end());
+                }
+            }
+
+            _result = result;
+        }
+
+        virtual void apply(const osg::ByteArray& array) { gather(array); }
+        virtual void apply(const osg::ShortArray& array) { gather(array); }
+        virtual void apply(const osg::IntArray& array) { gather(array); }
+        virtual void apply(const osg::UByteArray& array) { gather(array); }
+        virtual void apply(const osg::UShortArray& array) { gather(array); }
+        virtual void apply(const osg::UIntArray& array) { gather(array); }
+        virtual void apply(const osg::FloatArray& array) { gather(array); }
+        virtual void apply(const osg::DoubleArray& array) { gather(array); }
+
+        virtual void apply(const osg::Vec2Array& array) { gather(array); }
+        virtual void apply(const osg::Vec3Array& array) { gather(array); }
+        virtual void apply(const osg::Vec4Array& array) { gather(array); }
+
+        virtual void apply(const osg::Vec4ubArray& array) { gather(array); }
+
+        virtual void apply(const osg::Vec2bArray& array) { gather(array); }
+        virtual void apply(const osg::Vec3bArray& array) { gather(array); }
+        virtual void apply(const osg::Vec4bArray& array) { gather(array); }
+
+        virtual void apply(const osg::Vec2sArray& array) { gather(array); }
+        virtual void apply(const osg::Vec3sArray& array) { gather(array); }
+        virtual void apply(const osg::Vec4sArray& array) { gather(array); }
+
+        virtual void apply(const osg::Vec2dArray& array) { gather(array); }
+        virtual void apply(const osg::Vec3dArray& array) { gather(array); }
+        virtual void apply(const osg::Vec4dArray& array) { gather(array); }
+
+        const Sources&              _sources;
+        osg::ref_ptr<osg::Array>    _result;
+
+    protected:
+
+        GatherArrayVisitor& operator = (const GatherArrayVisitor&) { return *this; }
+};
+
+struct GeometrySource
+{
+    GeometrySource(const osg::Geometry* geometry, const IndexList* indices) : _geometry(geometry), _indices(indices) {}
+
+    const osg::Geometry*    _geometry;
+    const IndexList*        _indices;
+};
+
+typedef std::vector<GeometrySource> GeometrySources;
+
+/** Gather the arrays of the same kind from all the sources, per vertex arrays are concatenated whilst
+  * other arrays are copied from the first source. Copies are made so that no array is shared with the sources.*/
+template<typename GetArray>
+osg::Array* gatherArray(const GeometrySources& sources, GetArray getArray)
+{
+    const osg::Array* first = getArray(*sources.front()._geometry);
+    if (!first) return 0;
+
+    if (first->getBinding()!=osg::Array::BIND_PER_VERTEX)
+    {
+        return osg::clone(first, osg::CopyOp::DEEP_COPY_ALL);
+    }
+
+    GatherArrayVisitor::Sources arraySources;
+    for(GeometrySources::const_iterator itr = sources.begin(); itr != sources.end(); ++itr)
+    {
+        arraySources.push_back(GatherArrayVisitor::Source(getArray(*(itr->_geometry)), itr->_indices));
+    }
+
+    GatherArrayVisitor gav(arraySources);
+    first->accept(gav);
+    return gav._result.release();
+}
+
+struct GetVertexArray { const osg::Array* operator()(const osg::Geometry& geom) const { return geom.getVertexArray(); } };
+struct GetNormalArray { const osg::Array* operator()(const osg::Geometry& geom) const { return geom.getNormalArray(); } };
+struct GetColorArray { const osg::Array* operator()(const osg::Geometry& geom) const { return geom.getColorArray(); } };
+struct GetSecondaryColorArray { const osg::Array* operator()(const osg::Geometry& geom) const { return geom.getSecondaryColorArray(); } };
+struct GetFogCoordArray { const osg::Array* operator()(const osg::Geometry& geom) const { return geom.getFogCoordArray(); } };
+struct GetTexCoordArray
+{
+    GetTexCoordArray(unsigned int unit) : _unit(unit) {}
+    const osg::Array* operator()(const osg::Geometry& geom) const { return geom.getTexCoordArray(_unit); }
+    unsigned int _unit;
+};
+struct GetVertexAttribArray
+{
+    GetVertexAttribArray(unsigned int index) : _index(index) {}
+    const osg::Array* operator()(const osg::Geometry& geom) const { return geom.getVertexAttribArray(_index); }
+    unsigned int _index;
+};
+
+/** Create a geometry with the vertex data of the sources, without primitives or StateSet
+  * so that it is safe to call from multiple threads.*/
+osg::Geometry* gatherGeometry(const GeometrySources& sources)
+{
+    const osg::Geometry& first = *sources.front()._geometry;
+
+    osg::Geometry* geometry = new osg::Geometry;
+    geometry->setUseDisplayList(first.getUseDisplayList());
+    geometry->setUseVertexBufferObjects(first.getUseVertexBufferObjects());
+
+    geometry->setVertexArray(gatherArray(sources, GetVertexArray()));
+    geometry->setNormalArray(gatherArray(sources, GetNormalArray()));
+    geometry->setColorArray(gatherArray(sources, GetColorArray()));
+    geometry->setSecondaryColorArray(gatherArray(sources, GetSecondaryColorArray()));
+    geometry->setFogCoordArray(gatherArray(sources, GetFogCoordArray()));
+
+    for(unsigned int unit=0; unit<first.getNumTexCoordArrays(); ++unit)
+    {
+        osg::Array* array = gatherArray(sources, GetTexCoordArray(unit));
+        if (array) geometry->setTexCoordArray(unit, array);
+    }
+
+    for(unsigned int index=0; index<first.getNumVertexAttribArrays(); ++index)
+    {
+        osg::Array* array = gatherArray(sources, GetVertexAttribArray(index));
+        if (array) geometry->setVertexAttribArray(index, array);
+    }
+
+    return geometry;
+}
+
+/** Create the geometry of a cluster made up of the specified triangles of the source geometry.*/
+osg::Geometry* createClusterGeometry(const osg::Geometry& source, const IndexList& indices, const IndexList& triangles)
+{
+    typedef std::map<unsigned int, unsigned int> VertexMap;
+    VertexMap vertexMap;
+    IndexList vertices;
+    IndexList localIndices;
+    localIndices.reserve(triangles.size()*3);
+
+    for(IndexList::const_iterator titr = triangles.begin(); titr != triangles.end(); ++titr)
+    {
+        for(unsigned int i=0; i<3; ++i)
+        {
+            unsigned int v = indices[*titr*3+i];
+            VertexMap::iterator vitr = vertexMap.find(v);
+            if (vitr==vertexMap.end())
+            {
+                vitr = vertexMap.insert(VertexMap::value_type(v, vertices.size())).first;
+                vertices.push_back(v);
+            }
+            localIndices.push_back(vitr->second);
+        }
+    }
+
+    GeometrySources sources;
+    sources.push_back(GeometrySource(&source, &vertices));
+
+    osg::Geometry* geometry = gatherGeometry(sources);
+
+    if (vertices.size()<65536)
+    {
+        osg::DrawElementsUShort* elements = new osg::DrawElementsUShort(GL_TRIANGLES);
+        elements->reserve(localIndices.size());
+        for(IndexList::iterator itr = localIndices.begin(); itr != localIndices.end(); ++itr)
+        {
+            elements->push_back(static_cast<GLushort>(*itr));
+        }
+        geometry->addPrimitiveSet(elements);
+    }
+    else
+    {
+        geometry->addPrimitiveSet(new osg::DrawElementsUInt(GL_TRIANGLES, localIndices.begin(), localIndices.end()));
+    }
+
+    return geometry;
+}
+
+osg::BoundingSphere computeBound(const osg::Geometry& geometry)
+{
+    osg::BoundingSphere bs;
+    const osg::Vec3Array* positions = static_cast<const osg::Vec3Array*>(geometry.getVertexArray());
+    osg::BoundingBox bb;
+    for(osg::Vec3Array::const_iterator itr = positions->begin(); itr != positions->end(); ++itr)
+    {
+        bb.expandBy(*itr);
+    }
+    if (!bb.valid()) return bs;
+
+    bs.center() = bb.center();
+    for(osg::Vec3Array::const_iterator itr = positions->begin(); itr != positions->end(); ++itr)
+    {
+        bs.radius() = osg::maximum(bs.radius(), (*itr - bs.center()).length());
+    }
+    return bs;
+}
+
+/** Records the largest error of the edge collapses made by the Simplifier.*/
+class RecordErrorCallback : public Simplifier::ContinueSimplificationCallback
+{
+    public:
+
+        RecordErrorCallback() : _maximumError(0.0f) {}
+
+        virtual bool continueSimplification(const Simplifier& simplifier, float nextError, unsigned int numOriginalPrimitives, unsigned int numRemainingPrimitives) const
+        {
+            bool result = simplifier.continueSimplificationImplementation(nextError, numOriginalPrimitives, numRemainingPrimitives);
+
+            // edges that can't be collapsed have an error of FLT_MAX
+            if (result && nextError<FLT_MAX) _maximumError = osg::maximum(_maximumError, nextError);
+            return result;
+        }
+
+        mutable float _maximumError;
+
+    protected:
+
+        virtual ~RecordErrorCallback() {}
+};
+
+struct CreateClustersOperation : public Optimizer::TaskOperation
+{
+    CreateClustersOperation(const osg::Geometry& source, const IndexList& indices, const std::vector<IndexList>& clusterTriangles):
+        _source(source),
+        _indices(indices),
+        _clusterTriangles(clusterTriangles),
+        _geometries(clusterTriangles.size()) {}
+
+    virtual void operator() (unsigned int taskIndex)
+    {
+        _geometries[taskIndex] = createClusterGeometry(_source, _indices, _clusterTriangles[taskIndex]);
+    }
+
+    const osg::Geometry&                        _source;
+    const IndexList&                            _indices;
+    const std::vector<IndexList>&               _clusterTriangles;
+    std::vector< osg::ref_ptr<osg::Geometry> >  _geometries;
+};
+
+struct Group
+{
+    Group() : _error(0.0f), _simplified(false) {}
+
+    IndexList                                   _clusters;
+    std::vector<osg::Vec3>                      _lockedPositions;
+
+    float                                       _error;
+    osg::BoundingSphere                         _bound;
+    bool                                        _simplified;
+    std::vector< osg::ref_ptr<osg::Geometry> >  _geometries;
+};
+
+typedef std::vector<Group> Groups;
+
+struct SimplifyGroupsOperation : public Optimizer::TaskOperation
+{
+    SimplifyGroupsOperation(const ClusterLODBuilder& builder, const ClusterLODBuilder::Clusters& clusters, Groups& groups):
+        _builder(builder),
+        _clusters(clusters),
+        _groups(groups) {}
+
+    virtual void operator() (unsigned int taskIndex)
+    {
+        Group& group = _groups[taskIndex];
+
+        GeometrySources sources;
+        for(IndexList::iterator itr = group._clusters.begin(); itr != group._clusters.end(); ++itr)
+        {
+            sources.push_back(GeometrySource(_clusters[*itr].geometry.get(), 0));
+        }
+
+        osg::ref_ptr<osg::Geometry> geometry = gatherGeometry(sources);
+
+        // offset the cluster indices into the merged vertex arrays
+        osg::ref_ptr<osg::DrawElementsUInt> elements = new osg::DrawElementsUInt(GL_TRIANGLES);
+        unsigned int base = 0;
+        for(IndexList::iterator itr = group._clusters.begin(); itr != group._clusters.end(); ++itr)
+        {
+            const osg::Geometry* clusterGeometry = _clusters[*itr].geometry.get();
+            IndexList clusterIndices;
+            collectTriangles(*clusterGeometry, clusterIndices);
+            for(IndexList::iterator iitr = clusterIndices.begin(); iitr != clusterIndices.end(); ++iitr)
+            {
+                elements->push_back(base + *iitr);
+            }
+            base += clusterGeometry->getVertexArray()->getNumElements();
+        }
+        geometry->addPrimitiveSet(elements.get());
+
+        unsigned int numOriginalTriangles = elements->size()/3;
+
+        // lock the vertices shared with other groups so that the borders between groups stay crack free
+        const osg::Vec3Array* positions = static_cast<const osg::Vec3Array*>(geometry->getVertexArray());
+        Simplifier::IndexList protectedPoints;
+        for(unsigned int i=0; i<positions->size(); ++i)
+        {
+            if (std::binary_search(group._lockedPositions.begin(), group._lockedPositions.end(), (*positions)[i]))
+            {
+                protectedPoints.push_back(i);
+            }
+        }
+
+        osg::ref_ptr<RecordErrorCallback> errorCallback = new RecordErrorCallback;
+
+        Simplifier simplifier(_builder.getSimplificationRatio());
+        simplifier.setMethod(Simplifier::QUADRIC_EDGE_COLLAPSE);
+        simplifier.setSmoothing(false);
+        simplifier.setDoTriStrip(false);
+        simplifier.setContinueSimplificationCallback(errorCallback.get());
+        simplifier.simplify(*geometry, protectedPoints);
+
+        IndexList indices;
+        collectTriangles(*geometry, indices);
+        unsigned int numTriangles = indices.size()/3;
+
+        // give up on groups that are mostly locked
+        if (numTriangles==0 || static_cast<float>(numTriangles) > static_cast<float>(numOriginalTriangles)*0.85f)
+        {
+            return;
+        }
+
+        float maximumChildError = 0.0f;
+        for(IndexList::iterator itr = group._clusters.begin(); itr != group._clusters.end(); ++itr)
+        {
+            const ClusterLODBuilder::Cluster& cluster = _clusters[*itr];
+            maximumChildError = osg::maximum(maximumChildError, cluster.error);
+            group._bound.expandBy(cluster.bound);
+        }
+
+        group._error = maximumChildError + errorCallback->_maximumError;
+        group._simplified = true;
+
+        std::vector<IndexList> clusterTriangles;
+        splitIntoClusters(*static_cast<const osg::Vec3Array*>(geometry->getVertexArray()), indices, _builder.getClusterSize(), clusterTriangles);
+        for(std::vector<IndexList>::iterator itr = clusterTriangles.begin(); itr != clusterTriangles.end(); ++itr)
+        {
+            group._geometries.push_back(createClusterGeometry(*geometry, indices, *itr));
+        }
+    }
+
+    const ClusterLODBuilder&                _builder;
+    const ClusterLODBuilder::Clusters&      _clusters;
+    Groups&                                 _groups;
+
+    protected:
+
+        SimplifyGroupsOperation& operator = (const SimplifyGroupsOperation&) { return *this; }
+};
+
+struct PositionReference
+{
+    PositionReference(const osg::Vec3& position, unsigned int cluster) : _position(position), _cluster(cluster) {}
+
+    bool operator < (const PositionReference& rhs) const
+    {
+        if (_position<rhs._position) return true;
+        if (rhs._position<_position) return false;
+        return _cluster<rhs._cluster;
+    }
+
+    osg::Vec3       _position;
+    unsigned int    _cluster;
+};
+
+typedef std::vector<PositionReference> PositionReferences;
+
+/** Group the clusters, indexing into current, with the clusters they share the most vertices with.*/
+void formGroups(const ClusterLODBuilder::Clusters& clusters, const IndexList& current, unsigned int groupSize, Groups& groups)
+{
+    // find the positions that are shared between clusters
+    PositionReferences references;
+    for(unsigned int c=0; c<current.size(); ++c)
+    {
+        const osg::Vec3Array* positions = static_cast<const osg::Vec3Array*>(clusters[current[c]].geometry->getVertexArray());
+        for(osg::Vec3Array::const_iterator itr = positions->begin(); itr != positions->end(); ++itr)
+        {
+            references.push_back(PositionReference(*itr, c));
+        }
+    }
+    std::sort(references.begin(), references.end());
+
+    typedef std::map<unsigned int, unsigned int> NeighbourMap;
+    std::vector<NeighbourMap> neighbours(current.size());
+
+    PositionReferences::iterator begin = references.begin();
+    while(begin != references.end())
+    {
+        PositionReferences::iterator end = begin;
+        while(end != references.end() && !(begin->_position<end->_position)) ++end;
+
+        for(PositionReferences::iterator i = begin; i != end; ++i)
+        {
+            for(PositionReferences::iterator j = begin; j != end; ++j)
+            {
+                if (i->_cluster!=j->_cluster) ++neighbours[i->_cluster][j->_cluster];
+            }
+        }
+
+        begin = end;
+    }
+
+    // grow the groups greedily, visiting the clusters in Morton order
+    osg::BoundingBox bb;
+    for(IndexList::const_iterator itr = current.begin(); itr != current.end(); ++itr)
+    {
+        bb.expandBy(clusters[*itr].bound.center());
+    }
+
+    std::vector<unsigned int> codes(current.size());
+    std::vector<unsigned int> order(current.size());
+    for(unsigned int c=0; c<current.size(); ++c)
+    {
+        codes[c] = mortonCode(clusters[current[c]].bound.center(), bb);
+        order[c] = c;
+    }
+    std::sort(order.begin(), order.end(), MortonLess(codes));
+
+    std::vector<unsigned int> groupOf(current.size(), ~0u);
+    for(std::vector<unsigned int>::iterator oitr = order.begin(); oitr != order.end(); ++oitr)
+    {
+        if (groupOf[*oitr]!=~0u) continue;
+
+        unsigned int groupIndex = groups.size();
+        groups.push_back(Group());
+
+        NeighbourMap candidates;
+        unsigned int c = *oitr;
+        while(true)
+        {
+            groupOf[c] = groupIndex;
+            groups.back()._clusters.push_back(c);
+            candidates.erase(c);
+
+            if (groups.back()._clusters.size()>=groupSize) break;
+
+            for(NeighbourMap::iterator nitr = neighbours[c].begin(); nitr != neighbours[c].end(); ++nitr)
+            {
+                if (groupOf[nitr->first]==~0u) candidates[nitr->first] += nitr->second;
+            }
+
+            if (candidates.empty()) break;
+
+            NeighbourMap::iterator best = candidates.begin();
+            for(NeighbourMap::iterator nitr = candidates.begin(); nitr != candidates.end(); ++nitr)
+            {
+                if (nitr->second>best->second) best = nitr;
+            }
+            c = best->first;
+        }
+    }
+
+    // lock the positions shared between groups
+    begin = references.begin();
+    while(begin != references.end())
+    {
+        PositionReferences::iterator end = begin;
+        bool shared = false;
+        while(end != references.end() && !(begin->_position<end->_position))
+        {
+            if (groupOf[end->_cluster]!=groupOf[begin->_cluster]) shared = true;
+            ++end;
+        }
+
+        if (shared)
+        {
+            unsigned int previousGroup = ~0u;
+            for(PositionReferences::iterator i = begin; i != end; ++i)
+            {
+                unsigned int g = groupOf[i->_cluster];
+                if (g!=previousGroup) groups[g]._lockedPositions.push_back(begin->_position);
+                previousGroup = g;
+            }
+        }
+
+        begin = end;
+    }
+
+    for(Groups::iterator itr = groups.begin(); itr != groups.end(); ++itr)
+    {
+        // convert from indices into current to cluster indices
+        for(IndexList::iterator citr = itr->_clusters.begin(); citr != itr->_clusters.end(); ++citr)
+        {
+            *citr = current[*citr];
+        }
+
+        std::sort(itr->_lockedPositions.begin(), itr->_lockedPositions.end());
+        itr->_lockedPositions.erase(std::unique(itr->_lockedPositions.begin(), itr->_lockedPositions.end()), itr->_lockedPositions.end());
+    }
+}
+
+}
+
+ClusterLODBuilder::ClusterLODBuilder():
+    _clusterSize(256),
+    _groupSize(4),
+    _simplificationRatio(0.5f),
+    _maximumNumLevels(16),
+    _numThreads(0),
+    _distanceErrorRatio(1000.0f)
+{
+}
+
+bool ClusterLODBuilder::build(const osg::Geometry& geometry)
+{
+    _clusters.clear();
+
+    const osg::Vec3Array* positions = dynamic_cast<const osg::Vec3Array*>(geometry.getVertexArray());
+    if (!positions || positions->empty())
+    {
+        OSG_NOTICE<<"ClusterLODBuilder::build() requires a geometry with an osg::Vec3Array vertex array."<<std::endl;
+        return false;
+    }
+
+    IndexList indices;
+    collectTriangles(geometry, indices);
+    if (indices.empty()) return false;
+
+    osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+    Optimizer taskRunner;
+    taskRunner.setNumThreads(_numThreads);
+
+    // split the original mesh into the clusters of the first level
+    std::vector<IndexList> clusterTriangles;
+    splitIntoClusters(*positions, indices, _clusterSize, clusterTriangles);
+
+    CreateClustersOperation createClusters(geometry, indices, clusterTriangles);
+    taskRunner.runTasks(createClusters, clusterTriangles.size());
+
+    IndexList current;
+    for(unsigned int i=0; i<createClusters._geometries.size(); ++i)
+    {
+        Cluster cluster;
+        cluster.geometry = createClusters._geometries[i];
+        cluster.bound = computeBound(*cluster.geometry);
+        current.push_back(_clusters.size());
+        _clusters.push_back(cluster);
+    }
+
+    OSG_INFO<<"ClusterLODBuilder::build() level 0 has "<<current.size()<<" clusters"<<std::endl;
+
+    for(unsigned int level=1; level<=_maximumNumLevels && current.size()>1; ++level)
+    {
+        Groups groups;
+        formGroups(_clusters, current, _groupSize, groups);
+
+        SimplifyGroupsOperation simplifyGroups(*this, _clusters, groups);
+        taskRunner.runTasks(simplifyGroups, groups.size());
+
+        IndexList next;
+        for(Groups::iterator gitr = groups.begin(); gitr != groups.end(); ++gitr)
+        {
+            if (!gitr->_simplified) continue;
+
+            for(IndexList::iterator citr = gitr->_clusters.begin(); citr != gitr->_clusters.end(); ++citr)
+            {
+                _clusters[*citr].parentError = gitr->_error;
+                _clusters[*citr].parentBound = gitr->_bound;
+            }
+
+            for(unsigned int i=0; i<gitr->_geometries.size(); ++i)
+            {
+                Cluster cluster;
+                cluster.geometry = gitr->_geometries[i];
+                cluster.level = level;
+                cluster.error = gitr->_error;
+                cluster.bound = gitr->_bound;
+                cluster.children = gitr->_clusters;
+                next.push_back(_clusters.size());
+                _clusters.push_back(cluster);
+            }
+        }
+
+        OSG_INFO<<"ClusterLODBuilder::build() level "<<level<<" has "<<next.size()<<" clusters from "<<groups.size()<<" groups"<<std::endl;
+
+        current.swap(next);
+    }
+
+    // sharing the StateSet modifies its parent list so isn't done by the worker threads.
+    osg::StateSet* stateset = const_cast<osg::StateSet*>(geometry.getStateSet());
+    if (stateset)
+    {
+        for(Clusters::iterator itr = _clusters.begin(); itr != _clusters.end(); ++itr)
+        {
+            itr->geometry->setStateSet(stateset);
+        }
+    }
+
+    osg::Timer_t endTick = osg::Timer::instance()->tick();
+    OSG_INFO<<"ClusterLODBuilder::build() created "<<_clusters.size()<<" clusters in "<<getNumLevels()<<" levels in "<<osg::Timer::instance()->delta_s(startTick, endTick)<<"s"<<std::endl;
+
+    return true;
+}
+
+unsigned int ClusterLODBuilder::getNumLevels() const
+{
+    unsigned int numLevels = 0;
+    for(Clusters::const_iterator itr = _clusters.begin(); itr != _clusters.end(); ++itr)
+    {
+        numLevels = osg::maximum(numLevels, itr->level+1);
+    }
+    return numLevels;
+}
+
+osg::Group* ClusterLODBuilder::createSceneGraph() const
+{
+    osg::Group* root = new osg::Group;
+
+    unsigned int numLevels = getNumLevels();
+    for(unsigned int level=0; level<numLevels; ++level)
+    {
+        root->addChild(new osg::Group);
+    }
+
+    for(Clusters::const_iterator itr = _clusters.begin(); itr != _clusters.end(); ++itr)
+    {
+        const Cluster& cluster = *itr;
+        osg::ref_ptr<osg::Node> node = cluster.geometry.get();
+
+        // the cluster is accurate enough once the error of its own simplification is small enough...
+        if (cluster.error>0.0f)
+        {
+            osg::LOD* lod = new osg::LOD;
+            lod->setCenter(cluster.bound.center());
+            lod->setRadius(cluster.bound.radius());
+            lod->addChild(node.get(), cluster.error*_distanceErrorRatio + cluster.bound.radius(), FLT_MAX);
+            node = lod;
+        }
+
+        // ... until the simplification of its group is also accurate enough.
+        if (cluster.parentError<FLT_MAX)
+        {
+            osg::LOD* lod = new osg::LOD;
+            lod->setCenter(cluster.parentBound.center());
+            lod->setRadius(cluster.parentBound.radius());
+            lod->addChild(node.get(), 0.0f, cluster.parentError*_distanceErrorRatio + cluster.parentBound.radius());
+            node = lod;
+        }
+
+        root->getChild(cluster.level)->asGroup()->addChild(node.get());
+    }
+
+    return root;
+}
@@ -0,0 +1,332 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgUtil/CompiledCullGroup>
+#include <osgUtil/CullVisitor>
+
+#include <osg/Geode>
+#include <osg/MatrixTransform>
+#include <osg/PositionAttitudeTransform>
+#include <osg/Notify>
+
+#include <OpenThreads/ScopedLock>
+
+#include <algorithm>
+#include <typeinfo>
+
+using namespace osgUtil;
+
+namespace
+{
+
+// the number of items below which a node of the bounding volume hierarchy isn't split.
+const unsigned int s_maximumNumLeafItems = 8;
+
+int longestAxis(const osg::BoundingBox& bb)
+{
+    osg::Vec3 size = bb._max-bb._min;
+    return (size.x()>=size.y() && size.x()>=size.z()) ? 0 : (size.y()>=size.z() ? 1 : 2);
+}
+
+struct LessCenter
+{
+    LessCenter(const std::vector<CompiledCull::Item>& items, int axis):
+        _items(items),
+        _axis(axis) {}
+
+    bool operator() (unsigned int lhs, unsigned int rhs) const
+    {
+        return _items[lhs].bound.center()[_axis] < _items[rhs].bound.center()[_axis];
+    }
+
+    const std::vector<CompiledCull::Item>&  _items;
+    int                                     _axis;
+};
+
+}
+
+CompiledCull::CompiledCull()
+{
+}
+
+CompiledCull::~CompiledCull()
+{
+}
+
+bool CompiledCull::compile(osg::Group& group)
+{
+    _items.clear();
+    _matrices.clear();
+    _stateSets.clear();
+    _bvhNodes.clear();
+    _bvhBounds.clear();
+    _bvhItems.clear();
+    _bvhItemBounds.clear();
+    _unboundedItems.clear();
+    _compiledChildren.clear();
+
+    _matrices.push_back(osg::Matrix::identity());
+
+    unsigned int numCompiledChildren = 0;
+    for(unsigned int i=0; i<group.getNumChildren(); ++i)
+    {
+        unsigned int numItems = _items.size();
+        unsigned int numMatrices = _matrices.size();
+        unsigned int numStateSets = _stateSets.size();
+
+        bool compiled = compileNode(*group.getChild(i), i, 0, -1, ~0u, false);
+        if (compiled)
+        {
+            ++numCompiledChildren;
+        }
+        else
+        {
+            // leave the child for a normal traversal.
+            _items.resize(numItems);
+            _matrices.resize(numMatrices);
+            _stateSets.resize(numStateSets);
+        }
+        _compiledChildren.push_back(compiled);
+    }
+
+    OSG_INFO<<"CompiledCull::compile() compiled "<<numCompiledChildren<<" of "<<group.getNumChildren()<<" children into "<<_items.size()<<" drawables"<<std::endl;
+
+    if (numCompiledChildren==0) return false;
+
+    for(unsigned int i=0; i<_items.size(); ++i)
+    {
+        if (_items[i].bound.valid()) _bvhItems.push_back(i);
+        else _unboundedItems.push_back(i);
+    }
+
+    if (!_bvhItems.empty())
+    {
+        _bvhNodes.resize(1);
+        _bvhBounds.resize(1);
+        buildBVH(0, 0, _bvhItems.size());
+
+        for(unsigned int i=0; i<_bvhItems.size(); ++i)
+        {
+            _bvhItemBounds.push_back(_items[_bvhItems[i]].bound);
+        }
+    }
+
+    return true;
+}
+
+bool CompiledCull::compileNode(osg::Node& node, unsigned int child, unsigned int matrix, int stateSet, osg::Node::NodeMask nodeMask, bool hasNodeMask)
+{
+    // nodes that may change the traversal or its state, or be changed by one, can't be compiled.
+    if (node.getCullCallback() || node.getUpdateCallback() ||
+        node.getNumChildrenRequiringUpdateTraversal()>0 ||
+        !node.getCullingActive() || node.getNumChildrenWithCullingDisabled()>0 ||
+        node.getNumChildrenWithOccluderNodes()>0)
+    {
+        return false;
+    }
+
+    // an item keeps a single node mask, which tests the same as the masks on its path if only one differs from the default.
+    if (node.getNodeMask()!=~0u)
+    {
+        if (hasNodeMask) return false;
+
+        nodeMask = node.getNodeMask();
+        hasNodeMask = true;
+    }
+
+    if (node.getStateSet())
+    {
+        StateSetNode stateSetNode;
+        stateSetNode.stateSet = node.getStateSet();
+        stateSetNode.parent = stateSet;
+        stateSetNode.depth = stateSet<0 ? 1 : _stateSets[stateSet].depth+1;
+
+        stateSet = _stateSets.size();
+        _stateSets.push_back(stateSetNode);
+    }
+
+    osg::Drawable* drawable = node.asDrawable();
+    if (drawable)
+    {
+        Item item;
+        item.drawable = drawable;
+        item.matrix = matrix;
+        item.stateSet = stateSet;
+        item.nodeMask = nodeMask;
+        item.child = child;
+
+        const osg::BoundingBox& bb = drawable->getBoundingBox();
+        if (bb.valid())
+        {
+            for(unsigned int i=0; i<8; ++i) item.bound.expandBy(bb.corner(i)*_matrices[matrix]);
+        }
+
+        _items.push_back(item);
+        return true;
+    }
+
+    const std::type_info& type = typeid(node);
+    if (type==typeid(osg::MatrixTransform) || type==typeid(osg::PositionAttitudeTransform))
+    {
+        const osg::Transform* transform = node.asTransform();
+        if (transform->getReferenceFrame()!=osg::Transform::RELATIVE_RF) return false;
+
+        osg::Matrix localToGroup = _matrices[matrix];
+        transform->computeLocalToWorldMatrix(localToGroup, 0);
+
+        matrix = _matrices.size();
+        _matrices.push_back(localToGroup);
+    }
+    else if (type!=typeid(osg::Group) && type!=typeid(osg::Geode))
+    {
+        return false;
+    }
+
+    osg::Group* group = node.asGroup();
+    for(unsigned int i=0; i<group->getNumChildren(); ++i)
+    {
+        if (!compileNode(*group->getChild(i), child, matrix, stateSet, nodeMask, hasNodeMask)) return false;
+    }
+    return true;
+}
+
+void CompiledCull::buildBVH(unsigned int node, unsigned int begin, unsigned int end)
+{
+    osg::BoundingBox bound;
+    osg::BoundingBox centers;
+    for(unsigned int i=begin; i<end; ++i)
+    {
+        const osg::BoundingBox& bb = _items[_bvhItems[i]].bound;
+        bound.expandBy(bb);
+        centers.expandBy(bb.center());
+    }
+
+    _bvhBounds[node] = bound;
+    _bvhNodes[node].first = 0;
+    _bvhNodes[node].numChildren = 0;
+    _bvhNodes[node].itemBegin = begin;
+    _bvhNodes[node].itemEnd = end;
+
+    if (end-begin<=s_maximumNumLeafItems) return;
+
+    // split the items in half at the median of their centers along the longest axis, then each half the same way.
+    unsigned int ranges[5] = { begin, 0, (begin+end)/2, 0, end };
+
+    std::nth_element(_bvhItems.begin()+begin, _bvhItems.begin()+ranges[2], _bvhItems.begin()+end, LessCenter(_items, longestAxis(centers)));
+
+    for(unsigned int half=0; half<2; ++half)
+    {
+        unsigned int halfBegin = ranges[half*2];
+        unsigned int halfEnd = ranges[half*2+2];
+
+        osg::BoundingBox halfCenters;
+        for(unsigned int i=halfBegin; i<halfEnd; ++i) halfCenters.expandBy(_items[_bvhItems[i]].bound.center());
+
+        ranges[half*2+1] = (halfBegin+halfEnd)/2;
+        std::nth_element(_bvhItems.begin()+halfBegin, _bvhItems.begin()+ranges[half*2+1], _bvhItems.begin()+halfEnd, LessCenter(_items, longestAxis(halfCenters)));
+    }
+
+    // the children are allocated together so that their bounds are tested in one batch.
+    unsigned int first = _bvhNodes.size();
+    _bvhNodes.resize(first+4);
+    _bvhBounds.resize(first+4);
+    _bvhNodes[node].first = first;
+    _bvhNodes[node].numChildren = 4;
+
+    for(unsigned int i=0; i<4; ++i)
+    {
+        buildBVH(first+i, ranges[i], ranges[i+1]);
+    }
+}
+
+CompiledCullGroup::CompiledCullGroup():
+    _numStaticFramesBeforeCompile(2),
+    _dirty(true),
+    _compileFailed(false),
+    _dirtyTraversalNumber(0)
+{
+}
+
+CompiledCullGroup::CompiledCullGroup(const CompiledCullGroup& group, const osg::CopyOp& copyop):
+    osg::Group(group, copyop),
+    _numStaticFramesBeforeCompile(group._numStaticFramesBeforeCompile),
+    _dirty(true),
+    _compileFailed(false),
+    _dirtyTraversalNumber(0)
+{
+}
+
+CompiledCullGroup::~CompiledCullGroup()
+{
+}
+
+void CompiledCullGroup::dirtyCompiledCull()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_compiledCullMutex);
+    _compiledCull = 0;
+    _dirty = true;
+}
+
+osg::ref_ptr<const CompiledCull> CompiledCullGroup::getCompiledCull() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_compiledCullMutex);
+    return _compiledCull.get();
+}
+
+osg::BoundingSphere CompiledCullGroup::computeBound() const
+{
+    // the bound is only recomputed after a change below the group.
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_compiledCullMutex);
+        _compiledCull = 0;
+        _dirty = true;
+    }
+
+    return osg::Group::computeBound();
+}
+
+osg::ref_ptr<const CompiledCull> CompiledCullGroup::getOrCreateCompiledCull(unsigned int traversalNumber)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_compiledCullMutex);
+
+    if (_dirty)
+    {
+        _dirty = false;
+        _compileFailed = false;
+        _dirtyTraversalNumber = traversalNumber;
+    }
+
+    if (!_compiledCull && !_compileFailed && traversalNumber-_dirtyTraversalNumber>=_numStaticFramesBeforeCompile)
+    {
+        osg::ref_ptr<CompiledCull> compiledCull = new CompiledCull;
+        if (compiledCull->compile(*this)) _compiledCull = compiledCull;
+        else _compileFailed = true;
+    }
+
+    return _compiledCull.get();
+}
+
+void CompiledCullGroup::traverse(osg::NodeVisitor& nv)
+{
+    CullVisitor* cv = nv.getVisitorType()==osg::NodeVisitor::CULL_VISITOR ? nv.asCullVisitor() : 0;
+    if (cv)
+    {
+        // bring the bound up to date first, which discards the CompiledCull if anything below the group has changed.
+        getBound();
+
+        osg::ref_ptr<const CompiledCull> compiledCull = getOrCreateCompiledCull(cv->getTraversalNumber());
+        if (compiledCull.valid() && cv->traverseCompiledCull(*this, *compiledCull)) return;
+    }
+
+    osg::Group::traverse(nv);
+}
@@ -29,12 +29,19 @@
 #include <osg/io_utils>
 
 #include <osgUtil/CullVisitor>
+#include <osgUtil/CompiledCullGroup>
 
 #include <float.h>
 #include <algorithm>
 
 #include <osg/Timer>
 
+#include <OpenThreads/Thread>
+#include <OpenThreads/Barrier>
+#include <OpenThreads/Atomic>
+
+#include <typeinfo>
+
 using namespace osg;
 using namespace osgUtil;
 
@@ -44,6 +51,534 @@ inline int EQUAL_F(float a, float b)
     { return a == b || fabsf(a-b) <= MAX_F(fabsf(a),fabsf(b))*1e-3f; }
 
 
+////////////////////////////////////////////////////////////////////////////
+//
+// ParallelCull, culls contiguous ranges of the children of a Group with
+// worker CullVisitors into separate StateGraph and RenderStage fragments,
+// then merges the fragments in the order of the children so the
+// RenderLeaves, StateGraphs and RenderBins match those of a serial cull.
+//
+class CullVisitor::ParallelCull : public osg::Referenced
+{
+    public:
+
+        ParallelCull(const CullVisitor& cv, unsigned int numThreads);
+
+        unsigned int getNumThreads() const { return static_cast<unsigned int>(_visitors.size()); }
+
+        /** Reset the worker CullVisitors and fragments at the start of a cull traversal.*/
+        void reset();
+
+        /** Cull the children of the group and merge the results into the current StateGraph and RenderBin of the CullVisitor.*/
+        void traverse(CullVisitor& cv, osg::Group& group);
+
+    protected:
+
+        virtual ~ParallelCull();
+
+        struct Fragment
+        {
+            Fragment():
+                begin(0),
+                end(0),
+                stateGraph(0),
+                renderBin(0),
+                numRenderLeaves(0),
+                computed_znear(FLT_MAX),
+                computed_zfar(-FLT_MAX) {}
+
+            unsigned int                begin;
+            unsigned int                end;
+
+            osg::ref_ptr<StateGraph>    rootStateGraph;
+            StateGraph*                 stateGraph;
+            osg::ref_ptr<RenderStage>   renderStage;
+            RenderBin*                  renderBin;
+
+            unsigned int                numRenderLeaves;
+            value_type                  computed_znear;
+            value_type                  computed_zfar;
+            DistanceMatrixDrawableMap   nearPlaneCandidateMap;
+            DistanceMatrixDrawableMap   farPlaneCandidateMap;
+        };
+
+        class CullThread : public osg::Referenced, public OpenThreads::Thread
+        {
+            public:
+
+                CullThread(ParallelCull* parallelCull, CullVisitor* cv):
+                    _parallelCull(parallelCull),
+                    _cv(cv) {}
+
+                virtual void run()
+                {
+                    for(;;)
+                    {
+                        _parallelCull->_startBarrier.block();
+                        if (_parallelCull->_done) break;
+
+                        _parallelCull->cullFragments(*_cv);
+
+                        _parallelCull->_endBarrier.block();
+                    }
+                }
+
+            protected:
+
+                virtual ~CullThread() {}
+
+                ParallelCull*   _parallelCull;
+                CullVisitor*    _cv;
+        };
+
+        void setUpVisitor(const CullVisitor& cv, CullVisitor& worker);
+        void setUpFragment(const CullVisitor& cv, Fragment& fragment);
+        void cullFragments(CullVisitor& worker);
+        void cullFragment(CullVisitor& worker, Fragment& fragment);
+        void mergeFragment(CullVisitor& cv, Fragment& fragment);
+        void mergeRenderBin(RenderBin* bin, RenderBin* fragmentBin, Fragment& fragment, StateGraph* stateGraph, unsigned int traversalOrderOffset);
+        StateGraph* findStateGraph(StateGraph* fragmentStateGraph, Fragment& fragment, StateGraph* stateGraph);
+        void offsetTraversalOrder(RenderBin* bin, unsigned int traversalOrderOffset);
+
+        typedef std::vector< osg::ref_ptr<CullVisitor> > CullVisitors;
+        typedef std::vector< osg::ref_ptr<CullThread> > CullThreads;
+        typedef std::vector<Fragment> Fragments;
+        typedef std::vector<RenderBin*> RenderBinPath;
+        typedef std::vector<const osg::StateSet*> StateSetPath;
+
+        CullVisitors            _visitors;
+        CullThreads             _threads;
+
+        Fragments               _fragments;
+        unsigned int            _numFragments;
+        OpenThreads::Atomic     _nextFragment;
+
+        osg::Group*             _group;
+        RenderBinPath           _renderBinPath;
+        StateSetPath            _stateSetPath;
+        GLbitfield              _clearMask;
+        osg::Vec4               _clearColor;
+
+        OpenThreads::Barrier    _startBarrier;
+        OpenThreads::Barrier    _endBarrier;
+        bool                    _done;
+};
+
+CullVisitor::ParallelCull::ParallelCull(const CullVisitor& cv, unsigned int numThreads):
+    _numFragments(0),
+    _nextFragment(0),
+    _group(0),
+    _clearMask(0),
+    _startBarrier(numThreads),
+    _endBarrier(numThreads),
+    _done(false)
+{
+    // the calling thread culls fragments with the first visitor.
+    for(unsigned int i=0; i<numThreads; ++i)
+    {
+        _visitors.push_back(cv.clone());
+    }
+
+    for(unsigned int i=1; i<numThreads; ++i)
+    {
+        _threads.push_back(new CullThread(this, _visitors[i].get()));
+        _threads.back()->start();
+    }
+}
+
+CullVisitor::ParallelCull::~ParallelCull()
+{
+    if (!_threads.empty())
+    {
+        _done = true;
+        _startBarrier.block();
+
+        for(CullThreads::iterator itr = _threads.begin();
+            itr != _threads.end();
+            ++itr)
+        {
+            (*itr)->join();
+        }
+    }
+}
+
+void CullVisitor::ParallelCull::reset()
+{
+    for(CullVisitors::iterator itr = _visitors.begin();
+        itr != _visitors.end();
+        ++itr)
+    {
+        (*itr)->reset();
+    }
+}
+
+void CullVisitor::ParallelCull::traverse(CullVisitor& cv, osg::Group& group)
+{
+    // start the OcclusionBuffer's frame before the workers share it.
+    cv.isOcclusionCullingActive();
+
+    unsigned int numChildren = group.getNumChildren();
+    unsigned int numThreads = getNumThreads();
+
+    // several fragments per thread to balance the load of uneven subgraphs.
+    _numFragments = osg::minimum(numChildren, numThreads*4);
+    if (_fragments.size()<_numFragments) _fragments.resize(_numFragments);
+
+    // record the path of the current RenderBin from its RenderStage so it can be recreated in each fragment.
+    _renderBinPath.clear();
+    RenderStage* stage = cv._currentRenderBin->getStage();
+    for(RenderBin* bin = cv._currentRenderBin; bin && bin!=stage; bin = bin->getParent())
+    {
+        _renderBinPath.push_back(bin);
+    }
+
+    // record the StateSets of the current StateGraph so nested Cameras see the same chain of StateGraphs.
+    _stateSetPath.clear();
+    for(StateGraph* sg = cv._currentStateGraph; sg; sg = sg->_parent)
+    {
+        _stateSetPath.push_back(sg->getStateSet());
+    }
+
+    _clearMask = stage->getClearMask();
+    _clearColor = stage->getClearColor();
+
+    for(unsigned int i=0; i<_numFragments; ++i)
+    {
+        Fragment& fragment = _fragments[i];
+        fragment.begin = static_cast<unsigned int>((static_cast<unsigned long long>(numChildren)*i)/_numFragments);
+        fragment.end = static_cast<unsigned int>((static_cast<unsigned long long>(numChildren)*(i+1))/_numFragments);
+        setUpFragment(cv, fragment);
+    }
+
+    for(CullVisitors::iterator itr = _visitors.begin();
+        itr != _visitors.end();
+        ++itr)
+    {
+        setUpVisitor(cv, **itr);
+    }
+
+    // the workers count their own allocations, add those of this traversal to the calling CullVisitor.
+    unsigned int numAllocations = 0;
+    unsigned int numAbsoluteModelViewMatrices = 0;
+    for(CullVisitors::iterator itr = _visitors.begin(); itr != _visitors.end(); ++itr)
+    {
+        numAllocations += (*itr)->_numAllocations;
+        numAbsoluteModelViewMatrices += (*itr)->_numAbsoluteModelViewMatrices;
+    }
+
+    _group = &group;
+    _nextFragment.exchange(0);
+
+    _startBarrier.block();
+    cullFragments(*_visitors[0]);
+    _endBarrier.block();
+
+    _group = 0;
+
+    for(CullVisitors::iterator itr = _visitors.begin(); itr != _visitors.end(); ++itr)
+    {
+        cv._numAllocations += (*itr)->_numAllocations;
+        cv._numAbsoluteModelViewMatrices += (*itr)->_numAbsoluteModelViewMatrices;
+    }
+    cv._numAllocations -= numAllocations;
+    cv._numAbsoluteModelViewMatrices -= numAbsoluteModelViewMatrices;
+
+    for(unsigned int i=0; i<_numFragments; ++i)
+    {
+        mergeFragment(cv, _fragments[i]);
+    }
+}
+
+void CullVisitor::ParallelCull::setUpVisitor(const CullVisitor& cv, CullVisitor& worker)
+{
+    worker.setTraversalMode(cv.getTraversalMode());
+    worker.setTraversalMask(cv.getTraversalMask());
+    worker.setNodeMaskOverride(cv.getNodeMaskOverride());
+    worker.setFrameStamp(const_cast<osg::FrameStamp*>(cv.getFrameStamp()));
+    worker.setTraversalNumber(cv.getTraversalNumber());
+    worker.setUserData(const_cast<osg::Referenced*>(cv.getUserData()));
+    worker.setDatabaseRequestHandler(const_cast<osg::NodeVisitor::DatabaseRequestHandler*>(cv.getDatabaseRequestHandler()));
+    worker.setImageRequestHandler(const_cast<osg::NodeVisitor::ImageRequestHandler*>(cv.getImageRequestHandler()));
+    worker.getNodePath() = cv.getNodePath();
+
+    // the workers cull their subgraphs serially.
+    worker.setCullSettings(cv);
+    worker._parallelCullNumThreads = 0;
+
+    // copy the state of the CullStack, sharing the matrices and viewports of the calling CullVisitor.
+    worker._occluderList = cv._occluderList;
+    worker._projectionStack = cv._projectionStack;
+    worker._modelviewStack = cv._modelviewStack;
+    worker._MVPW_Stack = cv._MVPW_Stack;
+    worker._viewportStack = cv._viewportStack;
+    worker._referenceViewPoints = cv._referenceViewPoints;
+    worker._eyePointStack = cv._eyePointStack;
+    worker._viewPointStack = cv._viewPointStack;
+    worker._clipspaceCullingStack = cv._clipspaceCullingStack;
+    worker._projectionCullingStack = cv._projectionCullingStack;
+
+    unsigned int numCullingSets = cv._index_modelviewCullingStack;
+    if (worker._modelviewCullingStack.size()<numCullingSets) worker._modelviewCullingStack.resize(numCullingSets);
+    for(unsigned int i=0; i<numCullingSets; ++i)
+    {
+        worker._modelviewCullingStack[i] = cv._modelviewCullingStack[i];
+    }
+    worker._index_modelviewCullingStack = numCullingSets;
+    worker._back_modelviewCullingStack = numCullingSets>0 ? &worker._modelviewCullingStack[numCullingSets-1] : 0;
+
+    worker._frustumVolume = cv._frustumVolume;
+    worker._bbCornerNear = cv._bbCornerNear;
+    worker._bbCornerFar = cv._bbCornerFar;
+
+    // the workers test against the OcclusionBuffer started by the calling CullVisitor.
+    worker._occlusionBuffer = cv._occlusionBuffer;
+    worker._occlusionBufferStarted = cv._occlusionBufferStarted;
+
+    worker._rootRenderStage = cv._rootRenderStage;
+    worker._renderBinStack.clear();
+    worker._numberOfEncloseOverrideRenderBinDetails = cv._numberOfEncloseOverrideRenderBinDetails;
+    worker._renderInfo = cv._renderInfo;
+    worker._identifier = cv._identifier;
+}
+
+void CullVisitor::ParallelCull::setUpFragment(const CullVisitor& cv, Fragment& fragment)
+{
+    if (!fragment.rootStateGraph)
+    {
+        fragment.rootStateGraph = new StateGraph;
+        fragment.renderStage = new RenderStage;
+    }
+
+    // nested Cameras inherit their settings from the enclosing RenderStage.
+    const RenderStage* stage = cv._currentRenderBin->getStage();
+    RenderStage* fragmentStage = fragment.renderStage.get();
+    fragmentStage->setCamera(const_cast<osg::Camera*>(stage->getCamera()));
+    fragmentStage->setViewport(const_cast<osg::Viewport*>(stage->getViewport()));
+    fragmentStage->setInitialViewMatrix(const_cast<RenderStage*>(stage)->getInitialViewMatrix());
+    fragmentStage->setClearMask(stage->getClearMask());
+    fragmentStage->setClearColor(stage->getClearColor());
+    fragmentStage->setClearAccum(stage->getClearAccum());
+    fragmentStage->setClearDepth(stage->getClearDepth());
+    fragmentStage->setClearStencil(stage->getClearStencil());
+    fragmentStage->setColorMask(const_cast<osg::ColorMask*>(stage->getColorMask()));
+    fragmentStage->setDrawBuffer(stage->getDrawBuffer(), stage->getDrawBufferApplyMask());
+    fragmentStage->setReadBuffer(stage->getReadBuffer(), stage->getReadBufferApplyMask());
+
+    StateSetPath::reverse_iterator sitr = _stateSetPath.rbegin();
+    fragment.rootStateGraph->setStateSet(*sitr++);
+    fragment.stateGraph = fragment.rootStateGraph.get();
+    for(; sitr != _stateSetPath.rend(); ++sitr)
+    {
+        fragment.stateGraph = fragment.stateGraph->find_or_insert(*sitr);
+    }
+
+    fragment.renderBin = fragmentStage;
+    for(RenderBinPath::reverse_iterator itr = _renderBinPath.rbegin();
+        itr != _renderBinPath.rend();
+        ++itr)
+    {
+        fragment.renderBin = fragment.renderBin->find_or_insert(*itr);
+    }
+
+    fragment.numRenderLeaves = 0;
+    fragment.computed_znear = cv._computed_znear;
+    fragment.computed_zfar = cv._computed_zfar;
+    fragment.nearPlaneCandidateMap.clear();
+    fragment.farPlaneCandidateMap.clear();
+}
+
+void CullVisitor::ParallelCull::cullFragments(CullVisitor& worker)
+{
+    for(unsigned int i = (++_nextFragment)-1;
+        i < _numFragments;
+        i = (++_nextFragment)-1)
+    {
+        cullFragment(worker, _fragments[i]);
+    }
+}
+
+void CullVisitor::ParallelCull::cullFragment(CullVisitor& worker, Fragment& fragment)
+{
+    worker._rootStateGraph = fragment.rootStateGraph;
+    worker._currentStateGraph = fragment.stateGraph;
+    worker._currentRenderBin = fragment.renderBin;
+    worker._traversalOrderNumber = 0;
+    worker._computed_znear = fragment.computed_znear;
+    worker._computed_zfar = fragment.computed_zfar;
+
+    for(unsigned int i=fragment.begin; i<fragment.end; ++i)
+    {
+        _group->getChild(i)->accept(worker);
+    }
+
+    // remove the StateGraphs that are no longer used, as SceneView does after each cull traversal.
+    fragment.rootStateGraph->prune();
+
+    fragment.numRenderLeaves = worker._traversalOrderNumber;
+    fragment.computed_znear = worker._computed_znear;
+    fragment.computed_zfar = worker._computed_zfar;
+    fragment.nearPlaneCandidateMap.swap(worker._nearPlaneCandidateMap);
+    fragment.farPlaneCandidateMap.swap(worker._farPlaneCandidateMap);
+    worker._nearPlaneCandidateMap.clear();
+    worker._farPlaneCandidateMap.clear();
+
+    worker._rootStateGraph = 0;
+    worker._currentStateGraph = 0;
+    worker._currentRenderBin = 0;
+}
+
+StateGraph* CullVisitor::ParallelCull::findStateGraph(StateGraph* fragmentStateGraph, Fragment& fragment, StateGraph* stateGraph)
+{
+    if (fragmentStateGraph==fragment.stateGraph) return stateGraph;
+
+    return findStateGraph(fragmentStateGraph->_parent, fragment, stateGraph)->find_or_insert(fragmentStateGraph->getStateSet());
+}
+
+void CullVisitor::ParallelCull::mergeRenderBin(RenderBin* bin, RenderBin* fragmentBin, Fragment& fragment, StateGraph* stateGraph, unsigned int traversalOrderOffset)
+{
+    RenderBin::StateGraphList& fragmentStateGraphs = fragmentBin->getStateGraphList();
+    for(RenderBin::StateGraphList::iterator itr = fragmentStateGraphs.begin();
+        itr != fragmentStateGraphs.end();
+        ++itr)
+    {
+        StateGraph* fragmentStateGraph = *itr;
+        StateGraph* sg = findStateGraph(fragmentStateGraph, fragment, stateGraph);
+
+        // as in CullVisitor::addDrawable(), a StateGraph is added to a RenderBin with its first leaf.
+        if (sg->leaves_empty()) bin->addStateGraph(sg);
+
+        for(StateGraph::LeafList::iterator litr = fragmentStateGraph->_leaves.begin();
+            litr != fragmentStateGraph->_leaves.end();
+            ++litr)
+        {
+            (*litr)->_traversalOrderNumber += traversalOrderOffset;
+            sg->addLeaf(litr->get());
+        }
+
+        fragmentStateGraph->_leaves.clear();
+    }
+
+    // only merge the bins used by this frame's cull, not those the fragment kept from previous frames.
+    fragmentBin->removeUnusedRenderBins();
+
+    RenderBin::RenderBinList& fragmentBins = fragmentBin->getRenderBinList();
+    for(RenderBin::RenderBinList::iterator itr = fragmentBins.begin();
+        itr != fragmentBins.end();
+        ++itr)
+    {
+        mergeRenderBin(bin->find_or_insert(itr->second.get()), itr->second.get(), fragment, stateGraph, traversalOrderOffset);
+    }
+}
+
+void CullVisitor::ParallelCull::offsetTraversalOrder(RenderBin* bin, unsigned int traversalOrderOffset)
+{
+    for(RenderBin::StateGraphList::iterator itr = bin->getStateGraphList().begin();
+        itr != bin->getStateGraphList().end();
+        ++itr)
+    {
+        for(StateGraph::LeafList::iterator litr = (*itr)->_leaves.begin();
+            litr != (*itr)->_leaves.end();
+            ++litr)
+        {
+            (*litr)->_traversalOrderNumber += traversalOrderOffset;
+        }
+    }
+
+    for(RenderBin::RenderBinList::iterator itr = bin->getRenderBinList().begin();
+        itr != bin->getRenderBinList().end();
+        ++itr)
+    {
+        offsetTraversalOrder(itr->second.get(), traversalOrderOffset);
+    }
+
+    RenderStage* stage = dynamic_cast<RenderStage*>(bin);
+    if (stage)
+    {
+        for(RenderStage::RenderStageList::iterator itr = stage->getPreRenderList().begin();
+            itr != stage->getPreRenderList().end();
+            ++itr)
+        {
+            offsetTraversalOrder(itr->second.get(), traversalOrderOffset);
+        }
+
+        for(RenderStage::RenderStageList::iterator itr = stage->getPostRenderList().begin();
+            itr != stage->getPostRenderList().end();
+            ++itr)
+        {
+            offsetTraversalOrder(itr->second.get(), traversalOrderOffset);
+        }
+    }
+}
+
+void CullVisitor::ParallelCull::mergeFragment(CullVisitor& cv, Fragment& fragment)
+{
+    RenderStage* stage = cv._currentRenderBin->getStage();
+    RenderStage* fragmentStage = fragment.renderStage.get();
+
+    unsigned int traversalOrderOffset = cv._traversalOrderNumber;
+    mergeRenderBin(stage, fragmentStage, fragment, cv._currentStateGraph, traversalOrderOffset);
+    cv._traversalOrderNumber += fragment.numRenderLeaves;
+
+    PositionalStateContainer* fragmentPositionalState = fragmentStage->getPositionalStateContainer();
+    PositionalStateContainer::AttrMatrixList& attrList = fragmentPositionalState->getAttrMatrixList();
+    for(PositionalStateContainer::AttrMatrixList::iterator itr = attrList.begin();
+        itr != attrList.end();
+        ++itr)
+    {
+        stage->addPositionedAttribute(itr->second.get(), itr->first.get());
+    }
+
+    PositionalStateContainer::TexUnitAttrMatrixListMap& texAttrListMap = fragmentPositionalState->getTexUnitAttrMatrixListMap();
+    for(PositionalStateContainer::TexUnitAttrMatrixListMap::iterator titr = texAttrListMap.begin();
+        titr != texAttrListMap.end();
+        ++titr)
+    {
+        for(PositionalStateContainer::AttrMatrixList::iterator itr = titr->second.begin();
+            itr != titr->second.end();
+            ++itr)
+        {
+            stage->addPositionedTextureAttribute(titr->first, itr->second.get(), itr->first.get());
+        }
+    }
+
+    // move the RenderStages of nested Cameras across, along with the positional state they inherit.
+    RenderStage::RenderStageList& preRenderList = fragmentStage->getPreRenderList();
+    for(RenderStage::RenderStageList::iterator itr = preRenderList.begin();
+        itr != preRenderList.end();
+        ++itr)
+    {
+        if (itr->second->getInheritedPositionalStateContainer()==fragmentPositionalState) itr->second->setInheritedPositionalStateContainer(stage->getPositionalStateContainer());
+        offsetTraversalOrder(itr->second.get(), traversalOrderOffset);
+        stage->addPreRenderStage(itr->second.get(), itr->first);
+    }
+    preRenderList.clear();
+
+    RenderStage::RenderStageList& postRenderList = fragmentStage->getPostRenderList();
+    for(RenderStage::RenderStageList::iterator itr = postRenderList.begin();
+        itr != postRenderList.end();
+        ++itr)
+    {
+        if (itr->second->getInheritedPositionalStateContainer()==fragmentPositionalState) itr->second->setInheritedPositionalStateContainer(stage->getPositionalStateContainer());
+        offsetTraversalOrder(itr->second.get(), traversalOrderOffset);
+        stage->addPostRenderStage(itr->second.get(), itr->first);
+    }
+    postRenderList.clear();
+
+    // pick up changes made by ClearNodes.
+    if (fragmentStage->getClearMask()!=_clearMask) stage->setClearMask(fragmentStage->getClearMask());
+    if (fragmentStage->getClearColor()!=_clearColor) stage->setClearColor(fragmentStage->getClearColor());
+
+    fragmentStage->reset();
+
+    if (fragment.computed_znear<cv._computed_znear) cv._computed_znear = fragment.computed_znear;
+    if (fragment.computed_zfar>cv._computed_zfar) cv._computed_zfar = fragment.computed_zfar;
+
+    cv._nearPlaneCandidateMap.insert(fragment.nearPlaneCandidateMap.begin(), fragment.nearPlaneCandidateMap.end());
+    cv._farPlaneCandidateMap.insert(fragment.farPlaneCandidateMap.begin(), fragment.farPlaneCandidateMap.end());
+    fragment.nearPlaneCandidateMap.clear();
+    fragment.farPlaneCandidateMap.clear();
+}
+
 CullVisitor::CullVisitor():
     osg::NodeVisitor(CULL_VISITOR,TRAVERSE_ACTIVE_CHILDREN),
     _currentStateGraph(NULL),
@@ -52,7 +587,8 @@ CullVisitor::CullVisitor():
     _computed_zfar(-FLT_MAX),
     _traversalOrderNumber(0),
     _currentReuseRenderLeafIndex(0),
-    _numberOfEncloseOverrideRenderBinDetails(0)
+    _numberOfEncloseOverrideRenderBinDetails(0),
+    _occlusionBufferStarted(false)
 {
     _identifier = new Identifier;
 }
@@ -68,7 +604,8 @@ CullVisitor::CullVisitor(const CullVisitor& rhs):
     _traversalOrderNumber(0),
     _currentReuseRenderLeafIndex(0),
     _numberOfEncloseOverrideRenderBinDetails(0),
-    _identifier(rhs._identifier)
+    _identifier(rhs._identifier),
+    _occlusionBufferStarted(false)
 {
 }
 
@@ -106,6 +643,9 @@ void CullVisitor::reset()
     // reset the traversal order number
     _traversalOrderNumber = 0;
 
+    // the OcclusionBuffer starts its frame on first use in the traversal.
+    _occlusionBufferStarted = false;
+
     // reset the calculated near far planes.
     _computed_znear = FLT_MAX;
     _computed_zfar = -FLT_MAX;
@@ -133,6 +673,8 @@ void CullVisitor::reset()
 
     _nearPlaneCandidateMap.clear();
     _farPlaneCandidateMap.clear();
+
+    if (_parallelCull.valid()) _parallelCull->reset();
 }
 
 float CullVisitor::getDistanceToEyePoint(const Vec3& pos, bool withLODScale) const
@@ -249,6 +791,13 @@ void CullVisitor::popProjectionMatrix()
         //OSG_INFO<<"Not clamping "<< "znear="<<_computed_znear << " zfar="<<_computed_zfar<<std::endl;
     }
 
+    // the end of the traversal of the top level projection ends the OcclusionBuffer's frame.
+    if (_occlusionBufferStarted && _projectionStack.size()==1)
+    {
+        _occlusionBuffer->endFrame();
+        _occlusionBufferStarted = false;
+    }
+
     CullStack::popProjectionMatrix();
 }
 
@@ -264,6 +813,220 @@ bool CullVisitor::clampProjectionMatrixImplementation(osg::Matrixd& projection,
     return osg::clampProjectionMatrix( projection, znear, zfar, _nearFarRatio );
 }
 
+bool CullVisitor::isOcclusionCullingActive()
+{
+    if ((_cullingMode&SOFTWARE_OCCLUSION_CULLING)==0 || _projectionStack.size()!=1 || _modelviewStack.empty()) return false;
+
+    if (!_occlusionBufferStarted)
+    {
+        if (!_occlusionBuffer) _occlusionBuffer = new OcclusionBuffer;
+
+        // the first model view matrix pushed is the view matrix.
+        _occlusionBuffer->beginFrame(*_modelviewStack.front(), *_projectionStack.front());
+        _occlusionBufferStarted = true;
+    }
+    return true;
+}
+
+bool CullVisitor::isOccludedByOcclusionBuffer(const osg::BoundingSphere& bs)
+{
+    if (!isOcclusionCullingActive()) return false;
+
+    if (!_occlusionBuffer->isOccluded(bs, (*getModelViewMatrix())*(*getProjectionMatrix()))) return false;
+
+    _occlusionBuffer->addOccluded();
+    return true;
+}
+
+bool CullVisitor::isOccludedByOcclusionBuffer(const osg::BoundingBox& bb, const osg::Drawable* drawable)
+{
+    if (!isOcclusionCullingActive()) return false;
+
+    // an occluder that has just started to move can lie behind where it was rasterized, so never hides itself.
+    if (!_occlusionBuffer->isOccluded(bb, (*getModelViewMatrix())*(*getProjectionMatrix())) || _occlusionBuffer->isOccluder(drawable)) return false;
+
+    _occlusionBuffer->addOccluded();
+    return true;
+}
+
+void CullVisitor::addOccluderCandidate(osg::Drawable& drawable, const osg::RefMatrix& matrix, const osg::BoundingBox& bb, float depth)
+{
+    // only opaque drawables in the default bin of the RenderStage hide what lies behind them.
+    if (!bb.valid() || _currentRenderBin->getStage()!=_currentRenderBin || !isOcclusionCullingActive()) return;
+
+    float radius = bb.radius()*sqrtf(matrix(0,0)*matrix(0,0) + matrix(0,1)*matrix(0,1) + matrix(0,2)*matrix(0,2));
+    float size = depth>radius ? radius/depth : 1.0f;
+    if (!_occlusionBuffer->isOccluderCandidate(drawable, size)) return;
+
+    for(StateGraph* sg = _currentStateGraph; sg; sg = sg->_parent)
+    {
+        const osg::StateSet* stateset = sg->getStateSet();
+        if (stateset && ((stateset->getMode(GL_BLEND)&osg::StateAttribute::ON) || stateset->getAttribute(osg::StateAttribute::ALPHAFUNC))) return;
+    }
+
+    _occlusionBuffer->addOccluderCandidate(&drawable, matrix, size);
+}
+
+struct CullVisitor::SharedCull
+{
+    SharedCull(CullVisitor& cv, StateGraph* sourceStateGraph, const osg::RefMatrix* sourceProjection, osg::RefMatrix* projection, const osg::Matrix& viewOffset, const osg::Polytope& frustum):
+        _cv(cv),
+        _sourceStateGraph(sourceStateGraph),
+        _sourceProjection(sourceProjection),
+        _projection(projection),
+        _viewOffset(viewOffset),
+        _frustum(frustum),
+        _lastSourceMatrix(0),
+        _lastMatrix(0)
+    {
+        // an offset that leaves the eye z axis alone, such as the separation of stereo eyes, only shifts the depths.
+        _depthOffsetOnly = viewOffset(0,2)==0.0 && viewOffset(1,2)==0.0 && viewOffset(2,2)==1.0;
+    }
+
+    osg::RefMatrix* matrix(osg::RefMatrix* sourceMatrix)
+    {
+        if (!sourceMatrix) return 0;
+
+        // the leaves of a StateGraph often share a model view matrix, so only look it up when it changes.
+        if (sourceMatrix!=_lastSourceMatrix)
+        {
+            _lastSourceMatrix = sourceMatrix;
+            _lastMatrix = _cv.createOrReuseMatrix((*sourceMatrix)*_viewOffset);
+        }
+        return _lastMatrix;
+    }
+
+    bool visible(const RenderLeaf* leaf) const
+    {
+        const osg::BoundingBox& bb = leaf->_drawable->getBoundingBox();
+        if (!bb.valid() || !leaf->_modelview) return true;
+
+        const osg::Matrix& m = *(leaf->_modelview);
+        osg::Vec3 center = bb.center()*m;
+        double scale2 = osg::maximum(osg::Vec3d(m(0,0),m(0,1),m(0,2)).length2(),
+                        osg::maximum(osg::Vec3d(m(1,0),m(1,1),m(1,2)).length2(),
+                                     osg::Vec3d(m(2,0),m(2,1),m(2,2)).length2()));
+        float radius = bb.radius()*sqrt(scale2);
+
+        const osg::Polytope::PlaneList& planes = _frustum.getPlaneList();
+        for(osg::Polytope::PlaneList::const_iterator itr = planes.begin();
+            itr != planes.end();
+            ++itr)
+        {
+            if (itr->distance(center)<-radius) return false;
+        }
+        return true;
+    }
+
+    float depth(const RenderLeaf* leaf, const osg::RefMatrix* matrix) const
+    {
+        if (_depthOffsetOnly) return leaf->_depth - _viewOffset(3,2);
+
+        const osg::BoundingBox& bb = leaf->_drawable->getBoundingBox();
+        return (bb.valid() && matrix) ? distance(bb.center(), *matrix) : leaf->_depth;
+    }
+
+    StateGraph* stateGraph(StateGraph* sourceStateGraph)
+    {
+        if (sourceStateGraph==_sourceStateGraph) return _cv._rootStateGraph.get();
+
+        return stateGraph(sourceStateGraph->_parent)->find_or_insert(sourceStateGraph->getStateSet());
+    }
+
+    bool copyRenderBin(RenderBin* bin, RenderBin* sourceBin)
+    {
+        // a sorted RenderBin has moved its leaves out of its StateGraphs.
+        if (!sourceBin->getRenderLeafList().empty()) return false;
+
+        RenderBin::StateGraphList& sourceStateGraphs = sourceBin->getStateGraphList();
+        for(RenderBin::StateGraphList::iterator itr = sourceStateGraphs.begin();
+            itr != sourceStateGraphs.end();
+            ++itr)
+        {
+            StateGraph* sourceStateGraph = *itr;
+            StateGraph* sg = 0;
+            for(StateGraph::LeafList::iterator litr = sourceStateGraph->_leaves.begin();
+                litr != sourceStateGraph->_leaves.end();
+                ++litr)
+            {
+                RenderLeaf* sourceLeaf = litr->get();
+                if (sourceLeaf->_projection.get()!=_sourceProjection) return false;
+
+                if (!visible(sourceLeaf)) continue;
+
+                if (!sg)
+                {
+                    sg = stateGraph(sourceStateGraph);
+
+                    // as in CullVisitor::addDrawable(), a StateGraph is added to a RenderBin with its first leaf.
+                    if (sg->leaves_empty()) bin->addStateGraph(sg);
+                }
+
+                osg::RefMatrix* modelview = matrix(sourceLeaf->_modelview.get());
+                RenderLeaf* leaf = _cv.createOrReuseRenderLeaf(sourceLeaf->_drawable.get(), _projection, modelview, depth(sourceLeaf, modelview));
+                leaf->_traversalOrderNumber = sourceLeaf->_traversalOrderNumber;
+                sg->addLeaf(leaf);
+            }
+        }
+
+        // only copy the bins used by this frame's cull, not those kept from previous frames.
+        sourceBin->removeUnusedRenderBins();
+
+        RenderBin::RenderBinList& sourceBins = sourceBin->getRenderBinList();
+        for(RenderBin::RenderBinList::iterator itr = sourceBins.begin();
+            itr != sourceBins.end();
+            ++itr)
+        {
+            if (!copyRenderBin(bin->find_or_insert(itr->second.get()), itr->second.get())) return false;
+        }
+        return true;
+    }
+
+    CullVisitor&                _cv;
+    StateGraph*                 _sourceStateGraph;
+    const osg::RefMatrix*       _sourceProjection;
+    osg::RefMatrix*             _projection;
+    osg::Matrix                 _viewOffset;
+    const osg::Polytope&        _frustum;
+    bool                        _depthOffsetOnly;
+    osg::RefMatrix*             _lastSourceMatrix;
+    osg::RefMatrix*             _lastMatrix;
+};
+
+bool CullVisitor::shareCullTraversal(RenderStage* sourceStage, StateGraph* sourceStateGraph, const osg::RefMatrix* sourceProjection,
+                                     osg::RefMatrix* projection, const osg::Matrix& viewOffset, const osg::Polytope& frustum)
+{
+    if (!_rootStateGraph || !_rootRenderStage) return false;
+
+    // the RenderStages of nested Cameras are set up for the source view.
+    if (!sourceStage->getPreRenderList().empty() || !sourceStage->getPostRenderList().empty()) return false;
+
+    SharedCull sharedCull(*this, sourceStateGraph, sourceProjection, projection, viewOffset, frustum);
+
+    PositionalStateContainer::AttrMatrixList& attrList = sourceStage->getPositionalStateContainer()->getAttrMatrixList();
+    for(PositionalStateContainer::AttrMatrixList::iterator itr = attrList.begin();
+        itr != attrList.end();
+        ++itr)
+    {
+        _rootRenderStage->addPositionedAttribute(sharedCull.matrix(itr->second.get()), itr->first.get());
+    }
+
+    PositionalStateContainer::TexUnitAttrMatrixListMap& texAttrListMap = sourceStage->getPositionalStateContainer()->getTexUnitAttrMatrixListMap();
+    for(PositionalStateContainer::TexUnitAttrMatrixListMap::iterator titr = texAttrListMap.begin();
+        titr != texAttrListMap.end();
+        ++titr)
+    {
+        for(PositionalStateContainer::AttrMatrixList::iterator itr = titr->second.begin();
+            itr != titr->second.end();
+            ++itr)
+        {
+            _rootRenderStage->addPositionedTextureAttribute(titr->first, sharedCull.matrix(itr->second.get()), itr->first.get());
+        }
+    }
+
+    return sharedCull.copyRenderBin(_rootRenderStage.get(), sourceStage);
+}
+
 template<typename Comparator>
 struct ComputeNearFarFunctor
 {
@@ -882,7 +1645,7 @@ void CullVisitor::apply(Node& node)
 
 void CullVisitor::apply(Geode& node)
 {
-    if (isCulled(node)) return;
+    if (isCulled(node) || isOccluded(node)) return;
 
     // push the culling mode.
     pushCurrentMask();
@@ -891,7 +1654,15 @@ void CullVisitor::apply(Geode& node)
     StateSet* node_state = node.getStateSet();
     if (node_state) pushStateSet(node_state);
 
-    handle_cull_callbacks_and_traverse(node);
+    // only plain Geodes are culled in batches as subclasses may override traverse().
+    if (!node.getCullCallback() && typeid(node)==typeid(osg::Geode))
+    {
+        traverseWithBatchedCulling(node);
+    }
+    else
+    {
+        handle_cull_callbacks_and_traverse(node);
+    }
 
     // pop the node's state off the geostate stack.
     if (node_state) popStateSet();
@@ -921,6 +1692,7 @@ void CullVisitor::apply(osg::Drawable& drawable)
 
     if (drawable.isCullingActive() && isCulled(bb)) return;
 
+    if (drawable.isCullingActive() && isOccluded(drawable, bb)) return;
 
     if (_computeNearFar && bb.valid())
     {
@@ -970,6 +1742,8 @@ void CullVisitor::apply(osg::Drawable& drawable)
     else
     {
         addDrawableAndDepth(&drawable,&matrix,depth);
+
+        if (_cullingMode&SOFTWARE_OCCLUSION_CULLING) addOccluderCandidate(drawable, matrix, bb, depth);
     }
 
     for(unsigned int i=0;i< numPopStateSetRequired; ++i)
@@ -1136,7 +1910,7 @@ void CullVisitor::apply(TexGenNode& node)
 
 void CullVisitor::apply(Group& node)
 {
-    if (isCulled(node)) return;
+    if (isCulled(node) || isOccluded(node)) return;
 
     // push the culling mode.
     pushCurrentMask();
@@ -1145,7 +1919,27 @@ void CullVisitor::apply(Group& node)
     StateSet* node_state = node.getStateSet();
     if (node_state) pushStateSet(node_state);
 
-    handle_cull_callbacks_and_traverse(node);
+    // only plain Groups are culled in parallel as subclasses may override traverse().
+    if (_parallelCullNumThreads>1 &&
+        node.getNumChildren()>=_parallelCullMinimumNumChildren &&
+        !node.getCullCallback() &&
+        typeid(node)==typeid(osg::Group))
+    {
+        if (!_parallelCull || _parallelCull->getNumThreads()!=_parallelCullNumThreads)
+        {
+            _parallelCull = new ParallelCull(*this, _parallelCullNumThreads);
+        }
+
+        _parallelCull->traverse(*this, node);
+    }
+    else if (!node.getCullCallback() && typeid(node)==typeid(osg::Group))
+    {
+        traverseWithBatchedCulling(node);
+    }
+    else
+    {
+        handle_cull_callbacks_and_traverse(node);
+    }
 
     // pop the node's state off the render graph stack.
     if (node_state) popStateSet();
@@ -1154,9 +1948,296 @@ void CullVisitor::apply(Group& node)
     popCurrentMask();
 }
 
+void CullVisitor::traverseWithBatchedCulling(osg::Group& group)
+{
+    // below this number of children batches don't pay for gathering the bounds.
+    const unsigned int minimumNumChildren = 4;
+
+    unsigned int numChildren = group.getNumChildren();
+    if (numChildren<minimumNumChildren ||
+        _traversalMode==TRAVERSE_NONE || _traversalMode==TRAVERSE_PARENTS ||
+        !getCurrentCullingSet().canCullInBatches())
+    {
+        traverse(group);
+        return;
+    }
+
+    // children are culled in blocks on the stack rather than all at once to avoid any allocations.
+    const unsigned int blockSize = 16;
+
+    osg::BoundingSphere spheres[blockSize];
+    bool sphereCulled[blockSize];
+    osg::Polytope::ClippingMask sphereMasks[blockSize];
+
+    osg::BoundingBox boxes[blockSize];
+    bool boxCulled[blockSize];
+    osg::Polytope::ClippingMask boxMasks[blockSize];
+
+    // for each child of a block the index of its sphere or box, or -1 if it isn't culled.
+    int sphereIndices[blockSize];
+    int boxIndices[blockSize];
+
+    for(unsigned int begin=0; begin<numChildren; begin+=blockSize)
+    {
+        unsigned int end = osg::minimum(begin+blockSize, numChildren);
+
+        unsigned int numSpheres = 0;
+        unsigned int numBoxes = 0;
+        for(unsigned int i=begin; i<end; ++i)
+        {
+            osg::Node* child = group.getChild(i);
+            sphereIndices[i-begin] = -1;
+            boxIndices[i-begin] = -1;
+
+            if (!child->isCullingActive() || !validNodeMask(*child)) continue;
+
+            // drawables are culled by their bounding box, see apply(osg::Drawable&).
+            osg::Drawable* drawable = child->asDrawable();
+            if (drawable)
+            {
+                const osg::BoundingBox& bb = drawable->getBoundingBox();
+                if (!bb.valid()) continue;
+
+                boxIndices[i-begin] = numBoxes;
+                boxes[numBoxes++] = bb;
+            }
+            else
+            {
+                sphereIndices[i-begin] = numSpheres;
+                spheres[numSpheres++] = child->getBound();
+            }
+        }
+
+        const osg::CullingSet& cullingSet = getCurrentCullingSet();
+        if (numSpheres>0) cullingSet.isCulled(spheres, numSpheres, sphereCulled, sphereMasks);
+        if (numBoxes>0) cullingSet.isCulled(boxes, numBoxes, boxCulled, boxMasks);
+
+        // the results remain valid while visiting the block as each child restores the culling mask before the next,
+        // unless visiting the earlier children has changed a bound.
+        for(unsigned int i=begin; i<end; ++i)
+        {
+            osg::Node* child = group.getChild(i);
+
+            int index = sphereIndices[i-begin];
+            if (index>=0 && child->getBound()==spheres[index])
+            {
+                setPrecomputedCullResult(child->getBound(), sphereCulled[index], sphereMasks[index]);
+            }
+
+            index = boxIndices[i-begin];
+            if (index>=0 && child->asDrawable()->getBoundingBox()==boxes[index])
+            {
+                setPrecomputedCullResult(child->asDrawable()->getBoundingBox(), boxCulled[index], boxMasks[index]);
+            }
+
+            child->accept(*this);
+
+            clearPrecomputedCullResult();
+        }
+    }
+}
+
+typedef std::vector<CompiledCull::StateSetNode> CompiledStateSets;
+
+static void pushCompiledStateSets(CullVisitor& cv, const CompiledStateSets& stateSets, int from, int to)
+{
+    if (to==from) return;
+
+    pushCompiledStateSets(cv, stateSets, from, stateSets[to].parent);
+    cv.pushStateSet(stateSets[to].stateSet.get());
+}
+
+// switch from the StateSets of one compiled item to those of the next, popping and pushing only the StateSets below the ones they share.
+static void switchCompiledStateSets(CullVisitor& cv, const CompiledStateSets& stateSets, int& current, int target)
+{
+    if (current==target) return;
+
+    unsigned int targetDepth = target<0 ? 0 : stateSets[target].depth;
+    while(current>=0 && stateSets[current].depth>targetDepth)
+    {
+        cv.popStateSet();
+        current = stateSets[current].parent;
+    }
+
+    int ancestor = target;
+    while(ancestor>=0 && (current<0 || stateSets[ancestor].depth>stateSets[current].depth))
+    {
+        ancestor = stateSets[ancestor].parent;
+    }
+
+    while(current!=ancestor)
+    {
+        cv.popStateSet();
+        current = stateSets[current].parent;
+        ancestor = stateSets[ancestor].parent;
+    }
+
+    pushCompiledStateSets(cv, stateSets, current, target);
+    current = target;
+}
+
+bool CullVisitor::traverseCompiledCull(osg::Group& group, const CompiledCull& compiled)
+{
+    osg::CullingSet& cullingSet = getCurrentCullingSet();
+    bool testFrustum = (cullingSet.getCullingMask()&osg::CullingSet::VIEW_FRUSTUM_CULLING) && cullingSet.getFrustum().getCurrentMask()!=0;
+
+    if (compiled._compiledChildren.size()!=group.getNumChildren() ||
+        _traversalMode==TRAVERSE_NONE || _traversalMode==TRAVERSE_PARENTS ||
+        !cullingSet.getStateFrustumList().empty() ||
+        (testFrustum && !cullingSet.canCullInBatches()))
+    {
+        return false;
+    }
+
+    // take the scratch list so that a CompiledCullGroup nested below an uncompiled child gets one of its own.
+    std::vector<unsigned int> visibleItems;
+    visibleItems.swap(_compiledCullItems);
+    visibleItems.clear();
+
+    visibleItems.insert(visibleItems.end(), compiled._unboundedItems.begin(), compiled._unboundedItems.end());
+
+    if (!testFrustum)
+    {
+        visibleItems.insert(visibleItems.end(), compiled._bvhItems.begin(), compiled._bvhItems.end());
+    }
+    else if (!compiled._bvhNodes.empty())
+    {
+        osg::Polytope& frustum = cullingSet.getFrustum();
+        osg::Polytope::ClippingMask& currentMask = frustum.getCurrentMask();
+        osg::Polytope::ClippingMask groupMask = currentMask;
+
+        // nodes still to visit, each with the mask of the planes its bound hasn't been found to lie above.
+        const unsigned int maximumStackSize = 128;
+        unsigned int stackNodes[maximumStackSize];
+        osg::Polytope::ClippingMask stackMasks[maximumStackSize];
+        unsigned int stackSize = 0;
+
+        // items and children are tested in blocks on the stack, as in traverseWithBatchedCulling().
+        const unsigned int blockSize = 16;
+        bool contained[blockSize];
+        osg::Polytope::ClippingMask resultMasks[blockSize];
+
+        frustum.contains(&compiled._bvhBounds[0], 1, contained, resultMasks);
+        if (contained[0])
+        {
+            stackNodes[0] = 0;
+            stackMasks[0] = resultMasks[0];
+            stackSize = 1;
+        }
+
+        while(stackSize>0)
+        {
+            --stackSize;
+            const CompiledCull::BVHNode& node = compiled._bvhNodes[stackNodes[stackSize]];
+            osg::Polytope::ClippingMask mask = stackMasks[stackSize];
+
+            if (mask==0)
+            {
+                // wholly inside the frustum, so all its items are visible.
+                visibleItems.insert(visibleItems.end(), compiled._bvhItems.begin()+node.itemBegin, compiled._bvhItems.begin()+node.itemEnd);
+                continue;
+            }
+
+            currentMask = mask;
+
+            if (node.numChildren==0 || stackSize+node.numChildren>maximumStackSize)
+            {
+                for(unsigned int begin=node.itemBegin; begin<node.itemEnd; begin+=blockSize)
+                {
+                    unsigned int num = osg::minimum(blockSize, node.itemEnd-begin);
+                    frustum.contains(&compiled._bvhItemBounds[begin], num, contained, resultMasks);
+                    for(unsigned int i=0; i<num; ++i)
+                    {
+                        if (contained[i]) visibleItems.push_back(compiled._bvhItems[begin+i]);
+                    }
+                }
+            }
+            else
+            {
+                frustum.contains(&compiled._bvhBounds[node.first], node.numChildren, contained, resultMasks);
+                for(unsigned int i=0; i<node.numChildren; ++i)
+                {
+                    if (contained[i])
+                    {
+                        stackNodes[stackSize] = node.first+i;
+                        stackMasks[stackSize] = resultMasks[i];
+                        ++stackSize;
+                    }
+                }
+            }
+        }
+
+        currentMask = groupMask;
+    }
+
+    // draw the visible items in the order a traversal would have added them.
+    std::sort(visibleItems.begin(), visibleItems.end());
+
+    const CompiledStateSets& stateSets = compiled._stateSets;
+    int currentStateSet = -1;
+
+    osg::RefMatrix* groupModelView = getModelViewMatrix();
+    unsigned int currentMatrixIndex = 0;
+    osg::RefMatrix* currentMatrix = groupModelView;
+
+    std::vector<unsigned int>::const_iterator itemItr = visibleItems.begin();
+    for(unsigned int childIndex=0; childIndex<group.getNumChildren(); ++childIndex)
+    {
+        if (!compiled._compiledChildren[childIndex])
+        {
+            switchCompiledStateSets(*this, stateSets, currentStateSet, -1);
+            group.getChild(childIndex)->accept(*this);
+            continue;
+        }
+
+        for(; itemItr!=visibleItems.end() && compiled._items[*itemItr].child==childIndex; ++itemItr)
+        {
+            const CompiledCull::Item& item = compiled._items[*itemItr];
+            osg::Drawable* drawable = item.drawable.get();
+
+            if ((getTraversalMask() & (getNodeMaskOverride() | item.nodeMask))==0) continue;
+
+            // the bound is in the group's coordinates, which are those of the current model view matrix.
+            if (item.bound.valid() && isOccluded(*drawable, item.bound)) continue;
+
+            if (item.matrix!=currentMatrixIndex)
+            {
+                currentMatrixIndex = item.matrix;
+                currentMatrix = item.matrix==0 ? groupModelView : createOrReuseMatrix(compiled._matrices[item.matrix]*(*groupModelView));
+            }
+
+            const osg::BoundingBox& bb = drawable->getBoundingBox();
+            if (_computeNearFar && bb.valid())
+            {
+                if (!updateCalculatedNearFar(*currentMatrix,*drawable,false)) continue;
+            }
+
+            switchCompiledStateSets(*this, stateSets, currentStateSet, item.stateSet);
+
+            float depth = bb.valid() ? distance(bb.center(),*currentMatrix) : 0.0f;
+            if (osg::isNaN(depth))
+            {
+                OSG_NOTICE<<"CullVisitor::traverseCompiledCull() detected NaN,"<<std::endl
+                                        <<"    depth="<<depth<<", center=("<<bb.center()<<"),"<<std::endl
+                                        <<"    matrix="<<*currentMatrix<<std::endl;
+                continue;
+            }
+
+            addDrawableAndDepth(drawable,currentMatrix,depth);
+
+            if (_cullingMode&SOFTWARE_OCCLUSION_CULLING) addOccluderCandidate(*drawable, *currentMatrix, bb, depth);
+        }
+    }
+
+    switchCompiledStateSets(*this, stateSets, currentStateSet, -1);
+
+    visibleItems.swap(_compiledCullItems);
+    return true;
+}
+
 void CullVisitor::apply(Transform& node)
 {
-    if (isCulled(node)) return;
+    if (isCulled(node) || isOccluded(node)) return;
 
     // push the culling mode.
     pushCurrentMask();
@@ -1244,7 +2325,7 @@ void CullVisitor::apply(Switch& node)
 
 void CullVisitor::apply(LOD& node)
 {
-    if (isCulled(node)) return;
+    if (isCulled(node) || isOccluded(node)) return;
 
     // push the culling mode.
     pushCurrentMask();
@@ -1511,6 +2592,7 @@ void CullVisitor::apply(osg::Camera& camera)
 
             rtts = _rootRenderStage.valid() ? osg::cloneType(_rootRenderStage.get()) : new osgUtil::RenderStage;
             rsCache->setRenderStage(this,rtts.get());
+            ++_numAllocations;
 
             rtts->setCamera(&camera);
 
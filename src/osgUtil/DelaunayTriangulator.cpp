@@ -12,7 +12,7 @@
 */
 
 #include <osgUtil/DelaunayTriangulator>
-// NB this algorithm makes heavy use of the osgUtil::Tessellator for constrained triangulation.
+// NB the osgUtil::Tessellator is used by DelaunayConstraint::handleOverlaps to find where constraints cross.
 // truly it is built on the shoulders of giants.
 
 #include <osg/GL>
@@ -23,343 +23,617 @@
 #include <algorithm>
 #include <set>
 #include <map> //GWM July 2005 map is used in constraints.
-#include <osgUtil/Tessellator> // tessellator triangulates the constrained triangles
+#include <deque>
+#include <osgUtil/Tessellator> // tessellator finds the crossings of overlapping constraints
 #include <stdlib.h>
 #include <iterator>
 
 namespace osgUtil
 {
 
-//////////////////////////////////////////////////////////////////////////////////////
-// MISC MATH FUNCTIONS
+// data type for vertex indices
+typedef GLuint Vertex_index;
 
 
-// Compute the circumcircle of a triangle (only x and y coordinates are used),
-// return (Cx, Cy, r^2)
-inline osg::Vec3 compute_circumcircle(
-    const osg::Vec3 &a,
-    const osg::Vec3 &b,
-    const osg::Vec3 &c)
+// CLASS: Triangle
+
+class Triangle
 {
-    float D =
-        (a.x() - c.x()) * (b.y() - c.y()) -
-        (b.x() - c.x()) * (a.y() - c.y());
+public:
+
+    Triangle(Vertex_index a, Vertex_index b, Vertex_index c):
+        a_(a),
+        b_(b),
+        c_(c) {}
 
-    float cx, cy, r2;
+    inline Vertex_index a() const { return a_; }
+    inline Vertex_index b() const { return b_; }
+    inline Vertex_index c() const { return c_; }
 
-    if(D==0.0)
+    inline osg::Vec3 compute_centroid(const osg::Vec3Array *points) const
     {
-        // (Nearly) degenerate condition - either two of the points are equal (which we discount)
-        // or the three points are colinear. In this case we just determine the average of
-        // the three points as the centre for correctness, but squirt out a zero radius.
-        // This method will produce a triangulation with zero area, so we have to check later
-        cx = (a.x()+b.x()+c.x())/3.0;
-        cy = (a.y()+b.y()+c.y())/3.0;
-        r2 = 0.0;
+        return ((*points)[a_] +(*points)[b_] + (*points)[c_])/3;
     }
-    else
+
+    inline osg::Vec3 compute_normal(osg::Vec3Array *points) const
     {
-        cx =
-        (((a.x() - c.x()) * (a.x() + c.x()) +
-        (a.y() - c.y()) * (a.y() + c.y())) / 2 * (b.y() - c.y()) -
-        ((b.x() - c.x()) * (b.x() + c.x()) +
-        (b.y() - c.y()) * (b.y() + c.y())) / 2 * (a.y() - c.y())) / D;
-
-        cy =
-        (((b.x() - c.x()) * (b.x() + c.x()) +
-        (b.y() - c.y()) * (b.y() + c.y())) / 2 * (a.x() - c.x()) -
-        ((a.x() - c.x()) * (a.x() + c.x()) +
-        (a.y() - c.y()) * (a.y() + c.y())) / 2 * (b.x() - c.x())) / D;
-
-      //  r2 = (c.x() - cx) * (c.x() - cx) + (c.y() - cy) * (c.y() - cy);
-        // the return r square is compared with r*r many times in an inner loop
-        // so for efficiency use the inefficient sqrt once rather than 30* multiplies later.
-        r2 = sqrt((c.x() - cx) * (c.x() - cx) + (c.y() - cy) * (c.y() - cy));
+        osg::Vec3 N = ((*points)[b_] - (*points)[a_]) ^ ((*points)[c_] - (*points)[a_]);
+        return N / N.length();
     }
-    return osg::Vec3(cx, cy, r2);
-}
 
-// Test whether a point (only the x and y coordinates are used) lies inside
-// a circle; the circle is passed as a vector: (Cx, Cy, r).
+private:
+
+    Vertex_index a_;
+    Vertex_index b_;
+    Vertex_index c_;
+};
 
-inline bool point_in_circle(const osg::Vec3 &point, const osg::Vec3 &circle)
+// comparison function for sorting sample points by the X coordinate
+bool Sample_point_compare(const osg::Vec3 &p1, const osg::Vec3 &p2)
 {
-    float r2 =
-        (point.x() - circle.x()) * (point.x() - circle.x()) +
-        (point.y() - circle.y()) * (point.y() - circle.y());
-    return r2 <= circle.z()*circle.z();
-//    return r2 <= circle.z();
+    // replace pure sort by X coordinate with X then Y.
+    // errors can occur if the delaunay triangulation specifies 2 points at same XY and different Z
+    if (p1.x() != p2.x()) return p1.x() < p2.x();
+    if (p1.y() != p2.y()) return p1.y() < p2.y(); // GWM 30.06.05 - further rule if x coords are same.
+    OSG_INFO << "Two points are coincident at "<<p1.x() <<","<<p1.y() << std::endl;
+    return p1.z() < p2.z(); // never get here unless 2 points coincide
 }
 
 
-//
+
 //////////////////////////////////////////////////////////////////////////////////////
+// INCREMENTAL TRIANGULATION
 
+namespace
+{
 
-// data type for vertex indices
-typedef GLuint Vertex_index;
+const int NO_TRIANGLE = -1;
+
+// twice the signed area of the triangle abc, positive when abc is counter clockwise (only x and y are used)
+inline double orient2d(const osg::Vec3 &a, const osg::Vec3 &b, const osg::Vec3 &c)
+{
+    return (double(b.x())-double(a.x()))*(double(c.y())-double(a.y())) -
+           (double(b.y())-double(a.y()))*(double(c.x())-double(a.x()));
+}
 
+// positive when d lies inside the circumcircle of the counter clockwise triangle abc (only x and y are used)
+inline double incircle(const osg::Vec3 &a, const osg::Vec3 &b, const osg::Vec3 &c, const osg::Vec3 &d)
+{
+    double adx = double(a.x())-double(d.x()), ady = double(a.y())-double(d.y());
+    double bdx = double(b.x())-double(d.x()), bdy = double(b.y())-double(d.y());
+    double cdx = double(c.x())-double(d.x()), cdy = double(c.y())-double(d.y());
 
-// CLASS: Edge
-// This class describes an edge of a triangle (it stores vertex indices to the two
-// endpoints).
+    double ad = adx*adx + ady*ady;
+    double bd = bdx*bdx + bdy*bdy;
+    double cd = cdx*cdx + cdy*cdy;
 
-class Edge {
-public:
+    return adx*(bdy*cd - bd*cdy) - ady*(bdx*cd - bd*cdx) + ad*(bdx*cdy - bdy*cdx);
+}
 
-    // Comparison object (for sorting)
-    struct Less
+// position along the Hilbert curve of a point on a 65536x65536 grid
+inline unsigned int hilbert_index(unsigned int x, unsigned int y)
+{
+    const unsigned int n = 1u<<16;
+    unsigned int d = 0;
+    for (unsigned int s=n/2; s>0; s/=2)
     {
-        inline bool operator()(const Edge &e1, const Edge &e2) const
+        unsigned int rx = (x & s) ? 1 : 0;
+        unsigned int ry = (y & s) ? 1 : 0;
+        d += s * s * ((3 * rx) ^ ry);
+        if (ry==0)
         {
-            if (e1.ibs() < e2.ibs()) return true;
-            if (e1.ibs() > e2.ibs()) return false;
-            if (e1.ies() < e2.ies()) return true;
-            return false;
+            if (rx==1)
+            {
+                x = n-1 - x;
+                y = n-1 - y;
+            }
+            std::swap(x, y);
         }
-    };
+    }
+    return d;
+}
 
-    Edge(): ib_(0), ie_(0), ibs_(0), ies_(0), duplicate_(false) {}
-    Edge(Vertex_index ib, Vertex_index ie) : ib_(ib), ie_(ie), ibs_(osg::minimum(ib, ie)), ies_(osg::maximum(ib, ie)), duplicate_(false) {}
+// CLASS: DelaunayMesh
+// Triangulation held in flat arrays, three counter clockwise vertex indices per triangle along with the
+// triangle across each edge, where edge i runs from vertex i to vertex i+1. Points are located by walking
+// across the triangles from the last one created and the Delaunay property is restored with edge flips.
+// Constraint edges are recovered by flipping the edges that cross them, and are never flipped afterwards.
 
-    // first endpoint
-    inline Vertex_index ib() const { return ib_; }
+class DelaunayMesh
+{
+public:
+
+    DelaunayMesh(const osg::Vec3Array *points):
+        points_(points),
+        vertex_triangles_(points->size(), NO_TRIANGLE),
+        last_triangle_(0) {}
 
-    // second endpoint
-    inline Vertex_index ie() const { return ie_; }
+    // add a triangle without any neighbours, used to set up the initial triangles enclosing all the points
+    int addTriangle(Vertex_index a, Vertex_index b, Vertex_index c)
+    {
+        int t = newTriangle();
+        setTriangle(t, a, b, c, NO_TRIANGLE, NO_TRIANGLE, NO_TRIANGLE, 0);
+        return t;
+    }
 
-    // first sorted endpoint
-    inline Vertex_index ibs() const { return ibs_; }
+    void setNeighbour(int t, unsigned int edge, int n) { neighbours_[t*3+edge] = n; }
 
-    // second sorted endpoint
-    inline Vertex_index ies() const { return ies_; }
+    // insert the point, return false if it lies outside the triangulation or on an existing vertex
+    bool insertPoint(Vertex_index p);
 
-    // get the "duplicate" flag
-    inline bool get_duplicate() const { return duplicate_; }
+    // force the edge between two vertices into the triangulation, return false if another constraint crosses it
+    bool insertConstraint(Vertex_index a, Vertex_index b);
 
-    // set the "duplicate" flag
-    inline void set_duplicate(bool v) { duplicate_ = v; }
+    unsigned int getNumTriangles() const { return vertices_.size()/3; }
+    const Vertex_index *getTriangle(unsigned int t) const { return &vertices_[t*3]; }
 
 private:
-    Vertex_index ib_, ie_;
-    Vertex_index ibs_, ies_;
-    bool duplicate_;
-};
 
+    typedef std::pair<Vertex_index, Vertex_index> VertexPair;
+    typedef std::vector<VertexPair> VertexPairList;
 
-// CLASS: Triangle
+    static inline unsigned int next(unsigned int i) { return i==2 ? 0 : i+1; }
+    static inline unsigned int prev(unsigned int i) { return i==0 ? 2 : i-1; }
 
-class Triangle
+    inline const osg::Vec3 &point(Vertex_index v) const { return (*points_)[v]; }
+    inline Vertex_index vertex(int t, unsigned int i) const { return vertices_[t*3+i]; }
+    inline int neighbour(int t, unsigned int i) const { return neighbours_[t*3+i]; }
+    inline bool isConstrained(int t, unsigned int i) const { return ((constrained_[t]>>i) & 1)!=0; }
+
+    // index of vertex v in triangle t, the edge starting at v
+    inline unsigned int indexOf(int t, Vertex_index v) const
+    {
+        return vertex(t,0)==v ? 0 : (vertex(t,1)==v ? 1 : 2);
+    }
+
+    int newTriangle();
+    void setTriangle(int t, Vertex_index a, Vertex_index b, Vertex_index c, int na, int nb, int nc, unsigned char constrained);
+    void replaceNeighbour(int t, int oldNeighbour, int newNeighbour);
+
+    int locate(const osg::Vec3 &p) const;
+    void splitTriangle(int t, Vertex_index p);
+    void splitEdge(int t, unsigned int i, Vertex_index p);
+    void flipEdge(int t, unsigned int i);
+    void legalize();
+
+    bool findEdge(Vertex_index u, Vertex_index v, int &t, unsigned int &i) const;
+    void constrainEdge(int t, unsigned int i);
+    bool collectCrossingEdges(Vertex_index a, Vertex_index b, VertexPairList &crossing, Vertex_index &c) const;
+    bool removeCrossingEdges(Vertex_index a, Vertex_index c, const VertexPairList &crossing);
+
+    const osg::Vec3Array*           points_;
+    std::vector<Vertex_index>       vertices_;
+    std::vector<int>                neighbours_;
+    std::vector<unsigned char>      constrained_;       // bit i set when edge i is a constraint
+    std::vector<int>                vertex_triangles_;  // a triangle using each vertex
+    std::vector< std::pair<int, unsigned int> > flip_stack_;
+    mutable int                     last_triangle_;
+};
+
+int DelaunayMesh::newTriangle()
 {
-public:
+    int t = vertices_.size()/3;
+    vertices_.resize(vertices_.size()+3);
+    neighbours_.resize(neighbours_.size()+3, NO_TRIANGLE);
+    constrained_.push_back(0);
+    return t;
+}
 
-    Triangle():
-        a_(0),
-        b_(0),
-        c_(0) {}
+void DelaunayMesh::setTriangle(int t, Vertex_index a, Vertex_index b, Vertex_index c, int na, int nb, int nc, unsigned char constrained)
+{
+    vertices_[t*3] = a; vertices_[t*3+1] = b; vertices_[t*3+2] = c;
+    neighbours_[t*3] = na; neighbours_[t*3+1] = nb; neighbours_[t*3+2] = nc;
+    constrained_[t] = constrained;
 
+    vertex_triangles_[a] = vertex_triangles_[b] = vertex_triangles_[c] = t;
+}
+
+void DelaunayMesh::replaceNeighbour(int t, int oldNeighbour, int newNeighbour)
+{
+    if (t==NO_TRIANGLE) return;
+    for (unsigned int i=0; i<3; ++i)
+    {
+        if (neighbours_[t*3+i]==oldNeighbour) neighbours_[t*3+i] = newNeighbour;
+    }
+}
 
-    Triangle(Vertex_index a, Vertex_index b, Vertex_index c, osg::Vec3Array *points)
-        :    a_(a),
-            b_(b),
-            c_(c),
-            cc_(compute_circumcircle((*points)[a_], (*points)[b_], (*points)[c_]))
+int DelaunayMesh::locate(const osg::Vec3 &p) const
+{
+    // walk towards p from the last triangle created, which with the spatially coherent insertion order is close by,
+    // varying the first edge tested so that the walk can't cycle.
+    int t = last_triangle_;
+    unsigned int offset = 0;
+    for (unsigned int step=0; step<getNumTriangles(); ++step)
     {
-        edge_[0] = Edge(a_, b_);
-        edge_[1] = Edge(b_, c_);
-        edge_[2] = Edge(c_, a_);
+        bool moved = false;
+        for (unsigned int k=0; k<3 && !moved; ++k)
+        {
+            unsigned int i = (k+offset)%3;
+            if (orient2d(point(vertex(t,i)), point(vertex(t,next(i))), p)<0.0)
+            {
+                t = neighbour(t,i);
+                if (t==NO_TRIANGLE) return NO_TRIANGLE;
+                moved = true;
+            }
+        }
+        if (!moved) return last_triangle_ = t;
+        offset = (offset+1)%3;
     }
 
-    Triangle& operator = (const Triangle& rhs)
+    OSG_INFO << "DelaunayTriangulator: walk failed to locate point, searching all triangles" << std::endl;
+    for (t=0; t<static_cast<int>(getNumTriangles()); ++t)
     {
-        if (&rhs==this) return *this;
+        if (orient2d(point(vertex(t,0)), point(vertex(t,1)), p)>=0.0 &&
+            orient2d(point(vertex(t,1)), point(vertex(t,2)), p)>=0.0 &&
+            orient2d(point(vertex(t,2)), point(vertex(t,0)), p)>=0.0) return last_triangle_ = t;
+    }
+    return NO_TRIANGLE;
+}
 
-        a_ = rhs.a_;
-        b_ = rhs.b_;
-        c_ = rhs.c_;
-        cc_ = rhs.cc_;
-        edge_[0]  = rhs.edge_[0];
-        edge_[1]  = rhs.edge_[1];
-        edge_[2]  = rhs.edge_[2];
+bool DelaunayMesh::insertPoint(Vertex_index p)
+{
+    const osg::Vec3 &pt = point(p);
+    int t = locate(pt);
+    if (t==NO_TRIANGLE) return false;
+
+    int onEdge = -1;
+    for (unsigned int i=0; i<3; ++i)
+    {
+        const osg::Vec3 &v = point(vertex(t,i));
+        if (v.x()==pt.x() && v.y()==pt.y()) return false;
 
-        return *this;
+        if (orient2d(v, point(vertex(t,next(i))), pt)==0.0) onEdge = i;
     }
 
-    inline Vertex_index a() const { return a_; }
-    inline Vertex_index b() const { return b_; }
-    inline Vertex_index c() const { return c_; }
-    inline void incrementa(const int delta) { a_+=delta; }
-    inline void incrementb(const int delta) { b_+=delta; }
-    inline void incrementc(const int delta) { c_+=delta; }
+    if (onEdge<0) splitTriangle(t, p);
+    else splitEdge(t, onEdge, p);
 
-    inline const Edge &get_edge(int idx) const { return edge_[idx];    }
-    inline const osg::Vec3 &get_circumcircle() const { return cc_; }
+    legalize();
+    return true;
+}
 
-    inline osg::Vec3 compute_centroid(const osg::Vec3Array *points) const
+void DelaunayMesh::splitTriangle(int t, Vertex_index p)
+{
+    Vertex_index a = vertex(t,0), b = vertex(t,1), c = vertex(t,2);
+    int n0 = neighbour(t,0), n1 = neighbour(t,1), n2 = neighbour(t,2);
+    unsigned char constrained = constrained_[t];
+
+    int t1 = newTriangle();
+    int t2 = newTriangle();
+    setTriangle(t,  a, b, p, n0, t1, t2, constrained & 1);
+    setTriangle(t1, b, c, p, n1, t2, t, (constrained>>1) & 1);
+    setTriangle(t2, c, a, p, n2, t, t1, (constrained>>2) & 1);
+    replaceNeighbour(n1, t, t1);
+    replaceNeighbour(n2, t, t2);
+
+    // the edges opposite the new point are edge 0 of each triangle
+    flip_stack_.push_back(std::make_pair(t, 0u));
+    flip_stack_.push_back(std::make_pair(t1, 0u));
+    flip_stack_.push_back(std::make_pair(t2, 0u));
+}
+
+void DelaunayMesh::splitEdge(int t, unsigned int i, Vertex_index p)
+{
+    // split triangle (a,b,c) and its neighbour (b,a,d) across edge a-b into four
+    Vertex_index a = vertex(t,i), b = vertex(t,next(i)), c = vertex(t,prev(i));
+    int nbc = neighbour(t,next(i)), nca = neighbour(t,prev(i));
+    unsigned char fab = isConstrained(t,i) ? 1 : 0;
+    unsigned char fbc = isConstrained(t,next(i)) ? 1 : 0;
+    unsigned char fca = isConstrained(t,prev(i)) ? 1 : 0;
+
+    int u = neighbour(t,i);
+    int t1 = newTriangle();
+    int u1 = NO_TRIANGLE;
+
+    if (u!=NO_TRIANGLE)
     {
-        return ((*points)[a_] +(*points)[b_] + (*points)[c_])/3;
+        unsigned int j = indexOf(u, b);
+        Vertex_index d = vertex(u,prev(j));
+        int nad = neighbour(u,next(j)), ndb = neighbour(u,prev(j));
+        unsigned char fad = isConstrained(u,next(j)) ? 1 : 0;
+        unsigned char fdb = isConstrained(u,prev(j)) ? 1 : 0;
+
+        u1 = newTriangle();
+        setTriangle(u,  b, p, d, t1, u1, ndb, fab | (fdb<<2));
+        setTriangle(u1, p, a, d, t, nad, u, fab | (fad<<1));
+        replaceNeighbour(nad, u, u1);
+
+        flip_stack_.push_back(std::make_pair(u, 2u));
+        flip_stack_.push_back(std::make_pair(u1, 1u));
     }
 
-    inline osg::Vec3 compute_normal(osg::Vec3Array *points) const
+    setTriangle(t,  a, p, c, u1, t1, nca, fab | (fca<<2));
+    setTriangle(t1, p, b, c, u, nbc, t, fab | (fbc<<1));
+    replaceNeighbour(nbc, t, t1);
+
+    flip_stack_.push_back(std::make_pair(t, 2u));
+    flip_stack_.push_back(std::make_pair(t1, 1u));
+}
+
+void DelaunayMesh::flipEdge(int t, unsigned int i)
+{
+    // replace edge a-b shared by triangles (a,b,p) and (b,a,q) with edge p-q, giving triangles (a,q,p) and (q,b,p)
+    int n = neighbour(t,i);
+    Vertex_index a = vertex(t,i), b = vertex(t,next(i)), p = vertex(t,prev(i));
+    unsigned int j = indexOf(n, b);
+    Vertex_index q = vertex(n,prev(j));
+
+    int nbp = neighbour(t,next(i)), npa = neighbour(t,prev(i));
+    int naq = neighbour(n,next(j)), nqb = neighbour(n,prev(j));
+    unsigned char fbp = isConstrained(t,next(i)) ? 1 : 0;
+    unsigned char fpa = isConstrained(t,prev(i)) ? 1 : 0;
+    unsigned char faq = isConstrained(n,next(j)) ? 1 : 0;
+    unsigned char fqb = isConstrained(n,prev(j)) ? 1 : 0;
+
+    setTriangle(t, a, q, p, naq, n, npa, faq | (fpa<<2));
+    setTriangle(n, q, b, p, nqb, nbp, t, fqb | (fbp<<1));
+    replaceNeighbour(naq, n, t);
+    replaceNeighbour(nbp, t, n);
+}
+
+void DelaunayMesh::legalize()
+{
+    while (!flip_stack_.empty())
     {
-        osg::Vec3 N = ((*points)[b_] - (*points)[a_]) ^ ((*points)[c_] - (*points)[a_]);
-        return N / N.length();
-    }
+        int t = flip_stack_.back().first;
+        unsigned int i = flip_stack_.back().second;
+        flip_stack_.pop_back();
+
+        int n = neighbour(t,i);
+        if (n==NO_TRIANGLE || isConstrained(t,i)) continue;
 
-    bool isedge(const unsigned int ip1,const unsigned int ip2) const
-    { // is one of the edges of this triangle from ip1-ip2
-        bool isedge=ip1==a() && ip2==b();
-        if (!isedge)
+        Vertex_index a = vertex(t,i), b = vertex(t,next(i)), p = vertex(t,prev(i));
+        Vertex_index q = vertex(n,prev(indexOf(n, b)));
+
+        if (incircle(point(a), point(b), point(p), point(q))>0.0)
         {
-            isedge=ip1==b() && ip2==c();
-            if (!isedge)
-            {
-                isedge=ip1==c() && ip2==a();
-            }
+            flipEdge(t, i);
+
+            // p is the last vertex of both new triangles, so the edges opposite it are edge 0
+            flip_stack_.push_back(std::make_pair(t, 0u));
+            flip_stack_.push_back(std::make_pair(n, 0u));
         }
-        return isedge;
     }
+}
 
-    bool intersectedby(const osg::Vec2 p1,const osg::Vec2 p2,osg::Vec3Array *points) const {
-        // true if line [p1,p2] cuts at least one edge of this triangle
-        osg::Vec2 tp1((*points)[a()].x(),(*points)[a()].y());
-        osg::Vec2 tp2((*points)[b()].x(),(*points)[b()].y());
-        osg::Vec2 tp3((*points)[c()].x(),(*points)[c()].y());
-        bool ip=intersect(tp1,tp2,p1,p2);
-        if (!ip)
+bool DelaunayMesh::findEdge(Vertex_index u, Vertex_index v, int &t, unsigned int &i) const
+{
+    // rotate around u looking for v, the triangles around the supervertices don't form a closed fan
+    // so if the edge of the triangulation is reached rotate back the other way.
+    int start = vertex_triangles_[u];
+    if (start==NO_TRIANGLE) return false;
+
+    for (unsigned int direction=0; direction<2; ++direction)
+    {
+        int current = start;
+        do
         {
-            ip=intersect(tp2,tp3,p1,p2);
-            if (!ip)
-            {
-                ip=intersect(tp3,tp1,p1,p2);
-            }
+            unsigned int iu = indexOf(current, u);
+            if (vertex(current,next(iu))==v) { t = current; i = iu; return true; }
+            if (vertex(current,prev(iu))==v) { t = current; i = prev(iu); return true; }
+
+            current = neighbour(current, direction==0 ? prev(iu) : iu);
         }
-        return ip;
-    }
-    int whichEdge(osg::Vec3Array *points,const osg::Vec2 p1, const osg::Vec2 p2,
-        const unsigned int e1,const unsigned int e2) const
-    {
-        int icut=0;
-        // find which edge of triangle is cut by line (p1-p2) and is NOT e1-e2 indices.
-        // return 1 - cut is on edge b-c; 2==c-a
-        osg::Vec2 tp1((*points)[a()].x(),(*points)[a()].y()); // triangle vertices
-        osg::Vec2 tp2((*points)[b()].x(),(*points)[b()].y());
-        osg::Vec2 tp3((*points)[c()].x(),(*points)[c()].y());
-        bool ip=intersect(tp2,tp3,p1,p2);
-        if (ip && (a()==e1 || a()==e2)) { return 1;}
-        ip=intersect(tp3,tp1,p1,p2);
-        if (ip && (b()==e1 || b()==e2)) { return 2;}
-        ip=intersect(tp1,tp2,p1,p2);
-        if (ip && (c()==e1 || c()==e2)) { return 3;}
-        return icut;
-    }
+        while (current!=start && current!=NO_TRIANGLE);
 
-    bool usesVertex(const unsigned int ip) const
-    {
-        return ip==a_ || ip==b_ || ip==c_;
+        if (current==start) break;
     }
 
-    int lineBisectTest(const osg::Vec3 apt,const osg::Vec3 bpt,const osg::Vec3 cpt, const osg::Vec2 p2) const
+    return false;
+}
+
+void DelaunayMesh::constrainEdge(int t, unsigned int i)
+{
+    constrained_[t] |= (1<<i);
+
+    int n = neighbour(t,i);
+    if (n!=NO_TRIANGLE) constrained_[n] |= (1<<indexOf(n, vertex(t,next(i))));
+}
+
+bool DelaunayMesh::collectCrossingEdges(Vertex_index a, Vertex_index b, VertexPairList &crossing, Vertex_index &c) const
+{
+    const osg::Vec3 &pa = point(a), &pb = point(b);
+    osg::Vec3 direction = pb-pa;
+
+    // find the triangle around a that the segment a-b leaves through
+    int start = vertex_triangles_[a];
+    int t = start;
+    Vertex_index right = 0, left = 0;
+    bool found = false;
+    do
     {
-        osg::Vec2 vp2tp=p2-osg::Vec2(apt.x(), apt.y()); // vector from p1 to a.
-        // test is: cross product (z component) with ab,ac is opposite signs
-        // AND dot product with ab,ac has at least one positive value.
-        osg::Vec2 vecba=osg::Vec2(bpt.x(), bpt.y())-osg::Vec2(apt.x(), apt.y());
-        osg::Vec2 vecca=osg::Vec2(cpt.x(), cpt.y())-osg::Vec2(apt.x(), apt.y());
-        float cprodzba=vp2tp.x()*vecba.y() - vp2tp.y()*vecba.x();
-        float cprodzca=vp2tp.x()*vecca.y() - vp2tp.y()*vecca.x();
-    //    OSG_WARN << "linebisect test " << " tri " << a_<<","<< b_<<","<< c_<<std::endl;
-        if (cprodzba*cprodzca<0)
+        unsigned int ia = indexOf(t, a);
+        Vertex_index v1 = vertex(t,next(ia)), v2 = vertex(t,prev(ia));
+        double o1 = orient2d(pa, point(v1), pb);
+        double o2 = orient2d(pa, point(v2), pb);
+
+        // a vertex lying on the segment splits it
+        if (o1==0.0 && (point(v1)-pa)*direction>0.0) { c = v1; return true; }
+        if (o2==0.0 && (point(v2)-pa)*direction>0.0) { c = v2; return true; }
+
+        if (o1>0.0 && o2<0.0)
         {
-            // more tests - check dot products are at least partly parallel to test line.
-            osg::Vec2 tp1(bpt.x(),bpt.y()); // triangle vertices
-            osg::Vec2 tp2(cpt.x(),cpt.y());
-            osg::Vec2 tp3(apt.x(),apt.y());
-            bool ip=intersect(tp1,tp2,tp3,p2);
-            if (ip) return 1;
+            if (isConstrained(t,next(ia)))
+            {
+                OSG_WARN << "DelaunayTriangulator: constraint edge crosses another constraint" << std::endl;
+                return false;
+            }
+            right = v1;
+            left = v2;
+            t = neighbour(t,next(ia));
+            found = true;
+            break;
         }
-        return 0;
+
+        t = neighbour(t,prev(ia));
     }
+    while (t!=start && t!=NO_TRIANGLE);
+
+    if (!found || t==NO_TRIANGLE) return false;
 
-    int lineBisects(osg::Vec3Array *points, const unsigned int ip1, const osg::Vec2 p2) const
+    crossing.push_back(VertexPair(right, left));
+
+    // walk across the triangles that the segment passes through
+    while (true)
     {
-        // return true if line starts at vertex <ip1> and lies between the 2 edges which meet at vertex
-        // <vertex> is that which uses index ip1.
-        // line is <vertex> to p2
-        //    return value is 0 - no crossing; 1,2,3 - which edge of the triangle is cut.
-        if (a_==ip1)
+        unsigned int j = indexOf(t, left);   // edge left->right of t
+        Vertex_index w = vertex(t,prev(j));
+        if (w==b) { c = b; return true; }
+
+        double o = orient2d(pa, pb, point(w));
+        if (o==0.0) { c = w; return true; }
+
+        unsigned int edge;
+        if (o>0.0)
         {
-            // first vertex is the vertex - test that a_ to p2 lies between edges a,b and a,c
-            osg::Vec3 apt=(*points)[a_];
-            osg::Vec3 bpt=(*points)[b_];
-            osg::Vec3 cpt=(*points)[c_];
-            return lineBisectTest(apt,bpt,cpt,p2)?1:0;
+            edge = next(j);    // edge right->w
+            left = w;
         }
-        else if (b_==ip1)
+        else
         {
-            // second vertex is the vertex - test that b_ to p2 lies between edges a,b and a,c
-            osg::Vec3 apt=(*points)[b_];
-            osg::Vec3 bpt=(*points)[c_];
-            osg::Vec3 cpt=(*points)[a_];
-            return lineBisectTest(apt,bpt,cpt,p2)?2:0;
+            edge = prev(j);    // edge w->left
+            right = w;
         }
-        else if (c_==ip1)
+
+        if (isConstrained(t,edge))
         {
-            // 3rd vertex is the vertex - test that c_ to p2 lies between edges a,b and a,c
-            osg::Vec3 apt=(*points)[c_];
-            osg::Vec3 bpt=(*points)[a_];
-            osg::Vec3 cpt=(*points)[b_];
-            return lineBisectTest(apt,bpt,cpt,p2)?3:0;
+            OSG_WARN << "DelaunayTriangulator: constraint edge crosses another constraint" << std::endl;
+            return false;
         }
-        return 0;
+
+        crossing.push_back(VertexPair(right, left));
+        t = neighbour(t,edge);
+        if (t==NO_TRIANGLE) return false;
     }
+}
 
-private:
+bool DelaunayMesh::removeCrossingEdges(Vertex_index a, Vertex_index c, const VertexPairList &crossing)
+{
+    const osg::Vec3 &pa = point(a), &pc = point(c);
 
+    // flip the edges crossing a-c whilst they form convex quadrilaterals, until none cross
+    std::deque<VertexPair> queue(crossing.begin(), crossing.end());
+    VertexPairList newEdges;
+    unsigned int maxAttempts = 16*crossing.size()*crossing.size() + 64;
+    for (unsigned int attempt=0; !queue.empty(); ++attempt)
+    {
+        if (attempt>maxAttempts)
+        {
+            OSG_WARN << "DelaunayTriangulator: unable to recover constraint edge" << std::endl;
+            return false;
+        }
+
+        VertexPair edge = queue.front();
+        queue.pop_front();
+
+        int t;
+        unsigned int i;
+        if (!findEdge(edge.first, edge.second, t, i)) continue;
+
+        int n = neighbour(t,i);
+        Vertex_index u = vertex(t,i), v = vertex(t,next(i)), p = vertex(t,prev(i));
+        Vertex_index q = vertex(n,prev(indexOf(n, v)));
+
+        bool convex = orient2d(point(p), point(q), point(u))*orient2d(point(p), point(q), point(v))<0.0;
+        if (!convex)
+        {
+            queue.push_back(edge);
+            continue;
+        }
 
-    bool intersect(const osg::Vec2 p1,const osg::Vec2 p2,const osg::Vec2 p3,const osg::Vec2 p4) const
+        flipEdge(t, i);
+
+        bool crosses = p!=a && p!=c && q!=a && q!=c &&
+                       orient2d(pa, pc, point(p))*orient2d(pa, pc, point(q))<0.0 &&
+                       orient2d(point(p), point(q), pa)*orient2d(point(p), point(q), pc)<0.0;
+        if (crosses) queue.push_back(VertexPair(p, q));
+        else newEdges.push_back(VertexPair(p, q));
+    }
+
+    int t;
+    unsigned int i;
+    if (!findEdge(a, c, t, i)) return false;
+    constrainEdge(t, i);
+
+    // restore the Delaunay property around the new edges
+    bool flipped = true;
+    for (unsigned int pass=0; flipped && pass<newEdges.size()+1; ++pass)
     {
-        // intersection point of p1,p2 and p3,p4
-        // test from http://astronomy.swin.edu.au/~pbourke/geometry/lineline2d/
-        // the intersection must be internal to the lines, not an end point.
-        float det=((p4.y()-p3.y())*(p2.x()-p1.x())-(p4.x()-p3.x())*(p2.y()-p1.y()));
-        if (det!=0)
+        flipped = false;
+        for (VertexPairList::iterator itr=newEdges.begin(); itr!=newEdges.end(); ++itr)
         {
-            // point on line is P=p1+ua.(p2-p1) and Q=p3+ub.(p4-p3)
-            float ua=((p4.x()-p3.x())*(p1.y()-p3.y())-(p4.y()-p3.y())*(p1.x()-p3.x()))/det;
-            float ub=((p2.x()-p1.x())*(p1.y()-p3.y())-(p2.y()-p1.y())*(p1.x()-p3.x()))/det;
-            if (ua> 0.00 && ua< 1 && ub> 0.0000  && ub< 1)
+            if (!findEdge(itr->first, itr->second, t, i) || isConstrained(t,i)) continue;
+
+            int n = neighbour(t,i);
+            if (n==NO_TRIANGLE) continue;
+
+            Vertex_index u = vertex(t,i), v = vertex(t,next(i)), p = vertex(t,prev(i));
+            Vertex_index q = vertex(n,prev(indexOf(n, v)));
+            if (incircle(point(u), point(v), point(p), point(q))>0.0)
             {
-                return true;
+                flipEdge(t, i);
+                *itr = VertexPair(p, q);
+                flipped = true;
             }
         }
-        return false;
     }
 
-    Vertex_index a_;
-    Vertex_index b_;
-    Vertex_index c_;
-    osg::Vec3 cc_;
-    Edge edge_[3];
-};
-
-typedef std::list<Triangle> Triangle_list;
+    return true;
+}
 
-// comparison function for sorting sample points by the X coordinate
-bool Sample_point_compare(const osg::Vec3 &p1, const osg::Vec3 &p2)
+bool DelaunayMesh::insertConstraint(Vertex_index a, Vertex_index b)
 {
-    // replace pure sort by X coordinate with X then Y.
-    // errors can occur if the delaunay triangulation specifies 2 points at same XY and different Z
-    if (p1.x() != p2.x()) return p1.x() < p2.x();
-    if (p1.y() != p2.y()) return p1.y() < p2.y(); // GWM 30.06.05 - further rule if x coords are same.
-    OSG_INFO << "Two points are coincident at "<<p1.x() <<","<<p1.y() << std::endl;
-    return p1.z() < p2.z(); // never get here unless 2 points coincide
+    while (a!=b)
+    {
+        int t;
+        unsigned int i;
+        if (findEdge(a, b, t, i))
+        {
+            constrainEdge(t, i);
+            return true;
+        }
+
+        // recover the part of a-b up to the first vertex lying on it
+        VertexPairList crossing;
+        Vertex_index c = b;
+        if (!collectCrossingEdges(a, b, crossing, c)) return false;
+
+        if (crossing.empty())
+        {
+            if (!findEdge(a, c, t, i)) return false;
+            constrainEdge(t, i);
+        }
+        else if (!removeCrossingEdges(a, c, crossing))
+        {
+            return false;
+        }
+
+        a = c;
+    }
+    return true;
 }
 
+// index of the point with the same x and y as pt within the first numPoints points sorted with Sample_point_compare, or -1
+int find_sorted_point(const osg::Vec3 &pt, const osg::Vec3Array *points, unsigned int numPoints)
+{
+    unsigned int first = 0, count = numPoints;
+    while (count>0)
+    {
+        unsigned int step = count/2;
+        const osg::Vec3 &v = (*points)[first+step];
+        if (v.x()<pt.x() || (v.x()==pt.x() && v.y()<pt.y()))
+        {
+            first += step+1;
+            count -= step+1;
+        }
+        else count = step;
+    }
 
-// container types
-typedef std::set<Edge, Edge::Less> Edge_set;
+    if (first<numPoints && (*points)[first].x()==pt.x() && (*points)[first].y()==pt.y()) return first;
+    return -1;
+}
 
+}
 
 DelaunayTriangulator::DelaunayTriangulator():
     osg::Referenced()
@@ -385,23 +659,6 @@ DelaunayTriangulator::~DelaunayTriangulator()
 {
 }
 
-const Triangle * getTriangleWithEdge(const unsigned int ip1,const unsigned int ip2, const Triangle_list *triangles)
-{ // find triangle in list with edge from ip1 to ip2...
-    Triangle_list::const_iterator trconnitr; // connecting triangle
-    int idx=0;
-    for (trconnitr=triangles->begin(); trconnitr!=triangles->end(); )
-    {
-        if (trconnitr->isedge (ip1,ip2))
-        {
-            // this is the triangle.
-            return &(*trconnitr);
-        }
-        ++trconnitr;
-        idx++;
-    }
-    return NULL; //-1;
-}
-
 int DelaunayTriangulator::getindex(const osg::Vec3 &pt,const osg::Vec3Array *points)
 {
     // return index of pt in points (or -1)
@@ -415,174 +672,6 @@ int DelaunayTriangulator::getindex(const osg::Vec3 &pt,const osg::Vec3Array *poi
     return -1;
 }
 
-Triangle_list fillHole(osg::Vec3Array *points, const std::vector<int>& vindexlist)
-{
-    // eg clockwise vertex neighbours around the hole made by the constraint
-    Triangle_list triangles; // returned list
-    osg::ref_ptr<osg::Geometry> gtess=new osg::Geometry; // add all the contours to this for analysis
-    osg::ref_ptr<osg::Vec3Array> constraintverts=new osg::Vec3Array;
-    osg::ref_ptr<osgUtil::Tessellator> tscx=new osgUtil::Tessellator; // this assembles all the constraints
-
-    for (std::vector<int>::const_iterator itint=vindexlist.begin(); itint!=vindexlist.end(); itint++)
-    {
-    //    OSG_WARN<< "add point " << (*itint) << " at " << (*points)[*itint].x() << ","<< (*points)[*itint].y() <<std::endl;
-        constraintverts->push_back((*points)[*itint]);
-    }
-
-    unsigned int npts=vindexlist.size();
-
-    gtess->setVertexArray(constraintverts.get());
-    gtess->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::POLYGON,0,npts));
-    tscx->setTessellationNormal(osg::Vec3(0.0,0.0,1.0));
-    tscx->setTessellationType(osgUtil::Tessellator::TESS_TYPE_GEOMETRY);
-    tscx->setBoundaryOnly(false);
-    tscx->setWindingType( osgUtil::Tessellator::TESS_WINDING_ODD); // the commonest tessellation is default, ODD. GE2 allows intersections of constraints to be found.
-    tscx->retessellatePolygons(*(gtess.get())); // this should insert extra vertices where constraints overlap
-
-    // extract triangles from gtess
-
-    unsigned int ipr;
-    for (ipr=0; ipr<gtess->getNumPrimitiveSets(); ipr++)
-    {
-        unsigned int ic;
-        osg::PrimitiveSet* prset=gtess->getPrimitiveSet(ipr);
-        //                    OSG_WARN<< "gtess set " << ipr << " nprims " << prset->getNumPrimitives() <<
-        //                        " type " << prset->getMode() << std::endl;
-        unsigned int pidx,pidx1,pidx2;
-        switch (prset->getMode()) {
-        case osg::PrimitiveSet::TRIANGLES:
-            for (ic=0; ic<prset->getNumIndices()-2; ic+=3)
-            {
-                if (prset->index(ic)>=npts)
-                {
-                    // this is an added point.
-                    points->push_back((*constraintverts)[prset->index(ic)]);
-                    pidx=points->size()-1;
-                }
-                else
-                {
-                    pidx=vindexlist[prset->index(ic)];
-                }
-
-                if (prset->index(ic+1)>=npts)
-                {
-                    // this is an added point.
-                    points->push_back((*constraintverts)[prset->index(ic+1)]);
-                    pidx1=points->size()-1;
-                }
-                else
-                {
-                    pidx1=vindexlist[prset->index(ic+1)];
-                }
-
-                if (prset->index(ic+2)>=npts)
-                {
-                    // this is an added point.
-                    points->push_back((*constraintverts)[prset->index(ic+2)]);
-                    pidx2=points->size()-1;
-                }
-                else
-                {
-                    pidx2=vindexlist[prset->index(ic+2)];
-                }
-                triangles.push_back(Triangle(pidx, pidx1, pidx2, points));
-                //                    OSG_WARN<< "vert " << prset->index(ic) << " in array"<<std::endl;
-            }
-            break;
-        case osg::PrimitiveSet::TRIANGLE_STRIP: // 123, 234, 345...
-
-            for (ic=0; ic<prset->getNumIndices()-2; ic++)
-            {
-                if (prset->index(ic)>=npts)
-                {
-                    // this is an added point.
-                    points->push_back((*constraintverts)[prset->index(ic)]);
-                    pidx=points->size()-1;
-                } else {
-                    pidx=vindexlist[prset->index(ic)];
-                }
-                if (prset->index(ic+1)>=npts)
-                {
-                    // this is an added point.
-                    points->push_back((*constraintverts)[prset->index(ic+1)]);
-                    pidx1=points->size()-1;
-                }
-                else
-                {
-                    pidx1=vindexlist[prset->index(ic+1)];
-                }
-
-                if (prset->index(ic+2)>=npts)
-                {
-                    // this is an added point.
-                    points->push_back((*constraintverts)[prset->index(ic+2)]);
-                    pidx2=points->size()-1;
-                }
-                else
-                {
-                    pidx2=vindexlist[prset->index(ic+2)];
-                }
-
-                if (ic%2==0)
-                {
-                    triangles.push_back(Triangle(pidx, pidx1, pidx2, points));
-                }
-                else
-                {
-                    triangles.push_back(Triangle(pidx1, pidx, pidx2, points));
-                }
-                //                    OSG_WARN<< "vert " << prset->index(ic) << " in array"<<std::endl;
-            }
-            break;
-
-        case osg::PrimitiveSet::TRIANGLE_FAN:
-            {
-                if (prset->index(0)>=npts)
-                {
-                    // this is an added point.
-                    points->push_back((*constraintverts)[prset->index(0)]);
-                    pidx=points->size()-1;
-                }
-                else
-                {
-                    pidx=vindexlist[prset->index(0)];
-                }
-                //        OSG_WARN<< "tfan has " << prset->getNumIndices() << " indices"<<std::endl;
-                for (ic=1; ic<prset->getNumIndices()-1; ic++)
-                {
-                    if (prset->index(ic)>=npts)
-                    {
-                        // this is an added point.
-                        points->push_back((*constraintverts)[prset->index(ic)]);
-                        pidx1=points->size()-1;
-                    }
-                    else
-                    {
-                        pidx1=vindexlist[prset->index(ic)];
-                    }
-
-                    if (prset->index(ic+1)>=npts)
-                    { // this is an added point.
-                        points->push_back((*constraintverts)[prset->index(ic+1)]);
-                        pidx2=points->size()-1;
-                    }
-                    else
-                    {
-                        pidx2=vindexlist[prset->index(ic+1)];
-                    }
-                    triangles.push_back(Triangle(pidx, pidx1, pidx2, points));
-                }
-            }
-            break;
-        default:
-            OSG_WARN<< "WARNING set " << ipr << " nprims " << prset->getNumPrimitives() <<
-                " type " << prset->getMode() << " Type not triangle, tfan or strip"<< std::endl;
-            break;
-        }
-    }
-    return triangles;
-}
-
 template <typename TVector>
 void removeIndices( TVector& elements, unsigned int index )
 {
@@ -760,12 +849,9 @@ bool DelaunayTriangulator::triangulate()
     // Eliminate duplicate lat/lon points from input coordinates.
     _uniqueifyPoints();
 
-
-    // initialize storage structures
-    Triangle_list triangles;
-    Triangle_list discarded_tris;
-
     // GWM July 2005 add constraint vertices to terrain
+    // the unique points are sorted by x then y, so only the constraint vertices added need searching linearly.
+    GLuint num_unique_points = points->size();
     linelist::iterator linitr;
     for (linitr=constraint_lines.begin();linitr!=constraint_lines.end();linitr++)
     {
@@ -773,15 +859,18 @@ bool DelaunayTriangulator::triangulate()
         const osg::Vec3Array* vercon= dynamic_cast<const osg::Vec3Array*>(dc->getVertexArray());
         if (vercon)
         {
-            int nadded=0;
             for (unsigned int icon=0;icon<vercon->size();icon++)
             {
                 osg::Vec3 p1=(*vercon)[icon];
-                int idx=getindex(p1,points_.get());
-                if (idx<0)
+                bool duplicate=find_sorted_point(p1, points, num_unique_points)>=0;
+                for (GLuint iadded=num_unique_points; iadded<points->size() && !duplicate; iadded++)
+                {
+                    duplicate = p1.x()==(*points)[iadded].x() && p1.y()==(*points)[iadded].y();
+                }
+
+                if (!duplicate)
                 { // only unique vertices are permitted.
                     points_->push_back(p1); // add non-unique constraint points to triangulation
-                    nadded++;
                 }
                 else
                 {
@@ -789,7 +878,6 @@ bool DelaunayTriangulator::triangulate()
                 }
             }
         }
-    //    OSG_WARN<< "constraint size "<<vercon->size()<<" " <<nadded<< std::endl;
     }
         // GWM July 2005 end
 
@@ -831,238 +919,86 @@ bool DelaunayTriangulator::triangulate()
     points_->push_back(osg::Vec3(maxx + .10*(maxx - minx), maxy + .10*(maxy - miny), 0));
     points_->push_back(osg::Vec3(minx - .10*(maxx - minx), maxy + .10*(maxy - miny), 0));
 
-    // add supertriangles to triangle list
-    triangles.push_back(Triangle(last_valid_index+1, last_valid_index+2, last_valid_index+3, points));
-    triangles.push_back(Triangle(last_valid_index+4, last_valid_index+1, last_valid_index+3, points));
-
-
-    // begin triangulation
-    GLuint pidx = 0;
-
-    OSG_INFO << "DelaunayTriangulator: triangulating vertex grid (" << (points->size()-3) <<" points)\n";
-
-    for (osg::Vec3Array::const_iterator i=points->begin(); i!=points->end(); ++i, ++pidx)
+    // add supertriangles to the triangulation, sharing the edge from the 3rd to the 1st supervertex
+    DelaunayMesh mesh(points);
+    int st0 = mesh.addTriangle(last_valid_index+1, last_valid_index+2, last_valid_index+3);
+    int st1 = mesh.addTriangle(last_valid_index+4, last_valid_index+1, last_valid_index+3);
+    mesh.setNeighbour(st0, 2, st1);
+    mesh.setNeighbour(st1, 1, st0);
+
+    // insert the points in rounds of doubling size, each round a random sample of the points not yet inserted
+    // ordered along a Hilbert curve, so that each point is found by a short walk from the previous one whilst the
+    // randomness keeps the number of edge flips low.
+    OSG_INFO << "DelaunayTriangulator: ordering points for insertion\n";
+    float scalex = maxx>minx ? 65535.0f/(maxx-minx) : 0.0f;
+    float scaley = maxy>miny ? 65535.0f/(maxy-miny) : 0.0f;
+    const unsigned int max_round = 31;
+
+    std::vector< std::pair<unsigned long long, GLuint> > insertion_order(last_valid_index+1);
+    unsigned int random = 0x2545F491;
+    for (GLuint pidx=0; pidx<=last_valid_index; ++pidx)
     {
-
-        // don't process supertriangle vertices
-        if (pidx > last_valid_index) break;
-
-        Edge_set edges;
-
-        // iterate through triangles
-        Triangle_list::iterator j, next_j;
-        for (j=triangles.begin(); j!=triangles.end(); j = next_j)
+        unsigned int round = 0;
+        while (round<max_round)
         {
+            // xorshift pseudo random numbers keep the triangulation repeatable
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            if ((random & 1)==0) break;
+            ++round;
+        }
 
-            next_j = j;
-            ++next_j;
+        const osg::Vec3 &p = (*points)[pidx];
+        unsigned int hx = static_cast<unsigned int>((p.x()-minx)*scalex);
+        unsigned int hy = static_cast<unsigned int>((p.y()-miny)*scaley);
+        unsigned long long key = (static_cast<unsigned long long>(max_round-round)<<32) | hilbert_index(osg::minimum(hx, 65535u), osg::minimum(hy, 65535u));
+        insertion_order[pidx] = std::make_pair(key, pidx);
+    }
+    std::sort(insertion_order.begin(), insertion_order.end());
 
-            // get the circumcircle (x,y centre & radius)
-            osg::Vec3 cc = j->get_circumcircle();
+    OSG_INFO << "DelaunayTriangulator: triangulating vertex grid (" << (last_valid_index+1) <<" points)\n";
 
-            // OPTIMIZATION: since points are pre-sorted by the X component,
-            // check whether we can discard this triangle for future operations
-            float xdist = i->x() - cc.x();
-            // this is where the circumcircles radius rather than R^2 is faster.
-            // original code used r^2 and needed to test xdist*xdist>cc.z && i->x()>cc.x().
-            if ((xdist ) > cc.z() )
-            {
-                discarded_tris.push_back(*j); // these are not needed for further tests as no more
-                // points will ever lie inside this triangle.
-                triangles.erase(j);
-            }
-            else
-            {
-
-                // if the point lies in the triangle's circumcircle then add
-                // its edges to the edge list and remove the triangle
-                if (point_in_circle(*i, cc))
-                {
-                    for (int ei=0; ei<3; ++ei)
-                    {
-                        std::pair<Edge_set::iterator, bool> result = edges.insert(j->get_edge(ei));
-                        if (!result.second)
-                        {
-                            // cast away constness of a set element, which is
-                            // safe in this case since the set_duplicate is
-                            // not used as part of the Less operator.
-                            Edge& edge = const_cast<Edge&>(*(result.first));
-                            // not clear why this change is needed? But prevents removal of twice referenced edges??
-                      //      edge.set_duplicate(true);
-                            edge.set_duplicate(!edge.get_duplicate());
-                        }
-                    }
-                    triangles.erase(j);
-                }
-            }
-        }
-
-        // remove duplicate edges and add new triangles
-        Edge_set::iterator ci;
-        for (ci=edges.begin(); ci!=edges.end(); ++ci)
+    for (GLuint i=0; i<insertion_order.size(); ++i)
+    {
+        if (!mesh.insertPoint(insertion_order[i].second))
         {
-            if (!ci->get_duplicate())
-            {
-                triangles.push_back(Triangle(pidx, ci->ib(), ci->ie(), points));
-            }
+            const osg::Vec3 &p = (*points)[insertion_order[i].second];
+            OSG_INFO << "DelaunayTriangulator: unable to insert point at " << p.x() << " " << p.y() << std::endl;
         }
     }
-    // dec 2006 we used to remove supertriangle vertices here, but then we can't strictly use the supertriangle
-    // vertices to find intersections of constraints with terrain, so moved to later.
-
-    OSG_INFO << "DelaunayTriangulator: finalizing and cleaning up structures\n";
-
-     // rejoin the two triangle lists
-    triangles.insert(triangles.begin(), discarded_tris.begin(), discarded_tris.end());
 
-        // GWM July 2005 eliminate any triangle with an edge crossing a constraint line
+    // GWM July 2005 force the edges of the constraint lines into the triangulation
     // http://www.geom.uiuc.edu/~samuelp/del_project.html
-    // we could also implement the sourcecode in http://gts.sourceforge.net/reference/gts-delaunay-and-constrained-delaunay-triangulations.html
-    // this uses the set of lines which are boundaries of the constraints, including points
-    // added to the contours by tessellation.
+    // edges crossing a constraint line are flipped until none remain, then the new edges are flipped to restore the
+    // Delaunay property, see Sloan, "A fast algorithm for generating constrained Delaunay triangulations", 1993.
+    OSG_INFO << "DelaunayTriangulator: inserting constraint edges\n";
     for (linelist::iterator dcitr=constraint_lines.begin();dcitr!=constraint_lines.end();dcitr++)
     {
-        //DelaunayConstraint *dc=(*dcitr).get();
         const osg::Vec3Array* vercon = dynamic_cast<const osg::Vec3Array*>((*dcitr)->getVertexArray());
         if (vercon)
         {
             for (unsigned int ipr=0; ipr<(*dcitr)->getNumPrimitiveSets(); ipr++)
             {
                 const osg::PrimitiveSet* prset=(*dcitr)->getPrimitiveSet(ipr);
-                if (prset->getMode()==osg::PrimitiveSet::LINE_LOOP ||
-                    prset->getMode()==osg::PrimitiveSet::LINE_STRIP)
+                if ((prset->getMode()==osg::PrimitiveSet::LINE_LOOP ||
+                     prset->getMode()==osg::PrimitiveSet::LINE_STRIP) && prset->getNumIndices()>0)
                 {
                     // loops or strips
                     // start with the last point on the loop
-                    int ip1=getindex((*vercon)[prset->index (prset->getNumIndices()-1)],points_.get());
-                    for (unsigned int i=0; i<prset->getNumIndices() && ip1>=0; i++)
+                    int ip1=find_sorted_point((*vercon)[prset->index(prset->getNumIndices()-1)], points, last_valid_index+1);
+                    for (unsigned int i=0; i<prset->getNumIndices(); i++)
                     {
-                        int ip2=getindex((*vercon)[prset->index(i)],points_.get());
-                        if (ip2>=0 && (i>0 || prset->getMode()==osg::PrimitiveSet::LINE_LOOP))
+                        int ip2=find_sorted_point((*vercon)[prset->index(i)], points, last_valid_index+1);
+
+                        // don't add the edge from end to start for strips
+                        if (ip1>=0 && ip2>=0 && ip1!=ip2 && (i>0 || prset->getMode()==osg::PrimitiveSet::LINE_LOOP))
                         {
-                            // don't check edge from end to start
-                            // for strips
-                            // 2 points on the constraint
-                            bool edgused=false;// first check for exact edge indices are used.
-                            Triangle_list::iterator titr;
-                            int it=0;
-                            for (titr=triangles.begin(); titr!=triangles.end() && !edgused; ++titr)
-                            {
-                                //check that the edge ip1-ip2 is not already part of the triangulation.
-                                if (titr->isedge(ip1,ip2)) edgused=true;
-                                if (titr->isedge(ip2,ip1)) edgused=true;
-                                //        if (edgused) OSG_WARN << "Edge used in triangle " << it << " " <<
-                                //            titr->a()<<","<< titr->b()<<","<< titr->c()<<  std::endl;
-                                it++;
-                            }
-                            if (!edgused)
+                            if (!mesh.insertConstraint(ip1, ip2))
                             {
-                                // then check for intermediate triangles, erase them and replace with constrained triangles.
-                                // find triangle with point ip1 where the 2 edges from ip1 contain the line p1-p2.
-                                osg::Vec2 p1((*points_)[ip1].x(),(*points_)[ip1].y()); // a constraint line joins p1-p2
-                                osg::Vec2 p2((*points_)[ip2].x(),(*points_)[ip2].y());
-                                int ntr=0;
-                                std::vector<const Triangle *> trisToDelete; // array of triangles to delete from terrain.
-                                // form 2 lists of vertices for the edges of the hole created.
-                                // The hole joins vertex ip1 to ip2, and one list of edges lies to the left
-                                // of the line ip1-ip2m the other to the right.
-                                // a list of vertices forming 2 halves of the removed triangles.
-                                // which in turn are filled in with the tessellator.
-                                for (titr=triangles.begin(); titr!=triangles.end(); )
-                                {
-                                    int icut=titr->lineBisects(points_.get(),ip1,p2);
-                                    //    OSG_WARN << "Testing triangle " << ntr << " "<< ip1 << " ti " <<
-                                    //        titr->a()<< ","<<titr->b() <<"," <<titr->c() << std::endl;
-                                    if (icut>0)
-                                    {
-                                        // triangle titr starts the constraint edge
-                                        std::vector<int> edgeRight, edgeLeft;
-                                        edgeRight.push_back(ip1);
-                                        edgeLeft.push_back(ip1);
-                                        //        OSG_WARN << "hole first " << edgeLeft.back()<<  " rt " << edgeRight.back()<< std::endl;
-                                        trisToDelete.push_back(&(*titr));
-                                        // now find the unique triangle that shares the defined edge
-                                        int e1, e2; // indices of ends of test triangle titr
-                                        if    (icut==1)
-                                        {
-                                            // icut=1 implies vertex a is not involved
-                                            e1=titr->b(); e2=titr->c();
-                                        }
-                                        else if (icut==2)
-                                        {
-                                            e1=titr->c(); e2=titr->a();
-                                        }
-                                        else
-                                        {
-                                            e1=titr->a(); e2=titr->b();
-                                        }
-                                        edgeRight.push_back(e2);
-                                        edgeLeft.push_back(e1);
-                                        //        OSG_WARN << icut << "hole edges " << edgeLeft.back()<<  " rt " << edgeRight.back()<< std::endl;
-                                        const Triangle *tradj=getTriangleWithEdge(e2,e1, &triangles);
-                                        if (tradj)
-                                        {
-                                            while (tradj && !tradj->usesVertex(ip2) && trisToDelete.size()<999)
-                                            {
-                                                trisToDelete.push_back(tradj);
-                                                icut=tradj->whichEdge(points_.get(),p1,p2,e1,e2);
-                                                //    OSG_WARN  << ntr << " cur triedge " << icut << " " << ip1 <<
-                                                //        " to " << ip2 << " tadj " << tradj->a()<< ","<<tradj->b() <<","
-                                                //        <<tradj->c() <<std::endl;
-                                                if        (icut==1) {e1=tradj->b(); e2=tradj->c();} // icut=1 implies vertex a is not involved
-                                                else if (icut==2) {e1=tradj->c(); e2=tradj->a();}
-                                                else if (icut==3) {e1=tradj->a(); e2=tradj->b();}
-                                                if (edgeLeft.back()!=e1 && edgeRight.back()==e2 && e1!=ip2) {
-                                                    edgeLeft.push_back(e1);
-                                                } else if(edgeRight.back()!=e2 && edgeLeft.back()==e1 && e2!=ip2) {
-                                                    edgeRight.push_back(e2);
-                                                } else {
-                                                    if (!tradj->usesVertex(ip2)) OSG_WARN << "tradj error " << tradj->a()<<  " , " << tradj->b()<<  " , " << tradj->c()<< std::endl;
-                                                }
-                                                const Triangle *previousTradj = tradj;
-                                                tradj=getTriangleWithEdge(e2,e1, &triangles);
-                                                if (tradj == previousTradj) {
-                                                    tradj = 0;
-                                                }
-                                            }
-                                            if (trisToDelete.size()>=900) {
-                                                OSG_WARN << " found " << trisToDelete.size() << " adjacent tris " <<std::endl;
-                                            }
-                                        }
-
-                                        // both lines end at ip2 point.
-                                        edgeLeft.push_back(ip2);
-                                        edgeRight.push_back(ip2);
-                                        if (tradj) trisToDelete.push_back(tradj);
-                                        //        OSG_WARN << icut << "hole last " << edgeLeft.back()<<  " rt " << edgeRight.back()<< std::endl;
-                                        Triangle_list constrainedtris=fillHole(points_.get(),edgeLeft);
-                                        triangles.insert(triangles.begin(), constrainedtris.begin(), constrainedtris.end());
-                                        constrainedtris=fillHole(points_.get(),edgeRight);
-                                        triangles.insert(triangles.begin(), constrainedtris.begin(), constrainedtris.end());
-
-                                    }
-                                    ++titr;
-                                    ntr++;
-                                }
-                                // remove the triangles list
-                                Triangle_list::iterator tri; // counts through triangles
-                                for (tri=triangles.begin(); tri!=triangles.end(); )
-                                {
-                                    bool deleted=false;
-                                    for (std::vector<const Triangle *>::iterator deleteTri=trisToDelete.begin();
-                                    deleteTri!=trisToDelete.end(); )
-                                    {
-                                        if (&(*tri)==*deleteTri)
-                                        {
-                                            deleted=true;
-                                            tri=triangles.erase(tri);
-                                            deleteTri=trisToDelete.erase(deleteTri); // 24.12.06 remove from delete list.
-                                        } else {deleteTri++; }
-                                    }
-                                    if (!deleted) ++tri;
-                                }
+                                OSG_INFO << "DelaunayTriangulator: constraint edge " << ip1 << " to " << ip2 << " not inserted" << std::endl;
                             }
-                        } // strip test
+                        }
 
                         ip1=ip2; // next edge of line
                     }
@@ -1071,61 +1007,35 @@ bool DelaunayTriangulator::triangulate()
         }
     }
     // GWM Sept 2005 end
-    // dec 2006 remove supertriangle vertices - IF we have added some internal vertices (see fillholes)
-    // then these may not be the last vertices in the list.
-//    } else { // remove 3 super-triangle vertices more completely, moving any reference indices down.
-    Triangle_list::iterator tri;
-    GLuint supertriend = last_valid_index+4;
-    for (tri=triangles.begin(); tri!=triangles.end();)
-    { // look for triangles using the supertriangle indices or >super indices and move down by 3.
-        if ((tri->a() > last_valid_index && tri->a() <= supertriend) ||
-            (tri->b() > last_valid_index && tri->b() <= supertriend ) ||
-            (tri->c() > last_valid_index && tri->c() <= supertriend )) {
-            tri=triangles.erase(tri);
-        } else { // move down by 3 tests
-            if (tri->a() > last_valid_index) { // move index down 4
-                tri->incrementa(-4);
-            }
-            if (tri->b() > last_valid_index) { // move down 4
-                tri->incrementb(-4);
-            }
-            if (tri->c() > last_valid_index) { // move down 4 -- correction 21.12.06- was b() should test index c()
-                tri->incrementc(-4);
-            }
-            ++tri; // only increment tri here as the other path increments tri when tri=triangles.erase.
-        }
-    }
-        // remove 3 supertriangle vertices from points. They may not be the last vertices in points if
-        // extra points have been inserted by the constraint re-triangulation.
+
+    // remove 4 supertriangle vertices from points.
     points->erase(points->begin()+last_valid_index+1,points->begin()+last_valid_index+5);
-    //last_valid_index = points->size()-1; // the last valid vertex is last point.
-    // end of dec 2006 changes.
 
     // initialize index storage vector
     std::vector<GLuint> pt_indices;
-    pt_indices.reserve(triangles.size() * 3);
+    pt_indices.reserve(mesh.getNumTriangles() * 3);
 
     // build osg primitive
     OSG_INFO << "DelaunayTriangulator: building primitive(s)\n";
-    Triangle_list::const_iterator ti;
-    for (ti=triangles.begin(); ti!=triangles.end(); ++ti)
+    for (unsigned int ti=0; ti<mesh.getNumTriangles(); ++ti)
     {
+        const Vertex_index *tri = mesh.getTriangle(ti);
 
-        // don't add this triangle to the primitive if it shares any vertex with
-        // the supertriangle triangles have already been removed.
-        // Don't need this test: ti->a() <= last_valid_index && ti->b() <= last_valid_index && ti->c() <= last_valid_index &&
-          // Don't add degenerate (zero radius) triangles
-        if ( ti->get_circumcircle().z()>0.0)
-        {
+        // don't add triangles that share any vertex with the supertriangle
+        if (tri[0]>last_valid_index || tri[1]>last_valid_index || tri[2]>last_valid_index) continue;
 
+        // Don't add degenerate (zero area) triangles
+        if (orient2d((*points)[tri[0]], (*points)[tri[1]], (*points)[tri[2]])>0.0)
+        {
             if (normals_.valid())
             {
-                (normals_.get())->push_back(ti->compute_normal(points));
+                osg::Vec3 N = ((*points)[tri[1]] - (*points)[tri[0]]) ^ ((*points)[tri[2]] - (*points)[tri[0]]);
+                (normals_.get())->push_back(N / N.length());
             }
 
-            pt_indices.push_back(ti->a());
-            pt_indices.push_back(ti->b());
-            pt_indices.push_back(ti->c());
+            pt_indices.push_back(tri[0]);
+            pt_indices.push_back(tri[1]);
+            pt_indices.push_back(tri[2]);
         }
     }
 
@@ -1159,7 +1069,7 @@ void DelaunayTriangulator::removeInternalTriangles(DelaunayConstraint *dc )
         for (osg::DrawElementsUInt::iterator triit=prim_tris_->begin(); triit!=prim_tris_->end(); )
         {
             // triangle joins points_[itr, itr+1, itr+2]
-            Triangle tritest((*triit), *(triit+1), *(triit+2), points_.get());
+            Triangle tritest((*triit), *(triit+1), *(triit+2));
             if ( dc->contains(tritest.compute_centroid( points_.get()) ) )
             {
                 // centroid is inside the triangle, so IF inside linear, remove
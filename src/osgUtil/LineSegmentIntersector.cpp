@@ -402,6 +402,87 @@ struct IntersectFunctor
     }
 };
 
+// Shares a single KdTree traversal between the segments of a LineSegmentPacketIntersector, tracking
+// which of the segments are still active in the current subtree with a bit mask per level.
+template<typename Vec3, typename value_type>
+struct PacketIntersectFunctor
+{
+    typedef IntersectFunctor<Vec3, value_type> SegmentFunctor;
+
+    SegmentFunctor              _segments[osgUtil::LineSegmentPacketIntersector::MAXIMUM_PACKET_SIZE];
+    Settings                    _settings[osgUtil::LineSegmentPacketIntersector::MAXIMUM_PACKET_SIZE];
+    unsigned int                _numSegments;
+    std::vector<unsigned int>   _activeMaskStack;
+
+    PacketIntersectFunctor():
+        _numSegments(0)
+    {
+        _activeMaskStack.reserve(64);
+        _activeMaskStack.push_back(0);
+    }
+
+    void add(const osg::Vec3d& s, const osg::Vec3d& e, const Settings& settings)
+    {
+        unsigned int i = _numSegments++;
+        _settings[i] = settings;
+        _segments[i].set(s, e, &_settings[i]);
+        _activeMaskStack.back() |= (1u<<i);
+    }
+
+    bool enter(const osg::BoundingBox& bb)
+    {
+        unsigned int active = _activeMaskStack.back();
+        unsigned int entered = 0;
+        for(unsigned int i=0; i<_numSegments; ++i)
+        {
+            if ((active & (1u<<i)) && _segments[i].enter(bb)) entered |= (1u<<i);
+        }
+
+        // whole packet misses the node, so the subtree can be skipped.
+        if (entered==0) return false;
+
+        _activeMaskStack.push_back(entered);
+        return true;
+    }
+
+    void leave()
+    {
+        unsigned int entered = _activeMaskStack.back();
+        _activeMaskStack.pop_back();
+
+        for(unsigned int i=0; i<_numSegments; ++i)
+        {
+            if (entered & (1u<<i)) _segments[i].leave();
+        }
+    }
+
+    void intersect(const osg::Vec3Array*, int , unsigned int)
+    {
+    }
+
+    void intersect(const osg::Vec3Array*, int, unsigned int, unsigned int)
+    {
+    }
+
+    void intersect(const osg::Vec3Array* vertices, int primitiveIndex, unsigned int p0, unsigned int p1, unsigned int p2)
+    {
+        unsigned int active = _activeMaskStack.back();
+        for(unsigned int i=0; i<_numSegments; ++i)
+        {
+            if (active & (1u<<i)) _segments[i].intersect(vertices, primitiveIndex, p0, p1, p2);
+        }
+    }
+
+    void intersect(const osg::Vec3Array* vertices, int primitiveIndex, unsigned int p0, unsigned int p1, unsigned int p2, unsigned int p3)
+    {
+        unsigned int active = _activeMaskStack.back();
+        for(unsigned int i=0; i<_numSegments; ++i)
+        {
+            if (active & (1u<<i)) _segments[i].intersect(vertices, primitiveIndex, p0, p1, p2, p3);
+        }
+    }
+};
+
 } // namespace LineSegmentIntersectorUtils
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -537,7 +618,7 @@ void LineSegmentIntersector::intersect(osgUtil::IntersectionVisitor& iv, osg::Dr
         osg::TemplatePrimitiveFunctor<LineSegmentIntersectorUtils::IntersectFunctor<osg::Vec3d, double> > intersector;
         intersector.set(s,e, &settings);
 
-        if (kdTree) kdTree->intersect(intersector, kdTree->getNode(0));
+        if (kdTree) kdTree->intersect(intersector);
         else drawable->accept(intersector);
     }
     else
@@ -545,7 +626,7 @@ void LineSegmentIntersector::intersect(osgUtil::IntersectionVisitor& iv, osg::Dr
         osg::TemplatePrimitiveFunctor<LineSegmentIntersectorUtils::IntersectFunctor<osg::Vec3f, float> > intersector;
         intersector.set(s,e, &settings);
 
-        if (kdTree) kdTree->intersect(intersector, kdTree->getNode(0));
+        if (kdTree) kdTree->intersect(intersector);
         else drawable->accept(intersector);
     }
 }
@@ -838,3 +919,191 @@ osg::Texture* LineSegmentIntersector::Intersection::getTextureLookUp(osg::Vec3&
     }
     return 0;
 }
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  LineSegmentPacketIntersector
+//
+
+LineSegmentPacketIntersector::LineSegmentPacketIntersector()
+{
+}
+
+bool LineSegmentPacketIntersector::addIntersector(LineSegmentIntersector* intersector)
+{
+    if (_intersectors.size()>=MAXIMUM_PACKET_SIZE) return false;
+
+    _intersectors.push_back(intersector);
+    _segmentsBound.expandBy(intersector->getStart());
+    _segmentsBound.expandBy(intersector->getEnd());
+    return true;
+}
+
+void LineSegmentPacketIntersector::clear()
+{
+    _intersectors.clear();
+    _segmentsBound.init();
+}
+
+Intersector* LineSegmentPacketIntersector::clone(osgUtil::IntersectionVisitor& iv)
+{
+    osg::ref_ptr<LineSegmentPacketIntersector> packet = new LineSegmentPacketIntersector;
+    packet->_intersectionLimit = this->_intersectionLimit;
+    packet->setPrecisionHint(getPrecisionHint());
+
+    // now copy across all intersectors that aren't disabled.
+    for(Intersectors::iterator itr = _intersectors.begin();
+        itr != _intersectors.end();
+        ++itr)
+    {
+        if (!(*itr)->disabled())
+        {
+            osg::ref_ptr<Intersector> lsi = (*itr)->clone(iv);
+            packet->addIntersector(static_cast<LineSegmentIntersector*>(lsi.get()));
+        }
+    }
+
+    return packet.release();
+}
+
+bool LineSegmentPacketIntersector::enter(const osg::Node& node)
+{
+    if (disabled()) return false;
+
+    if (node.isCullingActive())
+    {
+        // cull the whole packet when the bounding sphere misses the bounding box of all the segments.
+        const osg::BoundingSphere& bs = node.getBound();
+        if (bs.valid())
+        {
+            const osg::Vec3d& c = bs.center();
+            osg::Vec3d nearest(osg::clampBetween(c.x(), _segmentsBound.xMin(), _segmentsBound.xMax()),
+                               osg::clampBetween(c.y(), _segmentsBound.yMin(), _segmentsBound.yMax()),
+                               osg::clampBetween(c.z(), _segmentsBound.zMin(), _segmentsBound.zMax()));
+            double r = bs.radius();
+            if ((nearest-c).length2()>r*r) return false;
+        }
+    }
+
+    bool foundIntersections = false;
+
+    for(Intersectors::iterator itr = _intersectors.begin();
+        itr != _intersectors.end();
+        ++itr)
+    {
+        if ((*itr)->disabled()) (*itr)->incrementDisabledCount();
+        else if ((*itr)->enter(node)) foundIntersections = true;
+        else (*itr)->incrementDisabledCount();
+    }
+
+    if (!foundIntersections)
+    {
+        // need to call leave to clean up the DisabledCount's.
+        leave();
+        return false;
+    }
+
+    return true;
+}
+
+void LineSegmentPacketIntersector::leave()
+{
+    for(Intersectors::iterator itr = _intersectors.begin();
+        itr != _intersectors.end();
+        ++itr)
+    {
+        if ((*itr)->disabled()) (*itr)->decrementDisabledCount();
+    }
+}
+
+void LineSegmentPacketIntersector::intersect(osgUtil::IntersectionVisitor& iv, osg::Drawable* drawable)
+{
+    if (disabled()) return;
+
+    osg::KdTree* kdTree = iv.getUseKdTreeWhenAvailable() ? dynamic_cast<osg::KdTree*>(drawable->getShape()) : 0;
+    if (!kdTree)
+    {
+        // no shared acceleration structure to traverse so fall back to intersecting each segment in turn.
+        for(Intersectors::iterator itr = _intersectors.begin();
+            itr != _intersectors.end();
+            ++itr)
+        {
+            if (!(*itr)->disabled()) (*itr)->intersect(iv, drawable);
+        }
+        return;
+    }
+
+    LineSegmentIntersectorUtils::Settings settings;
+    settings._iv = &iv;
+    settings._drawable = drawable;
+
+    osg::Geometry* geometry = drawable->asGeometry();
+    if (geometry)
+    {
+        settings._vertices = dynamic_cast<osg::Vec3Array*>(geometry->getVertexArray());
+    }
+
+    if (getPrecisionHint()==USE_DOUBLE_CALCULATIONS)
+    {
+        LineSegmentIntersectorUtils::PacketIntersectFunctor<osg::Vec3d, double> intersector;
+        for(Intersectors::iterator itr = _intersectors.begin();
+            itr != _intersectors.end();
+            ++itr)
+        {
+            LineSegmentIntersector* lsi = itr->get();
+            if (lsi->disabled() || lsi->reachedLimit()) continue;
+
+            osg::Vec3d s(lsi->getStart()), e(lsi->getEnd());
+            if ( drawable->isCullingActive() && !lsi->intersectAndClip( s, e, drawable->getBoundingBox() ) ) continue;
+
+            settings._lineSegIntersector = lsi;
+            settings._limitOneIntersection = (lsi->getIntersectionLimit() == LIMIT_ONE_PER_DRAWABLE || lsi->getIntersectionLimit() == LIMIT_ONE);
+            intersector.add(s, e, settings);
+        }
+
+        if (intersector._numSegments>0 && !iv.getDoDummyTraversal()) kdTree->intersect(intersector);
+    }
+    else
+    {
+        LineSegmentIntersectorUtils::PacketIntersectFunctor<osg::Vec3f, float> intersector;
+        for(Intersectors::iterator itr = _intersectors.begin();
+            itr != _intersectors.end();
+            ++itr)
+        {
+            LineSegmentIntersector* lsi = itr->get();
+            if (lsi->disabled() || lsi->reachedLimit()) continue;
+
+            osg::Vec3d s(lsi->getStart()), e(lsi->getEnd());
+            if ( drawable->isCullingActive() && !lsi->intersectAndClip( s, e, drawable->getBoundingBox() ) ) continue;
+
+            settings._lineSegIntersector = lsi;
+            settings._limitOneIntersection = (lsi->getIntersectionLimit() == LIMIT_ONE_PER_DRAWABLE || lsi->getIntersectionLimit() == LIMIT_ONE);
+            intersector.add(s, e, settings);
+        }
+
+        if (intersector._numSegments>0 && !iv.getDoDummyTraversal()) kdTree->intersect(intersector);
+    }
+}
+
+void LineSegmentPacketIntersector::reset()
+{
+    Intersector::reset();
+
+    for(Intersectors::iterator itr = _intersectors.begin();
+        itr != _intersectors.end();
+        ++itr)
+    {
+        (*itr)->reset();
+    }
+}
+
+bool LineSegmentPacketIntersector::containsIntersections()
+{
+    for(Intersectors::iterator itr = _intersectors.begin();
+        itr != _intersectors.end();
+        ++itr)
+    {
+        if ((*itr)->containsIntersections()) return true;
+    }
+    return false;
+}
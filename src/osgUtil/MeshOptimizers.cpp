@@ -16,13 +16,16 @@
 #include <limits>
 
 #include <algorithm>
+#include <map>
 #include <vector>
 
 #include <iostream>
 
 #include <osg/Geometry>
 #include <osg/Math>
+#include <osg/Notify>
 #include <osg/PrimitiveSet>
+#include <osg/TexMat>
 #include <osg/TriangleIndexFunctor>
 #include <osg/TriangleLinePointIndexFunctor>
 
@@ -43,6 +46,85 @@ void GeometryCollector::apply(Geometry& geom)
     _geometryList.insert(&geom);
 }
 
+namespace
+{
+struct ProcessGeometriesOperation : public Optimizer::TaskOperation
+{
+    typedef std::vector<Geometry*> Geometries;
+
+    ProcessGeometriesOperation(GeometryCollector::GeometryOperator& op,
+                               const Geometries& geometries,
+                               const Optimizer::TaskPartitioner::Tasks& tasks)
+        : _op(op), _geometries(geometries), _tasks(tasks)
+    {
+    }
+
+    virtual void operator()(unsigned int taskIndex)
+    {
+        const Optimizer::TaskPartitioner::Items& items = _tasks[taskIndex];
+        for (Optimizer::TaskPartitioner::Items::const_iterator itr = items.begin(), end = items.end();
+             itr != end;
+             ++itr)
+        {
+            _op(*_geometries[*itr]);
+        }
+    }
+
+    GeometryCollector::GeometryOperator& _op;
+    const Geometries& _geometries;
+    const Optimizer::TaskPartitioner::Tasks& _tasks;
+};
+
+// Adapts a GeometryCollector subclass method to a GeometryOperator.
+template<class T>
+struct GeometryMethodOperator : public GeometryCollector::GeometryOperator
+{
+    typedef void (T::*Method)(Geometry&);
+
+    GeometryMethodOperator(T& object, Method method)
+        : _object(object), _method(method)
+    {
+    }
+
+    virtual void operator()(Geometry& geom) { (_object.*_method)(geom); }
+
+    T& _object;
+    Method _method;
+};
+}
+
+void GeometryCollector::processGeometries(GeometryOperator& op)
+{
+    if (!_optimizer || _optimizer->getNumThreads() == 1)
+    {
+        for (GeometryList::iterator itr = _geometryList.begin(), end = _geometryList.end();
+             itr != end;
+             ++itr)
+        {
+            op(*(*itr));
+        }
+        return;
+    }
+
+    ProcessGeometriesOperation::Geometries geometries(_geometryList.begin(), _geometryList.end());
+
+    Optimizer::TaskPartitioner partitioner;
+    for (unsigned int i = 0; i < geometries.size(); ++i)
+    {
+        partitioner.addGeometry(i, geometries[i]);
+
+        // dirty the bound up front so that the parents, which may be
+        // shared between threads, aren't modified while processing.
+        geometries[i]->dirtyBound();
+    }
+
+    Optimizer::TaskPartitioner::Tasks tasks;
+    partitioner.getTasks(static_cast<unsigned int>(geometries.size()), tasks);
+
+    ProcessGeometriesOperation operation(op, geometries, tasks);
+    _optimizer->runTasks(operation, static_cast<unsigned int>(tasks.size()));
+}
+
 namespace
 {
 typedef std::vector<unsigned int> IndexList;
@@ -401,12 +483,8 @@ void IndexMeshVisitor::makeMesh(Geometry& geom)
 
 void IndexMeshVisitor::makeMesh()
 {
-    for(GeometryList::iterator itr=_geometryList.begin();
-        itr!=_geometryList.end();
-        ++itr)
-    {
-        makeMesh(*(*itr));
-    }
+    GeometryMethodOperator<IndexMeshVisitor> op(*this, &IndexMeshVisitor::makeMesh);
+    processGeometries(op);
 }
 
 namespace
@@ -878,12 +956,8 @@ void VertexCacheVisitor::doVertexOptimization(Geometry& geom,
 
 void VertexCacheVisitor::optimizeVertices()
 {
-    for(GeometryList::iterator itr=_geometryList.begin();
-        itr!=_geometryList.end();
-        ++itr)
-    {
-        optimizeVertices(*(*itr));
-    }
+    GeometryMethodOperator<VertexCacheVisitor> op(*this, &VertexCacheVisitor::optimizeVertices);
+    processGeometries(op);
 }
 
 VertexCacheMissVisitor::VertexCacheMissVisitor(unsigned cacheSize)
@@ -1107,12 +1181,8 @@ struct VertexReorder : public TriangleLinePointIndexFunctor<osgUtil::VertexReord
 
 void VertexAccessOrderVisitor::optimizeOrder()
 {
-    for (GeometryList::iterator itr = _geometryList.begin(), end = _geometryList.end();
-         itr != end;
-         ++itr)
-    {
-        optimizeOrder(*(*itr));
-    }
+    GeometryMethodOperator<VertexAccessOrderVisitor> op(*this, &VertexAccessOrderVisitor::optimizeOrder);
+    processGeometries(op);
 }
 
 template<typename DE>
@@ -1191,6 +1261,455 @@ void VertexAccessOrderVisitor::optimizeOrder(Geometry& geom)
     geom.dirtyGLObjects();
 }
 
+namespace
+{
+// Simulation of a FIFO post-transform cache using per vertex timestamps,
+// a vertex is in the cache if it was added within the last cacheSize
+// misses. Flushing the cache just advances the timestamp past all the
+// entries.
+struct TimestampCache
+{
+    TimestampCache(unsigned numVertices, unsigned cacheSize_)
+        : timestamps(numVertices, 0), cacheSize(cacheSize_), timestamp(cacheSize_ + 1)
+    {
+    }
+
+    unsigned addTriangle(const unsigned* tri)
+    {
+        unsigned misses = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            if (timestamp - timestamps[tri[i]] > cacheSize)
+            {
+                timestamps[tri[i]] = timestamp++;
+                ++misses;
+            }
+        }
+        return misses;
+    }
+
+    void flush()
+    {
+        timestamp += cacheSize + 1;
+    }
+
+    std::vector<unsigned> timestamps;
+    unsigned cacheSize;
+    unsigned timestamp;
+};
+
+struct OverdrawCluster
+{
+    unsigned start;
+    unsigned end;
+    float sortKey;
+
+    bool operator<(const OverdrawCluster& rhs) const { return sortKey > rhs.sortKey; }
+};
+
+// Split a cache optimized triangle list into clusters and sort them so
+// that the clusters facing away from the centre of the mesh, which are
+// the most likely to occlude others, are drawn first.
+void computeOverdrawOrder(const std::vector<unsigned>& indices, const Vec3Array& positions,
+                          unsigned cacheSize, float threshold,
+                          std::vector<unsigned>& result)
+{
+    unsigned numTriangles = indices.size() / 3;
+    TimestampCache cache(positions.size(), cacheSize);
+
+    // A triangle with all three vertices missing the cache usually starts
+    // a new, disjoint patch of the mesh.
+    std::vector<unsigned> hardBoundaries;
+    for (unsigned i = 0; i < numTriangles; ++i)
+    {
+        unsigned misses = cache.addTriangle(&indices[i * 3]);
+        if (i == 0 || misses == 3)
+            hardBoundaries.push_back(i);
+    }
+
+    // Split the patches further wherever the running cache miss ratio is
+    // within threshold of the ratio of the whole patch.
+    std::vector<unsigned> boundaries;
+    for (unsigned h = 0; h < hardBoundaries.size(); ++h)
+    {
+        unsigned start = hardBoundaries[h];
+        unsigned end = h + 1 < hardBoundaries.size() ? hardBoundaries[h + 1] : numTriangles;
+
+        cache.flush();
+        unsigned patchMisses = 0;
+        for (unsigned i = start; i < end; ++i)
+            patchMisses += cache.addTriangle(&indices[i * 3]);
+
+        float patchThreshold = threshold * (float(patchMisses) / float(end - start));
+
+        boundaries.push_back(start);
+
+        cache.flush();
+        unsigned runningMisses = 0;
+        unsigned runningTriangles = 0;
+        for (unsigned i = start; i < end; ++i)
+        {
+            runningMisses += cache.addTriangle(&indices[i * 3]);
+            runningTriangles += 1;
+            if (float(runningMisses) / float(runningTriangles) <= patchThreshold)
+            {
+                boundaries.push_back(i + 1);
+                cache.flush();
+                runningMisses = 0;
+                runningTriangles = 0;
+            }
+        }
+
+        // The last cluster of a patch is usually a poor one, so merge it
+        // with the previous cluster. This also removes the empty cluster
+        // left when the final triangle closed a cluster.
+        if (boundaries.back() != start)
+            boundaries.pop_back();
+    }
+
+    Vec3 meshCentroid;
+    for (std::vector<unsigned>::const_iterator itr = indices.begin(), end = indices.end();
+         itr != end;
+         ++itr)
+        meshCentroid += positions[*itr];
+    if (!indices.empty())
+        meshCentroid /= float(indices.size());
+
+    std::vector<OverdrawCluster> clusters(boundaries.size());
+    for (unsigned c = 0; c < boundaries.size(); ++c)
+    {
+        OverdrawCluster& cluster = clusters[c];
+        cluster.start = boundaries[c];
+        cluster.end = c + 1 < boundaries.size() ? boundaries[c + 1] : numTriangles;
+
+        float clusterArea = 0.0f;
+        Vec3 clusterCentroid;
+        Vec3 clusterNormal;
+        for (unsigned i = cluster.start; i < cluster.end; ++i)
+        {
+            const Vec3& p0 = positions[indices[i * 3 + 0]];
+            const Vec3& p1 = positions[indices[i * 3 + 1]];
+            const Vec3& p2 = positions[indices[i * 3 + 2]];
+
+            Vec3 normal = (p1 - p0) ^ (p2 - p0);
+            float area = normal.length();
+
+            clusterCentroid += (p0 + p1 + p2) * (area / 3.0f);
+            clusterNormal += normal;
+            clusterArea += area;
+        }
+
+        if (clusterArea > 0.0f)
+            clusterCentroid /= clusterArea;
+        clusterNormal.normalize();
+
+        cluster.sortKey = (clusterCentroid - meshCentroid) * clusterNormal;
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end());
+
+    result.clear();
+    result.reserve(indices.size());
+    for (std::vector<OverdrawCluster>::iterator itr = clusters.begin(), end = clusters.end();
+         itr != end;
+         ++itr)
+    {
+        result.insert(result.end(), indices.begin() + itr->start * 3, indices.begin() + itr->end * 3);
+    }
+}
+
+struct TriangleCollectOperator
+{
+    std::vector<unsigned>* triangleIndices;
+
+    TriangleCollectOperator() : triangleIndices(0) {}
+
+    void operator()(unsigned p1, unsigned p2, unsigned p3)
+    {
+        // degenerate triangles don't contribute to the rendering
+        if (p1 == p2 || p2 == p3 || p1 == p3)
+            return;
+        triangleIndices->push_back(p1);
+        triangleIndices->push_back(p2);
+        triangleIndices->push_back(p3);
+    }
+};
+typedef TriangleIndexFunctor<TriangleCollectOperator> TriangleCollector;
+
+inline short quantizeSigned(float value)
+{
+    return static_cast<short>(osg::round(osg::clampBetween(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+inline short quantizeRange(float value, float minimum, float range)
+{
+    return static_cast<short>(osg::round((value - minimum) / range * 65535.0f) - 32768.0f);
+}
+
+bool hasTexMat(const StateSet* stateset)
+{
+    if (!stateset)
+        return false;
+    const StateSet::TextureAttributeList& tal = stateset->getTextureAttributeList();
+    for (unsigned unit = 0; unit < tal.size(); ++unit)
+    {
+        if (stateset->getTextureAttribute(unit, StateAttribute::TEXMAT))
+            return true;
+    }
+    return false;
+}
+}
+
+void VertexOverdrawVisitor::reset()
+{
+    GeometryCollector::reset();
+    _texMatGeometries.clear();
+    _statisticsBefore = Statistics();
+    _statisticsAfter = Statistics();
+}
+
+void VertexOverdrawVisitor::apply(Node& node)
+{
+    bool texMat = hasTexMat(node.getStateSet());
+    if (texMat)
+        ++_texMatDepth;
+    traverse(node);
+    if (texMat)
+        --_texMatDepth;
+}
+
+void VertexOverdrawVisitor::apply(Geometry& geom)
+{
+    GeometryCollector::apply(geom);
+    if (_texMatDepth > 0 || hasTexMat(geom.getStateSet()))
+        _texMatGeometries.insert(&geom);
+}
+
+void VertexOverdrawVisitor::optimize()
+{
+    GeometryMethodOperator<VertexOverdrawVisitor> op(*this, &VertexOverdrawVisitor::optimize);
+    processGeometries(op);
+
+    // Replacing the StateSet of a geometry modifies the parent list of a
+    // StateSet that might be shared, so the texture coordinates are done
+    // single threaded.
+    if (_quantizationMask & QUANTIZE_TEXCOORDS)
+    {
+        for (GeometryList::iterator itr = _geometryList.begin(), end = _geometryList.end();
+             itr != end;
+             ++itr)
+        {
+            if (_texMatGeometries.count(*itr) == 0)
+                quantizeTexCoords(*(*itr));
+        }
+    }
+
+    OSG_INFO << "VertexOverdrawVisitor::optimize() ACMR "
+             << _statisticsBefore.getACMR() << " -> " << _statisticsAfter.getACMR()
+             << ", ATVR " << _statisticsBefore.getATVR() << " -> " << _statisticsAfter.getATVR()
+             << std::endl;
+}
+
+void VertexOverdrawVisitor::optimize(Geometry& geom)
+{
+    Statistics before;
+    computeStatistics(geom, before);
+
+    IndexMeshVisitor imv;
+    imv.makeMesh(geom);
+
+    VertexCacheVisitor vcv;
+    vcv.optimizeVertices(geom);
+
+    reorderForOverdraw(geom);
+
+    VertexAccessOrderVisitor vaov;
+    vaov.optimizeOrder(geom);
+
+    if (_quantizationMask & QUANTIZE_NORMALS)
+        quantizeNormals(geom);
+
+    Statistics after;
+    computeStatistics(geom, after);
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_statisticsMutex);
+    _statisticsBefore.vertices += before.vertices;
+    _statisticsBefore.triangles += before.triangles;
+    _statisticsBefore.misses += before.misses;
+    _statisticsAfter.vertices += after.vertices;
+    _statisticsAfter.triangles += after.triangles;
+    _statisticsAfter.misses += after.misses;
+}
+
+void VertexOverdrawVisitor::computeStatistics(Geometry& geom, Statistics& statistics) const
+{
+    Array* vertArray = geom.getVertexArray();
+    if (!vertArray || vertArray->getNumElements()==0)
+        return;
+
+    VertexCacheMissVisitor missv(_cacheSize);
+    missv.doGeometry(geom);
+
+    statistics.vertices = vertArray->getNumElements();
+    statistics.triangles = missv.triangles;
+    statistics.misses = missv.misses;
+}
+
+void VertexOverdrawVisitor::reorderForOverdraw(Geometry& geom)
+{
+    Vec3Array* positions = dynamic_cast<Vec3Array*>(geom.getVertexArray());
+    if (!positions || positions->size() <= _cacheSize)
+        return;
+
+    // Only handle meshes that are made of indexed triangles, which is what
+    // the post-transform cache optimization produces.
+    Geometry::PrimitiveSetList& primSets = geom.getPrimitiveSetList();
+    if (primSets.empty())
+        return;
+
+    std::vector<unsigned> indices;
+    TriangleCollector collector;
+    collector.triangleIndices = &indices;
+    for (Geometry::PrimitiveSetList::iterator itr = primSets.begin(),
+             end = primSets.end();
+         itr != end;
+         ++itr)
+    {
+        PrimitiveSet* ps = itr->get();
+        if (ps->getMode() != PrimitiveSet::TRIANGLES)
+            return;
+        PrimitiveSet::Type type = ps->getType();
+        if (type != PrimitiveSet::DrawElementsUBytePrimitiveType
+            && type != PrimitiveSet::DrawElementsUShortPrimitiveType
+            && type != PrimitiveSet::DrawElementsUIntPrimitiveType)
+            return;
+        ps->accept(collector);
+    }
+
+    for (std::vector<unsigned>::iterator itr = indices.begin(), end = indices.end();
+         itr != end;
+         ++itr)
+    {
+        if (*itr >= positions->size())
+            return;
+    }
+
+    std::vector<unsigned> newIndices;
+    computeOverdrawOrder(indices, *positions, _cacheSize, _overdrawThreshold, newIndices);
+
+    Geometry::PrimitiveSetList newPrims;
+    if (positions->size() < 65536)
+    {
+        osg::DrawElementsUShort* elements = new DrawElementsUShort(GL_TRIANGLES);
+        elements->reserve(newIndices.size());
+        for (std::vector<unsigned>::iterator itr = newIndices.begin(),
+                 end = newIndices.end();
+             itr != end;
+             ++itr)
+            elements->push_back((GLushort)*itr);
+        if (geom.getUseVertexBufferObjects())
+        {
+            elements->setElementBufferObject(new ElementBufferObject);
+        }
+        newPrims.push_back(elements);
+    }
+    else
+    {
+        osg::DrawElementsUInt* elements
+            = new DrawElementsUInt(GL_TRIANGLES, newIndices.begin(),
+                                   newIndices.end());
+        if (geom.getUseVertexBufferObjects())
+        {
+            elements->setElementBufferObject(new ElementBufferObject);
+        }
+        newPrims.push_back(elements);
+    }
+
+    geom.setPrimitiveSetList(newPrims);
+    geom.dirtyGLObjects();
+}
+
+void VertexOverdrawVisitor::quantizeNormals(Geometry& geom)
+{
+    Vec3Array* normals = dynamic_cast<Vec3Array*>(geom.getNormalArray());
+    if (!normals || normals->empty())
+        return;
+
+    // Signed 16 bit normals are mapped back to [-1,1] by OpenGL, so they
+    // need no decoding by the fixed function pipeline or shaders.
+    ref_ptr<Vec3sArray> quantized = new Vec3sArray(normals->getBinding(), normals->size());
+    for (unsigned i = 0; i < normals->size(); ++i)
+    {
+        Vec3 normal = (*normals)[i];
+        normal.normalize();
+        (*quantized)[i].set(quantizeSigned(normal.x()), quantizeSigned(normal.y()), quantizeSigned(normal.z()));
+    }
+    quantized->setNormalize(true);
+
+    geom.setNormalArray(quantized.get(), normals->getBinding());
+    geom.dirtyGLObjects();
+}
+
+void VertexOverdrawVisitor::quantizeTexCoords(Geometry& geom)
+{
+    typedef std::map<Array*, std::pair<ref_ptr<Vec2sArray>, Matrix> > QuantizedMap;
+    QuantizedMap quantizedMap;
+
+    for (unsigned unit = 0; unit < geom.getNumTexCoordArrays(); ++unit)
+    {
+        Vec2Array* texcoords = dynamic_cast<Vec2Array*>(geom.getTexCoordArray(unit));
+        if (!texcoords || texcoords->empty())
+            continue;
+
+        QuantizedMap::iterator qitr = quantizedMap.find(texcoords);
+        if (qitr == quantizedMap.end())
+        {
+            Vec2 minimum((*texcoords)[0]);
+            Vec2 maximum((*texcoords)[0]);
+            for (Vec2Array::iterator itr = texcoords->begin(), end = texcoords->end();
+                 itr != end;
+                 ++itr)
+            {
+                minimum.set(osg::minimum(minimum.x(), itr->x()), osg::minimum(minimum.y(), itr->y()));
+                maximum.set(osg::maximum(maximum.x(), itr->x()), osg::maximum(maximum.y(), itr->y()));
+            }
+
+            Vec2 range(maximum - minimum);
+            if (range.x() <= 0.0f) range.x() = 1.0f;
+            if (range.y() <= 0.0f) range.y() = 1.0f;
+
+            ref_ptr<Vec2sArray> quantized = new Vec2sArray(texcoords->getBinding(), texcoords->size());
+            for (unsigned i = 0; i < texcoords->size(); ++i)
+            {
+                const Vec2& tc = (*texcoords)[i];
+                (*quantized)[i].set(quantizeRange(tc.x(), minimum.x(), range.x()),
+                                    quantizeRange(tc.y(), minimum.y(), range.y()));
+            }
+
+            // texcoord = (q + 32768) * range / 65535 + minimum
+            Vec2 scale(range.x() / 65535.0f, range.y() / 65535.0f);
+            Matrix dequantize = Matrix::scale(scale.x(), scale.y(), 1.0)
+                              * Matrix::translate(minimum.x() + 32768.0f * scale.x(),
+                                                  minimum.y() + 32768.0f * scale.y(),
+                                                  0.0);
+
+            qitr = quantizedMap.insert(QuantizedMap::value_type(texcoords, std::make_pair(quantized, dequantize))).first;
+        }
+
+        StateSet* stateset = geom.getStateSet();
+        if (stateset && stateset->referenceCount() > 1)
+        {
+            geom.setStateSet(new StateSet(*stateset, CopyOp::SHALLOW_COPY));
+        }
+
+        geom.setTexCoordArray(unit, qitr->second.first.get(), texcoords->getBinding());
+        geom.getOrCreateStateSet()->setTextureAttribute(unit, new TexMat(qitr->second.second));
+    }
+
+    if (!quantizedMap.empty())
+        geom.dirtyGLObjects();
+}
+
 void SharedArrayOptimizer::findDuplicatedUVs(const osg::Geometry& geometry)
 {
     _deduplicateUvs.clear();
@@ -0,0 +1,554 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgUtil/OcclusionBuffer>
+
+#include <osg/Geometry>
+#include <osg/TriangleFunctor>
+#include <osg/Notify>
+
+#include <OpenThreads/ScopedLock>
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+    #include <emmintrin.h>
+    #define OSG_OCCLUSION_BUFFER_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define OSG_OCCLUSION_BUFFER_NEON
+#endif
+
+using namespace osgUtil;
+
+namespace
+{
+
+// four pixels of a row are set up, written and tested at a time.
+#if defined(OSG_OCCLUSION_BUFFER_SSE2)
+
+    typedef __m128 Float4;
+    typedef __m128 Mask4;
+
+    inline Float4 set1(float v) { return _mm_set1_ps(v); }
+    inline Float4 set4(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+    inline Float4 add(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+    inline Float4 mul(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+    inline Float4 minimum(Float4 a, Float4 b) { return _mm_min_ps(a, b); }
+    inline Float4 maximum(Float4 a, Float4 b) { return _mm_max_ps(a, b); }
+    inline Mask4 greaterEqual(Float4 a, Float4 b) { return _mm_cmpge_ps(a, b); }
+    inline Mask4 both(Mask4 a, Mask4 b) { return _mm_and_ps(a, b); }
+    inline Float4 select(Mask4 m, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+    inline bool any(Mask4 m) { return _mm_movemask_ps(m)!=0; }
+    inline Float4 load(const float* ptr) { return _mm_loadu_ps(ptr); }
+    inline void store(float* ptr, Float4 v) { _mm_storeu_ps(ptr, v); }
+
+#elif defined(OSG_OCCLUSION_BUFFER_NEON)
+
+    typedef float32x4_t Float4;
+    typedef uint32x4_t Mask4;
+
+    inline Float4 set1(float v) { return vdupq_n_f32(v); }
+    inline Float4 set4(float a, float b, float c, float d) { float v[4] = { a, b, c, d }; return vld1q_f32(v); }
+    inline Float4 add(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+    inline Float4 mul(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+    inline Float4 minimum(Float4 a, Float4 b) { return vminq_f32(a, b); }
+    inline Float4 maximum(Float4 a, Float4 b) { return vmaxq_f32(a, b); }
+    inline Mask4 greaterEqual(Float4 a, Float4 b) { return vcgeq_f32(a, b); }
+    inline Mask4 both(Mask4 a, Mask4 b) { return vandq_u32(a, b); }
+    inline Float4 select(Mask4 m, Float4 a, Float4 b) { return vbslq_f32(m, a, b); }
+    inline bool any(Mask4 m) { return vmaxvq_u32(m)!=0; }
+    inline Float4 load(const float* ptr) { return vld1q_f32(ptr); }
+    inline void store(float* ptr, Float4 v) { vst1q_f32(ptr, v); }
+
+#else
+
+    struct Float4 { float v[4]; };
+    struct Mask4 { bool v[4]; };
+
+    inline Float4 set1(float v) { Float4 r = { { v, v, v, v } }; return r; }
+    inline Float4 set4(float a, float b, float c, float d) { Float4 r = { { a, b, c, d } }; return r; }
+    inline Float4 add(const Float4& a, const Float4& b) { Float4 r; for(int i=0; i<4; ++i) r.v[i] = a.v[i]+b.v[i]; return r; }
+    inline Float4 mul(const Float4& a, const Float4& b) { Float4 r; for(int i=0; i<4; ++i) r.v[i] = a.v[i]*b.v[i]; return r; }
+    inline Float4 minimum(const Float4& a, const Float4& b) { Float4 r; for(int i=0; i<4; ++i) r.v[i] = osg::minimum(a.v[i], b.v[i]); return r; }
+    inline Float4 maximum(const Float4& a, const Float4& b) { Float4 r; for(int i=0; i<4; ++i) r.v[i] = osg::maximum(a.v[i], b.v[i]); return r; }
+    inline Mask4 greaterEqual(const Float4& a, const Float4& b) { Mask4 r; for(int i=0; i<4; ++i) r.v[i] = a.v[i]>=b.v[i]; return r; }
+    inline Mask4 both(const Mask4& a, const Mask4& b) { Mask4 r; for(int i=0; i<4; ++i) r.v[i] = a.v[i] && b.v[i]; return r; }
+    inline Float4 select(const Mask4& m, const Float4& a, const Float4& b) { Float4 r; for(int i=0; i<4; ++i) r.v[i] = m.v[i] ? a.v[i] : b.v[i]; return r; }
+    inline bool any(const Mask4& m) { return m.v[0] || m.v[1] || m.v[2] || m.v[3]; }
+    inline Float4 load(const float* ptr) { return set4(ptr[0], ptr[1], ptr[2], ptr[3]); }
+    inline void store(float* ptr, const Float4& v) { for(int i=0; i<4; ++i) ptr[i] = v.v[i]; }
+
+#endif
+
+inline float maximumOf(const Float4& v)
+{
+    float values[4];
+    store(values, v);
+    return osg::maximum(osg::maximum(values[0], values[1]), osg::maximum(values[2], values[3]));
+}
+
+// the farthest depth of each square tile of pixels is kept so that tiles hidden from a bound are tested at once.
+const int s_tileSize = 8;
+
+// written depths are pushed back by a little more than the rounding of a float normalized device depth,
+// so that a drawable is never hidden by the triangles of its own surface.
+const double s_depthBias = 1e-6;
+
+// compare the model matrices of a drawable in successive frames, which are rebuilt from different view matrices.
+bool isSamePlace(const osg::Matrix& lhs, const osg::Matrix& rhs)
+{
+    for(int i=0; i<16; ++i)
+    {
+        double a = lhs.ptr()[i];
+        double b = rhs.ptr()[i];
+        if (fabs(a-b)>1e-6*(1.0+osg::maximum(fabs(a), fabs(b)))) return false;
+    }
+    return true;
+}
+
+}
+
+struct OcclusionBuffer::RasterizeTriangles
+{
+    RasterizeTriangles():
+        buffer(0),
+        numTriangles(0) {}
+
+    void operator() (const osg::Vec3& v0, const osg::Vec3& v1, const osg::Vec3& v2)
+    {
+        buffer->clipAndRasterizeTriangle(osg::Vec4d(v0, 1.0)*modelViewProjection, osg::Vec4d(v1, 1.0)*modelViewProjection, osg::Vec4d(v2, 1.0)*modelViewProjection);
+        ++numTriangles;
+    }
+
+    OcclusionBuffer*    buffer;
+    osg::Matrix         modelViewProjection;
+    unsigned int        numTriangles;
+};
+
+OcclusionBuffer::OcclusionBuffer():
+    _width(0),
+    _height(0),
+    _numTileColumns(0),
+    _numTileRows(0),
+    _dirtyXMin(0),
+    _dirtyXMax(-1),
+    _dirtyYMin(0),
+    _dirtyYMax(-1),
+    _maximumNumOccluders(32),
+    _maximumNumOccluderPrimitives(1024),
+    _minimumOccluderSize(0.05f),
+    _occluderMask(0),
+    _candidateSizeThreshold(0.0f),
+    _numOccluders(0),
+    _numOccluderTriangles(0),
+    _numOccluded(0)
+{
+    setSize(256, 128);
+}
+
+OcclusionBuffer::~OcclusionBuffer()
+{
+}
+
+void OcclusionBuffer::setSize(unsigned int width, unsigned int height)
+{
+    _width = (width+3) & ~3u;
+    _height = height;
+    _depthBuffer.resize(_width*_height);
+    _numTileColumns = (_width+s_tileSize-1)/s_tileSize;
+    _numTileRows = (_height+s_tileSize-1)/s_tileSize;
+    _tileDepths.resize(_numTileColumns*_numTileRows);
+    clear();
+}
+
+void OcclusionBuffer::clear()
+{
+    std::fill(_depthBuffer.begin(), _depthBuffer.end(), FLT_MAX);
+    std::fill(_tileDepths.begin(), _tileDepths.end(), FLT_MAX);
+    _dirtyXMin = 0;
+    _dirtyXMax = -1;
+    _dirtyYMin = 0;
+    _dirtyYMax = -1;
+}
+
+void OcclusionBuffer::addTriangle(const osg::Vec4d& c0, const osg::Vec4d& c1, const osg::Vec4d& c2)
+{
+    clipAndRasterizeTriangle(c0, c1, c2);
+    updateTileDepths();
+}
+
+void OcclusionBuffer::clipAndRasterizeTriangle(const osg::Vec4d& c0, const osg::Vec4d& c1, const osg::Vec4d& c2)
+{
+    // clip the triangle to the near plane, z>=-w, which leaves a triangle or a quad.
+    const osg::Vec4d* input[3] = { &c0, &c1, &c2 };
+    osg::Vec4d polygon[4];
+    unsigned int numVertices = 0;
+    for(unsigned int i=0; i<3; ++i)
+    {
+        const osg::Vec4d& a = *input[i];
+        const osg::Vec4d& b = *input[(i+1)%3];
+        double da = a.z()+a.w();
+        double db = b.z()+b.w();
+        if (da>=0.0) polygon[numVertices++] = a;
+        if ((da>=0.0)!=(db>=0.0)) polygon[numVertices++] = a+(b-a)*(da/(da-db));
+    }
+    if (numVertices<3) return;
+
+    osg::Vec3d screen[4];
+    for(unsigned int i=0; i<numVertices; ++i)
+    {
+        const osg::Vec4d& c = polygon[i];
+        if (c.w()<=DBL_EPSILON) return;
+
+        double inv_w = 1.0/c.w();
+        screen[i].set((c.x()*inv_w*0.5+0.5)*_width, (c.y()*inv_w*0.5+0.5)*_height, c.z()*inv_w);
+    }
+
+    rasterizeTriangle(screen[0], screen[1], screen[2]);
+    if (numVertices==4) rasterizeTriangle(screen[0], screen[2], screen[3]);
+}
+
+void OcclusionBuffer::rasterizeTriangle(const osg::Vec3d& v0, const osg::Vec3d& in_v1, const osg::Vec3d& in_v2)
+{
+    // the pixels whose centers lie within the triangle are written, so the triangles of a mesh leave no gaps along their shared edges.
+    int xmin = osg::maximum(static_cast<int>(ceil(osg::minimum(v0.x(), osg::minimum(in_v1.x(), in_v2.x()))-0.5)), 0);
+    int xmax = osg::minimum(static_cast<int>(floor(osg::maximum(v0.x(), osg::maximum(in_v1.x(), in_v2.x()))-0.5)), static_cast<int>(_width)-1);
+    int ymin = osg::maximum(static_cast<int>(ceil(osg::minimum(v0.y(), osg::minimum(in_v1.y(), in_v2.y()))-0.5)), 0);
+    int ymax = osg::minimum(static_cast<int>(floor(osg::maximum(v0.y(), osg::maximum(in_v1.y(), in_v2.y()))-0.5)), static_cast<int>(_height)-1);
+    if (xmin>xmax || ymin>ymax) return;
+
+    if (_dirtyXMin>_dirtyXMax)
+    {
+        _dirtyXMin = xmin;
+        _dirtyXMax = xmax;
+        _dirtyYMin = ymin;
+        _dirtyYMax = ymax;
+    }
+    else
+    {
+        _dirtyXMin = osg::minimum(_dirtyXMin, xmin);
+        _dirtyXMax = osg::maximum(_dirtyXMax, xmax);
+        _dirtyYMin = osg::minimum(_dirtyYMin, ymin);
+        _dirtyYMax = osg::maximum(_dirtyYMax, ymax);
+    }
+
+    double area = (in_v1.x()-v0.x())*(in_v2.y()-v0.y()) - (in_v2.x()-v0.x())*(in_v1.y()-v0.y());
+    if (fabs(area)<1e-12) return;
+
+    // wind the triangle counter clockwise so that the edge functions are positive inside it.
+    const osg::Vec3d& v1 = area>0.0 ? in_v1 : in_v2;
+    const osg::Vec3d& v2 = area>0.0 ? in_v2 : in_v1;
+    area = fabs(area);
+
+    // edge function e = a*x + b*y + c of each edge, a pixel is covered if e at its center is not negative.
+    const osg::Vec3d* vertices[3] = { &v0, &v1, &v2 };
+    double a[3], b[3], c[3];
+    for(int i=0; i<3; ++i)
+    {
+        const osg::Vec3d& p = *vertices[i];
+        const osg::Vec3d& q = *vertices[(i+1)%3];
+        a[i] = p.y()-q.y();
+        b[i] = q.x()-p.x();
+        c[i] = -(a[i]*p.x() + b[i]*p.y());
+    }
+
+    // the depth plane, written at the farthest depth over each pixel, no farther than the farthest vertex.
+    double dzdx = ((v1.z()-v0.z())*(v2.y()-v0.y()) - (v2.z()-v0.z())*(v1.y()-v0.y()))/area;
+    double dzdy = ((v1.x()-v0.x())*(v2.z()-v0.z()) - (v2.x()-v0.x())*(v1.z()-v0.z()))/area;
+    double dz = v0.z() - dzdx*v0.x() - dzdy*v0.y() + 0.5*(fabs(dzdx)+fabs(dzdy)) + s_depthBias;
+    double zmax = osg::maximum(v0.z(), osg::maximum(v1.z(), v2.z())) + s_depthBias;
+
+    Float4 stepX = set1(4.0f);
+    Float4 zeroToThree = set4(0.0f, 1.0f, 2.0f, 3.0f);
+    Float4 zero = set1(0.0f);
+    Float4 depthLimit = set1(static_cast<float>(zmax));
+
+    // align the blocks of four pixels to the rows of the buffer, masking off the pixels outside [xmin, xmax].
+    int xstart = xmin & ~3;
+    for(int y=ymin; y<=ymax; ++y)
+    {
+        double cy = y+0.5;
+        double cx = xstart+0.5;
+
+        Float4 e[3];
+        Float4 ea[3];
+        for(int i=0; i<3; ++i)
+        {
+            e[i] = add(set1(static_cast<float>(a[i]*cx + b[i]*cy + c[i])), mul(zeroToThree, set1(static_cast<float>(a[i]))));
+            ea[i] = mul(stepX, set1(static_cast<float>(a[i])));
+        }
+        Float4 z = add(set1(static_cast<float>(dz + dzdx*cx + dzdy*cy)), mul(zeroToThree, set1(static_cast<float>(dzdx))));
+        Float4 zstep = mul(stepX, set1(static_cast<float>(dzdx)));
+        Float4 px = add(set1(static_cast<float>(xstart)), zeroToThree);
+        Float4 pxmin = set1(static_cast<float>(xmin));
+        Float4 pxmax = set1(static_cast<float>(xmax));
+
+        float* row = &_depthBuffer[y*_width];
+        for(int x=xstart; x<=xmax; x+=4)
+        {
+            Mask4 inside = both(both(greaterEqual(e[0], zero), greaterEqual(e[1], zero)),
+                                both(greaterEqual(e[2], zero), both(greaterEqual(px, pxmin), greaterEqual(pxmax, px))));
+            if (any(inside))
+            {
+                Float4 current = load(row+x);
+                store(row+x, select(inside, minimum(current, minimum(z, depthLimit)), current));
+            }
+
+            for(int i=0; i<3; ++i) e[i] = add(e[i], ea[i]);
+            z = add(z, zstep);
+            px = add(px, stepX);
+        }
+    }
+}
+
+unsigned int OcclusionBuffer::addOccluder(const osg::Drawable& drawable, const osg::Matrix& modelViewProjection)
+{
+    osg::TriangleFunctor<RasterizeTriangles> functor;
+    functor.buffer = this;
+    functor.modelViewProjection = modelViewProjection;
+    drawable.accept(functor);
+    updateTileDepths();
+    return functor.numTriangles;
+}
+
+void OcclusionBuffer::updateTileDepths()
+{
+    if (_dirtyXMin>_dirtyXMax || _dirtyYMin>_dirtyYMax) return;
+
+    for(int ty=_dirtyYMin/s_tileSize; ty<=_dirtyYMax/s_tileSize; ++ty)
+    {
+        int yend = osg::minimum((ty+1)*s_tileSize, static_cast<int>(_height));
+        for(int tx=_dirtyXMin/s_tileSize; tx<=_dirtyXMax/s_tileSize; ++tx)
+        {
+            int xend = osg::minimum((tx+1)*s_tileSize, static_cast<int>(_width));
+            Float4 depth = set1(-FLT_MAX);
+            for(int y=ty*s_tileSize; y<yend; ++y)
+            {
+                const float* row = &_depthBuffer[y*_width];
+                for(int x=tx*s_tileSize; x<xend; x+=4) depth = maximum(depth, load(row+x));
+            }
+            _tileDepths[ty*_numTileColumns+tx] = maximumOf(depth);
+        }
+    }
+
+    _dirtyXMin = 0;
+    _dirtyXMax = -1;
+    _dirtyYMin = 0;
+    _dirtyYMax = -1;
+}
+
+bool OcclusionBuffer::isOccluded(const osg::BoundingBox& bb, const osg::Matrix& modelViewProjection) const
+{
+    if (!bb.valid()) return false;
+
+    // the corners are the clip coordinates of the minimum corner plus the rows of the matrix scaled by the sides of the box.
+    const osg::Matrix& m = modelViewProjection;
+    osg::Vec4d origin = osg::Vec4d(bb._min, 1.0)*m;
+    osg::Vec4d sides[3];
+    for(int i=0; i<3; ++i)
+    {
+        double length = bb._max[i]-bb._min[i];
+        sides[i].set(m(i,0)*length, m(i,1)*length, m(i,2)*length, m(i,3)*length);
+    }
+
+    double xmin = DBL_MAX, xmax = -DBL_MAX, ymin = DBL_MAX, ymax = -DBL_MAX, zmin = DBL_MAX;
+    for(unsigned int i=0; i<8; ++i)
+    {
+        osg::Vec4d c = origin;
+        if (i&1) c += sides[0];
+        if (i&2) c += sides[1];
+        if (i&4) c += sides[2];
+
+        // bounds that reach the near plane are in front of all the occluders.
+        if (c.z()<-c.w() || c.w()<=DBL_EPSILON) return false;
+
+        double inv_w = 1.0/c.w();
+        double x = (c.x()*inv_w*0.5+0.5)*_width;
+        double y = (c.y()*inv_w*0.5+0.5)*_height;
+        xmin = osg::minimum(xmin, x);
+        xmax = osg::maximum(xmax, x);
+        ymin = osg::minimum(ymin, y);
+        ymax = osg::maximum(ymax, y);
+        zmin = osg::minimum(zmin, c.z()*inv_w);
+    }
+
+    // test every pixel the bound touches, leaving any parts off screen to the view frustum culling.
+    if (xmax<=0.0 || ymax<=0.0 || xmin>=_width || ymin>=_height) return false;
+
+    // the occluders cover the pixels whose centers they cover, up to half a pixel beyond their edges,
+    // so the pixels bordering the bound are tested too.
+    int ixmin = osg::maximum(static_cast<int>(floor(xmin))-1, 0);
+    int ixmax = osg::minimum(static_cast<int>(ceil(xmax)), static_cast<int>(_width)-1);
+    int iymin = osg::maximum(static_cast<int>(floor(ymin))-1, 0);
+    int iymax = osg::minimum(static_cast<int>(ceil(ymax)), static_cast<int>(_height)-1);
+
+    // round the nearest depth down so that the float comparisons stay conservative.
+    float nearest = static_cast<float>(zmin-s_depthBias);
+    Float4 depth = set1(nearest);
+    Float4 zeroToThree = set4(0.0f, 1.0f, 2.0f, 3.0f);
+    Float4 pxmin = set1(static_cast<float>(ixmin));
+    Float4 pxmax = set1(static_cast<float>(ixmax));
+    Float4 stepX = set1(4.0f);
+    for(int ty=iymin/s_tileSize; ty<=iymax/s_tileSize; ++ty)
+    {
+        int ybegin = osg::maximum(ty*s_tileSize, iymin);
+        int yend = osg::minimum((ty+1)*s_tileSize-1, iymax);
+        for(int tx=ixmin/s_tileSize; tx<=ixmax/s_tileSize; ++tx)
+        {
+            // a tile with a farthest depth nearer than the bound hides its part of it, and any other tile lying
+            // wholly within the bound has a pixel that shows it.
+            if (_tileDepths[ty*_numTileColumns+tx]<nearest) continue;
+
+            int xbegin = osg::maximum(tx*s_tileSize, ixmin);
+            int xend = osg::minimum((tx+1)*s_tileSize-1, ixmax);
+            if (xbegin==tx*s_tileSize && xend==osg::minimum((tx+1)*s_tileSize, static_cast<int>(_width))-1 &&
+                ybegin==ty*s_tileSize && yend==osg::minimum((ty+1)*s_tileSize, static_cast<int>(_height))-1) return false;
+
+            int xstart = xbegin & ~3;
+            for(int y=ybegin; y<=yend; ++y)
+            {
+                const float* row = &_depthBuffer[y*_width];
+                Float4 px = add(set1(static_cast<float>(xstart)), zeroToThree);
+                for(int x=xstart; x<=xend; x+=4)
+                {
+                    Mask4 visible = both(greaterEqual(load(row+x), depth), both(greaterEqual(px, pxmin), greaterEqual(pxmax, px)));
+                    if (any(visible)) return false;
+                    px = add(px, stepX);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool OcclusionBuffer::isOccluded(const osg::BoundingSphere& bs, const osg::Matrix& modelViewProjection) const
+{
+    if (!bs.valid()) return false;
+
+    osg::Vec3 r(bs.radius(), bs.radius(), bs.radius());
+    return isOccluded(osg::BoundingBox(bs.center()-r, bs.center()+r), modelViewProjection);
+}
+
+void OcclusionBuffer::beginFrame(const osg::Matrix& view, const osg::Matrix& projection)
+{
+    clear();
+
+    _numOccluders = 0;
+    _numOccluderTriangles = 0;
+    _numOccluded.exchange(0);
+    _occluderDrawables.clear();
+
+    if (!_inverseView.invert(view))
+    {
+        _occluders.clear();
+        return;
+    }
+
+    osg::Matrix viewProjection = view*projection;
+    for(Occluders::iterator itr = _occluders.begin();
+        itr != _occluders.end();
+        ++itr)
+    {
+        osg::ref_ptr<osg::Drawable> drawable;
+        if (!itr->drawable.lock(drawable)) continue;
+
+        _numOccluderTriangles += addOccluder(*drawable, itr->matrix*viewProjection);
+        _occluderDrawables.push_back(drawable.get());
+        ++_numOccluders;
+    }
+
+    std::sort(_occluderDrawables.begin(), _occluderDrawables.end());
+}
+
+bool OcclusionBuffer::isOccluderCandidate(const osg::Drawable& drawable, float size) const
+{
+    if (_occluderMask!=0)
+    {
+        if ((drawable.getNodeMask() & _occluderMask)==0) return false;
+    }
+    else if (size<_minimumOccluderSize) return false;
+
+    const osg::Geometry* geometry = drawable.asGeometry();
+    if (!geometry || !geometry->getVertexArray() || geometry->getVertexArray()->getType()!=osg::Array::Vec3ArrayType) return false;
+
+    unsigned int numPrimitives = 0;
+    const osg::Geometry::PrimitiveSetList& primitives = geometry->getPrimitiveSetList();
+    for(osg::Geometry::PrimitiveSetList::const_iterator itr = primitives.begin();
+        itr != primitives.end();
+        ++itr)
+    {
+        numPrimitives += (*itr)->getNumPrimitives();
+    }
+    return numPrimitives>0 && numPrimitives<=_maximumNumOccluderPrimitives;
+}
+
+void OcclusionBuffer::addOccluderCandidate(osg::Drawable* drawable, const osg::Matrix& modelView, float size)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_candidatesMutex);
+
+    if (size<_candidateSizeThreshold) return;
+
+    _candidates.push_back(Occluder());
+    Occluder& candidate = _candidates.back();
+    candidate.drawable = drawable;
+    candidate.matrix = modelView*_inverseView;
+    candidate.size = size;
+
+    // keep the list of candidates short in scenes with many large drawables, from then on turning away
+    // those smaller than the largest dropped.
+    if (_candidates.size()>=4*_maximumNumOccluders+4)
+    {
+        std::nth_element(_candidates.begin(), _candidates.begin()+_maximumNumOccluders, _candidates.end());
+        _candidateSizeThreshold = _candidates[_maximumNumOccluders].size;
+        _candidates.resize(_maximumNumOccluders);
+    }
+}
+
+void OcclusionBuffer::endFrame()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_candidatesMutex);
+
+    std::sort(_candidates.begin(), _candidates.end());
+
+    // only pick drawables that were also candidates in the same place in the previous frame, as occluders that
+    // move would be rasterized where they were when picked.
+    Occluders occluders;
+    for(Occluders::iterator itr = _candidates.begin();
+        itr != _candidates.end() && occluders.size()<_maximumNumOccluders;
+        ++itr)
+    {
+        for(Occluders::iterator pitr = _previousCandidates.begin();
+            pitr != _previousCandidates.end();
+            ++pitr)
+        {
+            if (pitr->drawable==itr->drawable && isSamePlace(pitr->matrix, itr->matrix))
+            {
+                occluders.push_back(*itr);
+                break;
+            }
+        }
+    }
+
+    _occluders.swap(occluders);
+    _previousCandidates.swap(_candidates);
+    _candidates.clear();
+    _candidateSizeThreshold = 0.0f;
+}
+
+bool OcclusionBuffer::isOccluder(const osg::Drawable* drawable) const
+{
+    return std::binary_search(_occluderDrawables.begin(), _occluderDrawables.end(), drawable);
+}
@@ -35,6 +35,9 @@
 #include <osg/TexMat>
 #include <osg/io_utils>
 
+#include <OpenThreads/Thread>
+#include <OpenThreads/Atomic>
+
 #include <osgUtil/TransformAttributeFunctor>
 #include <osgUtil/Tessellator>
 #include <osgUtil/Statistics>
@@ -53,7 +56,7 @@ void Optimizer::reset()
 {
 }
 
-static osg::ApplicationUsageProxy Optimizer_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER \"<type> [<type>]\"","OFF | DEFAULT | FLATTEN_STATIC_TRANSFORMS | FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS | REMOVE_REDUNDANT_NODES | COMBINE_ADJACENT_LODS | SHARE_DUPLICATE_STATE | MERGE_GEOMETRY | MERGE_GEODES | SPATIALIZE_GROUPS  | COPY_SHARED_NODES | OPTIMIZE_TEXTURE_SETTINGS | REMOVE_LOADED_PROXY_NODES | TESSELLATE_GEOMETRY | CHECK_GEOMETRY |  FLATTEN_BILLBOARDS | TEXTURE_ATLAS_BUILDER | STATIC_OBJECT_DETECTION | INDEX_MESH | VERTEX_POSTTRANSFORM | VERTEX_PRETRANSFORM | BUFFER_OBJECT_SETTINGS");
+static osg::ApplicationUsageProxy Optimizer_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER \"<type> [<type>]\"","OFF | DEFAULT | FLATTEN_STATIC_TRANSFORMS | FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS | REMOVE_REDUNDANT_NODES | COMBINE_ADJACENT_LODS | SHARE_DUPLICATE_STATE | MERGE_GEOMETRY | MERGE_GEODES | SPATIALIZE_GROUPS  | COPY_SHARED_NODES | OPTIMIZE_TEXTURE_SETTINGS | REMOVE_LOADED_PROXY_NODES | TESSELLATE_GEOMETRY | CHECK_GEOMETRY |  FLATTEN_BILLBOARDS | TEXTURE_ATLAS_BUILDER | STATIC_OBJECT_DETECTION | INDEX_MESH | VERTEX_POSTTRANSFORM | VERTEX_PRETRANSFORM | VERTEX_OVERDRAW | BUFFER_OBJECT_SETTINGS");
 
 void Optimizer::optimize(osg::Node* node)
 {
@@ -130,6 +133,9 @@ void Optimizer::optimize(osg::Node* node)
         if(str.find("~VERTEX_PRETRANSFORM")!=std::string::npos) options ^= VERTEX_PRETRANSFORM;
         else if(str.find("VERTEX_PRETRANSFORM")!=std::string::npos) options |= VERTEX_PRETRANSFORM;
 
+        if(str.find("~VERTEX_OVERDRAW")!=std::string::npos) options ^= VERTEX_OVERDRAW;
+        else if(str.find("VERTEX_OVERDRAW")!=std::string::npos) options |= VERTEX_OVERDRAW;
+
         if(str.find("~BUFFER_OBJECT_SETTINGS")!=std::string::npos) options ^= BUFFER_OBJECT_SETTINGS;
         else if(str.find("BUFFER_OBJECT_SETTINGS")!=std::string::npos) options |= BUFFER_OBJECT_SETTINGS;
     }
@@ -314,7 +320,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
         MergeGeometryVisitor mgv(this);
         mgv.setTargetMaximumNumberOfVertices(10000);
-        node->accept(mgv);
+        mgv.mergeSubgraph(*node);
 
         osg::Timer_t endTick = osg::Timer::instance()->tick();
 
@@ -349,7 +355,7 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & VERTEX_POSTTRANSFORM)
     {
         OSG_INFO<<"Optimizer::optimize() doing VERTEX_POSTTRANSFORM"<<std::endl;
-        VertexCacheVisitor vcv;
+        VertexCacheVisitor vcv(this);
         node->accept(vcv);
         vcv.optimizeVertices();
     }
@@ -357,11 +363,19 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
     if (options & VERTEX_PRETRANSFORM)
     {
         OSG_INFO<<"Optimizer::optimize() doing VERTEX_PRETRANSFORM"<<std::endl;
-        VertexAccessOrderVisitor vaov;
+        VertexAccessOrderVisitor vaov(this);
         node->accept(vaov);
         vaov.optimizeOrder();
     }
 
+    if (options & VERTEX_OVERDRAW)
+    {
+        OSG_INFO<<"Optimizer::optimize() doing VERTEX_OVERDRAW"<<std::endl;
+        VertexOverdrawVisitor vov(this);
+        node->accept(vov);
+        vov.optimize();
+    }
+
     if (options & BUFFER_OBJECT_SETTINGS)
     {
         OSG_INFO<<"Optimizer::optimize() doing BUFFER_OBJECT_SETTINGS"<<std::endl;
@@ -380,12 +394,160 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 }
 
 
+////////////////////////////////////////////////////////////////////////////
+// Running independent tasks across threads
+////////////////////////////////////////////////////////////////////////////
+namespace
+{
+
+class TaskThread : public osg::Referenced, public OpenThreads::Thread
+{
+    public:
+
+        TaskThread(Optimizer::TaskOperation& operation, OpenThreads::Atomic& nextTask, unsigned int numTasks):
+            _operation(operation),
+            _nextTask(nextTask),
+            _numTasks(numTasks) {}
+
+        virtual void run()
+        {
+            runTasks(_operation, _nextTask, _numTasks);
+        }
+
+        static void runTasks(Optimizer::TaskOperation& operation, OpenThreads::Atomic& nextTask, unsigned int numTasks)
+        {
+            for(unsigned int taskIndex = (++nextTask)-1;
+                taskIndex < numTasks;
+                taskIndex = (++nextTask)-1)
+            {
+                operation(taskIndex);
+            }
+        }
+
+    protected:
+
+        virtual ~TaskThread() {}
+
+        Optimizer::TaskOperation&   _operation;
+        OpenThreads::Atomic&        _nextTask;
+        unsigned int                _numTasks;
+};
+
+}
+
+void Optimizer::runTasks(TaskOperation& operation, unsigned int numTasks) const
+{
+    unsigned int numThreads = _numThreads>0 ? _numThreads : static_cast<unsigned int>(OpenThreads::GetNumberOfProcessors());
+    if (numThreads>numTasks) numThreads = numTasks;
+
+    if (numThreads<=1)
+    {
+        for(unsigned int i=0; i<numTasks; ++i)
+        {
+            operation(i);
+        }
+        return;
+    }
+
+    OpenThreads::Atomic nextTask(0);
+
+    // the calling thread does its share of the tasks as well.
+    typedef std::vector< osg::ref_ptr<TaskThread> > TaskThreads;
+    TaskThreads threads;
+    for(unsigned int i=1; i<numThreads; ++i)
+    {
+        threads.push_back(new TaskThread(operation, nextTask, numTasks));
+        threads.back()->start();
+    }
+
+    TaskThread::runTasks(operation, nextTask, numTasks);
+
+    for(TaskThreads::iterator itr = threads.begin();
+        itr != threads.end();
+        ++itr)
+    {
+        (*itr)->join();
+    }
+}
+
+void Optimizer::TaskPartitioner::addObject(unsigned int item, const osg::Referenced* object)
+{
+    if (!object) return;
+
+    while(_parents.size()<=item) _parents.push_back(static_cast<unsigned int>(_parents.size()));
+
+    ObjectItemMap::iterator itr = _objectItemMap.find(object);
+    if (itr==_objectItemMap.end()) _objectItemMap[object] = item;
+    else join(itr->second, item);
+}
+
+void Optimizer::TaskPartitioner::addGeometry(unsigned int item, const osg::Geometry* geometry)
+{
+    addObject(item, geometry);
+
+    osg::Geometry::ArrayList arrays;
+    geometry->getArrayList(arrays);
+    for(osg::Geometry::ArrayList::iterator itr = arrays.begin();
+        itr != arrays.end();
+        ++itr)
+    {
+        addObject(item, itr->get());
+        addObject(item, (*itr)->getBufferObject());
+    }
+
+    const osg::Geometry::PrimitiveSetList& primitives = geometry->getPrimitiveSetList();
+    for(osg::Geometry::PrimitiveSetList::const_iterator itr = primitives.begin();
+        itr != primitives.end();
+        ++itr)
+    {
+        addObject(item, itr->get());
+        addObject(item, (*itr)->getBufferObject());
+    }
+}
+
+unsigned int Optimizer::TaskPartitioner::findRoot(unsigned int item)
+{
+    while(_parents[item]!=item)
+    {
+        _parents[item] = _parents[_parents[item]];
+        item = _parents[item];
+    }
+    return item;
+}
+
+void Optimizer::TaskPartitioner::join(unsigned int lhs, unsigned int rhs)
+{
+    lhs = findRoot(lhs);
+    rhs = findRoot(rhs);
+    if (lhs<rhs) _parents[rhs] = lhs;
+    else if (rhs<lhs) _parents[lhs] = rhs;
+}
+
+void Optimizer::TaskPartitioner::getTasks(unsigned int numItems, Tasks& tasks)
+{
+    while(_parents.size()<numItems) _parents.push_back(static_cast<unsigned int>(_parents.size()));
+
+    std::vector<unsigned int> taskIndices(numItems, 0);
+    for(unsigned int item=0; item<numItems; ++item)
+    {
+        unsigned int root = findRoot(item);
+        if (root==item)
+        {
+            taskIndices[item] = static_cast<unsigned int>(tasks.size());
+            tasks.push_back(Items());
+        }
+        tasks[taskIndices[root]].push_back(item);
+    }
+}
+
+
 ////////////////////////////////////////////////////////////////////////////
 // Tessellate geometry - eg break complex POLYGONS into triangles, strips, fans..
 ////////////////////////////////////////////////////////////////////////////
 void Optimizer::TessellateVisitor::apply(osg::Geometry &geom)
 {
     osgUtil::Tessellator Tessellator;
+    Tessellator.setFastTessellation(true);
     Tessellator.retessellatePolygons(geom);
 }
 
@@ -1773,387 +1935,579 @@ bool isAbleToMerge(const osg::Geometry& g1, const osg::Geometry& g2)
     return true;
 }
 
-bool Optimizer::MergeGeometryVisitor::mergeGroup(osg::Group& group)
+struct Optimizer::MergeGeometryVisitor::MergePlan
 {
-    if (!isOperationPermissibleForObject(&group)) return false;
+    typedef std::vector< osg::ref_ptr<osg::Geometry> >  DuplicateList;
+    typedef std::vector< osg::ref_ptr<osg::Node> >      Nodes;
+    typedef std::vector<DuplicateList>                  MergeList;
 
-    if (group.getNumChildren()>=2)
-    {
+    MergePlan() : needToDoMerge(false) {}
+
+    Nodes       standardChildren;   // children that are kept as they are
+    MergeList   mergeList;          // lists of geometries to merge into the first geometry of each list
+    bool        needToDoMerge;
+};
 
-        typedef std::vector< osg::ref_ptr<osg::Geometry> >                          DuplicateList;
-        typedef std::vector< osg::ref_ptr<osg::Node> >                              Nodes;
-        typedef std::map< osg::ref_ptr<osg::Geometry> ,DuplicateList,LessGeometry>  GeometryDuplicateMap;
+bool Optimizer::MergeGeometryVisitor::computeMergePlan(osg::Group& group, MergePlan& plan)
+{
+    if (group.getNumChildren()<2) return false;
 
-        typedef std::vector<DuplicateList> MergeList;
+    typedef MergePlan::DuplicateList                                            DuplicateList;
+    typedef MergePlan::MergeList                                                MergeList;
+    typedef std::map< osg::ref_ptr<osg::Geometry> ,DuplicateList,LessGeometry>  GeometryDuplicateMap;
 
-        GeometryDuplicateMap geometryDuplicateMap;
-        Nodes standardChildren;
+    GeometryDuplicateMap geometryDuplicateMap;
 
-        unsigned int i;
-        for(i=0;i<group.getNumChildren();++i)
+    unsigned int i;
+    for(i=0;i<group.getNumChildren();++i)
+    {
+        osg::Node* child = group.getChild(i);
+        osg::Geometry* geom = child->asGeometry();
+        if (geom)
         {
-            osg::Node* child = group.getChild(i);
-            osg::Geometry* geom = child->asGeometry();
-            if (geom)
+            if (!geometryContainsSharedArrays(*geom) &&
+                geom->getDataVariance()!=osg::Object::DYNAMIC &&
+                isOperationPermissibleForObject(geom))
             {
-                if (!geometryContainsSharedArrays(*geom) &&
-                    geom->getDataVariance()!=osg::Object::DYNAMIC &&
-                    isOperationPermissibleForObject(geom))
-                {
-                    geometryDuplicateMap[geom].push_back(geom);
-                }
-                else
-                {
-                    standardChildren.push_back(geom);
-                }
+                geometryDuplicateMap[geom].push_back(geom);
             }
             else
             {
-                standardChildren.push_back(child);
+                plan.standardChildren.push_back(geom);
             }
         }
+        else
+        {
+            plan.standardChildren.push_back(child);
+        }
+    }
 
-        // first try to group geometries with the same properties
-        // (i.e. array types) to avoid loss of data during merging
-        MergeList mergeListChecked;        // List of drawables just before merging, grouped by "compatibility" and vertex limit
-        MergeList mergeList;            // Intermediate list of drawables, grouped ony by "compatibility"
-        for(GeometryDuplicateMap::iterator itr=geometryDuplicateMap.begin();
-            itr!=geometryDuplicateMap.end();
-            ++itr)
+    // first try to group geometries with the same properties
+    // (i.e. array types) to avoid loss of data during merging
+    MergeList mergeListChecked;        // List of drawables just before merging, grouped by "compatibility" and vertex limit
+    for(GeometryDuplicateMap::iterator itr=geometryDuplicateMap.begin();
+        itr!=geometryDuplicateMap.end();
+        ++itr)
+    {
+        if (itr->second.empty()) continue;
+        if (itr->second.size()==1)
         {
-            if (itr->second.empty()) continue;
-            if (itr->second.size()==1)
-            {
-                mergeList.push_back(DuplicateList());
-                DuplicateList* duplicateList = &mergeList.back();
-                duplicateList->push_back(itr->second[0]);
-                continue;
-            }
+            plan.mergeList.push_back(DuplicateList());
+            DuplicateList* duplicateList = &plan.mergeList.back();
+            duplicateList->push_back(itr->second[0]);
+            continue;
+        }
 
-            std::sort(itr->second.begin(),itr->second.end(),LessGeometryPrimitiveType());
+        std::sort(itr->second.begin(),itr->second.end(),LessGeometryPrimitiveType());
 
-            // initialize the temporary list by pushing the first geometry
-            MergeList mergeListTmp;
-            mergeListTmp.push_back(DuplicateList());
-            DuplicateList* duplicateList = &mergeListTmp.back();
-            duplicateList->push_back(itr->second[0]);
+        // initialize the temporary list by pushing the first geometry
+        MergeList mergeListTmp;
+        mergeListTmp.push_back(DuplicateList());
+        DuplicateList* duplicateList = &mergeListTmp.back();
+        duplicateList->push_back(itr->second[0]);
 
-            for(DuplicateList::iterator dupItr=itr->second.begin()+1;
-                dupItr!=itr->second.end();
-                ++dupItr)
-            {
-                osg::Geometry* geomToPush = dupItr->get();
+        for(DuplicateList::iterator dupItr=itr->second.begin()+1;
+            dupItr!=itr->second.end();
+            ++dupItr)
+        {
+            osg::Geometry* geomToPush = dupItr->get();
 
-                // try to group geomToPush with another geometry
-                MergeList::iterator eachMergeList=mergeListTmp.begin();
-                for(;eachMergeList!=mergeListTmp.end();++eachMergeList)
+            // try to group geomToPush with another geometry
+            MergeList::iterator eachMergeList=mergeListTmp.begin();
+            for(;eachMergeList!=mergeListTmp.end();++eachMergeList)
+            {
+                if (!eachMergeList->empty() && eachMergeList->front()!=NULL
+                    && isAbleToMerge(*eachMergeList->front(),*geomToPush))
                 {
-                    if (!eachMergeList->empty() && eachMergeList->front()!=NULL
-                        && isAbleToMerge(*eachMergeList->front(),*geomToPush))
-                    {
-                        eachMergeList->push_back(geomToPush);
-                        break;
-                    }
+                    eachMergeList->push_back(geomToPush);
+                    break;
                 }
+            }
 
-                // if no suitable group was found, then a new one is created
-                if (eachMergeList==mergeListTmp.end())
-                {
-                    mergeListTmp.push_back(DuplicateList());
-                    duplicateList = &mergeListTmp.back();
-                    duplicateList->push_back(geomToPush);
-                }
+            // if no suitable group was found, then a new one is created
+            if (eachMergeList==mergeListTmp.end())
+            {
+                mergeListTmp.push_back(DuplicateList());
+                duplicateList = &mergeListTmp.back();
+                duplicateList->push_back(geomToPush);
             }
+        }
 
-            // copy the group in the mergeListChecked
-            for(MergeList::iterator eachMergeList=mergeListTmp.begin();eachMergeList!=mergeListTmp.end();++eachMergeList)
+        // copy the group in the mergeListChecked
+        for(MergeList::iterator eachMergeList=mergeListTmp.begin();eachMergeList!=mergeListTmp.end();++eachMergeList)
+        {
+            mergeListChecked.push_back(*eachMergeList);
+        }
+    }
+
+    // then build merge list using _targetMaximumNumberOfVertices
+    // dequeue each DuplicateList when vertices limit is reached or when all elements has been checked
+    for(MergeList::iterator itr=mergeListChecked.begin(); itr!=mergeListChecked.end(); ++itr)
+    {
+        DuplicateList& duplicateList(*itr);
+        if (duplicateList.size()==0)
+        {
+            continue;
+        }
+
+        if (duplicateList.size()==1)
+        {
+            plan.mergeList.push_back(duplicateList);
+            continue;
+        }
+
+        unsigned int totalNumberVertices = 0;
+        DuplicateList subset;
+        for(DuplicateList::iterator ditr = duplicateList.begin();
+            ditr != duplicateList.end();
+            ++ditr)
+        {
+            osg::Geometry* geometry = ditr->get();
+            unsigned int numVertices = (geometry->getVertexArray() ? geometry->getVertexArray()->getNumElements() : 0);
+            if ((totalNumberVertices+numVertices)>_targetMaximumNumberOfVertices && !subset.empty())
             {
-                mergeListChecked.push_back(*eachMergeList);
+
+                plan.mergeList.push_back(subset);
+                subset.clear();
+                totalNumberVertices = 0;
             }
+            totalNumberVertices += numVertices;
+            subset.push_back(geometry);
+            if (subset.size()>1) plan.needToDoMerge = true;
         }
+        if (!subset.empty()) plan.mergeList.push_back(subset);
+    }
+
+    return plan.needToDoMerge;
+}
+
+void Optimizer::MergeGeometryVisitor::replaceChildren(osg::Group& group, MergePlan& plan)
+{
+    // to avoid performance issues associated with incrementally removing a large number children, we remove them all and add back the ones we need.
+    group.removeChildren(0, group.getNumChildren());
+
+    for(MergePlan::Nodes::iterator itr = plan.standardChildren.begin();
+        itr != plan.standardChildren.end();
+        ++itr)
+    {
+        group.addChild(*itr);
+    }
 
-        // then build merge list using _targetMaximumNumberOfVertices
-        bool needToDoMerge = false;
-        // dequeue each DuplicateList when vertices limit is reached or when all elements has been checked
-        for(MergeList::iterator itr=mergeListChecked.begin(); itr!=mergeListChecked.end(); ++itr)
+    for(MergePlan::MergeList::iterator mitr = plan.mergeList.begin();
+        mitr != plan.mergeList.end();
+        ++mitr)
+    {
+        if (!mitr->empty()) group.addChild(mitr->front().get());
+    }
+}
+
+void Optimizer::MergeGeometryVisitor::mergeGeometries(MergePlan& plan)
+{
+    for(MergePlan::MergeList::iterator mitr = plan.mergeList.begin();
+        mitr != plan.mergeList.end();
+        ++mitr)
+    {
+        MergePlan::DuplicateList& duplicateList = *mitr;
+        if (!duplicateList.empty())
         {
-            DuplicateList& duplicateList(*itr);
-            if (duplicateList.size()==0)
+            MergePlan::DuplicateList::iterator ditr = duplicateList.begin();
+            osg::ref_ptr<osg::Geometry> lhs = *ditr++;
+
+            for(;
+                ditr != duplicateList.end();
+                ++ditr)
             {
-                continue;
+                mergeGeometry(*lhs, **ditr);
             }
+        }
+    }
+}
 
-            if (duplicateList.size()==1)
+void Optimizer::MergeGeometryVisitor::convertPolygons(osg::Geometry& geom)
+{
+    // convert all polygon primitives which has 3 indices into TRIANGLES, 4 indices into QUADS.
+    osg::Geometry::PrimitiveSetList& primitives = geom.getPrimitiveSetList();
+    for(osg::Geometry::PrimitiveSetList::iterator itr=primitives.begin();
+        itr!=primitives.end();
+        ++itr)
+    {
+        osg::PrimitiveSet* prim = itr->get();
+        if (prim->getMode()==osg::PrimitiveSet::POLYGON)
+        {
+            if (prim->getNumIndices()==3)
             {
-                mergeList.push_back(duplicateList);
-                continue;
+                prim->setMode(osg::PrimitiveSet::TRIANGLES);
+            }
+            else if (prim->getNumIndices()==4)
+            {
+                prim->setMode(osg::PrimitiveSet::QUADS);
             }
+        }
+    }
+}
 
-            unsigned int totalNumberVertices = 0;
-            DuplicateList subset;
-            for(DuplicateList::iterator ditr = duplicateList.begin();
-                ditr != duplicateList.end();
-                ++ditr)
+void Optimizer::MergeGeometryVisitor::combinePrimitives(osg::Geometry& geom)
+{
+    if (geom.getNumPrimitiveSets()>0 &&
+        osg::getBinding(geom.getNormalArray())!=osg::Array::BIND_PER_PRIMITIVE_SET &&
+        osg::getBinding(geom.getColorArray())!=osg::Array::BIND_PER_PRIMITIVE_SET &&
+        osg::getBinding(geom.getSecondaryColorArray())!=osg::Array::BIND_PER_PRIMITIVE_SET &&
+        osg::getBinding(geom.getFogCoordArray())!=osg::Array::BIND_PER_PRIMITIVE_SET)
+    {
+
+#if 1
+        bool doneCombine = false;
+
+        osg::Geometry::PrimitiveSetList& primitives = geom.getPrimitiveSetList();
+        unsigned int lhsNo=0;
+        unsigned int rhsNo=1;
+        while(rhsNo<primitives.size())
+        {
+            osg::PrimitiveSet* lhs = primitives[lhsNo].get();
+            osg::PrimitiveSet* rhs = primitives[rhsNo].get();
+
+            bool combine = false;
+
+            if (lhs->getType()==rhs->getType() &&
+                lhs->getMode()==rhs->getMode())
             {
-                osg::Geometry* geometry = ditr->get();
-                unsigned int numVertices = (geometry->getVertexArray() ? geometry->getVertexArray()->getNumElements() : 0);
-                if ((totalNumberVertices+numVertices)>_targetMaximumNumberOfVertices && !subset.empty())
+
+                switch(lhs->getMode())
                 {
+                case(osg::PrimitiveSet::POINTS):
+                case(osg::PrimitiveSet::LINES):
+                case(osg::PrimitiveSet::TRIANGLES):
+                case(osg::PrimitiveSet::QUADS):
+                    combine = true;
+                    break;
+                }
+
+            }
+
+            if (combine)
+            {
 
-                    mergeList.push_back(subset);
-                    subset.clear();
-                    totalNumberVertices = 0;
+                switch(lhs->getType())
+                {
+                case(osg::PrimitiveSet::DrawArraysPrimitiveType):
+                    combine = mergePrimitive(*(static_cast<osg::DrawArrays*>(lhs)),*(static_cast<osg::DrawArrays*>(rhs)));
+                    break;
+                case(osg::PrimitiveSet::DrawArrayLengthsPrimitiveType):
+                    combine = mergePrimitive(*(static_cast<osg::DrawArrayLengths*>(lhs)),*(static_cast<osg::DrawArrayLengths*>(rhs)));
+                    break;
+                case(osg::PrimitiveSet::DrawElementsUBytePrimitiveType):
+                    combine = mergePrimitive(*(static_cast<osg::DrawElementsUByte*>(lhs)),*(static_cast<osg::DrawElementsUByte*>(rhs)));
+                    break;
+                case(osg::PrimitiveSet::DrawElementsUShortPrimitiveType):
+                    combine = mergePrimitive(*(static_cast<osg::DrawElementsUShort*>(lhs)),*(static_cast<osg::DrawElementsUShort*>(rhs)));
+                    break;
+                case(osg::PrimitiveSet::DrawElementsUIntPrimitiveType):
+                    combine = mergePrimitive(*(static_cast<osg::DrawElementsUInt*>(lhs)),*(static_cast<osg::DrawElementsUInt*>(rhs)));
+                    break;
+                default:
+                    combine = false;
+                    break;
                 }
-                totalNumberVertices += numVertices;
-                subset.push_back(geometry);
-                if (subset.size()>1) needToDoMerge = true;
             }
-            if (!subset.empty()) mergeList.push_back(subset);
+
+            if (combine)
+            {
+                // make this primitive set as invalid and needing cleaning up.
+                rhs->setMode(0xffffff);
+                doneCombine = true;
+                ++rhsNo;
+            }
+            else
+            {
+                lhsNo = rhsNo;
+                ++rhsNo;
+            }
         }
 
-        if (needToDoMerge)
+    #if 1
+        if (doneCombine)
         {
-            // to avoid performance issues associated with incrementally removing a large number children, we remove them all and add back the ones we need.
-            group.removeChildren(0, group.getNumChildren());
+            // now need to clean up primitiveset so it no longer contains the rhs combined primitives.
 
-            for(Nodes::iterator itr = standardChildren.begin();
-                itr != standardChildren.end();
-                ++itr)
+            // first swap with a empty primitiveSet to empty it completely.
+            osg::Geometry::PrimitiveSetList oldPrimitives;
+            primitives.swap(oldPrimitives);
+
+            // now add the active primitive sets
+            for(osg::Geometry::PrimitiveSetList::iterator pitr = oldPrimitives.begin();
+                pitr != oldPrimitives.end();
+                ++pitr)
             {
-                group.addChild(*itr);
+                if ((*pitr)->getMode()!=0xffffff) primitives.push_back(*pitr);
             }
+        }
+    #endif
 
-            // now do the merging of geometries
-            for(MergeList::iterator mitr = mergeList.begin();
-                mitr != mergeList.end();
-                ++mitr)
+#else
+
+        osg::Geometry::PrimitiveSetList& primitives = geom.getPrimitiveSetList();
+        unsigned int primNo=0;
+        while(primNo+1<primitives.size())
+        {
+            osg::PrimitiveSet* lhs = primitives[primNo].get();
+            osg::PrimitiveSet* rhs = primitives[primNo+1].get();
+
+            bool combine = false;
+
+            if (lhs->getType()==rhs->getType() &&
+                lhs->getMode()==rhs->getMode())
             {
-                DuplicateList& duplicateList = *mitr;
-                if (!duplicateList.empty())
+
+                switch(lhs->getMode())
                 {
-                    DuplicateList::iterator ditr = duplicateList.begin();
-                    osg::ref_ptr<osg::Geometry> lhs = *ditr++;
-                    group.addChild(lhs.get());
+                case(osg::PrimitiveSet::POINTS):
+                case(osg::PrimitiveSet::LINES):
+                case(osg::PrimitiveSet::TRIANGLES):
+                case(osg::PrimitiveSet::QUADS):
+                    combine = true;
+                    break;
+                }
 
-                    for(;
-                        ditr != duplicateList.end();
-                        ++ditr)
-                    {
-                        mergeGeometry(*lhs, **ditr);
-                    }
+            }
+
+            if (combine)
+            {
+
+                switch(lhs->getType())
+                {
+                case(osg::PrimitiveSet::DrawArraysPrimitiveType):
+                    combine = mergePrimitive(*(static_cast<osg::DrawArrays*>(lhs)),*(static_cast<osg::DrawArrays*>(rhs)));
+                    break;
+                case(osg::PrimitiveSet::DrawArrayLengthsPrimitiveType):
+                    combine = mergePrimitive(*(static_cast<osg::DrawArrayLengths*>(lhs)),*(static_cast<osg::DrawArrayLengths*>(rhs)));
+                    break;
+                case(osg::PrimitiveSet::DrawElementsUBytePrimitiveType):
+                    combine = mergePrimitive(*(static_cast<osg::DrawElementsUByte*>(lhs)),*(static_cast<osg::DrawElementsUByte*>(rhs)));
+                    break;
+                case(osg::PrimitiveSet::DrawElementsUShortPrimitiveType):
+                    combine = mergePrimitive(*(static_cast<osg::DrawElementsUShort*>(lhs)),*(static_cast<osg::DrawElementsUShort*>(rhs)));
+                    break;
+                case(osg::PrimitiveSet::DrawElementsUIntPrimitiveType):
+                    combine = mergePrimitive(*(static_cast<osg::DrawElementsUInt*>(lhs)),*(static_cast<osg::DrawElementsUInt*>(rhs)));
+                    break;
+                default:
+                    break;
                 }
             }
+            if (combine)
+            {
+                primitives.erase(primitives.begin()+primNo+1);
+            }
+
+            if (!combine)
+            {
+                primNo++;
+            }
         }
+#endif
     }
+}
 
+bool Optimizer::MergeGeometryVisitor::mergeGroup(osg::Group& group)
+{
+    if (!isOperationPermissibleForObject(&group)) return false;
+
+    MergePlan plan;
+    if (computeMergePlan(group, plan))
+    {
+        replaceChildren(group, plan);
+        mergeGeometries(plan);
+    }
 
-    // convert all polygon primitives which has 3 indices into TRIANGLES, 4 indices into QUADS.
     unsigned int i;
     for(i=0;i<group.getNumChildren();++i)
     {
-        osg::Drawable* drawable = group.getChild(i)->asDrawable();
-        if (!drawable)
-            continue;
-        osg::Geometry* geom = drawable->asGeometry();
-        if (geom)
-        {
-            osg::Geometry::PrimitiveSetList& primitives = geom->getPrimitiveSetList();
-            for(osg::Geometry::PrimitiveSetList::iterator itr=primitives.begin();
-                itr!=primitives.end();
-                ++itr)
-            {
-                osg::PrimitiveSet* prim = itr->get();
-                if (prim->getMode()==osg::PrimitiveSet::POLYGON)
-                {
-                    if (prim->getNumIndices()==3)
-                    {
-                        prim->setMode(osg::PrimitiveSet::TRIANGLES);
-                    }
-                    else if (prim->getNumIndices()==4)
-                    {
-                        prim->setMode(osg::PrimitiveSet::QUADS);
-                    }
-                }
-            }
-        }
+        osg::Geometry* geom = group.getChild(i)->asGeometry();
+        if (geom) convertPolygons(*geom);
     }
 
     // now merge any compatible primitives.
     for(i=0;i<group.getNumChildren();++i)
     {
-        osg::Drawable* drawable = group.getChild(i)->asDrawable();
-        if (!drawable)
-            continue;
-        osg::Geometry* geom = drawable->asGeometry();
-        if (geom)
-        {
-            if (geom->getNumPrimitiveSets()>0 &&
-                osg::getBinding(geom->getNormalArray())!=osg::Array::BIND_PER_PRIMITIVE_SET &&
-                osg::getBinding(geom->getColorArray())!=osg::Array::BIND_PER_PRIMITIVE_SET &&
-                osg::getBinding(geom->getSecondaryColorArray())!=osg::Array::BIND_PER_PRIMITIVE_SET &&
-                osg::getBinding(geom->getFogCoordArray())!=osg::Array::BIND_PER_PRIMITIVE_SET)
-            {
+        osg::Geometry* geom = group.getChild(i)->asGeometry();
+        if (geom) combinePrimitives(*geom);
+    }
 
-#if 1
-                bool doneCombine = false;
+    return false;
+}
 
-                osg::Geometry::PrimitiveSetList& primitives = geom->getPrimitiveSetList();
-                unsigned int lhsNo=0;
-                unsigned int rhsNo=1;
-                while(rhsNo<primitives.size())
-                {
-                    osg::PrimitiveSet* lhs = primitives[lhsNo].get();
-                    osg::PrimitiveSet* rhs = primitives[rhsNo].get();
+namespace
+{
 
-                    bool combine = false;
+class CollectMergeGroupsVisitor : public osg::NodeVisitor
+{
+    public:
 
-                    if (lhs->getType()==rhs->getType() &&
-                        lhs->getMode()==rhs->getMode())
-                    {
+        typedef std::vector<osg::Group*> Groups;
 
-                        switch(lhs->getMode())
-                        {
-                        case(osg::PrimitiveSet::POINTS):
-                        case(osg::PrimitiveSet::LINES):
-                        case(osg::PrimitiveSet::TRIANGLES):
-                        case(osg::PrimitiveSet::QUADS):
-                            combine = true;
-                            break;
-                        }
+        CollectMergeGroupsVisitor(Optimizer::MergeGeometryVisitor& mgv):
+            osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+            _mgv(mgv)
+        {
+            setNodeMaskOverride(0xffffffff);
+        }
 
-                    }
+        virtual void apply(osg::Group& group)
+        {
+            if (_visited.insert(&group).second)
+            {
+                if (_mgv.isOperationPermissibleForObject(&group)) _groups.push_back(&group);
+            }
+            traverse(group);
+        }
 
-                    if (combine)
-                    {
+        virtual void apply(osg::Billboard&) {}
 
-                        switch(lhs->getType())
-                        {
-                        case(osg::PrimitiveSet::DrawArraysPrimitiveType):
-                            combine = mergePrimitive(*(static_cast<osg::DrawArrays*>(lhs)),*(static_cast<osg::DrawArrays*>(rhs)));
-                            break;
-                        case(osg::PrimitiveSet::DrawArrayLengthsPrimitiveType):
-                            combine = mergePrimitive(*(static_cast<osg::DrawArrayLengths*>(lhs)),*(static_cast<osg::DrawArrayLengths*>(rhs)));
-                            break;
-                        case(osg::PrimitiveSet::DrawElementsUBytePrimitiveType):
-                            combine = mergePrimitive(*(static_cast<osg::DrawElementsUByte*>(lhs)),*(static_cast<osg::DrawElementsUByte*>(rhs)));
-                            break;
-                        case(osg::PrimitiveSet::DrawElementsUShortPrimitiveType):
-                            combine = mergePrimitive(*(static_cast<osg::DrawElementsUShort*>(lhs)),*(static_cast<osg::DrawElementsUShort*>(rhs)));
-                            break;
-                        case(osg::PrimitiveSet::DrawElementsUIntPrimitiveType):
-                            combine = mergePrimitive(*(static_cast<osg::DrawElementsUInt*>(lhs)),*(static_cast<osg::DrawElementsUInt*>(rhs)));
-                            break;
-                        default:
-                            combine = false;
-                            break;
-                        }
-                    }
+        Optimizer::MergeGeometryVisitor&    _mgv;
+        std::set<osg::Group*>               _visited;
+        Groups                              _groups;
+};
 
-                    if (combine)
-                    {
-                        // make this primitive set as invalid and needing cleaning up.
-                        rhs->setMode(0xffffff);
-                        doneCombine = true;
-                        ++rhsNo;
-                    }
-                    else
-                    {
-                        lhsNo = rhsNo;
-                        ++rhsNo;
-                    }
-                }
+}
 
-    #if 1
-                if (doneCombine)
-                {
-                    // now need to clean up primitiveset so it no longer contains the rhs combined primitives.
+struct Optimizer::MergeGeometryVisitor::MergeGroupsOperation : public Optimizer::TaskOperation
+{
+    typedef std::vector<osg::Group*>    Groups;
+    typedef std::vector<MergePlan>      MergePlans;
 
-                    // first swap with a empty primitiveSet to empty it completely.
-                    osg::Geometry::PrimitiveSetList oldPrimitives;
-                    primitives.swap(oldPrimitives);
+    MergeGroupsOperation(MergeGeometryVisitor& mgv, const Groups& groups):
+        _mgv(mgv),
+        _groups(groups),
+        _plans(groups.size()) {}
 
-                    // now add the active primitive sets
-                    for(osg::Geometry::PrimitiveSetList::iterator pitr = oldPrimitives.begin();
-                        pitr != oldPrimitives.end();
-                        ++pitr)
-                    {
-                        if ((*pitr)->getMode()!=0xffffff) primitives.push_back(*pitr);
-                    }
-                }
-    #endif
+    virtual void operator()(unsigned int taskIndex)
+    {
+        osg::Group& group = *_groups[taskIndex];
+        MergePlan& plan = _plans[taskIndex];
 
-#else
+        typedef std::vector<osg::Geometry*> Geometries;
+        Geometries geometries;
 
-                osg::Geometry::PrimitiveSetList& primitives = geom->getPrimitiveSetList();
-                unsigned int primNo=0;
-                while(primNo+1<primitives.size())
-                {
-                    osg::PrimitiveSet* lhs = primitives[primNo].get();
-                    osg::PrimitiveSet* rhs = primitives[primNo+1].get();
+        if (_mgv.computeMergePlan(group, plan))
+        {
+            mergeGeometries(plan);
 
-                    bool combine = false;
+            // collect the geometries that will make up the group once the children have been replaced.
+            for(MergePlan::Nodes::iterator itr = plan.standardChildren.begin();
+                itr != plan.standardChildren.end();
+                ++itr)
+            {
+                osg::Geometry* geom = (*itr)->asGeometry();
+                if (geom) geometries.push_back(geom);
+            }
 
-                    if (lhs->getType()==rhs->getType() &&
-                        lhs->getMode()==rhs->getMode())
-                    {
+            for(MergePlan::MergeList::iterator mitr = plan.mergeList.begin();
+                mitr != plan.mergeList.end();
+                ++mitr)
+            {
+                if (!mitr->empty()) geometries.push_back(mitr->front().get());
+            }
+        }
+        else
+        {
+            for(unsigned int i=0;i<group.getNumChildren();++i)
+            {
+                osg::Geometry* geom = group.getChild(i)->asGeometry();
+                if (geom) geometries.push_back(geom);
+            }
+        }
 
-                        switch(lhs->getMode())
-                        {
-                        case(osg::PrimitiveSet::POINTS):
-                        case(osg::PrimitiveSet::LINES):
-                        case(osg::PrimitiveSet::TRIANGLES):
-                        case(osg::PrimitiveSet::QUADS):
-                            combine = true;
-                            break;
-                        }
+        Geometries::iterator itr;
+        for(itr = geometries.begin(); itr != geometries.end(); ++itr)
+        {
+            convertPolygons(**itr);
+        }
 
-                    }
+        for(itr = geometries.begin(); itr != geometries.end(); ++itr)
+        {
+            combinePrimitives(**itr);
+        }
+    }
 
-                    if (combine)
-                    {
+    MergeGeometryVisitor&   _mgv;
+    const Groups&           _groups;
+    MergePlans              _plans;
+};
 
-                        switch(lhs->getType())
-                        {
-                        case(osg::PrimitiveSet::DrawArraysPrimitiveType):
-                            combine = mergePrimitive(*(static_cast<osg::DrawArrays*>(lhs)),*(static_cast<osg::DrawArrays*>(rhs)));
-                            break;
-                        case(osg::PrimitiveSet::DrawArrayLengthsPrimitiveType):
-                            combine = mergePrimitive(*(static_cast<osg::DrawArrayLengths*>(lhs)),*(static_cast<osg::DrawArrayLengths*>(rhs)));
-                            break;
-                        case(osg::PrimitiveSet::DrawElementsUBytePrimitiveType):
-                            combine = mergePrimitive(*(static_cast<osg::DrawElementsUByte*>(lhs)),*(static_cast<osg::DrawElementsUByte*>(rhs)));
-                            break;
-                        case(osg::PrimitiveSet::DrawElementsUShortPrimitiveType):
-                            combine = mergePrimitive(*(static_cast<osg::DrawElementsUShort*>(lhs)),*(static_cast<osg::DrawElementsUShort*>(rhs)));
-                            break;
-                        case(osg::PrimitiveSet::DrawElementsUIntPrimitiveType):
-                            combine = mergePrimitive(*(static_cast<osg::DrawElementsUInt*>(lhs)),*(static_cast<osg::DrawElementsUInt*>(rhs)));
-                            break;
-                        default:
-                            break;
-                        }
-                    }
-                    if (combine)
-                    {
-                        primitives.erase(primitives.begin()+primNo+1);
-                    }
+void Optimizer::MergeGeometryVisitor::mergeSubgraph(osg::Node& node)
+{
+    if (!_optimizer || _optimizer->getNumThreads()==1)
+    {
+        node.accept(*this);
+        return;
+    }
 
-                    if (!combine)
-                    {
-                        primNo++;
-                    }
-                }
-#endif
-            }
+    CollectMergeGroupsVisitor cmgv(*this);
+    node.accept(cmgv);
+
+    // groups sharing geometries, arrays or primitive sets have to be handled by the same thread.
+    TaskPartitioner partitioner;
+    unsigned int numGroups = static_cast<unsigned int>(cmgv._groups.size());
+    for(unsigned int gi=0; gi<numGroups; ++gi)
+    {
+        osg::Group* group = cmgv._groups[gi];
+        for(unsigned int i=0;i<group->getNumChildren();++i)
+        {
+            osg::Geometry* geom = group->getChild(i)->asGeometry();
+            if (geom) partitioner.addGeometry(gi, geom);
         }
+    }
 
+    TaskPartitioner::Tasks tasks;
+    partitioner.getTasks(numGroups, tasks);
 
+    MergeGroupsOperation::Groups independentGroups;
+    for(TaskPartitioner::Tasks::iterator itr = tasks.begin();
+        itr != tasks.end();
+        ++itr)
+    {
+        if (itr->size()==1) independentGroups.push_back(cmgv._groups[itr->front()]);
     }
 
-//    geode.dirtyBound();
+    // dirty the bounds up front so that dirtyBound() calls made while merging don't propagate
+    // to parents that are shared between threads.
+    for(MergeGroupsOperation::Groups::iterator itr = independentGroups.begin();
+        itr != independentGroups.end();
+        ++itr)
+    {
+        osg::Group* group = *itr;
+        for(unsigned int i=0;i<group->getNumChildren();++i)
+        {
+            osg::Geometry* geom = group->getChild(i)->asGeometry();
+            if (geom) geom->dirtyBound();
+        }
+    }
 
+    OSG_INFO<<"MergeGeometryVisitor::mergeSubgraph() merging "<<independentGroups.size()<<" of "<<numGroups<<" groups concurrently"<<std::endl;
 
-    return false;
+    MergeGroupsOperation operation(*this, independentGroups);
+    _optimizer->runTasks(operation, static_cast<unsigned int>(independentGroups.size()));
+
+    // changing the children modifies the parent lists of shared nodes so is done single threaded.
+    for(unsigned int i=0; i<independentGroups.size(); ++i)
+    {
+        if (operation._plans[i].needToDoMerge) replaceChildren(*independentGroups[i], operation._plans[i]);
+    }
+
+    // groups that share geometry data are merged in traversal order.
+    for(TaskPartitioner::Tasks::iterator itr = tasks.begin();
+        itr != tasks.end();
+        ++itr)
+    {
+        if (itr->size()<=1) continue;
+
+        for(TaskPartitioner::Items::iterator gitr = itr->begin();
+            gitr != itr->end();
+            ++gitr)
+        {
+            mergeGroup(*cmgv._groups[*gitr]);
+        }
+    }
 }
 
 bool Optimizer::MergeGeometryVisitor::geometryContainsSharedArrays(osg::Geometry& geom)
@@ -564,7 +564,7 @@ void PolytopeIntersector::intersect(osgUtil::IntersectionVisitor& iv, osg::Drawa
         osg::TemplatePrimitiveFunctor<PolytopeIntersectorUtils::IntersectFunctor<osg::Vec3d> > intersector;
         intersector._settings = settings;
 
-        if (kdTree) kdTree->intersect(intersector, kdTree->getNode(0));
+        if (kdTree) kdTree->intersect(intersector);
         else drawable->accept(intersector);
     }
     else
@@ -572,7 +572,7 @@ void PolytopeIntersector::intersect(osgUtil::IntersectionVisitor& iv, osg::Drawa
         osg::TemplatePrimitiveFunctor<PolytopeIntersectorUtils::IntersectFunctor<osg::Vec3f> > intersector;
         intersector._settings = settings;
 
-        if (kdTree) kdTree->intersect(intersector, kdTree->getNode(0));
+        if (kdTree) kdTree->intersect(intersector);
         else drawable->accept(intersector);
     }
 }
@@ -22,6 +22,7 @@
 #include <osg/AlphaFunc>
 
 #include <algorithm>
+#include <typeinfo>
 
 using namespace osg;
 using namespace osgUtil;
@@ -149,6 +150,7 @@ RenderBin::RenderBin()
     _stage = NULL;
     _sorted = false;
     _sortMode = getDefaultRenderBinSortMode();
+    _used = true;
 }
 
 RenderBin::RenderBin(SortMode mode)
@@ -158,6 +160,7 @@ RenderBin::RenderBin(SortMode mode)
     _stage = NULL;
     _sorted = false;
     _sortMode = mode;
+    _used = true;
 
 #if 1
     if (_sortMode==SORT_BACK_TO_FRONT)
@@ -189,7 +192,9 @@ RenderBin::RenderBin(const RenderBin& rhs,const CopyOp& copyop):
         _sortMode(rhs._sortMode),
         _sortCallback(rhs._sortCallback),
         _drawCallback(rhs._drawCallback),
-        _stateset(rhs._stateset)
+        _stateset(rhs._stateset),
+        _binName(rhs._binName),
+        _used(true)
 {
 
 }
@@ -202,14 +207,53 @@ void RenderBin::reset()
 {
     _stateGraphList.clear();
     _renderLeafList.clear();
-    _bins.clear();
+
+    // keep the child bins, along with the capacity of their lists, for reuse by the next frame.
+    for(RenderBinList::iterator itr = _bins.begin();
+        itr != _bins.end();
+        ++itr)
+    {
+        itr->second->reset();
+        itr->second->_used = false;
+    }
+
     _sorted = false;
 }
 
+bool RenderBin::reuse(const RenderBin* source)
+{
+    // subclasses, RenderStages among them, may carry per frame state or need registering
+    // with their stage, so only plain RenderBins are reused rather than created afresh.
+    if (!source || typeid(*this)!=typeid(RenderBin) || typeid(*source)!=typeid(RenderBin)) return false;
+
+    // restore the state a clone of the source would have, the cull may have changed it last frame.
+    _rootStateGraph = NULL;
+    _sortMode = source->_sortMode;
+    _sortCallback = source->_sortCallback;
+    _drawCallback = source->_drawCallback;
+    _stateset = source->_stateset;
+    _used = true;
+
+    return true;
+}
+
+void RenderBin::removeUnusedRenderBins()
+{
+    for(RenderBinList::iterator itr = _bins.begin();
+        itr != _bins.end();
+        )
+    {
+        if (itr->second->_used) ++itr;
+        else _bins.erase(itr++);
+    }
+}
+
 void RenderBin::sort()
 {
     if (_sorted) return;
 
+    removeUnusedRenderBins();
+
     for(RenderBinList::iterator itr = _bins.begin();
         itr!=_bins.end();
         ++itr)
@@ -272,78 +316,166 @@ void RenderBin::sortByState()
 }
 
 
-struct StateGraphFrontToBackSortFunctor
+namespace
 {
-    bool operator() (const StateGraph* lhs,const StateGraph* rhs) const
+    /** Map a depth to a key whose unsigned integer order is the order of the depths, with -0 and +0 equal.*/
+    inline unsigned int depthSortKey(float depth)
     {
-        return (lhs->_minimumDistance<rhs->_minimumDistance);
+        if (depth==0.0f) depth = 0.0f;
+
+        union { float f; unsigned int u; } value;
+        value.f = depth;
+        return (value.u & 0x80000000u) ? ~value.u : (value.u | 0x80000000u);
     }
-};
 
-void RenderBin::sortByStateThenFrontToBack()
-{
-    for(StateGraphList::iterator itr=_stateGraphList.begin();
-        itr!=_stateGraphList.end();
-        ++itr)
+    /** Reorder list into the order of the sorted keys, swapping elements so that ref_ptr<> are not ref'd and unref'd.*/
+    template<class List, class Keys>
+    void applySortKeys(List& list, List& scratch, const Keys& keys)
     {
-        (*itr)->sortFrontToBack();
-        (*itr)->getMinimumDistance();
+        using std::swap;
+        scratch.resize(list.size());
+        for(unsigned int i=0; i<keys.size(); ++i)
+        {
+            swap(scratch[i], list[keys[i].index]);
+        }
+        list.swap(scratch);
     }
-    std::sort(_stateGraphList.begin(),_stateGraphList.end(),StateGraphFrontToBackSortFunctor());
 }
 
-struct FrontToBackSortFunctor
+void RenderBin::sortKeys()
 {
-    bool operator() (const RenderLeaf* lhs,const RenderLeaf* rhs) const
+    const unsigned int numKeys = _sortKeys.size();
+
+    // insertion sort short lists, such as the leaves of most StateGraphs, rather than paying for the histograms.
+    if (numKeys<64)
     {
-        return (lhs->_depth<rhs->_depth);
+        for(unsigned int i=1; i<numKeys; ++i)
+        {
+            SortKey sortKey = _sortKeys[i];
+            unsigned int j = i;
+            for(; j>0 && sortKey.key<_sortKeys[j-1].key; --j)
+            {
+                _sortKeys[j] = _sortKeys[j-1];
+            }
+            _sortKeys[j] = sortKey;
+        }
+        return;
     }
-};
 
+    // least significant digit first radix sort, a byte at a time, which is stable so equal keys keep their order.
+    unsigned int counts[4][256];
+    std::fill(&counts[0][0], &counts[0][0]+4*256, 0u);
+    for(SortKeyList::const_iterator itr = _sortKeys.begin();
+        itr != _sortKeys.end();
+        ++itr)
+    {
+        ++counts[0][itr->key & 0xff];
+        ++counts[1][(itr->key>>8) & 0xff];
+        ++counts[2][(itr->key>>16) & 0xff];
+        ++counts[3][itr->key>>24];
+    }
 
-void RenderBin::sortFrontToBack()
-{
-    copyLeavesFromStateGraphListToRenderLeafList();
+    _sortKeysScratch.resize(numKeys);
+    SortKey* source = &_sortKeys.front();
+    SortKey* destination = &_sortKeysScratch.front();
+    for(unsigned int digit=0; digit<4; ++digit)
+    {
+        unsigned int shift = digit*8;
 
-    // now sort the list into ascending depth order.
-    std::sort(_renderLeafList.begin(),_renderLeafList.end(),FrontToBackSortFunctor());
+        // skip digits that all the keys share.
+        if (counts[digit][(source[0].key>>shift) & 0xff]==numKeys) continue;
+
+        unsigned int offset = 0;
+        for(unsigned int b=0; b<256; ++b)
+        {
+            unsigned int count = counts[digit][b];
+            counts[digit][b] = offset;
+            offset += count;
+        }
+
+        for(unsigned int i=0; i<numKeys; ++i)
+        {
+            destination[counts[digit][(source[i].key>>shift) & 0xff]++] = source[i];
+        }
+
+        std::swap(source, destination);
+    }
 
-//    cout << "sort front to back"<<endl;
+    if (source!=&_sortKeys.front()) _sortKeys.swap(_sortKeysScratch);
 }
 
-struct BackToFrontSortFunctor
+void RenderBin::sortByStateThenFrontToBack()
 {
-    bool operator() (const RenderLeaf* lhs,const RenderLeaf* rhs) const
+    for(StateGraphList::iterator itr=_stateGraphList.begin();
+        itr!=_stateGraphList.end();
+        ++itr)
     {
-        return (rhs->_depth<lhs->_depth);
+        StateGraph::LeafList& leaves = (*itr)->_leaves;
+        _sortKeys.resize(leaves.size());
+        for(unsigned int i=0; i<leaves.size(); ++i)
+        {
+            _sortKeys[i].key = depthSortKey(leaves[i]->_depth);
+            _sortKeys[i].index = i;
+        }
+        sortKeys();
+        applySortKeys(leaves, _leafListScratch, _sortKeys);
+
+        (*itr)->getMinimumDistance();
     }
-};
 
-void RenderBin::sortBackToFront()
+    _sortKeys.resize(_stateGraphList.size());
+    for(unsigned int i=0; i<_stateGraphList.size(); ++i)
+    {
+        _sortKeys[i].key = depthSortKey(_stateGraphList[i]->_minimumDistance);
+        _sortKeys[i].index = i;
+    }
+    sortKeys();
+    applySortKeys(_stateGraphList, _stateGraphListScratch, _sortKeys);
+}
+
+void RenderBin::sortFrontToBack()
 {
     copyLeavesFromStateGraphListToRenderLeafList();
 
     // now sort the list into ascending depth order.
-    std::sort(_renderLeafList.begin(),_renderLeafList.end(),BackToFrontSortFunctor());
-
-//    cout << "sort back to front"<<endl;
+    _sortKeys.resize(_renderLeafList.size());
+    for(unsigned int i=0; i<_renderLeafList.size(); ++i)
+    {
+        _sortKeys[i].key = depthSortKey(_renderLeafList[i]->_depth);
+        _sortKeys[i].index = i;
+    }
+    sortKeys();
+    applySortKeys(_renderLeafList, _renderLeafListScratch, _sortKeys);
 }
 
-
-struct TraversalOrderFunctor
+void RenderBin::sortBackToFront()
 {
-    bool operator() (const RenderLeaf* lhs,const RenderLeaf* rhs) const
+    copyLeavesFromStateGraphListToRenderLeafList();
+
+    // now sort the list into descending depth order.
+    _sortKeys.resize(_renderLeafList.size());
+    for(unsigned int i=0; i<_renderLeafList.size(); ++i)
     {
-        return (lhs->_traversalOrderNumber<rhs->_traversalOrderNumber);
+        _sortKeys[i].key = ~depthSortKey(_renderLeafList[i]->_depth);
+        _sortKeys[i].index = i;
     }
-};
+    sortKeys();
+    applySortKeys(_renderLeafList, _renderLeafListScratch, _sortKeys);
+}
 
 void RenderBin::sortTraversalOrder()
 {
     copyLeavesFromStateGraphListToRenderLeafList();
 
-    // now sort the list into ascending depth order.
-    std::sort(_renderLeafList.begin(),_renderLeafList.end(),TraversalOrderFunctor());
+    // now sort the list into ascending traversal order.
+    _sortKeys.resize(_renderLeafList.size());
+    for(unsigned int i=0; i<_renderLeafList.size(); ++i)
+    {
+        _sortKeys[i].key = _renderLeafList[i]->_traversalOrderNumber;
+        _sortKeys[i].index = i;
+    }
+    sortKeys();
+    applySortKeys(_renderLeafList, _renderLeafListScratch, _sortKeys);
 }
 
 void RenderBin::copyLeavesFromStateGraphListToRenderLeafList()
@@ -391,14 +523,21 @@ void RenderBin::copyLeavesFromStateGraphListToRenderLeafList()
 
 RenderBin* RenderBin::find_or_insert(int binNum,const std::string& binName)
 {
-    // search for appropriate bin.
+    // search for appropriate bin, a bin kept from a previous frame is only reused if it is a plain RenderBin from the same prototype.
     RenderBinList::iterator itr = _bins.find(binNum);
-    if (itr!=_bins.end()) return itr->second.get();
+    if (itr!=_bins.end())
+    {
+        RenderBin* bin = itr->second.get();
+        if (bin->_used) return bin;
+        if (bin->_binName==binName && bin->reuse(getRenderBinPrototype(binName))) return bin;
+    }
 
     // create a rendering bin and insert into bin list.
     RenderBin* rb = RenderBin::createRenderBin(binName);
     if (rb)
     {
+        rb->_binName = binName;
+        rb->_used = true;
 
         RenderStage* rs = dynamic_cast<RenderStage*>(rb);
         if (rs)
@@ -419,6 +558,33 @@ RenderBin* RenderBin::find_or_insert(int binNum,const std::string& binName)
     return rb;
 }
 
+RenderBin* RenderBin::find_or_insert(const RenderBin* bin)
+{
+    // search for appropriate bin, a bin kept from a previous frame is only reused if it is a plain RenderBin like the one merged.
+    RenderBinList::iterator itr = _bins.find(bin->_binNum);
+    if (itr!=_bins.end())
+    {
+        RenderBin* existing = itr->second.get();
+        if (existing->_used) return existing;
+        if (existing->_binName==bin->_binName && existing->reuse(bin)) return existing;
+    }
+
+    // create an empty copy of the bin, bins are created as clones of the registered prototypes
+    // so the copy has the same implementation and sort settings as a bin of the same name.
+    RenderBin* rb = dynamic_cast<RenderBin*>(bin->clone(osg::CopyOp::SHALLOW_COPY));
+    if (rb)
+    {
+        // the copy shares the child bins of the original so discard rather than reset them.
+        rb->_bins.clear();
+        rb->reset();
+        rb->_binNum = bin->_binNum;
+        rb->_parent = this;
+        rb->_stage = _stage;
+        _bins[rb->_binNum] = rb;
+    }
+    return rb;
+}
+
 void RenderBin::draw(osg::RenderInfo& renderInfo,RenderLeaf*& previous)
 {
     renderInfo.pushRenderBin(this);
@@ -141,6 +141,10 @@ SceneView::SceneView(DisplaySettings* ds)
 
     _dynamicObjectCount = 0;
 
+    _sharedStereoCullTraversal = false;
+    _sharedStereoCullRetryInterval = 0;
+    _sharedStereoCullFramesToSkip = 0;
+
     _resetColorMaskToAllEnabled = true;
 }
 
@@ -178,6 +182,10 @@ SceneView::SceneView(const SceneView& rhs, const osg::CopyOp& copyop):
 
     _dynamicObjectCount = 0;
 
+    _sharedStereoCullTraversal = false;
+    _sharedStereoCullRetryInterval = 0;
+    _sharedStereoCullFramesToSkip = 0;
+
     _resetColorMaskToAllEnabled = rhs._resetColorMaskToAllEnabled;
 }
 
@@ -727,11 +735,23 @@ void SceneView::cull()
             if (!_stateGraphRight.valid()) _stateGraphRight = _stateGraph->cloneStateGraph();
             if (!_renderStageRight.valid()) _renderStageRight = osg::clone(_renderStage.get(), osg::CopyOp::DEEP_COPY_ALL);
 
+            bool computeNearFar = false;
+            if (_displaySettings->getSharedStereoCullHint() && cullStereoShared(computeNearFar))
+            {
+                if (computeNearFar)
+                {
+                    CullVisitor::value_type zNear = _cullVisitor->getCalculatedNearPlane();
+                    CullVisitor::value_type zFar = _cullVisitor->getCalculatedFarPlane();
+                    _cullVisitor->clampProjectionMatrix(getProjectionMatrix(),zNear,zFar);
+                }
+                return;
+            }
+
             _cullVisitorLeft->setDatabaseRequestHandler(_cullVisitor->getDatabaseRequestHandler());
             _cullVisitorLeft->setClampProjectionMatrixCallback(_cullVisitor->getClampProjectionMatrixCallback());
             _cullVisitorLeft->setTraversalMask(_cullMaskLeft);
             computeLeftEyeViewport(getViewport());
-            bool computeNearFar = cullStage(computeLeftEyeProjection(getProjectionMatrix()),computeLeftEyeView(getViewMatrix()),_cullVisitorLeft.get(),_stateGraphLeft.get(),_renderStageLeft.get(),_viewportLeft.get());
+            computeNearFar = cullStage(computeLeftEyeProjection(getProjectionMatrix()),computeLeftEyeView(getViewMatrix()),_cullVisitorLeft.get(),_stateGraphLeft.get(),_renderStageLeft.get(),_viewportLeft.get());
 
 
             // set up the right eye.
@@ -882,6 +902,16 @@ bool SceneView::cullStage(const osg::Matrixd& projection,const osg::Matrixd& mod
 
     cullVisitor->pushViewport(viewport);
     cullVisitor->pushProjectionMatrix(proj.get());
+
+    // a traversal shared by both eyes culls against a frustum enclosing both, see cullStereoShared().
+    if (_sharedStereoCullTraversal)
+    {
+        osg::Polytope& frustum = cullVisitor->getProjectionCullingStack().back().getFrustum();
+        frustum.getMaskStack().clear();
+        frustum.set(_sharedStereoCullFrustum.getPlaneList());
+        _sharedStereoCullProjection = proj;
+    }
+
     cullVisitor->pushModelViewMatrix(mv.get(),osg::Transform::ABSOLUTE_RF);
 
     // traverse the scene graph to generate the rendergraph.
@@ -903,7 +933,8 @@ bool SceneView::cullStage(const osg::Matrixd& projection,const osg::Matrixd& mod
     if (_globalStateSet.valid()) cullVisitor->popStateSet();
 
 
-    renderStage->sort();
+    // the RenderStage of a shared traversal is copied to those of the eyes rather than drawn.
+    if (!_sharedStereoCullTraversal) renderStage->sort();
 
     // prune out any empty StateGraph children.
     // note, this would be not required if the rendergraph had been
@@ -913,13 +944,212 @@ bool SceneView::cullStage(const osg::Matrixd& projection,const osg::Matrixd& mod
     rendergraph->prune();
 
     // set the number of dynamic objects in the scene.
-    _dynamicObjectCount += renderStage->computeNumberOfDynamicRenderLeaves();
+    if (!_sharedStereoCullTraversal) _dynamicObjectCount += renderStage->computeNumberOfDynamicRenderLeaves();
 
 
     bool computeNearFar = (cullVisitor->getComputeNearFarMode()!=osgUtil::CullVisitor::DO_NOT_COMPUTE_NEAR_FAR) && getSceneData()!=0;
     return computeNearFar;
 }
 
+namespace
+{
+
+/** Compute the corners, and the directions of the edges from near to far, of the frustum of projection in the eye
+  * coordinates of the view it is offset from. Returns false if the frustum has no far corners, as infinite projections don't.*/
+bool computeFrustumCorners(const osg::Matrixd& viewOffset, const osg::Matrixd& projection, std::vector<osg::Vec3d>& corners, std::vector<osg::Vec3d>& edges)
+{
+    osg::Matrixd clipToEye;
+    if (!clipToEye.invert(viewOffset*projection)) return false;
+
+    corners.clear();
+    edges.clear();
+    for(int i=0; i<4; ++i)
+    {
+        double x = (i&1) ? 1.0 : -1.0;
+        double y = (i&2) ? 1.0 : -1.0;
+        osg::Vec4d nearCorner = osg::Vec4d(x, y, -1.0, 1.0)*clipToEye;
+        osg::Vec4d farCorner = osg::Vec4d(x, y, 1.0, 1.0)*clipToEye;
+        if (nearCorner.w()<=0.0 || farCorner.w()<=0.0) return false;
+
+        osg::Vec3d n(nearCorner.x()/nearCorner.w(), nearCorner.y()/nearCorner.w(), nearCorner.z()/nearCorner.w());
+        osg::Vec3d f(farCorner.x()/farCorner.w(), farCorner.y()/farCorner.w(), farCorner.z()/farCorner.w());
+        corners.push_back(n);
+        corners.push_back(f);
+        edges.push_back(f-n);
+    }
+    return true;
+}
+
+/** Return how far plane has to be moved to enclose the frustum of another view, or -1 if it can't be, as when the
+  * frustum isn't bounded by a far plane and its edges diverge from plane.*/
+double computePlaneRelaxation(const osg::Plane& plane, const std::vector<osg::Vec3d>& corners, const std::vector<osg::Vec3d>& edges, bool withFar)
+{
+    if (!withFar)
+    {
+        for(std::vector<osg::Vec3d>::const_iterator itr = edges.begin(); itr != edges.end(); ++itr)
+        {
+            if (plane.getNormal()*(*itr) < -1e-6*itr->length()) return -1.0;
+        }
+    }
+
+    double relaxation = 0.0;
+    for(std::vector<osg::Vec3d>::const_iterator itr = corners.begin(); itr != corners.end(); ++itr)
+    {
+        relaxation = osg::maximum(relaxation, -plane.distance(*itr));
+    }
+    return relaxation;
+}
+
+}
+
+bool SceneView::cullStereoShared(bool& computeNearFar)
+{
+    if (!_camera || !getViewport()) return false;
+
+    // after a shared traversal has had to fall back to culling each eye, skip the ones that would most likely fail too.
+    if (_sharedStereoCullFramesToSkip>0)
+    {
+        --_sharedStereoCullFramesToSkip;
+        return false;
+    }
+
+    // the eyes can only share a traversal that would visit the same nodes, without occluders positioned for each eye.
+    if (_cullMaskLeft!=_cullMaskRight || _camera->containsOccluderNodes() || (getCullingMode()&SOFTWARE_OCCLUSION_CULLING)!=0) return false;
+
+    osg::Matrixd inverseView;
+    if (!inverseView.invert(getViewMatrix())) return false;
+
+    computeLeftEyeViewport(getViewport());
+    computeRightEyeViewport(getViewport());
+
+    osgUtil::CullVisitor* cullVisitors[2] = { _cullVisitorLeft.get(), _cullVisitorRight.get() };
+    osgUtil::StateGraph* stateGraphs[2] = { _stateGraphLeft.get(), _stateGraphRight.get() };
+    osgUtil::RenderStage* renderStages[2] = { _renderStageLeft.get(), _renderStageRight.get() };
+    osg::Viewport* viewports[2] = { _viewportLeft.get(), _viewportRight.get() };
+    osg::ref_ptr<osg::RefMatrix> projections[2] = { new osg::RefMatrix(computeLeftEyeProjection(getProjectionMatrix())), new osg::RefMatrix(computeRightEyeProjection(getProjectionMatrix())) };
+    osg::ref_ptr<osg::RefMatrix> views[2] = { new osg::RefMatrix(computeLeftEyeView(getViewMatrix())), new osg::RefMatrix(computeRightEyeView(getViewMatrix())) };
+    osg::Matrixd viewOffsets[2] = { inverseView*(*views[0]), inverseView*(*views[1]) };
+
+    // the frusta of the eyes in the eye coordinates of the shared view, the one CullStack would set up for each.
+    bool withNear = (getCullingMode()&NEAR_PLANE_CULLING)!=0;
+    bool withFar = (getCullingMode()&FAR_PLANE_CULLING)!=0;
+    osg::Polytope frusta[2];
+    std::vector<osg::Vec3d> corners[2];
+    std::vector<osg::Vec3d> edges[2];
+    for(int i=0; i<2; ++i)
+    {
+        if (!computeFrustumCorners(viewOffsets[i], *projections[i], corners[i], edges[i])) return false;
+
+        // with the near plane unbounded the frustum extends back to the eye.
+        if (!withNear) corners[i].push_back(osg::Vec3d(0.0,0.0,0.0)*osg::Matrixd::inverse(viewOffsets[i]));
+
+        frusta[i].setToUnitFrustum(withNear, withFar);
+        frusta[i].transformProvidingInverse(viewOffsets[i]*(*projections[i]));
+        if ((getCullingMode()&VIEW_FRUSTUM_SIDES_CULLING)==0) frusta[i].getPlaneList().clear();
+    }
+
+    // cull the shared traversal against the planes of either eye moved out just enough to enclose the other eye,
+    // dropping any plane for which neither eye's can.
+    osg::Polytope::PlaneList planes;
+    for(unsigned int p=0; p<frusta[0].getPlaneList().size(); ++p)
+    {
+        osg::Plane plane;
+        double bestRelaxation = -1.0;
+        for(int i=0; i<2; ++i)
+        {
+            const osg::Plane& candidate = frusta[i].getPlaneList()[p];
+            double relaxation = computePlaneRelaxation(candidate, corners[1-i], edges[1-i], withFar);
+            if (relaxation>=0.0 && (bestRelaxation<0.0 || relaxation<bestRelaxation))
+            {
+                bestRelaxation = relaxation;
+                plane.set(candidate[0], candidate[1], candidate[2], candidate[3]+relaxation);
+            }
+        }
+        if (bestRelaxation>=0.0) planes.push_back(plane);
+    }
+    _sharedStereoCullFrustum.set(planes);
+
+    _cullVisitor->setTraversalMask(_cullMaskLeft);
+
+    _sharedStereoCullTraversal = true;
+    computeNearFar = cullStage(getProjectionMatrix(),getViewMatrix(),_cullVisitor.get(),_stateGraph.get(),_renderStage.get(),_viewportLeft.get());
+    _sharedStereoCullTraversal = false;
+
+    osg::ref_ptr<osg::RefMatrix> sharedProjection;
+    sharedProjection.swap(_sharedStereoCullProjection);
+
+    // absolute Transforms place their subgraphs relative to each eye rather than the shared view.
+    if (_cullVisitor->getNumAbsoluteModelViewMatrices()>0)
+    {
+        backOffSharedStereoCull();
+        return false;
+    }
+
+    unsigned int dynamicObjectCount = 0;
+    for(int i=0; i<2; ++i)
+    {
+        osgUtil::CullVisitor* cullVisitor = cullVisitors[i];
+        osgUtil::RenderStage* renderStage = renderStages[i];
+
+        cullVisitor->setClampProjectionMatrixCallback(_cullVisitor->getClampProjectionMatrixCallback());
+        cullVisitor->reset();
+        cullVisitor->setFrameStamp(_frameStamp.get());
+        if (_frameStamp.valid())
+        {
+             cullVisitor->setTraversalNumber(_frameStamp->getFrameNumber());
+        }
+        cullVisitor->inheritCullSettings(*this);
+        cullVisitor->setStateGraph(stateGraphs[i]);
+        cullVisitor->setRenderStage(renderStage);
+        cullVisitor->setRenderInfo( _renderInfo );
+
+        renderStage->reset();
+        stateGraphs[i]->clean();
+
+        renderStage->setInitialViewMatrix(views[i].get());
+        renderStage->setViewport(viewports[i]);
+        renderStage->setClearColor(_renderStage->getClearColor());
+        renderStage->setClearDepth(_renderStage->getClearDepth());
+        renderStage->setClearAccum(_renderStage->getClearAccum());
+        renderStage->setClearStencil(_renderStage->getClearStencil());
+        renderStage->setClearMask(_renderStage->getClearMask());
+        renderStage->setCamera(_camera.get());
+
+        if (!cullVisitor->shareCullTraversal(_renderStage.get(), _stateGraph.get(), sharedProjection.get(), projections[i].get(), viewOffsets[i], frusta[i]))
+        {
+            backOffSharedStereoCull();
+            return false;
+        }
+
+        // widen the near/far range computed for the shared view by the distance of the eye from it.
+        if (computeNearFar)
+        {
+            CullVisitor::value_type margin = viewOffsets[i].getTrans().length();
+            CullVisitor::value_type zNear = _cullVisitor->getCalculatedNearPlane()-margin;
+            CullVisitor::value_type zFar = _cullVisitor->getCalculatedFarPlane()+margin;
+            if (zFar>=zNear) cullVisitor->clampProjectionMatrix(*projections[i],zNear,zFar);
+        }
+
+        renderStage->sort();
+        stateGraphs[i]->prune();
+        dynamicObjectCount += renderStage->computeNumberOfDynamicRenderLeaves();
+    }
+
+    _dynamicObjectCount += dynamicObjectCount;
+
+    _sharedStereoCullRetryInterval = 0;
+
+    return true;
+}
+
+void SceneView::backOffSharedStereoCull()
+{
+    // back off exponentially while the scene graph keeps needing a traversal for each eye, so a permanent
+    // absolute Transform or nested Camera costs an extra shared traversal only once in a while.
+    _sharedStereoCullRetryInterval = osg::clampBetween(_sharedStereoCullRetryInterval*2u, 16u, 1024u);
+    _sharedStereoCullFramesToSkip = _sharedStereoCullRetryInterval;
+}
+
 void SceneView::releaseAllGLObjects()
 {
     if (!_camera) return;
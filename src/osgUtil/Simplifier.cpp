@@ -20,7 +20,9 @@
 
 #include <set>
 #include <list>
+#include <vector>
 #include <algorithm>
+#include <float.h>
 
 #include <iterator>
 
@@ -1719,13 +1721,597 @@ void EdgeCollapse::copyBackToGeometry()
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////
+//
+// QuadricEdgeCollapse, down sampling using the quadric error metric of Garland and Heckbert.
+//
+// All the mesh data is held in flat arrays, the triangles as a plain index list with the corners
+// that reference each vertex chained together in a per vertex list, the quadrics as a structure of
+// arrays, and the candidate collapses in a binary heap whose entries are invalidated lazily with per
+// vertex stamps rather than removed. Vertices are only ever collapsed onto one of their neighbours so
+// no new vertex attributes need to be computed. Like EdgeCollapse, vertices on the boundary of the mesh
+// are never removed, along with vertices on attribute seams, non manifold edges and protected points.
+//
+namespace
+{
+
+const unsigned int INVALID_INDEX = 0xffffffff;
+
+struct CollectTriangleIndicesOperator
+{
+    CollectTriangleIndicesOperator():
+        _indices(0) {}
+
+    void operator() (unsigned int p1, unsigned int p2, unsigned int p3)
+    {
+        if (p1==p2 || p2==p3 || p1==p3) return;
+
+        _indices->push_back(p1);
+        _indices->push_back(p2);
+        _indices->push_back(p3);
+    }
+
+    std::vector<unsigned int>* _indices;
+};
+
+typedef std::vector<osg::Array*> ArrayList;
+
+struct VertexAttributesLess
+{
+    VertexAttributesLess(const ArrayList& arrays):
+        _arrays(arrays) {}
+
+    bool operator() (unsigned int lhs, unsigned int rhs) const
+    {
+        for(ArrayList::const_iterator itr = _arrays.begin(); itr != _arrays.end(); ++itr)
+        {
+            int compare = (*itr)->compare(lhs, rhs);
+            if (compare<0) return true;
+            if (compare>0) return false;
+        }
+        return lhs<rhs;
+    }
+
+    bool equal(unsigned int lhs, unsigned int rhs) const
+    {
+        for(ArrayList::const_iterator itr = _arrays.begin(); itr != _arrays.end(); ++itr)
+        {
+            if ((*itr)->compare(lhs, rhs)!=0) return false;
+        }
+        return true;
+    }
+
+    const ArrayList& _arrays;
+};
+
+struct VertexPositionLess
+{
+    VertexPositionLess(const osg::Vec3Array& vertices):
+        _vertices(vertices) {}
+
+    bool operator() (unsigned int lhs, unsigned int rhs) const
+    {
+        if (_vertices[lhs]<_vertices[rhs]) return true;
+        if (_vertices[rhs]<_vertices[lhs]) return false;
+        return lhs<rhs;
+    }
+
+    const osg::Vec3Array& _vertices;
+};
+
+class CompactArrayVisitor : public osg::ArrayVisitor
+{
+    public:
+        CompactArrayVisitor(const std::vector<unsigned int>& copyList):
+            _copyList(copyList) {}
+
+        template<class ARRAY>
+        void compact(ARRAY& array)
+        {
+            osg::ref_ptr<ARRAY> newArray = new ARRAY(_copyList.size());
+            for(unsigned int i=0;i<_copyList.size();++i)
+            {
+                (*newArray)[i] = array[_copyList[i]];
+            }
+            array.swap(*newArray);
+            array.dirty();
+        }
+
+        virtual void apply(osg::Array&) {}
+        virtual void apply(osg::ByteArray& array) { compact(array); }
+        virtual void apply(osg::ShortArray& array) { compact(array); }
+        virtual void apply(osg::IntArray& array) { compact(array); }
+        virtual void apply(osg::UByteArray& array) { compact(array); }
+        virtual void apply(osg::UShortArray& array) { compact(array); }
+        virtual void apply(osg::UIntArray& array) { compact(array); }
+        virtual void apply(osg::FloatArray& array) { compact(array); }
+        virtual void apply(osg::DoubleArray& array) { compact(array); }
+
+        virtual void apply(osg::Vec2bArray& array) { compact(array); }
+        virtual void apply(osg::Vec3bArray& array) { compact(array); }
+        virtual void apply(osg::Vec4bArray& array) { compact(array); }
+        virtual void apply(osg::Vec2sArray& array) { compact(array); }
+        virtual void apply(osg::Vec3sArray& array) { compact(array); }
+        virtual void apply(osg::Vec4sArray& array) { compact(array); }
+        virtual void apply(osg::Vec2ubArray& array) { compact(array); }
+        virtual void apply(osg::Vec3ubArray& array) { compact(array); }
+        virtual void apply(osg::Vec4ubArray& array) { compact(array); }
+        virtual void apply(osg::Vec2usArray& array) { compact(array); }
+        virtual void apply(osg::Vec3usArray& array) { compact(array); }
+        virtual void apply(osg::Vec4usArray& array) { compact(array); }
+        virtual void apply(osg::Vec2iArray& array) { compact(array); }
+        virtual void apply(osg::Vec3iArray& array) { compact(array); }
+        virtual void apply(osg::Vec4iArray& array) { compact(array); }
+        virtual void apply(osg::Vec2uiArray& array) { compact(array); }
+        virtual void apply(osg::Vec3uiArray& array) { compact(array); }
+        virtual void apply(osg::Vec4uiArray& array) { compact(array); }
+
+        virtual void apply(osg::Vec2Array& array) { compact(array); }
+        virtual void apply(osg::Vec3Array& array) { compact(array); }
+        virtual void apply(osg::Vec4Array& array) { compact(array); }
+        virtual void apply(osg::Vec2dArray& array) { compact(array); }
+        virtual void apply(osg::Vec3dArray& array) { compact(array); }
+        virtual void apply(osg::Vec4dArray& array) { compact(array); }
+
+        const std::vector<unsigned int>& _copyList;
+
+    protected:
+
+        CompactArrayVisitor& operator = (CompactArrayVisitor&) { return *this; }
+};
+
+class QuadricEdgeCollapse
+{
+public:
+
+    QuadricEdgeCollapse():
+        _geometry(0),
+        _vertices(0),
+        _numOriginalTriangles(0),
+        _numTriangles(0) {}
+
+    /** Set up the flat arrays for the triangles of the geometry, return false if the geometry doesn't have an osg::Vec3Array vertex array.*/
+    bool setGeometry(osg::Geometry* geometry, const Simplifier::IndexList& protectedPoints);
+
+    /** Collapse the cheapest edges for as long as Simplifier::continueSimplification() permits.*/
+    void simplify(const Simplifier& simplifier);
+
+    void copyBackToGeometry();
+
+    unsigned int getNumOriginalTriangles() const { return _numOriginalTriangles; }
+    unsigned int getNumTriangles() const { return _numTriangles; }
+
+protected:
+
+    struct Collapse
+    {
+        double          cost;
+        unsigned int    from;
+        unsigned int    to;
+        unsigned int    fromStamp;
+        unsigned int    toStamp;
+
+        // reversed so that the std heap functions keep the cheapest collapse at the front
+        bool operator < (const Collapse& rhs) const { return cost>rhs.cost; }
+    };
+
+    void addQuadric(unsigned int position, const osg::Vec3d& normal, double d, double weight);
+    bool computeCollapse(unsigned int v0, unsigned int v1, Collapse& collapse) const;
+    double computeCost(unsigned int position0, unsigned int position1, const osg::Vec3d& target) const;
+    void pushCollapse(unsigned int v0, unsigned int v1);
+    void pushCollapsesAround(unsigned int v);
+    bool isCollapseValid(unsigned int from, unsigned int to) const;
+    void collapseEdge(unsigned int from, unsigned int to);
+
+    osg::Geometry*              _geometry;
+    osg::Vec3Array*             _vertices;
+    ArrayList                   _arrays;
+
+    unsigned int                _numOriginalTriangles;
+    unsigned int                _numTriangles;
+
+    // three vertex indices per triangle, and whether each triangle is still part of the mesh
+    std::vector<unsigned int>   _indices;
+    std::vector<unsigned char>  _live;
+
+    // the corners referencing each vertex, chained through _cornerNext
+    std::vector<unsigned int>   _cornerNext;
+    std::vector<unsigned int>   _cornerHead;
+    std::vector<unsigned int>   _cornerTail;
+
+    // per vertex stamp, incremented whenever a collapse changes the vertex
+    std::vector<unsigned int>   _stamp;
+
+    // vertices that only differ in their other attributes share a position, quadrics and locking are per position
+    std::vector<unsigned int>   _position;
+    std::vector<unsigned char>  _locked;
+
+    // quadric A = a00..a22, b = b0..b2 and c of each position, along with the area of the triangles they were built from
+    std::vector<double>         _a00, _a11, _a22, _a01, _a02, _a12;
+    std::vector<double>         _b0, _b1, _b2;
+    std::vector<double>         _c;
+    std::vector<double>         _area;
+
+    std::vector<Collapse>       _heap;
+};
+
+bool QuadricEdgeCollapse::setGeometry(osg::Geometry* geometry, const Simplifier::IndexList& protectedPoints)
+{
+    if (!dynamic_cast<osg::Vec3Array*>(geometry->getVertexArray())) return false;
+
+    _geometry = geometry;
+
+    if (_geometry->containsSharedArrays())
+    {
+        OSG_INFO<<"QuadricEdgeCollapse::setGeometry(..): Duplicate shared arrays"<<std::endl;
+        _geometry->duplicateSharedArrays();
+    }
+
+    _vertices = static_cast<osg::Vec3Array*>(_geometry->getVertexArray());
+    unsigned int numVertices = _vertices->size();
+
+    // per vertex arrays, these decide which vertices can be welded and get compacted in copyBackToGeometry()
+    _arrays.push_back(_vertices);
+
+    for(unsigned int ti=0;ti<_geometry->getNumTexCoordArrays();++ti)
+    {
+        osg::Array* array = _geometry->getTexCoordArray(ti);
+        if (array && array->getNumElements()==numVertices) _arrays.push_back(array);
+    }
+
+    osg::Array* perVertexArrays[] = { _geometry->getNormalArray(), _geometry->getColorArray(), _geometry->getSecondaryColorArray(), _geometry->getFogCoordArray() };
+    for(unsigned int i=0;i<sizeof(perVertexArrays)/sizeof(osg::Array*);++i)
+    {
+        osg::Array* array = perVertexArrays[i];
+        if (array && array->getBinding()==osg::Array::BIND_PER_VERTEX && array->getNumElements()==numVertices) _arrays.push_back(array);
+    }
+
+    for(unsigned int vi=0;vi<_geometry->getNumVertexAttribArrays();++vi)
+    {
+        osg::Array* array = _geometry->getVertexAttribArray(vi);
+        if (array && array->getBinding()==osg::Array::BIND_PER_VERTEX && array->getNumElements()==numVertices) _arrays.push_back(array);
+    }
+
+    // weld vertices with identical attributes so that the triangles between them are connected
+    std::vector<unsigned int> order(numVertices);
+    for(unsigned int i=0;i<numVertices;++i) order[i] = i;
+
+    VertexAttributesLess attributesLess(_arrays);
+    std::sort(order.begin(), order.end(), attributesLess);
+
+    std::vector<unsigned int> weld(numVertices);
+    for(unsigned int i=0;i<numVertices;++i)
+    {
+        weld[order[i]] = (i>0 && attributesLess.equal(order[i-1], order[i])) ? weld[order[i-1]] : order[i];
+    }
+
+    osg::TriangleIndexFunctor<CollectTriangleIndicesOperator> collectTriangles;
+    collectTriangles._indices = &_indices;
+    _geometry->accept(collectTriangles);
+
+    unsigned int numIndices = 0;
+    for(unsigned int i=0;i+2<_indices.size();i+=3)
+    {
+        unsigned int i0 = weld[_indices[i]], i1 = weld[_indices[i+1]], i2 = weld[_indices[i+2]];
+        if (i0==i1 || i1==i2 || i0==i2) continue;
+
+        _indices[numIndices++] = i0;
+        _indices[numIndices++] = i1;
+        _indices[numIndices++] = i2;
+    }
+    _indices.resize(numIndices);
+
+    _numOriginalTriangles = _numTriangles = numIndices/3;
+    _live.resize(_numTriangles, 1);
+
+    // group the welded vertices by position, a position with more than one vertex lies on an attribute seam
+    order.clear();
+    for(unsigned int i=0;i<numVertices;++i)
+    {
+        if (weld[i]==i) order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), VertexPositionLess(*_vertices));
+
+    _position.resize(numVertices, INVALID_INDEX);
+    std::vector<unsigned int> numVerticesAtPosition;
+    for(unsigned int i=0;i<order.size();++i)
+    {
+        if (i==0 || (*_vertices)[order[i-1]]!=(*_vertices)[order[i]]) numVerticesAtPosition.push_back(0);
+
+        _position[order[i]] = numVerticesAtPosition.size()-1;
+        ++numVerticesAtPosition.back();
+    }
+
+    unsigned int numPositions = numVerticesAtPosition.size();
+    _locked.resize(numPositions, 0);
+    for(unsigned int p=0;p<numPositions;++p)
+    {
+        if (numVerticesAtPosition[p]>1) _locked[p] = 1;
+    }
+
+    for(Simplifier::IndexList::const_iterator pitr=protectedPoints.begin();
+        pitr!=protectedPoints.end();
+        ++pitr)
+    {
+        if (*pitr<numVertices) _locked[_position[weld[*pitr]]] = 1;
+    }
+
+    // lock the boundary and non manifold edges, found as half edges between positions with no or more than one opposite half edge
+    typedef std::pair<unsigned int, unsigned int> HalfEdge;
+    std::vector<HalfEdge> halfEdges;
+    halfEdges.reserve(_indices.size());
+    for(unsigned int i=0;i<_indices.size();i+=3)
+    {
+        unsigned int p[3] = { _position[_indices[i]], _position[_indices[i+1]], _position[_indices[i+2]] };
+        for(unsigned int k=0;k<3;++k)
+        {
+            unsigned int p0 = p[k], p1 = p[(k+1)%3];
+            if (p0!=p1) halfEdges.push_back(HalfEdge(p0, p1));
+            else _locked[p[0]] = _locked[p[1]] = _locked[p[2]] = 1;
+        }
+    }
+    std::sort(halfEdges.begin(), halfEdges.end());
+
+    for(std::vector<HalfEdge>::iterator itr = halfEdges.begin(); itr != halfEdges.end(); ++itr)
+    {
+        bool duplicate = (itr+1!=halfEdges.end() && *(itr+1)==*itr) || (itr!=halfEdges.begin() && *(itr-1)==*itr);
+        if (duplicate || !std::binary_search(halfEdges.begin(), halfEdges.end(), HalfEdge(itr->second, itr->first)))
+        {
+            _locked[itr->first] = _locked[itr->second] = 1;
+        }
+    }
+
+    // accumulate the area weighted plane quadrics of the triangles
+    _a00.resize(numPositions, 0.0); _a11.resize(numPositions, 0.0); _a22.resize(numPositions, 0.0);
+    _a01.resize(numPositions, 0.0); _a02.resize(numPositions, 0.0); _a12.resize(numPositions, 0.0);
+    _b0.resize(numPositions, 0.0); _b1.resize(numPositions, 0.0); _b2.resize(numPositions, 0.0);
+    _c.resize(numPositions, 0.0);
+    _area.resize(numPositions, 0.0);
+
+    for(unsigned int i=0;i<_indices.size();i+=3)
+    {
+        osg::Vec3d v0((*_vertices)[_indices[i]]), v1((*_vertices)[_indices[i+1]]), v2((*_vertices)[_indices[i+2]]);
+        osg::Vec3d normal = (v1-v0)^(v2-v0);
+        double length = normal.normalize();
+        if (length==0.0) continue;
+
+        double d = -(normal*v0);
+        double area = length*0.5;
+        for(unsigned int k=0;k<3;++k)
+        {
+            addQuadric(_position[_indices[i+k]], normal, d, area);
+        }
+    }
+
+    // chain together the corners of each vertex
+    _cornerNext.resize(_indices.size(), INVALID_INDEX);
+    _cornerHead.resize(numVertices, INVALID_INDEX);
+    _cornerTail.resize(numVertices, INVALID_INDEX);
+    for(unsigned int c=0;c<_indices.size();++c)
+    {
+        unsigned int v = _indices[c];
+        if (_cornerHead[v]==INVALID_INDEX) _cornerHead[v] = c;
+        else _cornerNext[_cornerTail[v]] = c;
+        _cornerTail[v] = c;
+    }
+
+    _stamp.resize(numVertices, 0);
+
+    // queue up each edge once, interior edges appear as two half edges and boundary edges can't be collapsed
+    for(unsigned int i=0;i<_indices.size();i+=3)
+    {
+        for(unsigned int k=0;k<3;++k)
+        {
+            unsigned int v0 = _indices[i+k], v1 = _indices[i+(k+1)%3];
+            if (v0<v1) pushCollapse(v0, v1);
+        }
+    }
+
+    return true;
+}
+
+void QuadricEdgeCollapse::addQuadric(unsigned int position, const osg::Vec3d& normal, double d, double weight)
+{
+    _a00[position] += weight*normal.x()*normal.x();
+    _a11[position] += weight*normal.y()*normal.y();
+    _a22[position] += weight*normal.z()*normal.z();
+    _a01[position] += weight*normal.x()*normal.y();
+    _a02[position] += weight*normal.x()*normal.z();
+    _a12[position] += weight*normal.y()*normal.z();
+    _b0[position] += weight*normal.x()*d;
+    _b1[position] += weight*normal.y()*d;
+    _b2[position] += weight*normal.z()*d;
+    _c[position] += weight*d*d;
+    _area[position] += weight;
+}
+
+double QuadricEdgeCollapse::computeCost(unsigned int p0, unsigned int p1, const osg::Vec3d& target) const
+{
+    double x = target.x(), y = target.y(), z = target.z();
+
+    double error = (_a00[p0]+_a00[p1])*x*x + (_a11[p0]+_a11[p1])*y*y + (_a22[p0]+_a22[p1])*z*z +
+                   2.0*((_a01[p0]+_a01[p1])*x*y + (_a02[p0]+_a02[p1])*x*z + (_a12[p0]+_a12[p1])*y*z) +
+                   2.0*((_b0[p0]+_b0[p1])*x + (_b1[p0]+_b1[p1])*y + (_b2[p0]+_b2[p1])*z) +
+                   (_c[p0]+_c[p1]);
+
+    // normalize by the area so the cost is the mean squared distance to the planes of the merged triangles
+    double area = _area[p0]+_area[p1];
+    return (error>0.0 && area>0.0) ? error/area : 0.0;
+}
+
+bool QuadricEdgeCollapse::computeCollapse(unsigned int v0, unsigned int v1, Collapse& collapse) const
+{
+    unsigned int p0 = _position[v0], p1 = _position[v1];
+    if (p0==p1 || (_locked[p0] && _locked[p1])) return false;
+
+    double cost01 = _locked[p0] ? DBL_MAX : computeCost(p0, p1, osg::Vec3d((*_vertices)[v1]));
+    double cost10 = _locked[p1] ? DBL_MAX : computeCost(p0, p1, osg::Vec3d((*_vertices)[v0]));
+
+    collapse.cost = osg::minimum(cost01, cost10);
+    collapse.from = cost01<=cost10 ? v0 : v1;
+    collapse.to = cost01<=cost10 ? v1 : v0;
+    collapse.fromStamp = _stamp[collapse.from];
+    collapse.toStamp = _stamp[collapse.to];
+    return true;
+}
+
+void QuadricEdgeCollapse::pushCollapse(unsigned int v0, unsigned int v1)
+{
+    Collapse collapse;
+    if (computeCollapse(v0, v1, collapse))
+    {
+        _heap.push_back(collapse);
+        std::push_heap(_heap.begin(), _heap.end());
+    }
+}
+
+void QuadricEdgeCollapse::pushCollapsesAround(unsigned int v)
+{
+    for(unsigned int c=_cornerHead[v]; c!=INVALID_INDEX; c=_cornerNext[c])
+    {
+        unsigned int t = c/3;
+        if (!_live[t]) continue;
+
+        unsigned int corner = c%3;
+        pushCollapse(v, _indices[t*3+(corner+1)%3]);
+        pushCollapse(v, _indices[t*3+(corner+2)%3]);
+    }
+}
+
+bool QuadricEdgeCollapse::isCollapseValid(unsigned int from, unsigned int to) const
+{
+    const osg::Vec3d origin((*_vertices)[from]);
+    const osg::Vec3d target((*_vertices)[to]);
+
+    for(unsigned int c=_cornerHead[from]; c!=INVALID_INDEX; c=_cornerNext[c])
+    {
+        unsigned int t = c/3;
+        if (!_live[t]) continue;
+
+        unsigned int v1 = _indices[t*3+(c%3+1)%3];
+        unsigned int v2 = _indices[t*3+(c%3+2)%3];
+
+        // triangles sharing the edge are removed by the collapse
+        if (v1==to || v2==to) continue;
+
+        osg::Vec3d p1((*_vertices)[v1]), p2((*_vertices)[v2]);
+        osg::Vec3d before = (p1-origin)^(p2-origin);
+        osg::Vec3d after = (p1-target)^(p2-target);
+
+        // reject collapses that would flip a triangle or fold it over onto its neighbours
+        if (before*after <= 0.25*before.length()*after.length()) return false;
+    }
+
+    return true;
+}
+
+void QuadricEdgeCollapse::collapseEdge(unsigned int from, unsigned int to)
+{
+    unsigned int pf = _position[from], pt = _position[to];
+    _a00[pt] += _a00[pf]; _a11[pt] += _a11[pf]; _a22[pt] += _a22[pf];
+    _a01[pt] += _a01[pf]; _a02[pt] += _a02[pf]; _a12[pt] += _a12[pf];
+    _b0[pt] += _b0[pf]; _b1[pt] += _b1[pf]; _b2[pt] += _b2[pf];
+    _c[pt] += _c[pf];
+    _area[pt] += _area[pf];
+
+    for(unsigned int c=_cornerHead[from]; c!=INVALID_INDEX; c=_cornerNext[c])
+    {
+        unsigned int t = c/3;
+        if (!_live[t]) continue;
+
+        _indices[c] = to;
+
+        const unsigned int* triangle = &_indices[t*3];
+        if (triangle[0]==triangle[1] || triangle[1]==triangle[2] || triangle[0]==triangle[2])
+        {
+            _live[t] = 0;
+            --_numTriangles;
+        }
+    }
+
+    // hand the corners of the removed vertex over to the vertex it was collapsed onto
+    if (_cornerHead[from]!=INVALID_INDEX)
+    {
+        if (_cornerHead[to]==INVALID_INDEX) _cornerHead[to] = _cornerHead[from];
+        else _cornerNext[_cornerTail[to]] = _cornerHead[from];
+        _cornerTail[to] = _cornerTail[from];
+
+        _cornerHead[from] = _cornerTail[from] = INVALID_INDEX;
+    }
+
+    // invalidate all the queued collapses of both vertices, then queue up the new edges around the remaining one
+    ++_stamp[from];
+    ++_stamp[to];
+
+    pushCollapsesAround(to);
+}
+
+void QuadricEdgeCollapse::simplify(const Simplifier& simplifier)
+{
+    while (!_heap.empty())
+    {
+        std::pop_heap(_heap.begin(), _heap.end());
+        Collapse collapse = _heap.back();
+        _heap.pop_back();
+
+        if (collapse.fromStamp!=_stamp[collapse.from] || collapse.toStamp!=_stamp[collapse.to]) continue;
+
+        if (!simplifier.continueSimplification(static_cast<float>(sqrt(collapse.cost)), _numOriginalTriangles, _numTriangles)) break;
+
+        if (isCollapseValid(collapse.from, collapse.to))
+        {
+            collapseEdge(collapse.from, collapse.to);
+        }
+    }
+
+    OSG_INFO<<"QuadricEdgeCollapse::simplify() in = "<<_numOriginalTriangles<<"\tout = "<<_numTriangles<<std::endl;
+}
+
+void QuadricEdgeCollapse::copyBackToGeometry()
+{
+    // compact the vertices in the order the remaining triangles first use them
+    std::vector<unsigned int> newIndices(_vertices->size(), INVALID_INDEX);
+    std::vector<unsigned int> copyList;
+
+    osg::DrawElementsUInt* primitives = new osg::DrawElementsUInt(GL_TRIANGLES);
+    primitives->reserve(_numTriangles*3);
+
+    for(unsigned int t=0;t<_live.size();++t)
+    {
+        if (!_live[t]) continue;
+
+        for(unsigned int k=0;k<3;++k)
+        {
+            unsigned int v = _indices[t*3+k];
+            if (newIndices[v]==INVALID_INDEX)
+            {
+                newIndices[v] = copyList.size();
+                copyList.push_back(v);
+            }
+            primitives->push_back(newIndices[v]);
+        }
+    }
+
+    CompactArrayVisitor compactArray(copyList);
+    for(ArrayList::iterator itr = _arrays.begin(); itr != _arrays.end(); ++itr)
+    {
+        (*itr)->accept(compactArray);
+    }
+
+    _geometry->getPrimitiveSetList().clear();
+    _geometry->addPrimitiveSet(primitives);
+}
+
+}
+
 Simplifier::Simplifier(double sampleRatio, double maximumError, double maximumLength):
             osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
             _sampleRatio(sampleRatio),
             _maximumError(maximumError),
             _maximumLength(maximumLength),
             _triStrip(true),
-            _smoothing(true)
+            _smoothing(true),
+            _method(EDGE_COLLAPSE)
 
 {
 }
@@ -1745,6 +2331,30 @@ void Simplifier::simplify(osg::Geometry& geometry, const IndexList& protectedPoi
 
     bool downSample = requiresDownSampling();
 
+    if (downSample && _method==QUADRIC_EDGE_COLLAPSE)
+    {
+        QuadricEdgeCollapse qec;
+        if (qec.setGeometry(&geometry, protectedPoints))
+        {
+            qec.simplify(*this);
+            qec.copyBackToGeometry();
+
+            if (_smoothing)
+            {
+                osgUtil::SmoothingVisitor::smooth(geometry);
+            }
+
+            if (_triStrip)
+            {
+                osgUtil::optimizeMesh(&geometry);
+            }
+
+            return;
+        }
+
+        OSG_INFO<<"Simplifier::simplify(..) QUADRIC_EDGE_COLLAPSE requires an osg::Vec3Array vertex array, using EDGE_COLLAPSE."<<std::endl;
+    }
+
     EdgeCollapse ec;
     ec.setComputeErrorMetricUsingLength(!downSample);
     ec.setGeometry(&geometry, protectedPoints);
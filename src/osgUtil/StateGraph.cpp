@@ -26,6 +26,10 @@ void StateGraph::reset()
 
     _children.clear();
     _leaves.clear();
+
+    _childIndex.clear();
+    _numIndexedChildren = 0;
+    _childIndexModifiedCount = _children.getModifiedCount();
 }
 
 /** recursively clean the StateGraph of all its drawables, lights and depths.
@@ -37,7 +41,7 @@ void StateGraph::clean()
     _leaves.clear();
 
     // call clean on all children.
-    for(ChildList::iterator itr=_children.begin();
+    for(ChildList::const_iterator itr=_children.begin();
         itr!=_children.end();
         ++itr)
     {
@@ -57,9 +61,31 @@ void StateGraph::prune()
 
         if (citr->second->empty())
         {
-            ChildList::iterator ditr= citr++;
-            _children.erase(ditr);
+            citr = _children.erase(citr);
         }
         else ++citr;
     }
+
+    if (_childIndexModifiedCount!=_children.getModifiedCount()) rebuildChildIndex();
+}
+
+void StateGraph::rebuildChildIndex()
+{
+    std::size_t size = 8;
+    while(size<_children.size()*2) size *= 2;
+
+    _childIndex.assign(size, (const ChildList::value_type*)NULL);
+    _numIndexedChildren = 0;
+    _childIndexModifiedCount = _children.getModifiedCount();
+
+    std::size_t mask = size-1;
+    for(ChildList::const_iterator itr=_children.begin();
+        itr!=_children.end();
+        ++itr)
+    {
+        std::size_t i = hashStateSet(itr->first) & mask;
+        while(_childIndex[i]) i = (i+1) & mask;
+        _childIndex[i] = &(*itr);
+        ++_numIndexedChildren;
+    }
 }
@@ -15,18 +15,931 @@
 
 #include <osg/Notify>
 #include <osg/io_utils>
+#include <osg/Vec2d>
+#include <osg/Vec3d>
 #include <osgUtil/Tessellator>
 
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+
 using namespace osg;
 using namespace osgUtil;
 
+namespace
+{
+
+const unsigned int NO_NODE = ~0u;
+
+inline double orient(const osg::Vec2d& a, const osg::Vec2d& b, const osg::Vec2d& c)
+{
+    return (b.x()-a.x())*(c.y()-a.y()) - (b.y()-a.y())*(c.x()-a.x());
+}
+
+inline bool onSegment(const osg::Vec2d& a, const osg::Vec2d& b, const osg::Vec2d& p)
+{
+    return p.x()>=osg::minimum(a.x(),b.x()) && p.x()<=osg::maximum(a.x(),b.x()) &&
+           p.y()>=osg::minimum(a.y(),b.y()) && p.y()<=osg::maximum(a.y(),b.y());
+}
+
+/** return true if the closed segments p1-p2 and q1-q2 intersect or touch.*/
+bool segmentsIntersect(const osg::Vec2d& p1, const osg::Vec2d& p2, const osg::Vec2d& q1, const osg::Vec2d& q2)
+{
+    double d1 = orient(q1, q2, p1);
+    double d2 = orient(q1, q2, p2);
+    double d3 = orient(p1, p2, q1);
+    double d4 = orient(p1, p2, q2);
+
+    if (((d1>0.0 && d2<0.0) || (d1<0.0 && d2>0.0)) &&
+        ((d3>0.0 && d4<0.0) || (d3<0.0 && d4>0.0))) return true;
+
+    if (d1==0.0 && onSegment(q1, q2, p1)) return true;
+    if (d2==0.0 && onSegment(q1, q2, p2)) return true;
+    if (d3==0.0 && onSegment(p1, p2, q1)) return true;
+    if (d4==0.0 && onSegment(p1, p2, q2)) return true;
+    return false;
+}
+
+inline bool pointInTriangle(double ax, double ay, double bx, double by, double cx, double cy, double px, double py)
+{
+    return (cx-px)*(ay-py) >= (ax-px)*(cy-py) &&
+           (ax-px)*(by-py) >= (bx-px)*(ay-py) &&
+           (bx-px)*(cy-py) >= (cx-px)*(by-py);
+}
+
+}
+
+/** Classifies the contours of a tessellation and triangulates the simple cases by ear clipping, following the
+  * approach of the earcut library: the holes of each outer contour are joined to it with bridge edges so the
+  * result is a single ring that the ears are clipped from. All the buffers are kept between tessellations so that
+  * tessellating many small polygons does not allocate memory once they have grown.*/
+struct Tessellator::EarClipper
+{
+    struct Contour
+    {
+        unsigned int    first;      // position of the first vertex in indices
+        unsigned int    count;
+        double          area;       // signed area in the projection plane
+        unsigned int    depth;      // number of contours that contain this contour
+        unsigned int    parent;     // the innermost contour that contains this contour
+    };
+
+    struct Node
+    {
+        double          x, y;
+        unsigned int    i;          // index into vertices
+        unsigned int    prev, next;
+        unsigned int    prevZ, nextZ;
+        unsigned int    z;
+    };
+
+    struct Edge
+    {
+        double          minX, maxX;
+        double          minY, maxY;
+        unsigned int    a, b;       // indices into points
+        unsigned int    contour;
+        unsigned int    position;   // position of the edge within its contour
+    };
+
+    struct NodeZLess
+    {
+        NodeZLess(const std::vector<Node>& nodes):_nodes(nodes) {}
+        bool operator() (unsigned int lhs, unsigned int rhs) const { return _nodes[lhs].z<_nodes[rhs].z; }
+        const std::vector<Node>& _nodes;
+    };
+
+    struct NodeLeftLess
+    {
+        NodeLeftLess(const std::vector<Node>& nodes):_nodes(nodes) {}
+        bool operator() (unsigned int lhs, unsigned int rhs) const
+        {
+            if (_nodes[lhs].x!=_nodes[rhs].x) return _nodes[lhs].x<_nodes[rhs].x;
+            return _nodes[lhs].y<_nodes[rhs].y;
+        }
+        const std::vector<Node>& _nodes;
+    };
+
+    typedef std::vector<osg::Vec3*> VertexList;
+
+    // the contours as passed in, contour c spans vertices [contourStarts[c], contourStarts[c+1])
+    VertexList                  vertices;
+    std::vector<unsigned int>   contourStarts;
+
+    // the result, three indices into vertices per triangle
+    std::vector<unsigned int>   triangles;
+
+    // working buffers
+    std::vector<osg::Vec2d>     points;
+    std::vector<unsigned int>   indices;
+    std::vector<Contour>        contours;
+    std::vector<Edge>           edges;
+    std::vector<unsigned int>   cellStarts;
+    std::vector<unsigned int>   cellFill;
+    std::vector<unsigned int>   order;
+    std::vector<Node>           nodes;
+
+    // z-order hashing range
+    double                      minX, minY, invSize;
+
+    void clear()
+    {
+        vertices.clear();
+        contourStarts.clear();
+        triangles.clear();
+    }
+
+    void beginContour()
+    {
+        contourStarts.push_back(vertices.size());
+    }
+
+    void addVertex(osg::Vec3* vertex)
+    {
+        if (contourStarts.empty()) contourStarts.push_back(0);
+        vertices.push_back(vertex);
+    }
+
+    /** Triangulate the contours, returning false if they need the full tessellator.*/
+    bool tessellate(const osg::Vec3& tessNormal, bool nonZero);
+
+    bool projectContours(const osg::Vec3& tessNormal);
+    bool isStrictlyConvex(const Contour& contour) const;
+    bool edgesCompatible(const Edge& e1, const Edge& e2) const;
+    bool isSimple();
+    bool classifyContours(bool nonZero);
+    bool tessellateOuter(unsigned int outer);
+
+    unsigned int createRing(const Contour& contour, bool counterClockwise);
+    void removeNode(unsigned int p);
+    unsigned int filterPoints(unsigned int start);
+    unsigned int splitPolygon(unsigned int a, unsigned int b);
+    unsigned int findHoleBridge(unsigned int hole, unsigned int outerNode);
+    void indexCurve(unsigned int start);
+    unsigned int zOrder(double x, double y) const;
+    bool isEar(unsigned int ear) const;
+    bool isEarHashed(unsigned int ear) const;
+    bool clipEars(unsigned int ear, bool hashed);
+
+    inline double cross(unsigned int a, unsigned int b, unsigned int c) const
+    {
+        const Node& na = nodes[a];
+        const Node& nb = nodes[b];
+        const Node& nc = nodes[c];
+        return (nb.x-na.x)*(nc.y-nb.y) - (nb.y-na.y)*(nc.x-nb.x);
+    }
+
+    inline bool equals(unsigned int a, unsigned int b) const
+    {
+        return nodes[a].x==nodes[b].x && nodes[a].y==nodes[b].y;
+    }
+
+    bool locallyInside(unsigned int a, unsigned int b) const
+    {
+        const Node& na = nodes[a];
+        if (cross(na.prev, a, na.next)>0.0) return cross(a, b, na.next)<=0.0 && cross(a, na.prev, b)<=0.0;
+        return cross(a, b, na.prev)>0.0 || cross(a, na.next, b)>0.0;
+    }
+
+    bool sectorContainsSector(unsigned int m, unsigned int p) const
+    {
+        return cross(nodes[m].prev, m, nodes[p].prev)>0.0 && cross(nodes[p].next, m, nodes[m].next)>0.0;
+    }
+};
+
+bool Tessellator::EarClipper::tessellate(const osg::Vec3& tessNormal, bool nonZero)
+{
+    triangles.clear();
+
+    if (!projectContours(tessNormal)) return false;
+
+    if (contours.empty()) return true;
+
+    if (contours.size()==1 && isStrictlyConvex(contours[0]))
+    {
+        // triangle fan around the first vertex, in counter clockwise order.
+        const Contour& contour = contours[0];
+        bool forward = contour.area>0.0;
+        for(unsigned int k=1; k+1<contour.count; ++k)
+        {
+            unsigned int k1 = forward ? k : contour.count-k;
+            unsigned int k2 = forward ? k+1 : contour.count-k-1;
+            triangles.push_back(indices[contour.first]);
+            triangles.push_back(indices[contour.first+k1]);
+            triangles.push_back(indices[contour.first+k2]);
+        }
+        return true;
+    }
+
+    if (!isSimple()) return false;
+
+    if (!classifyContours(nonZero)) return false;
+
+    double expectedArea = 0.0;
+    for(unsigned int c=0; c<contours.size(); ++c)
+    {
+        if ((contours[c].depth%2)!=0) continue;
+
+        if (!tessellateOuter(c)) return false;
+
+        expectedArea += fabs(contours[c].area);
+        for(unsigned int h=0; h<contours.size(); ++h)
+        {
+            if (contours[h].parent==c) expectedArea -= fabs(contours[h].area);
+        }
+    }
+
+    // the triangles of a valid triangulation all face the same way and add up to the area of the polygon,
+    // anything else means the numerical precision was not sufficient and the full tessellator is needed.
+    double triangleArea = 0.0;
+    for(unsigned int t=0; t<triangles.size(); t+=3)
+    {
+        double area = orient(points[triangles[t]], points[triangles[t+1]], points[triangles[t+2]])*0.5;
+        if (area<0.0) return false;
+        triangleArea += area;
+    }
+
+    return fabs(triangleArea-expectedArea)<=expectedArea*1e-6;
+}
+
+bool Tessellator::EarClipper::projectContours(const osg::Vec3& tessNormal)
+{
+    contourStarts.push_back(vertices.size());
+
+    // use Newell's method for the normal if none has been set
+    osg::Vec3d normal(tessNormal);
+    if (normal.length2()==0.0)
+    {
+        for(unsigned int c=0; c+1<contourStarts.size(); ++c)
+        {
+            unsigned int start = contourStarts[c];
+            unsigned int end = contourStarts[c+1];
+            for(unsigned int i=start; i<end; ++i)
+            {
+                const osg::Vec3& v1 = *vertices[i];
+                const osg::Vec3& v2 = *vertices[(i+1<end) ? i+1 : start];
+                normal.x() += (double(v1.y())-double(v2.y()))*(double(v1.z())+double(v2.z()));
+                normal.y() += (double(v1.z())-double(v2.z()))*(double(v1.x())+double(v2.x()));
+                normal.z() += (double(v1.x())-double(v2.x()))*(double(v1.y())+double(v2.y()));
+            }
+        }
+        if (normal.length2()==0.0) return false;
+    }
+
+    // project onto the plane of the dominant axis, oriented so that counter clockwise around the normal
+    // is counter clockwise in the plane.
+    unsigned int axis = 2;
+    if (fabs(normal.x())>fabs(normal.y()) && fabs(normal.x())>fabs(normal.z())) axis = 0;
+    else if (fabs(normal.y())>fabs(normal.z())) axis = 1;
+
+    unsigned int u = (axis+1)%3;
+    unsigned int v = (axis+2)%3;
+    if (normal[axis]<0.0) std::swap(u, v);
+
+    points.resize(vertices.size());
+    for(unsigned int i=0; i<vertices.size(); ++i)
+    {
+        const osg::Vec3& vertex = *vertices[i];
+        points[i].set(vertex[u], vertex[v]);
+    }
+
+    // build the contours without repeated points
+    indices.clear();
+    contours.clear();
+    for(unsigned int c=0; c+1<contourStarts.size(); ++c)
+    {
+        Contour contour;
+        contour.first = indices.size();
+        contour.depth = 0;
+        contour.parent = NO_NODE;
+
+        for(unsigned int i=contourStarts[c]; i<contourStarts[c+1]; ++i)
+        {
+            if (indices.size()==contour.first || points[i]!=points[indices.back()]) indices.push_back(i);
+        }
+        while (indices.size()>contour.first+1 && points[indices.back()]==points[indices[contour.first]]) indices.pop_back();
+
+        contour.count = indices.size()-contour.first;
+        if (contour.count==0) continue;
+        if (contour.count<3) return false;
+
+        contour.area = 0.0;
+        for(unsigned int k=0; k<contour.count; ++k)
+        {
+            const osg::Vec2d& p1 = points[indices[contour.first+k]];
+            const osg::Vec2d& p2 = points[indices[contour.first+((k+1<contour.count) ? k+1 : 0)]];
+            contour.area += (p1.x()*p2.y()-p2.x()*p1.y())*0.5;
+        }
+        if (contour.area==0.0) return false;
+
+        contours.push_back(contour);
+    }
+
+    return true;
+}
+
+bool Tessellator::EarClipper::isStrictlyConvex(const Contour& contour) const
+{
+    // all turns in the same direction, and the edge directions turn around only once.
+    int xFlips = 0, yFlips = 0;
+    double xSign = 0.0, ySign = 0.0;
+    double turnSign = 0.0;
+    for(unsigned int k=0; k<contour.count; ++k)
+    {
+        const osg::Vec2d& p0 = points[indices[contour.first+k]];
+        const osg::Vec2d& p1 = points[indices[contour.first+(k+1)%contour.count]];
+        const osg::Vec2d& p2 = points[indices[contour.first+(k+2)%contour.count]];
+
+        double turn = orient(p0, p1, p2);
+        if (turn==0.0) return false;
+        if (turnSign==0.0) turnSign = turn;
+        else if ((turn>0.0)!=(turnSign>0.0)) return false;
+
+        double dx = p2.x()-p1.x();
+        if (dx!=0.0)
+        {
+            if (xSign!=0.0 && (dx>0.0)!=(xSign>0.0)) ++xFlips;
+            xSign = dx;
+        }
+
+        double dy = p2.y()-p1.y();
+        if (dy!=0.0)
+        {
+            if (ySign!=0.0 && (dy>0.0)!=(ySign>0.0)) ++yFlips;
+            ySign = dy;
+        }
+    }
+    return xFlips<=2 && yFlips<=2;
+}
+
+bool Tessellator::EarClipper::edgesCompatible(const Edge& e1, const Edge& e2) const
+{
+    if (e1.maxX<e2.minX || e2.maxX<e1.minX || e1.maxY<e2.minY || e2.maxY<e1.minY) return true;
+
+    const osg::Vec2d& p1 = points[e1.a];
+    const osg::Vec2d& p2 = points[e1.b];
+    const osg::Vec2d& q1 = points[e2.a];
+    const osg::Vec2d& q2 = points[e2.b];
+
+    if (e1.contour==e2.contour)
+    {
+        // consecutive edges share a vertex, but must not fold back over each other
+        unsigned int count = contours[e1.contour].count;
+        if ((e1.position+1)%count==e2.position) return !(orient(p1, p2, q2)==0.0 && (p2-p1)*(q2-q1)<0.0);
+        if ((e2.position+1)%count==e1.position) return !(orient(q1, q2, p2)==0.0 && (q2-q1)*(p2-p1)<0.0);
+    }
+
+    return !segmentsIntersect(p1, p2, q1, q2);
+}
+
+bool Tessellator::EarClipper::isSimple()
+{
+    edges.clear();
+    double x0 = DBL_MAX, y0 = DBL_MAX, x1 = -DBL_MAX, y1 = -DBL_MAX;
+    double edgeWidth = 0.0, edgeHeight = 0.0;
+    for(unsigned int c=0; c<contours.size(); ++c)
+    {
+        const Contour& contour = contours[c];
+        for(unsigned int k=0; k<contour.count; ++k)
+        {
+            Edge edge;
+            edge.a = indices[contour.first+k];
+            edge.b = indices[contour.first+((k+1<contour.count) ? k+1 : 0)];
+            edge.minX = osg::minimum(points[edge.a].x(), points[edge.b].x());
+            edge.maxX = osg::maximum(points[edge.a].x(), points[edge.b].x());
+            edge.minY = osg::minimum(points[edge.a].y(), points[edge.b].y());
+            edge.maxY = osg::maximum(points[edge.a].y(), points[edge.b].y());
+            edge.contour = c;
+            edge.position = k;
+            edges.push_back(edge);
+
+            x0 = osg::minimum(x0, edge.minX);
+            y0 = osg::minimum(y0, edge.minY);
+            x1 = osg::maximum(x1, edge.maxX);
+            y1 = osg::maximum(y1, edge.maxY);
+            edgeWidth += edge.maxX-edge.minX;
+            edgeHeight += edge.maxY-edge.minY;
+        }
+    }
+
+    unsigned int numEdges = edges.size();
+    if (numEdges<=32)
+    {
+        for(unsigned int i=0; i<numEdges; ++i)
+        {
+            for(unsigned int j=i+1; j<numEdges; ++j)
+            {
+                if (!edgesCompatible(edges[i], edges[j])) return false;
+            }
+        }
+        return true;
+    }
+
+    // bin the edges into a uniform grid with cells about the size of an edge, and test the pairs sharing a cell.
+    double width = x1-x0;
+    double height = y1-y0;
+    double cellSize = osg::maximum(osg::maximum(edgeWidth, edgeHeight)/double(numEdges), sqrt(width*height/double(numEdges)));
+    if (cellSize<=0.0) return false;
+
+    unsigned int nx = osg::minimum(static_cast<unsigned int>(width/cellSize)+1, numEdges);
+    unsigned int ny = osg::minimum(static_cast<unsigned int>(height/cellSize)+1, numEdges);
+    double invCellX = double(nx)/osg::maximum(width, DBL_MIN);
+    double invCellY = double(ny)/osg::maximum(height, DBL_MIN);
+
+    #define OSGUTIL_EARCLIPPER_CELL(v, minV, invCell, n) osg::minimum(static_cast<unsigned int>(((v)-(minV))*(invCell)), (n)-1)
+
+    cellStarts.assign(nx*ny+1, 0);
+    for(unsigned int e=0; e<numEdges; ++e)
+    {
+        const Edge& edge = edges[e];
+        unsigned int cx0 = OSGUTIL_EARCLIPPER_CELL(edge.minX, x0, invCellX, nx);
+        unsigned int cx1 = OSGUTIL_EARCLIPPER_CELL(edge.maxX, x0, invCellX, nx);
+        unsigned int cy0 = OSGUTIL_EARCLIPPER_CELL(edge.minY, y0, invCellY, ny);
+        unsigned int cy1 = OSGUTIL_EARCLIPPER_CELL(edge.maxY, y0, invCellY, ny);
+        for(unsigned int cy=cy0; cy<=cy1; ++cy)
+        {
+            for(unsigned int cx=cx0; cx<=cx1; ++cx) ++cellStarts[cy*nx+cx+1];
+        }
+    }
+
+    for(unsigned int cell=0; cell<nx*ny; ++cell) cellStarts[cell+1] += cellStarts[cell];
+
+    order.resize(cellStarts[nx*ny]);
+    cellFill.assign(cellStarts.begin(), cellStarts.end()-1);
+    for(unsigned int e=0; e<numEdges; ++e)
+    {
+        const Edge& edge = edges[e];
+        unsigned int cx0 = OSGUTIL_EARCLIPPER_CELL(edge.minX, x0, invCellX, nx);
+        unsigned int cx1 = OSGUTIL_EARCLIPPER_CELL(edge.maxX, x0, invCellX, nx);
+        unsigned int cy0 = OSGUTIL_EARCLIPPER_CELL(edge.minY, y0, invCellY, ny);
+        unsigned int cy1 = OSGUTIL_EARCLIPPER_CELL(edge.maxY, y0, invCellY, ny);
+        for(unsigned int cy=cy0; cy<=cy1; ++cy)
+        {
+            for(unsigned int cx=cx0; cx<=cx1; ++cx) order[cellFill[cy*nx+cx]++] = e;
+        }
+    }
+
+    for(unsigned int cy=0; cy<ny; ++cy)
+    {
+        for(unsigned int cx=0; cx<nx; ++cx)
+        {
+            unsigned int cell = cy*nx+cx;
+            for(unsigned int i=cellStarts[cell]; i<cellStarts[cell+1]; ++i)
+            {
+                const Edge& e1 = edges[order[i]];
+                for(unsigned int j=i+1; j<cellStarts[cell+1]; ++j)
+                {
+                    const Edge& e2 = edges[order[j]];
+
+                    // pairs sharing several cells are only tested in the cell holding the corner of their overlap
+                    if (OSGUTIL_EARCLIPPER_CELL(osg::maximum(e1.minX, e2.minX), x0, invCellX, nx)!=cx ||
+                        OSGUTIL_EARCLIPPER_CELL(osg::maximum(e1.minY, e2.minY), y0, invCellY, ny)!=cy) continue;
+
+                    if (!edgesCompatible(e1, e2)) return false;
+                }
+            }
+        }
+    }
+
+    #undef OSGUTIL_EARCLIPPER_CELL
+
+    return true;
+}
+
+bool Tessellator::EarClipper::classifyContours(bool nonZero)
+{
+    if (contours.size()==1) return true;
+
+    // the contours don't cross, so one vertex tells whether a contour is inside another.
+    // avoid the quadratic cost for large numbers of contours.
+    if (contours.size()*indices.size()>(1u<<22)) return false;
+
+    for(unsigned int c=0; c<contours.size(); ++c)
+    {
+        Contour& contour = contours[c];
+        const osg::Vec2d& p = points[indices[contour.first]];
+        double parentArea = DBL_MAX;
+        for(unsigned int d=0; d<contours.size(); ++d)
+        {
+            if (d==c) continue;
+
+            const Contour& other = contours[d];
+            bool inside = false;
+            for(unsigned int k=0, l=other.count-1; k<other.count; l=k++)
+            {
+                const osg::Vec2d& pk = points[indices[other.first+k]];
+                const osg::Vec2d& pl = points[indices[other.first+l]];
+                if (((pk.y()>p.y())!=(pl.y()>p.y())) &&
+                    (p.x()<(pl.x()-pk.x())*(p.y()-pk.y())/(pl.y()-pk.y())+pk.x())) inside = !inside;
+            }
+
+            if (inside)
+            {
+                ++contour.depth;
+                if (fabs(other.area)<parentArea)
+                {
+                    parentArea = fabs(other.area);
+                    contour.parent = d;
+                }
+            }
+        }
+    }
+
+    // with the non zero rule nested contours must alternate in direction to give the same result as the odd rule.
+    if (nonZero)
+    {
+        for(unsigned int c=0; c<contours.size(); ++c)
+        {
+            unsigned int parent = contours[c].parent;
+            if (parent!=NO_NODE && (contours[c].area>0.0)==(contours[parent].area>0.0)) return false;
+        }
+    }
+
+    return true;
+}
+
+unsigned int Tessellator::EarClipper::createRing(const Contour& contour, bool counterClockwise)
+{
+    unsigned int first = nodes.size();
+    bool forward = (contour.area>0.0)==counterClockwise;
+    for(unsigned int k=0; k<contour.count; ++k)
+    {
+        Node node;
+        node.i = indices[contour.first+(forward ? k : contour.count-1-k)];
+        node.x = points[node.i].x();
+        node.y = points[node.i].y();
+        node.prev = (k==0) ? first+contour.count-1 : first+k-1;
+        node.next = (k+1==contour.count) ? first : first+k+1;
+        node.prevZ = NO_NODE;
+        node.nextZ = NO_NODE;
+        node.z = 0;
+        nodes.push_back(node);
+    }
+    return first;
+}
+
+void Tessellator::EarClipper::removeNode(unsigned int p)
+{
+    Node& node = nodes[p];
+    nodes[node.next].prev = node.prev;
+    nodes[node.prev].next = node.next;
+    if (node.prevZ!=NO_NODE) nodes[node.prevZ].nextZ = node.nextZ;
+    if (node.nextZ!=NO_NODE) nodes[node.nextZ].prevZ = node.prevZ;
+}
+
+unsigned int Tessellator::EarClipper::filterPoints(unsigned int start)
+{
+    // remove repeated and collinear points
+    unsigned int p = start;
+    unsigned int end = start;
+    bool again;
+    do
+    {
+        again = false;
+        if (equals(p, nodes[p].next) || cross(nodes[p].prev, p, nodes[p].next)==0.0)
+        {
+            removeNode(p);
+            p = end = nodes[p].prev;
+            if (p==nodes[p].next) break;
+            again = true;
+        }
+        else
+        {
+            p = nodes[p].next;
+        }
+    } while (again || p!=end);
+
+    return end;
+}
+
+unsigned int Tessellator::EarClipper::splitPolygon(unsigned int a, unsigned int b)
+{
+    // link a to b with a pair of bridge edges, duplicating both ends
+    unsigned int a2 = nodes.size();
+    unsigned int b2 = a2+1;
+    nodes.push_back(nodes[a]);
+    nodes.push_back(nodes[b]);
+
+    unsigned int an = nodes[a].next;
+    unsigned int bp = nodes[b].prev;
+
+    nodes[a].next = b;
+    nodes[b].prev = a;
+
+    nodes[a2].next = an;
+    nodes[an].prev = a2;
+
+    nodes[b2].next = a2;
+    nodes[a2].prev = b2;
+
+    nodes[bp].next = b2;
+    nodes[b2].prev = bp;
+
+    return b2;
+}
+
+unsigned int Tessellator::EarClipper::findHoleBridge(unsigned int hole, unsigned int outerNode)
+{
+    // find the nearest segment of the outer ring to the left of the hole's leftmost point
+    double hx = nodes[hole].x;
+    double hy = nodes[hole].y;
+    double qx = -DBL_MAX;
+    unsigned int m = NO_NODE;
+
+    unsigned int p = outerNode;
+    do
+    {
+        const Node& np = nodes[p];
+        const Node& nn = nodes[np.next];
+        if (hy<=np.y && hy>=nn.y && nn.y!=np.y)
+        {
+            double x = np.x + (hy-np.y)*(nn.x-np.x)/(nn.y-np.y);
+            if (x<=hx && x>qx)
+            {
+                qx = x;
+                m = np.x<nn.x ? p : np.next;
+                if (x==hx) return m;
+            }
+        }
+        p = np.next;
+    } while (p!=outerNode);
+
+    if (m==NO_NODE) return NO_NODE;
+
+    // look for points inside the triangle of the hole point, the segment intersection and the endpoint,
+    // the one with the smallest angle to the ray is the bridge end, otherwise the endpoint is used.
+    unsigned int stop = m;
+    double mx = nodes[m].x;
+    double my = nodes[m].y;
+    double tanMin = DBL_MAX;
+
+    p = m;
+    do
+    {
+        const Node& np = nodes[p];
+        if (hx>=np.x && np.x>=mx && hx!=np.x &&
+            pointInTriangle(hy<my ? hx : qx, hy, mx, my, hy<my ? qx : hx, hy, np.x, np.y))
+        {
+            double tan = fabs(hy-np.y)/(hx-np.x);
+            if (locallyInside(p, hole) &&
+                (tan<tanMin || (tan==tanMin && (np.x>nodes[m].x || (np.x==nodes[m].x && sectorContainsSector(m, p))))))
+            {
+                m = p;
+                tanMin = tan;
+            }
+        }
+        p = np.next;
+    } while (p!=stop);
+
+    return m;
+}
+
+unsigned int Tessellator::EarClipper::zOrder(double x, double y) const
+{
+    unsigned int ix = static_cast<unsigned int>((x-minX)*invSize);
+    unsigned int iy = static_cast<unsigned int>((y-minY)*invSize);
+
+    ix = (ix | (ix << 8)) & 0x00FF00FF;
+    ix = (ix | (ix << 4)) & 0x0F0F0F0F;
+    ix = (ix | (ix << 2)) & 0x33333333;
+    ix = (ix | (ix << 1)) & 0x55555555;
+
+    iy = (iy | (iy << 8)) & 0x00FF00FF;
+    iy = (iy | (iy << 4)) & 0x0F0F0F0F;
+    iy = (iy | (iy << 2)) & 0x33333333;
+    iy = (iy | (iy << 1)) & 0x55555555;
+
+    return ix | (iy << 1);
+}
+
+void Tessellator::EarClipper::indexCurve(unsigned int start)
+{
+    minX = DBL_MAX;
+    minY = DBL_MAX;
+    double maxX = -DBL_MAX;
+    double maxY = -DBL_MAX;
+
+    order.clear();
+    unsigned int p = start;
+    do
+    {
+        const Node& node = nodes[p];
+        minX = osg::minimum(minX, node.x);
+        minY = osg::minimum(minY, node.y);
+        maxX = osg::maximum(maxX, node.x);
+        maxY = osg::maximum(maxY, node.y);
+        order.push_back(p);
+        p = node.next;
+    } while (p!=start);
+
+    double size = osg::maximum(maxX-minX, maxY-minY);
+    invSize = size>0.0 ? 32767.0/size : 0.0;
+
+    for(unsigned int k=0; k<order.size(); ++k)
+    {
+        Node& node = nodes[order[k]];
+        node.z = zOrder(node.x, node.y);
+    }
+
+    std::sort(order.begin(), order.end(), NodeZLess(nodes));
+
+    for(unsigned int k=0; k<order.size(); ++k)
+    {
+        Node& node = nodes[order[k]];
+        node.prevZ = (k>0) ? order[k-1] : NO_NODE;
+        node.nextZ = (k+1<order.size()) ? order[k+1] : NO_NODE;
+    }
+}
+
+bool Tessellator::EarClipper::isEar(unsigned int ear) const
+{
+    unsigned int a = nodes[ear].prev;
+    unsigned int c = nodes[ear].next;
+
+    // reflex or collinear, can't be an ear
+    if (cross(a, ear, c)<=0.0) return false;
+
+    const Node& na = nodes[a];
+    const Node& nb = nodes[ear];
+    const Node& nc = nodes[c];
+
+    double x0 = osg::minimum(na.x, osg::minimum(nb.x, nc.x));
+    double y0 = osg::minimum(na.y, osg::minimum(nb.y, nc.y));
+    double x1 = osg::maximum(na.x, osg::maximum(nb.x, nc.x));
+    double y1 = osg::maximum(na.y, osg::maximum(nb.y, nc.y));
+
+    // make sure no reflex point of the ring is inside the ear
+    unsigned int p = nc.next;
+    while (p!=a)
+    {
+        const Node& np = nodes[p];
+        if (np.x>=x0 && np.x<=x1 && np.y>=y0 && np.y<=y1 &&
+            !(np.x==na.x && np.y==na.y) &&
+            pointInTriangle(na.x, na.y, nb.x, nb.y, nc.x, nc.y, np.x, np.y) &&
+            cross(np.prev, p, np.next)<=0.0) return false;
+        p = np.next;
+    }
+    return true;
+}
+
+bool Tessellator::EarClipper::isEarHashed(unsigned int ear) const
+{
+    unsigned int a = nodes[ear].prev;
+    unsigned int c = nodes[ear].next;
+
+    if (cross(a, ear, c)<=0.0) return false;
+
+    const Node& na = nodes[a];
+    const Node& nb = nodes[ear];
+    const Node& nc = nodes[c];
+
+    double x0 = osg::minimum(na.x, osg::minimum(nb.x, nc.x));
+    double y0 = osg::minimum(na.y, osg::minimum(nb.y, nc.y));
+    double x1 = osg::maximum(na.x, osg::maximum(nb.x, nc.x));
+    double y1 = osg::maximum(na.y, osg::maximum(nb.y, nc.y));
+
+    // only the points within the z range of the ear's bounding box can be inside it
+    unsigned int minZ = zOrder(x0, y0);
+    unsigned int maxZ = zOrder(x1, y1);
+
+    unsigned int p = nb.prevZ;
+    unsigned int n = nb.nextZ;
+
+    #define OSGUTIL_EARCLIPPER_TEST(q) \
+        { \
+            const Node& nq = nodes[q]; \
+            if (q!=a && q!=c && nq.x>=x0 && nq.x<=x1 && nq.y>=y0 && nq.y<=y1 && \
+                !(nq.x==na.x && nq.y==na.y) && \
+                pointInTriangle(na.x, na.y, nb.x, nb.y, nc.x, nc.y, nq.x, nq.y) && \
+                cross(nq.prev, q, nq.next)<=0.0) return false; \
+        }
+
+    while (p!=NO_NODE && nodes[p].z>=minZ && n!=NO_NODE && nodes[n].z<=maxZ)
+    {
+        OSGUTIL_EARCLIPPER_TEST(p)
+        p = nodes[p].prevZ;
+
+        OSGUTIL_EARCLIPPER_TEST(n)
+        n = nodes[n].nextZ;
+    }
+
+    while (p!=NO_NODE && nodes[p].z>=minZ)
+    {
+        OSGUTIL_EARCLIPPER_TEST(p)
+        p = nodes[p].prevZ;
+    }
+
+    while (n!=NO_NODE && nodes[n].z<=maxZ)
+    {
+        OSGUTIL_EARCLIPPER_TEST(n)
+        n = nodes[n].nextZ;
+    }
+
+    #undef OSGUTIL_EARCLIPPER_TEST
+
+    return true;
+}
+
+bool Tessellator::EarClipper::clipEars(unsigned int ear, bool hashed)
+{
+    unsigned int stop = ear;
+    bool filtered = false;
+
+    while (nodes[ear].prev!=nodes[ear].next)
+    {
+        unsigned int prev = nodes[ear].prev;
+        unsigned int next = nodes[ear].next;
+
+        if (hashed ? isEarHashed(ear) : isEar(ear))
+        {
+            triangles.push_back(nodes[prev].i);
+            triangles.push_back(nodes[ear].i);
+            triangles.push_back(nodes[next].i);
+
+            removeNode(ear);
+
+            ear = nodes[next].next;
+            stop = ear;
+            filtered = false;
+            continue;
+        }
+
+        ear = next;
+
+        if (ear==stop)
+        {
+            // no ear left, remove any collinear points and try once more before giving up.
+            if (filtered) return false;
+
+            ear = stop = filterPoints(ear);
+            filtered = true;
+        }
+    }
+    return true;
+}
+
+bool Tessellator::EarClipper::tessellateOuter(unsigned int outer)
+{
+    nodes.clear();
+
+    unsigned int numHoles = 0;
+    unsigned int numNodes = contours[outer].count;
+    for(unsigned int c=0; c<contours.size(); ++c)
+    {
+        if (contours[c].parent==outer)
+        {
+            ++numHoles;
+            numNodes += contours[c].count;
+        }
+    }
+
+    // the bridges add two nodes per hole, reserve so that the nodes never move.
+    nodes.reserve(numNodes+numHoles*2);
+
+    unsigned int outerNode = createRing(contours[outer], true);
+
+    if (numHoles>0)
+    {
+        order.clear();
+        for(unsigned int c=0; c<contours.size(); ++c)
+        {
+            if (contours[c].parent!=outer) continue;
+
+            unsigned int start = createRing(contours[c], false);
+            unsigned int leftmost = start;
+            for(unsigned int p=nodes[start].next; p!=start; p=nodes[p].next)
+            {
+                if (nodes[p].x<nodes[leftmost].x || (nodes[p].x==nodes[leftmost].x && nodes[p].y<nodes[leftmost].y)) leftmost = p;
+            }
+            order.push_back(leftmost);
+        }
+
+        // join the holes from left to right
+        std::sort(order.begin(), order.end(), NodeLeftLess(nodes));
+        for(unsigned int h=0; h<order.size(); ++h)
+        {
+            unsigned int bridge = findHoleBridge(order[h], outerNode);
+            if (bridge==NO_NODE) return false;
+            splitPolygon(bridge, order[h]);
+        }
+    }
+
+    bool hashed = nodes.size()>80;
+    if (hashed) indexCurve(outerNode);
+
+    return clipEars(outerNode, hashed);
+}
+
 
 Tessellator::Tessellator() :
     _wtype(TESS_WINDING_ODD),
     _ttype(TESS_TYPE_POLYGONS),
     _boundaryOnly(false),
     _numberVerts(0),
-    _extraPrimitives(0)
+    _extraPrimitives(0),
+    _fastTessellation(false),
+    _earClipper(0),
+    _collectContours(false)
 {
     _tobj = gluNewTess();
     if (_tobj)
@@ -48,12 +961,30 @@ Tessellator::~Tessellator()
     {
         gluDeleteTess(_tobj);
     }
+    delete _earClipper;
 }
 
 void Tessellator::beginTessellation()
 {
     reset();
 
+    // the fast path gives the same result as glu for the odd and non zero rules,
+    // the other rules depend on the orientation glu picks for the contours.
+    _collectContours = _fastTessellation && !_boundaryOnly &&
+                       (_wtype==TESS_WINDING_ODD || _wtype==TESS_WINDING_NONZERO);
+
+    if (_collectContours)
+    {
+        if (!_earClipper) _earClipper = new EarClipper;
+        _earClipper->clear();
+        return;
+    }
+
+    beginGLUTessellation();
+}
+
+void Tessellator::beginGLUTessellation()
+{
     if (_tobj)
     {
         gluTessProperty(_tobj, GLU_TESS_WINDING_RULE, _wtype);
@@ -67,6 +998,12 @@ void Tessellator::beginTessellation()
 
 void Tessellator::beginContour()
 {
+    if (_collectContours)
+    {
+        _earClipper->beginContour();
+        return;
+    }
+
     if (_tobj)
     {
         gluTessBeginContour(_tobj);
@@ -79,12 +1016,8 @@ void Tessellator::addVertex(osg::Vec3* vertex)
     {
         if (vertex && vertex->valid())
         {
-            Vec3d* data = new Vec3d;
-            _coordData.push_back(data);
-            (*data)._v[0]=(*vertex)[0];
-            (*data)._v[1]=(*vertex)[1];
-            (*data)._v[2]=(*vertex)[2];
-            gluTessVertex(_tobj,data->_v,vertex);
+            if (_collectContours) _earClipper->addVertex(vertex);
+            else addGLUVertex(vertex);
         }
         else
         {
@@ -99,8 +1032,20 @@ void Tessellator::addVertex(osg::Vec3* vertex)
     }
 }
 
+void Tessellator::addGLUVertex(osg::Vec3* vertex)
+{
+    Vec3d* data = new Vec3d;
+    _coordData.push_back(data);
+    (*data)._v[0]=(*vertex)[0];
+    (*data)._v[1]=(*vertex)[1];
+    (*data)._v[2]=(*vertex)[2];
+    gluTessVertex(_tobj,data->_v,vertex);
+}
+
 void Tessellator::endContour()
 {
+    if (_collectContours) return;
+
     if (_tobj)
     {
         gluTessEndContour(_tobj);
@@ -109,6 +1054,41 @@ void Tessellator::endContour()
 
 void Tessellator::endTessellation()
 {
+    if (_collectContours)
+    {
+        _collectContours = false;
+
+        EarClipper& earClipper = *_earClipper;
+        if (earClipper.tessellate(tessNormal, _wtype==TESS_WINDING_NONZERO))
+        {
+            if (!earClipper.triangles.empty())
+            {
+                Prim* prim = new Prim(GL_TRIANGLES);
+                prim->_vertices.reserve(earClipper.triangles.size());
+                for(unsigned int t=0; t<earClipper.triangles.size(); ++t)
+                {
+                    prim->_vertices.push_back(earClipper.vertices[earClipper.triangles[t]]);
+                }
+                _primList.push_back(prim);
+            }
+            return;
+        }
+
+        // the contours need the full tessellator, pass them on to glu.
+        if (!_tobj) return;
+
+        beginGLUTessellation();
+        for(unsigned int c=0; c+1<earClipper.contourStarts.size(); ++c)
+        {
+            gluTessBeginContour(_tobj);
+            for(unsigned int i=earClipper.contourStarts[c]; i<earClipper.contourStarts[c+1]; ++i)
+            {
+                addGLUVertex(earClipper.vertices[i]);
+            }
+            gluTessEndContour(_tobj);
+        }
+    }
+
     if (_tobj)
     {
         gluTessEndPolygon(_tobj);
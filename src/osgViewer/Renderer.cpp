@@ -617,6 +617,23 @@ void Renderer::compile()
     sceneView->getState()->checkGLErrors("After Renderer::compile");
 }
 
+static unsigned int getNumCullAllocations(osgUtil::SceneView* sceneView)
+{
+    // stereo modes that draw both eyes cull each eye with its own CullVisitor, see SceneView::cull().
+    const osg::DisplaySettings* ds = sceneView->getDisplaySettings();
+    if (ds && ds->getStereo() &&
+        ds->getStereoMode()!=osg::DisplaySettings::LEFT_EYE &&
+        ds->getStereoMode()!=osg::DisplaySettings::RIGHT_EYE)
+    {
+        unsigned int numAllocations = 0;
+        if (sceneView->getCullVisitorLeft()) numAllocations += sceneView->getCullVisitorLeft()->getNumAllocations();
+        if (sceneView->getCullVisitorRight()) numAllocations += sceneView->getCullVisitorRight()->getNumAllocations();
+        return numAllocations;
+    }
+
+    return sceneView->getCullVisitor() ? sceneView->getCullVisitor()->getNumAllocations() : 0;
+}
+
 static void collectSceneViewStats(unsigned int frameNumber, osgUtil::SceneView* sceneView, osg::Stats* stats)
 {
     osgUtil::Statistics sceneStats;
@@ -631,6 +648,7 @@ static void collectSceneViewStats(unsigned int frameNumber, osgUtil::SceneView*
     stats->setAttribute(frameNumber, "Number of StateGraphs", static_cast<double>(sceneStats.numStateGraphs));
     stats->setAttribute(frameNumber, "Visible number of impostors", static_cast<double>(sceneStats.nimpostor));
     stats->setAttribute(frameNumber, "Number of ordered leaves", static_cast<double>(sceneStats.numOrderedLeaves));
+    stats->setAttribute(frameNumber, "Number of cull allocations", static_cast<double>(getNumCullAllocations(sceneView)));
 
     unsigned int totalNumPrimitiveSets = 0;
     const osgUtil::Statistics::PrimitiveValueMap& pvm = sceneStats.getPrimitiveValueMap();
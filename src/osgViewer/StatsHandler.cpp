@@ -601,6 +601,7 @@ struct CameraSceneStatsTextDrawCallback : public virtual osg::Drawable::DrawCall
                 STATS_ATTRIBUTE("Visible number of render bins")
                 STATS_ATTRIBUTE("Visible depth")
                 STATS_ATTRIBUTE("Number of StateGraphs")
+                STATS_ATTRIBUTE("Number of cull allocations")
                 STATS_ATTRIBUTE("Visible number of impostors")
                 STATS_ATTRIBUTE("Visible number of drawables")
                 STATS_ATTRIBUTE("Number of ordered leaves")
@@ -1598,7 +1599,7 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase* viewer)
         group->addChild(geode);
         geode->addDrawable(createBackgroundRectangle(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0),
                                                         10 * _characterSize + 2 * backgroundMargin,
-                                                        22 * _characterSize + 2 * backgroundMargin,
+                                                        23 * _characterSize + 2 * backgroundMargin,
                                                         backgroundColor));
 
         // Camera scene & primitive stats static text
@@ -1619,6 +1620,7 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase* viewer)
         viewStr << "Bins" << std::endl;
         viewStr << "Depth" << std::endl;
         viewStr << "State graphs" << std::endl;
+        viewStr << "Cull allocs" << std::endl;
         viewStr << "Imposters" << std::endl;
         viewStr << "Drawables" << std::endl;
         viewStr << "Sorted Drawables" << std::endl;
@@ -1647,7 +1649,7 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase* viewer)
         {
             geode->addDrawable(createBackgroundRectangle(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0),
                                                             5 * _characterSize + 2 * backgroundMargin,
-                                                            22 * _characterSize + 2 * backgroundMargin,
+                                                            23 * _characterSize + 2 * backgroundMargin,
                                                             backgroundColor));
 
             // Camera scene stats